@@ -8,6 +8,8 @@
 #undef  DAEDALUS_ENABLE_DYNAREC					// Define this is dynarec is supported on the platform
 #undef  DAEDALUS_ENABLE_OS_HOOKS				// Define this to enable OS HLE
 #undef  DAEDALUS_BREAKPOINTS_ENABLED			// Define this to enable breakpoint support
+#undef  DAEDALUS_ENABLE_REWIND					// Define this to keep in-memory snapshots for rewinding (needs spare memory)
+#undef  DAEDALUS_BATCH_TEST_WORKERS				// Define this if the batch tester can run roms in forked worker processes
 #undef	DAEDALUS_ENDIAN_MODE					// Define this to specify whether the platform is big or little endian
 
 // DAEDALUS_ENDIAN_MODE should be defined as one of:
@@ -37,6 +39,11 @@
 #define DAEDALUS_THREAD_CALL_TYPE
 #endif
 
+// Storage class for thread-local variables
+#ifndef DAEDALUS_THREAD_LOCAL
+#define DAEDALUS_THREAD_LOCAL __thread
+#endif
+
 // Calling convention for vararg functions
 #ifndef DAEDALUS_VARARG_CALL_TYPE
 #define DAEDALUS_VARARG_CALL_TYPE
@@ -42,6 +42,13 @@ bool	gVideoRateMatch				= false;	// Matches VI rate with framerate
 bool	gFogEnabled					= false;	// Enable fog
 bool    gMemoryAccessOptimisation   = false;    // Enable the memory access optmisation
 bool	gCheatsEnabled				= false;	// Enable cheat codes
+bool	gHeadlessMode				= false;	// Run without a visible window, audio output or framerate limiting
 u32		gControllerIndex			= 0;		// Which controller config to set
+u32		gInternalResolutionScale	= 0;		// Render at this multiple of the N64 resolution (0 to render at the window's resolution)
+u32		gInternalResolutionSamples	= 0;		// MSAA samples for the internal render targets (0 to disable)
+bool	gTnLCacheEnabled			= true;		// Reuse the transformed output of vertex loads which repeat from frame to frame
+u32		gTexelCacheSizeMB			= 0;		// Keep converted textures on disk between sessions, up to this many MB (0 to disable)
+u32		gTexturePackBudgetMB		= 256;		// Keep up to this many MB of decoded hi-res replacements in memory (0 to disable texture packs)
+bool	gTexturePackDump			= false;	// Dump each texture as a png named by its texture pack hash
 
 DaedalusConfig g_DaedalusConfig;
@@ -47,10 +47,17 @@ extern bool gVideoRateMatch;
 extern bool gFogEnabled;
 extern bool gMemoryAccessOptimisation;
 extern bool gCheatsEnabled;
+extern bool gHeadlessMode;				// No visible window, audio output or framerate limiting (for benchmarking)
 //ToDo: Needs moving to Graphics plugin config
 extern bool	gCleanSceneEnabled;
 extern bool	gClearDepthFrameBuffer;
 extern u32	gCheckTextureHashFrequency;
+extern u32	gInternalResolutionScale;		// Multiple of the N64 resolution to render at, 0 for the window's resolution
+extern u32	gInternalResolutionSamples;		// MSAA samples for the internal render targets
+extern bool	gTnLCacheEnabled;				// Reuse the transformed output of repeated vertex loads
+extern u32	gTexelCacheSizeMB;				// Size limit of the on-disk texel cache (0 to disable)
+extern u32	gTexturePackBudgetMB;			// Memory for decoded texture pack images (0 to disable texture packs)
+extern bool	gTexturePackDump;				// Write out textures named for texture pack replacement
 //ToDo: Needs moving to Input plugin config
 extern u32	gControllerIndex;
 
@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Cheats.h"
 #include "Dynamo.h"
+#include "GuestProfiler.h"
 #include "Interpret.h"
 #include "Interrupt.h"
 #include "Memory.h"
@@ -89,11 +90,16 @@ enum ESaveStateOperation
 };
 
 static ESaveStateOperation		gSaveStateOperation = SSO_NONE;
+static ESaveStateFormat			gSaveStateFormat = SSF_DAEDALUS;
 
 const  u32			kInitialVIInterruptCycles = 62500;
 static u32			gVerticalInterrupts = 0;
 static u32			VI_INTR_CYCLES = kInitialVIInterruptCycles;
 
+// Idle loop stats for the current rom
+static u32			gIdleLoopSkips = 0;
+static u64			gIdleLoopCyclesSkipped = 0;
+
 #ifdef USE_SCRATCH_PAD
 SCPUState *gPtrCPUState = (SCPUState*)0x10000;
 #else
@@ -136,6 +142,12 @@ void CPU_SkipToNextEvent()
 	LOCK_EVENT_QUEUE();
 
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "There are no events" );
+	s32 skipped( gCPUState.Events[ 0 ].mCount - 1 );
+	if( skipped > 0 )
+	{
+		gIdleLoopSkips++;
+		gIdleLoopCyclesSkipped += skipped;
+	}
 	gCPUState.CPUControl[C0_COUNT]._u32 += (gCPUState.Events[ 0 ].mCount - 1);
 	gCPUState.Events[ 0 ].mCount = 1;
 }
@@ -241,6 +253,11 @@ static ECPUEventType CPU_PopEvent()
 	return event_type;
 }
 
+u32 CPU_GetVerticalInterruptCount()
+{
+	return gVerticalInterrupts;
+}
+
 // XXXX This is for savestate. Looks very suspicious to me
 u32 CPU_GetVideoInterruptEventCount()
 {
@@ -333,6 +350,9 @@ bool CPU_RomOpen()
 	gCPUStopOnSimpleState = false;
 	RESET_EVENT_QUEUE_LOCK();
 
+	gIdleLoopSkips = 0;
+	gIdleLoopCyclesSkipped = 0;
+
 	memset(&gCPUState, 0, sizeof(gCPUState));
 
 	CPU_SetPC( 0xbfc00000 );
@@ -388,6 +408,13 @@ bool CPU_RomOpen()
 
 void CPU_RomClose()
 {
+	u64 total_cycles( u64( gVerticalInterrupts ) * VI_INTR_CYCLES );
+	if( total_cycles > 0 )
+	{
+		DBGConsole_Msg( 0, "Idle loops: skipped %d times, %llu cycles (%.1f%%)",
+			gIdleLoopSkips, gIdleLoopCyclesSkipped, 100.0f * f32( gIdleLoopCyclesSkipped ) / f32( total_cycles ) );
+	}
+
 #ifdef DAEDALUS_ENABLE_DYNAREC
 	#ifdef DAEDALUS_DEBUG_DYNAREC
 		//This will dump the fragment cache on exit to ROMs menu
@@ -422,7 +449,7 @@ void CPU_SelectCore()
 	}
 }
 
-bool CPU_RequestSaveState( const char * filename )
+bool CPU_RequestSaveState( const char * filename, ESaveStateFormat format )
 {
 	// Call SaveState_SaveToFile directly if the CPU is not running.
 	DAEDALUS_ASSERT(gCPURunning, "Expecting the CPU to be running at this point");
@@ -437,6 +464,7 @@ bool CPU_RequestSaveState( const char * filename )
 
 	gSaveStateOperation = SSO_SAVE;
 	gSaveStateFilename = filename;
+	gSaveStateFormat = format;
 	gCPUState.AddJob(CPU_CHANGE_CORE);
 
 	return true;
@@ -481,7 +509,7 @@ static void HandleSaveStateOperationOnVerticalBlank()
 		break;
 	case SSO_SAVE:
 		DBGConsole_Msg(0, "Saving '%s'\n", gSaveStateFilename.c_str());
-		SaveState_SaveToFile( gSaveStateFilename.c_str() );
+		SaveState_SaveToFile( gSaveStateFilename.c_str(), gSaveStateFormat );
 		gSaveStateOperation = SSO_NONE;
 		break;
 	case SSO_LOAD:
@@ -554,6 +582,9 @@ bool CPU_Run()
 			break;
 	}
 
+	// Make sure any savestate being written in the background hits the disk.
+	SaveState_Flush();
+
 	DAEDALUS_ASSERT(!gCPURunning, "gCPURunning should be false by now.");
 
 	return true;
@@ -708,6 +739,9 @@ void CPU_HANDLE_COUNT_INTERRUPT()
 		Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SP);
 		R4300_Interrupt_UpdateCause3();
 		break;
+	case CPU_EVENT_PROFILE_SAMPLE:
+		GuestProfiler_Sample();
+		break;
 	default:
 		NODEFAULT;
 	}
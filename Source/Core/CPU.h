@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "R4300Instruction.h"
 #include "R4300OpCode.h"
 #include "Memory.h"
+#include "SaveState.h"
 #include "TLB.h"
 #include "Utility/SpinLock.h"
 
@@ -73,10 +74,11 @@ enum	ECPUEventType
 	CPU_EVENT_COMPARE,
 	CPU_EVENT_AUDIO,
 	CPU_EVENT_SPINT,
+	CPU_EVENT_PROFILE_SAMPLE,
 };
 
-// In practice there should only ever be 2
-#define MAX_CPU_EVENTS 4
+// In practice there should only ever be 2 (plus one for the guest profiler)
+#define MAX_CPU_EVENTS 5
 
 struct CPUEvent
 {
@@ -157,11 +159,12 @@ void	CPU_RomClose();
 void	CPU_Step();
 void	CPU_Skip();
 bool	CPU_Run();
-bool	CPU_RequestSaveState( const char * filename );
+bool	CPU_RequestSaveState( const char * filename, ESaveStateFormat format = SSF_DAEDALUS );
 bool	CPU_RequestLoadState( const char * filename );
 void	CPU_Halt( const char * reason );
 void	CPU_SelectCore();
 u32		CPU_GetVideoInterruptEventCount();
+u32		CPU_GetVerticalInterruptCount();
 void	CPU_SetVideoInterruptEventCount( u32 count );
 void	CPU_DynarecEnable();
 void	R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length );
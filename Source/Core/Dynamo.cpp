@@ -432,6 +432,33 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 			gFragmentLookupSuccess++;
 		#endif
 
+#ifdef DAEDALUS_ENABLE_OS_HOOKS
+			// If the trace just called a HLE'd OS function, call it from the trace and keep recording at the return address
+			if( gTraceRecorder.IsTraceActive() && p_fragment->GetNativeFunction() != NULL && gTraceRecorder.CanInlineNativeCall( entry_address ) )
+			{
+				u32		return_address( gGPR[REG_ra]._u32_0 );
+
+				p_fragment->Execute();
+
+				DYNAREC_PROFILE_ENTEREXIT( entry_address, gCPUState.CurrentPC, gCPUState.CPUControl[C0_COUNT]._u32 - entry_count );
+
+				if( gCPUState.CurrentPC == return_address && gCPUState.Delay == NO_DELAY && gCPUState.GetStuffToDo() == 0 )
+				{
+					gTraceRecorder.InlineNativeCall( p_fragment->GetNativeFunction() );
+				}
+				else
+				{
+					gTraceRecorder.StopTrace( entry_address );
+					CPU_CreateAndAddFragment();
+
+					change_core = true;
+				}
+
+				start_of_trace = true;
+				continue;
+			}
+#endif
+
 		// Check if another trace is active and we're about to enter
 			if( gTraceRecorder.IsTraceActive() )
 			{
@@ -0,0 +1,399 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "GuestProfiler.h"
+
+#include "Core/CPU.h"
+#include "Core/Memory.h"
+#include "Core/R4300OpCode.h"
+#include "Core/N64Reg.h"
+
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
+
+#include "OSHLE/patch.h"
+
+#include "Utility/IO.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+	bool							sRunning = false;
+	bool							sEventPending = false;
+	u32								sInterval = kDefaultGuestProfileInterval;
+	u32								sNumSamples = 0;
+	std::map< u32, u32 >			sPCSamples;			// pc -> count
+	std::map< u64, u32 >			sCallSamples;		// (ra << 32) | pc -> count
+
+	// Don't scan back further than this looking for a function prologue.
+	const u32						kMaxFunctionScan = 0x1000;
+
+	struct SFunctionTotal
+	{
+		SFunctionTotal()
+			:	Address( 0 )
+			,	Samples( 0 )
+			,	IsOS( false )
+			,	Name( NULL )
+		{
+		}
+
+		u32				Address;
+		u32				Samples;
+		bool			IsOS;
+		const char *	Name;
+	};
+
+	struct SortBySamples
+	{
+		bool	operator()( const SFunctionTotal & a, const SFunctionTotal & b ) const
+		{
+			return a.Samples > b.Samples;
+		}
+	};
+
+	// Only handles unmapped (KSEG0/1) code - we don't want to touch the TLB from here.
+	bool ReadOp( u32 address, OpCode * op_code )
+	{
+		if( address < 0x80000000 || address >= 0xC0000000 )
+			return false;
+
+		u32 physical( address & 0x1FFFFFFF );
+		if( physical >= gRamSize )
+			return false;
+
+		op_code->_u32 = g_pu32RamBase[ physical >> 2 ];
+		return true;
+	}
+
+	bool IsBranchToSelf( u32 address )
+	{
+		OpCode	op_code;
+		if( !ReadOp( address, &op_code ) )
+			return false;
+
+		u32		target;
+		switch( op_code.op )
+		{
+		case OP_J:
+			target = ( address & 0xF0000000 ) | ( op_code.target << 2 );
+			break;
+		case OP_BEQ:
+		case OP_BNE:
+		case OP_BLEZ:
+		case OP_BGTZ:
+		case OP_BEQL:
+		case OP_BNEL:
+			target = address + 4 + ( s32( s16( op_code.immediate ) ) << 2 );
+			break;
+		default:
+			return false;
+		}
+
+		// Allow a couple of ops in the loop body (e.g. polling a register).
+		return target <= address && target + 8 >= address;
+	}
+
+	// A sample is idle if the PC sits on (or in the delay slot of) a tight backwards branch.
+	bool IsIdleSample( u32 pc )
+	{
+		return IsBranchToSelf( pc ) || IsBranchToSelf( pc - 4 );
+	}
+
+	u32 FindFunctionStart( u32 pc )
+	{
+		for( u32 offset = 0; offset < kMaxFunctionScan; offset += 4 )
+		{
+			u32		address( pc - offset );
+			OpCode	op_code;
+			if( !ReadOp( address, &op_code ) )
+				break;
+
+			// addiu sp, sp, -n
+			if( op_code.op == OP_ADDIU && op_code.rs == N64Reg_SP && op_code.rt == N64Reg_SP && s16( op_code.immediate ) < 0 )
+				return address;
+
+			// jr ra (+ delay slot) ends the previous function - this catches leaf functions.
+			if( offset >= 8 && op_code.op == OP_SPECOP && op_code.spec_op == SpecOp_JR && op_code.rs == N64Reg_RA )
+				return address + 8;
+		}
+		return pc;
+	}
+
+#ifdef DAEDALUS_ENABLE_OS_HOOKS
+	const PatchSymbol * FindOSSymbol( u32 pc )
+	{
+		if( pc < 0x80000000 || pc >= 0xC0000000 )
+			return NULL;
+
+		u32 physical( pc & 0x1FFFFFFF );
+		for( u32 i = 0; g_PatchSymbols[ i ] != NULL; ++i )
+		{
+			const PatchSymbol * symbol( g_PatchSymbols[ i ] );
+			if( !symbol->Found || physical < symbol->Location )
+				continue;
+
+			u32 num_ops( 0 );
+			for( u32 s = 0; symbol->Signatures[ s ].NumOps != 0; ++s )
+			{
+				num_ops = std::max( num_ops, symbol->Signatures[ s ].NumOps );
+			}
+
+			if( physical < symbol->Location + num_ops * 4 )
+				return symbol;
+		}
+		return NULL;
+	}
+#endif
+
+	SFunctionTotal ResolveFunction( u32 pc )
+	{
+		SFunctionTotal	function;
+
+#ifdef DAEDALUS_ENABLE_OS_HOOKS
+		if( const PatchSymbol * symbol = FindOSSymbol( pc ) )
+		{
+			function.Address = ( pc & 0xE0000000 ) | symbol->Location;
+			function.IsOS = true;
+			function.Name = symbol->Name;
+			return function;
+		}
+#endif
+
+		function.Address = FindFunctionStart( pc );
+		return function;
+	}
+
+	void FormatFunction( char ( &out )[ 64 ], const SFunctionTotal & function )
+	{
+		if( function.Name != NULL )
+		{
+			snprintf( out, sizeof( out ), "%s", function.Name );
+		}
+		else
+		{
+			snprintf( out, sizeof( out ), "func_%08x", function.Address );
+		}
+	}
+
+	void Clear()
+	{
+		sNumSamples = 0;
+		sPCSamples.clear();
+		sCallSamples.clear();
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool GuestProfiler_RomOpen()
+{
+	Clear();
+
+	// The event queue is reset with the cpu.
+	sRunning = false;
+	sEventPending = false;
+	return true;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void GuestProfiler_RomClose()
+{
+	if( sNumSamples > 0 )
+	{
+		GuestProfiler_WriteReport( stdout, 30 );
+
+		IO::Filename dir;
+		Dump_GetDumpDirectory( dir, "" );
+		IO::Filename filename;
+		IO::Path::Combine( filename, dir, "guest_profile.txt" );
+		if( FILE * fh = fopen( filename, "w" ) )
+		{
+			GuestProfiler_WriteReport( fh, 500 );
+			fclose( fh );
+		}
+	}
+
+	sRunning = false;
+	Clear();
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void GuestProfiler_Start( u32 sample_interval )
+{
+	DAEDALUS_ASSERT( sample_interval > 0, "Invalid sample interval" );
+
+	Clear();
+	sInterval = sample_interval;
+	sRunning = true;
+
+	if( !sEventPending )
+	{
+		sEventPending = true;
+		CPU_AddEvent( sInterval, CPU_EVENT_PROFILE_SAMPLE );
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void GuestProfiler_Stop()
+{
+	// Any pending event is left to expire - Sample() won't reschedule it.
+	sRunning = false;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool GuestProfiler_IsRunning()
+{
+	return sRunning;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void GuestProfiler_Sample()
+{
+	sEventPending = false;
+	if( !sRunning )
+		return;
+
+	u32 pc( gCPUState.CurrentPC );
+	u32 ra( gGPR[ N64Reg_RA ]._u32_0 );
+
+	sPCSamples[ pc ]++;
+	sCallSamples[ ( u64( ra ) << 32 ) | pc ]++;
+	sNumSamples++;
+
+	sEventPending = true;
+	CPU_AddEvent( sInterval, CPU_EVENT_PROFILE_SAMPLE );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void GuestProfiler_WriteReport( FILE * fh, u32 max_entries )
+{
+	if( sNumSamples == 0 )
+	{
+		fprintf( fh, "Guest profile: no samples\n" );
+		return;
+	}
+
+	// Resolve each distinct pc once.
+	std::map< u32, SFunctionTotal >		pc_functions;
+	std::map< u32, SFunctionTotal >		functions;
+	u32									idle_samples( 0 );
+	for( std::map< u32, u32 >::const_iterator it = sPCSamples.begin(); it != sPCSamples.end(); ++it )
+	{
+		SFunctionTotal function( ResolveFunction( it->first ) );
+		pc_functions[ it->first ] = function;
+
+		if( IsIdleSample( it->first ) )
+		{
+			idle_samples += it->second;
+		}
+
+		SFunctionTotal & total( functions[ function.Address ] );
+		total.Address = function.Address;
+		total.IsOS = function.IsOS;
+		total.Name = function.Name;
+		total.Samples += it->second;
+	}
+
+	std::vector< SFunctionTotal >	sorted;
+	u32								os_samples( 0 );
+	for( std::map< u32, SFunctionTotal >::const_iterator it = functions.begin(); it != functions.end(); ++it )
+	{
+		sorted.push_back( it->second );
+		if( it->second.IsOS )
+		{
+			os_samples += it->second.Samples;
+		}
+	}
+	std::sort( sorted.begin(), sorted.end(), SortBySamples() );
+
+	f32 scale( 100.0f / f32( sNumSamples ) );
+	fprintf( fh, "Guest profile: %d samples every %d cycles\n", sNumSamples, sInterval );
+	fprintf( fh, "  Idle loops: %5.1f%%\n", f32( idle_samples ) * scale );
+	fprintf( fh, "  OS:         %5.1f%%\n", f32( os_samples ) * scale );
+	fprintf( fh, "  Game:       %5.1f%%\n", f32( sNumSamples - os_samples ) * scale );
+	fprintf( fh, "\n" );
+
+	fprintf( fh, "  Samples      %%  Function\n" );
+	for( u32 i = 0; i < sorted.size() && i < max_entries; ++i )
+	{
+		char name[ 64 ];
+		FormatFunction( name, sorted[ i ] );
+		fprintf( fh, "  %7d %5.1f%%  %s%s\n", sorted[ i ].Samples, f32( sorted[ i ].Samples ) * scale, name, sorted[ i ].IsOS ? " (os)" : "" );
+	}
+
+	//
+	//	Call graph. ra points past the delay slot of the jal, so the call is at ra-8.
+	//	This is only accurate for leaf functions, or before ra is reused in the callee.
+	//
+	typedef std::map< u32, u32 >	CallerMap;
+	std::map< u32, CallerMap >		callers;		// callee function -> caller function -> count
+	std::map< u32, SFunctionTotal >	caller_functions;
+	for( std::map< u64, u32 >::const_iterator it = sCallSamples.begin(); it != sCallSamples.end(); ++it )
+	{
+		u32 pc( u32( it->first ) );
+		u32 ra( u32( it->first >> 32 ) );
+
+		SFunctionTotal caller( ResolveFunction( ra - 8 ) );
+		caller_functions[ caller.Address ] = caller;
+		callers[ pc_functions[ pc ].Address ][ caller.Address ] += it->second;
+	}
+
+	fprintf( fh, "\n  Callers\n" );
+	for( u32 i = 0; i < sorted.size() && i < max_entries; ++i )
+	{
+		char name[ 64 ];
+		FormatFunction( name, sorted[ i ] );
+		fprintf( fh, "  %s\n", name );
+
+		const CallerMap & caller_map( callers[ sorted[ i ].Address ] );
+		std::vector< SFunctionTotal > caller_list;
+		for( CallerMap::const_iterator it = caller_map.begin(); it != caller_map.end(); ++it )
+		{
+			SFunctionTotal caller( caller_functions[ it->first ] );
+			caller.Samples = it->second;
+			caller_list.push_back( caller );
+		}
+		std::sort( caller_list.begin(), caller_list.end(), SortBySamples() );
+
+		for( u32 c = 0; c < caller_list.size() && c < 4; ++c )
+		{
+			FormatFunction( name, caller_list[ c ] );
+			fprintf( fh, "    %7d %5.1f%%  <- %s\n", caller_list[ c ].Samples, f32( caller_list[ c ].Samples ) * scale, name );
+		}
+	}
+}
@@ -0,0 +1,53 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#pragma once
+
+#ifndef CORE_GUESTPROFILER_H_
+#define CORE_GUESTPROFILER_H_
+
+#include <stdio.h>
+
+//
+//	Samples the emulated PC (and ra, for a call graph) every N COUNT cycles,
+//	using a CPU event. The report attributes samples to OS functions located
+//	by the patch scanner, tight idle loops, and game functions (found by
+//	scanning back for the stack frame setup).
+//
+//	Under the dynarec, events are only processed at fragment exits, so PCs
+//	are biased towards branch targets.
+//
+
+static const u32 kDefaultGuestProfileInterval = 10000;
+
+bool	GuestProfiler_RomOpen();
+void	GuestProfiler_RomClose();
+
+// These must be called from the CPU thread (e.g. from a VBL callback).
+void	GuestProfiler_Start( u32 sample_interval = kDefaultGuestProfileInterval );
+void	GuestProfiler_Stop();
+bool	GuestProfiler_IsRunning();
+
+// Called from the CPU_EVENT_PROFILE_SAMPLE handler.
+void	GuestProfiler_Sample();
+
+void	GuestProfiler_WriteReport( FILE * fh, u32 max_entries );
+
+#endif // CORE_GUESTPROFILER_H_
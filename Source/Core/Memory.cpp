@@ -327,6 +327,56 @@ static void Memory_InitFunc(u32 start, u32 size, const u32 ReadRegion, const u32
 	}
 }
 
+static MemoryReadWatchCallback	gReadWatchCallback = NULL;
+
+static void * ReadWatchedRDRAM( u32 address )
+{
+	// Restore the fast path first - the callback may read RDRAM itself
+	u32 page = (address & 0x1FFFFFFF) >> 18;
+	for (u32 segment = 0x8000; segment <= 0xA000; segment += 0x2000)
+	{
+		MemFuncRead & m( g_MemoryLookupTableRead[page|(segment>>2)] );
+		m.pRead    = (u8*)(reinterpret_cast< u32 >(g_pMemoryBuffers[MEM_RD_RAM]) - (segment << 16));
+		m.ReadFunc = Read_8000_807F;
+	}
+
+	if (gReadWatchCallback != NULL)
+	{
+		gReadWatchCallback( address & 0x1FFFFFFF );
+	}
+
+	return Read_8000_807F( address );
+}
+
+void Memory_SetRDRAMReadWatchCallback( MemoryReadWatchCallback callback )
+{
+	gReadWatchCallback = callback;
+}
+
+void Memory_WatchRDRAMReads( u32 address, u32 length )
+{
+	if (length == 0)
+		return;
+
+	u32 start_page = (address & 0x1FFFFFFF) >> 18;
+	u32 end_page   = ((address & 0x1FFFFFFF) + length - 1) >> 18;
+
+	for (u32 page = start_page; page <= end_page && page < (MAX_RAM_ADDRESS >> 18); ++page)
+	{
+		for (u32 segment = 0x8000; segment <= 0xA000; segment += 0x2000)
+		{
+			MemFuncRead & m( g_MemoryLookupTableRead[page|(segment>>2)] );
+
+			// Leave pages that aren't plain RDRAM (e.g. EPAK disabled) alone
+			if (m.ReadFunc == Read_8000_807F || m.ReadFunc == ReadWatchedRDRAM)
+			{
+				m.pRead    = NULL;
+				m.ReadFunc = ReadWatchedRDRAM;
+			}
+		}
+	}
+}
+
 void Memory_InitTables()
 {
 	memset(g_MemoryLookupTableRead, 0, sizeof(MemFuncRead) * 0x4000);
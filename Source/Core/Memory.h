@@ -128,6 +128,13 @@ inline void WriteAddress( u32 address, u32 value )
 bool Memory_GetInternalReadAddress(u32 address, void ** p_translated);
 #endif
 
+// Trap the next CPU read from a range of RDRAM. The callback fires once per 256KB
+// page, before the read completes, so it can write back data still held elsewhere
+// (e.g. a colour image rendered on the GPU). Watches are cleared by Memory_Reset.
+typedef void (*MemoryReadWatchCallback)( u32 address );
+void Memory_SetRDRAMReadWatchCallback( MemoryReadWatchCallback callback );
+void Memory_WatchRDRAMReads( u32 address, u32 length );
+
 
 //////////////////////////////////////////////////////////////
 // Quick Read/Write methods that require a base returned by
@@ -98,6 +98,7 @@ area assignment does not change. After Tx/RxData assignment, this flag is reset
 
 #include "Debug/DBGConsole.h"
 #include "Input/InputManager.h"
+#include "Input/InputMovie.h"
 
 #include "OSHLE/ultra_os.h"
 
@@ -345,6 +346,7 @@ void IController::Process()
 
 	// Read controller data here (here gets called fewer times than CONT_READ_CONTROLLER)
 	CInputManager::Get()->GetState( mContPads );
+	InputMovie_Process( mContPads );
 
 	while(count < 64)
 	{
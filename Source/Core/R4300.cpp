@@ -28,6 +28,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/Registers.h"			// For REG_?? defines
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
+#include "DynaRec/StaticAnalysis.h"
 #include "DynaRec/TraceRecorder.h"
 #include "Math/Math.h"	// VFPU Math
 #include "OSHLE/ultra_R4300.h"
@@ -198,45 +199,75 @@ typedef f64 d64;
 #endif
 
 
+#ifdef SPEEDHACK_INTERPRETER
+namespace
+{
+	// Analysing a loop is too slow to do every iteration, so cache the result per branch.
+	// The whole body is kept, so loops rewritten by an overlay or DMA get analysed again.
+	struct SIdleLoopCacheEntry
+	{
+		u32		BranchAddress;
+		u32		NumOps;
+		u32		Ops[ StaticAnalysis::kMaxIdleLoopOps ];
+		bool	IsIdle;
+	};
+
+	const u32				kIdleLoopCacheSize = 256;
+	SIdleLoopCacheEntry		gIdleLoopCache[ kIdleLoopCacheSize ];
+}
+
+static bool IsIdleLoop(u32 pc, u32 new_pc)
+{
+	// The loop has to be contiguous in host memory (gLastAddress points at the branch)
+	if ((new_pc ^ (pc + 4)) & ~0xFFF)
+		return false;
+
+	const u32 * p_branch = (const u32 *)gLastAddress;
+	const u32 * p_target = p_branch - ((pc - new_pc) >> 2);
+
+	u32 num_ops = ((pc - new_pc) >> 2) + 2;
+
+	SIdleLoopCacheEntry & entry = gIdleLoopCache[ (pc >> 2) % kIdleLoopCacheSize ];
+	bool hit = entry.BranchAddress == pc && entry.NumOps == num_ops;
+	for (u32 i = 0; hit && i < num_ops; ++i)
+	{
+		hit = entry.Ops[i] == p_target[i];
+	}
+
+	if (!hit)
+	{
+		OpCode ops[ StaticAnalysis::kMaxIdleLoopOps ];
+		for (u32 i = 0; i < num_ops; ++i)
+		{
+			ops[i]._u32 = p_target[i];
+			entry.Ops[i] = p_target[i];
+		}
+
+		entry.BranchAddress = pc;
+		entry.NumOps = num_ops;
+		entry.IsIdle = StaticAnalysis::IsIdleLoop(ops, num_ops);
+	}
+	return entry.IsIdle;
+}
+#endif
+
 DAEDALUS_FORCEINLINE void SpeedHack(u32 pc, u32 new_pc)
 {
 #ifdef SPEEDHACK_INTERPRETER
-	// If jumping to the same address, this might be a busy-wait
-	if (pc == new_pc)
+	// Only short backwards branches can be busy-waits (this also handles pc == new_pc)
+	if (pc - new_pc <= (StaticAnalysis::kMaxIdleLoopOps - 2) * 4)
 	{
 #ifdef DAEDALUS_ENABLE_DYNAREC
 		if (gTraceRecorder.IsTraceActive())
 			return;
 #endif
-		// TODO: Should maybe use some internal function, so we can account
-		// for things like Branch/DelaySlot pair straddling a page boundary.
-		u32 next_op = *(u32 *)(gLastAddress + 4);
-
-		// If nop, then this is a busy-wait for an interrupt
-		if (next_op == 0)
+		// If the loop is just polling something, nothing can change until the next interrupt
+		if (IsIdleLoop(pc, new_pc))
 		{
 			// XXXX if we leave the counter at 1, then we always terminate traces with a delay slot active.
 			// Need a more permenant fix to for this - i.e. making tracing more robust.
 			CPU_SkipToNextEvent();
 		}
-		// XXXX check this....need to update count....
-		// This is:
-		// 0x7f0d01e8: BNEL      v0 != v1 --> 0x7f0d01e8
-		// 0x7f0d01ec: ADDIU     v0 = v0 + 0x0004
-		/*else if (op._u32 == 0x5443ffff && next_op == 0x24420004)
-		{
-			gGPR[REG_v0]._u64 = gGPR[REG_v1]._u64 - 4;
-		}*/
-		/*else
-		{
-			static bool warned = false;
-
-			if (!warned)
-			{
-				DBGConsole_Msg(0, "Missed Speedhack 0x%08x", gCPUState.CurrentPC);
-				warned = true;
-			}
-		}*/
 	}
 #endif
 }
@@ -777,7 +808,7 @@ static void R4300_CALL_TYPE R4300_J( R4300_CALL_SIGNATURE ) 				// Jump
 	u32 pc( gCPUState.CurrentPC );
 	u32 new_pc( (pc & 0xF0000000) | (op_code.target<<2) );
 
-	//SpeedHack(pc, new_pc);	// PMario and Tarzan use this, is it worth?
+	SpeedHack(pc, new_pc);		// PMario and Tarzan use this
 	CPU_TakeBranch( new_pc );
 }
 
@@ -1052,8 +1083,11 @@ static void R4300_CALL_TYPE R4300_BGTZL( R4300_CALL_SIGNATURE ) 		// Branch on G
 	//branch if rs > 0
 	if ( gGPR[op_code.rs]._s64 > 0 )
 	{
-		//ToDo : SpeedHack?
-		u32	new_pc( gCPUState.CurrentPC + ((s32)(s16)op_code.immediate<<2) + 4 );
+		s16 offset( (s16)op_code.immediate );
+		u32 pc( gCPUState.CurrentPC );
+		u32 new_pc( pc + ((s32)offset<<2) + 4 );
+
+		SpeedHack(pc, new_pc);
 		CPU_TakeBranch( new_pc );
 	}
 	else
@@ -2124,8 +2158,11 @@ static void R4300_CALL_TYPE R4300_RegImm_BLTZL( R4300_CALL_SIGNATURE ) 			// Bra
 	//branch if rs < 0
 	if ( gGPR[ op_code.rs ]._s64 < 0 )
 	{
-		//ToDo: SpeedHack?
-		u32	new_pc( gCPUState.CurrentPC + ((s32)(s16)op_code.immediate<<2) + 4 );
+		s16 offset( (s16)op_code.immediate );
+		u32 pc( gCPUState.CurrentPC );
+		u32 new_pc( pc + ((s32)offset<<2) + 4 );
+
+		SpeedHack(pc, new_pc);
 		CPU_TakeBranch( new_pc );
 	}
 	else
@@ -2176,8 +2213,11 @@ static void R4300_CALL_TYPE R4300_RegImm_BGEZL( R4300_CALL_SIGNATURE ) 			// Bra
 	//branch if rs >= 0
 	if ( gGPR[ op_code.rs ]._s64 >= 0 )
 	{
-		//ToDO: SpeedHack?
-		u32	new_pc( gCPUState.CurrentPC + ((s32)(s16)op_code.immediate<<2) + 4 );
+		s16 offset( (s16)op_code.immediate );
+		u32 pc( gCPUState.CurrentPC );
+		u32 new_pc( pc + ((s32)offset<<2) + 4 );
+
+		SpeedHack(pc, new_pc);
 		CPU_TakeBranch( new_pc );
 	}
 	else
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "ROMBuffer.h"
 
 #include "ROM.h"
+#include "CPU.h"
 #include "DMA.h"
 
 #ifdef DAEDALUS_PSP
@@ -32,13 +33,23 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Debug/DBGConsole.h"
 
+#include "System/Paths.h"
+
 #include "Utility/Preferences.h"
 #include "Utility/ROMFile.h"
 #include "Utility/ROMFileCache.h"
+#include "Utility/ROMFileCompressed.h"
 #include "Utility/ROMFileMemory.h"
 #include "Utility/Stream.h"
 #include "Utility/IO.h"
 
+#if defined(DAEDALUS_COMPRESSED_ROM_SUPPORT) && !defined(DAEDALUS_PSP)
+#define DAEDALUS_ROM_IMAGE_CACHE
+#include "Utility/Cond.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+#endif
+
 #ifdef DAEDALUS_PSP
 extern bool PSP_IS_SLIM;
 #endif
@@ -58,6 +69,219 @@ namespace
 	const u32		SCRATCH_BUFFER_LENGTH = 16;
 	u8				sScratchBuffer[ SCRATCH_BUFFER_LENGTH ];
 
+#ifdef DAEDALUS_ROM_IMAGE_CACHE
+	//
+	//	Zipped roms are inflated into spRomData on a background thread, which
+	//	publishes how many bytes are ready in sRomBytesAvailable. The decompressed
+	//	image is also written to disk, so later launches can just map it in.
+	//	If decompression fails, sDecompressFailed is set and the emulator halts
+	//	the first time it reads past the bytes that made it.
+	//
+	const u32		DECOMPRESS_CHUNK_SIZE = 256 * 1024;
+
+	bool			sRomMapped( false );
+	ThreadHandle	sDecompressThread( kInvalidThreadHandle );
+	ROMFile *		spDecompressRomFile( NULL );
+	Mutex			sDecompressMutex;
+	Cond *			sDecompressCond( NULL );
+	volatile u32	sRomBytesAvailable( 0 );
+	volatile bool	sDecompressFinished( false );
+	volatile bool	sDecompressFailed( false );
+	volatile bool	sDecompressAbort( false );
+	IO::Filename	sImageCacheFilename;
+
+	void	GetImageCacheFilename( char * p_filename, const char * rom_filename, ROMFileCompressed * p_rom_file )
+	{
+		u32	zip_size( 0 );
+		u64	zip_time( 0 );
+		IO::File::GetInfo( rom_filename, &zip_size, &zip_time );
+
+		// The crc and size come from the zip directory, the timestamp catches archives which have been replaced
+		char	name[ 64 ];
+		sprintf( name, "%08x%08x%08x%08x.z64", p_rom_file->GetRomCRC(), p_rom_file->GetRomSize(), u32( zip_time >> 32 ), u32( zip_time ) );
+
+		IO::Path::Combine( p_filename, gDaedalusExePath, "RomCache" );
+		IO::Path::Append( p_filename, name );
+	}
+
+	bool	MapImageCache( const char * cache_filename, u32 rom_size )
+	{
+		u32		mapped_size( 0 );
+		void *	p_data( IO::File::Map( cache_filename, &mapped_size ) );
+		if( p_data == NULL )
+			return false;
+
+		if( mapped_size != rom_size )
+		{
+			DBGConsole_Msg( 0, "Cached rom image [C%s] is the wrong size - ignoring", cache_filename );
+			IO::File::Unmap( p_data, mapped_size );
+			return false;
+		}
+
+		spRomData = (u8 *)p_data;
+		sRomMapped = true;
+		sRomBytesAvailable = rom_size;
+		return true;
+	}
+
+	u32 DAEDALUS_THREAD_CALL_TYPE DecompressRomThread( void * arg )
+	{
+		IO::Filename	cache_dir;
+		IO::Filename	temp_filename;
+		IO::Path::Assign( cache_dir, sImageCacheFilename );
+		IO::Path::RemoveFileSpec( cache_dir );
+		IO::Path::Assign( temp_filename, sImageCacheFilename );
+		IO::Path::SetExtension( temp_filename, ".tmp" );
+
+		// Failing to write the cache isn't fatal, it just means we'll decompress again next time
+		FILE *	fh( NULL );
+		if( IO::Directory::EnsureExists( cache_dir ) )
+		{
+			fh = fopen( temp_filename, "wb" );
+		}
+
+		u32		offset( 0 );
+		bool	failed( false );
+		while( offset < sRomSize && !sDecompressAbort )
+		{
+			u32		length( Min( sRomSize - offset, DECOMPRESS_CHUNK_SIZE ) );
+			u8 *	p_chunk( spRomData + offset );
+
+			if( !spDecompressRomFile->ReadChunk( offset, p_chunk, length ) )
+			{
+				failed = true;
+				break;
+			}
+
+			offset += length;
+			{
+				MutexLock	lock( &sDecompressMutex );
+				sRomBytesAvailable = offset;
+				CondSignal( sDecompressCond );
+			}
+
+			if( fh != NULL && fwrite( p_chunk, 1, length, fh ) != length )
+			{
+				fclose( fh );
+				fh = NULL;
+				IO::File::Delete( temp_filename );
+			}
+		}
+
+		if( fh != NULL )
+		{
+			fclose( fh );
+			if( offset == sRomSize )
+			{
+				IO::File::Delete( sImageCacheFilename );
+				IO::File::Move( temp_filename, sImageCacheFilename );
+			}
+			else
+			{
+				IO::File::Delete( temp_filename );
+			}
+		}
+
+		if( failed )
+		{
+			DBGConsole_Msg( 0, "[RFailed to decompress rom at offset %08x]", offset );
+		}
+
+		MutexLock	lock( &sDecompressMutex );
+		sDecompressFailed = failed;
+		sDecompressFinished = true;
+		CondSignal( sDecompressCond );
+		return 0;
+	}
+
+	bool	StartDecompressRom( ROMFile * p_rom_file, u8 * p_bytes )
+	{
+		spRomData           = p_bytes;
+		spDecompressRomFile = p_rom_file;
+		sRomBytesAvailable  = 0;
+		sDecompressFinished = false;
+		sDecompressFailed   = false;
+		sDecompressAbort    = false;
+
+		if( sDecompressCond == NULL )
+		{
+			sDecompressCond = CondCreate();
+		}
+
+		sDecompressThread = CreateThread( "DecompressRom", &DecompressRomThread, NULL );
+		if( sDecompressThread == kInvalidThreadHandle )
+		{
+			spRomData = NULL;
+			spDecompressRomFile = NULL;
+			return false;
+		}
+
+		return true;
+	}
+
+	void	StopDecompressRom()
+	{
+		if( sDecompressThread != kInvalidThreadHandle )
+		{
+			sDecompressAbort = true;
+			JoinThread( sDecompressThread, -1 );
+			ReleaseThreadHandle( sDecompressThread );
+			sDecompressThread = kInvalidThreadHandle;
+		}
+
+		delete spDecompressRomFile;
+		spDecompressRomFile = NULL;
+	}
+
+	void	WaitForRomBytesSlow( u32 end )
+	{
+		MutexLock	lock( &sDecompressMutex );
+		while( sRomBytesAvailable < end && !sDecompressFinished )
+		{
+			CondWait( sDecompressCond, &sDecompressMutex, kTimeoutInfinity );
+		}
+
+		if( sRomBytesAvailable < end && sDecompressFailed )
+		{
+			// The rest of the image is never coming. Stop rather than run on
+			// uninitialised memory, and zero it so the reads in flight are at
+			// least deterministic. The thread has finished, so nothing else writes it.
+			CPU_Halt( "Couldn't decompress the rom" );
+			memset( spRomData + sRomBytesAvailable, 0, sRomSize - sRomBytesAvailable );
+			sRomBytesAvailable = sRomSize;
+		}
+	}
+
+	// Pairs with the release of sDecompressMutex on the decompression thread, so
+	// the chunk data is visible once the count says it's there.
+	inline u32	GetRomBytesAvailable()
+	{
+#if defined( __GNUC__ )
+		return __atomic_load_n( &sRomBytesAvailable, __ATOMIC_ACQUIRE );
+#else
+		u32		available( sRomBytesAvailable );
+		_ReadWriteBarrier();
+		return available;
+#endif
+	}
+#endif
+
+	// Blocks until the rom bytes up to 'end' have been decompressed
+	inline void	WaitForRomBytes( u32 end )
+	{
+#ifdef DAEDALUS_ROM_IMAGE_CACHE
+		if( end > sRomSize )
+		{
+			end = sRomSize;
+		}
+
+		if( DAEDALUS_EXPECT_UNLIKELY( GetRomBytesAvailable() < end ) )
+		{
+			WaitForRomBytesSlow( end );
+		}
+#endif
+	}
+
 	bool		ShouldLoadAsFixed( u32 rom_size )
 	{
 #ifdef DAEDALUS_PSP
@@ -200,6 +424,37 @@ bool RomBuffer::Open()
 
 	sRomSize = p_rom_file->GetRomSize();
 
+#ifdef DAEDALUS_ROM_IMAGE_CACHE
+	if( p_rom_file->IsCompressed() && ShouldLoadAsFixed( sRomSize ) )
+	{
+		GetImageCacheFilename( sImageCacheFilename, filename, static_cast< ROMFileCompressed * >( p_rom_file ) );
+
+		if( MapImageCache( sImageCacheFilename, sRomSize ) )
+		{
+			DBGConsole_Msg(0, "Using cached rom image [C%s]\n", sImageCacheFilename);
+			delete p_rom_file;
+		}
+		else
+		{
+			// Start inflating in the background, reads will block until the bytes they need are available
+			u8 *	p_bytes( (u8*)CROMFileMemory::Get()->Alloc( AlignPow2( sRomSize, 4 ) ) );
+			if( !StartDecompressRom( p_rom_file, p_bytes ) )
+			{
+				DBGConsole_Msg(0, "Failed to start decompressing [C%s]\n", filename);
+				CROMFileMemory::Get()->Free( p_bytes );
+				delete p_rom_file;
+				return false;
+			}
+		}
+
+		sRomFixed = true;
+
+		DBGConsole_Msg(0, "Opened [C%s]\n", filename);
+		sRomLoaded = true;
+		return true;
+	}
+#endif
+
 	if( ShouldLoadAsFixed( sRomSize ) )
 	{
 		// Now, allocate memory for rom - round up to a 4 byte boundry
@@ -245,6 +500,9 @@ bool RomBuffer::Open()
 #endif
 		spRomData = p_bytes;
 		sRomFixed = true;
+#ifdef DAEDALUS_ROM_IMAGE_CACHE
+		sRomBytesAvailable = sRomSize;
+#endif
 
 		delete p_rom_file;
 	}
@@ -308,6 +566,18 @@ bool RomBuffer::Open()
 //*****************************************************************************
 void	RomBuffer::Close()
 {
+#ifdef DAEDALUS_ROM_IMAGE_CACHE
+	StopDecompressRom();
+
+	if (sRomMapped)
+	{
+		IO::File::Unmap( spRomData, sRomSize );
+		spRomData  = NULL;
+		sRomMapped = false;
+	}
+	sRomBytesAvailable = 0;
+#endif
+
 	if (spRomData)
 	{
 		CROMFileMemory::Get()->Free( spRomData );
@@ -388,6 +658,7 @@ void	RomBuffer::GetRomBytesRaw( void * p_dst, u32 rom_start, u32 length )
 {
 	if( sRomFixed )
 	{
+		WaitForRomBytes( rom_start + length );
 		memcpy(p_dst, (const u8*)spRomData + rom_start, length );
 	}
 	else
@@ -405,6 +676,7 @@ void	RomBuffer::PutRomBytesRaw( u32 rom_start, const void * p_src, u32 length )
 {
 	DAEDALUS_ASSERT( IsRomAddressFixed(), "Cannot put rom bytes when the data isn't fixed" );
 
+	WaitForRomBytes( rom_start + length );
 	memcpy( (u8*)spRomData + rom_start, p_src, length );
 
 }
@@ -418,6 +690,7 @@ void * RomBuffer::GetAddressRaw( u32 rom_start )
 	{
 		if( sRomFixed )
 		{
+			WaitForRomBytes( rom_start + SCRATCH_BUFFER_LENGTH );
 			return (u8 *)spRomData + rom_start;
 		}
 		else
@@ -444,6 +717,8 @@ void RomBuffer::CopyToRam( u8 * p_dst, u32 dst_offset, u32 dst_size, u32 src_off
 		const u8 *	p_src( (const u8 *)spRomData );
 		u32			src_size( sRomSize );
 
+		WaitForRomBytes( src_offset + length );
+
 		DMA_HandleTransfer( p_dst, dst_offset, dst_size, p_src, src_offset, src_size, length );
 	}
 	else
@@ -497,6 +772,8 @@ const void * RomBuffer::GetFixedRomBaseAddress()
 	DAEDALUS_ASSERT( IsRomLoaded(), "The rom isn't loaded" );
 	DAEDALUS_ASSERT( IsRomAddressFixed(), "Trying to access the rom base address when it's not fixed" );
 
+	// The caller can read anywhere in the image, so wait for all of it
+	WaitForRomBytes( sRomSize );
 	return spRomData;
 
 }
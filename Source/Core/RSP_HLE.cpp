@@ -23,9 +23,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Interrupt.h"
 #include "Memory.h"
+#include "Config/ConfigOptions.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
 #include "Debug/Dump.h"			// For Dump_GetDumpDirectory()
+#include "HLEAudio/audiohle.h"
 #include "Math/MathUtil.h"
 #include "OSHLE/ultra_mbi.h"
 #include "OSHLE/ultra_rcp.h"
@@ -33,6 +35,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Plugins/AudioPlugin.h"
 #include "Plugins/GraphicsPlugin.h"
 #include "Test/BatchTest.h"
+#include "Test/Benchmark.h"
 #include "Utility/IO.h"
 #include "Utility/PrintOpCode.h"
 #include "Utility/Profiler.h"
@@ -147,6 +150,7 @@ void RSP_HLE_Finished(u32 setbits)
 static EProcessResult RSP_HLE_Graphics()
 {
 	DAEDALUS_PROFILE( "HLE: Graphics" );
+	CBenchmarkScope benchmark_scope( BC_DISPLAY_LIST );
 
 	if (gGraphicsEnabled && gGraphicsPlugin != NULL)
 	{
@@ -176,11 +180,20 @@ static EProcessResult RSP_HLE_Graphics()
 static EProcessResult RSP_HLE_Audio()
 {
 	DAEDALUS_PROFILE( "HLE: Audio" );
+	CBenchmarkScope benchmark_scope( BC_AUDIO );
 
 	if (gAudioEnabled && gAudioPlugin != NULL)
 	{
 		return gAudioPlugin->ProcessAList();
 	}
+
+	// Headless runs have no audio plugin, but still pay for the alist processing
+	// so that benchmarks reflect a normal run.
+	if (gAudioEnabled && gHeadlessMode)
+	{
+		Memory_SP_SetRegisterBits(SP_STATUS_REG, SP_STATUS_HALT);
+		Audio_Ucode();
+	}
 	return PR_COMPLETED;
 }
 
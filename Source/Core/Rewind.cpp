@@ -0,0 +1,351 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "Rewind.h"
+
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "CPU.h"
+#include "Dynamo.h"
+#include "SaveState.h"
+
+#include "Debug/DBGConsole.h"
+#include "Math/MathUtil.h"
+#include "Utility/Timing.h"
+
+//#define DAEDALUS_REWIND_LOG_STATS		// Print the capture stats every second. Rewind_GetStats() returns them regardless
+
+#ifdef DAEDALUS_ENABLE_REWIND
+
+namespace
+{
+	const u32 REWIND_CAPTURE_INTERVAL	= 4;					// Vertical blanks between captures
+	const u32 REWIND_MEMORY_BUDGET		= 64 * 1024 * 1024;
+	const u32 REWIND_PAGE_SIZE			= 4096;
+	const u32 REWIND_MIN_ZERO_RUN		= 4;					// Shorter unchanged runs are cheaper stored as literals
+
+	//
+	//	Each snapshot holds the changes needed to turn the next newer image back
+	//	into this one. For each changed page there's a u32 page index and a u32
+	//	encoded length, then {u16 unchanged count, u16 literal count, literals}
+	//	runs, where the literals are the XOR of the two images.
+	//
+	struct RewindSnapshot
+	{
+		u32					Frame;
+		std::vector<u8>		Data;
+	};
+
+	std::deque<RewindSnapshot *>	sSnapshots;				// Oldest first
+	std::vector<u8>					sHead;					// Image at the most recent capture
+	std::vector<u8>					sScratch;
+	u32								sHeadFrame( 0 );
+	u32								sFrame( 0 );			// Vertical blanks since the rom was opened
+	u32								sFramesSinceCapture( 0 );
+	u32								sSnapshotMemory( 0 );
+	volatile u32					sRequestedFrames( 0 );
+
+	u64								sStatsStartTime( 0 );
+	u32								sStatsCaptures( 0 );
+	u64								sStatsCaptureTicks( 0 );
+	RewindStats						sStats;
+
+	template< typename T >
+	inline void Append( std::vector<u8> & data, T value )
+	{
+		const u8 * p( reinterpret_cast< const u8 * >( &value ) );
+		data.insert( data.end(), p, p + sizeof( T ) );
+	}
+
+	template< typename T >
+	inline T Extract( const u8 * p )
+	{
+		T	value;
+		memcpy( &value, p, sizeof( T ) );
+		return value;
+	}
+
+	void EncodePage( std::vector<u8> & data, const u8 * older, const u8 * newer, u32 length )
+	{
+		u32		i( 0 );
+		while( i < length )
+		{
+			const u32	run_start( i );
+			while( i < length && older[ i ] == newer[ i ] )
+			{
+				i++;
+			}
+
+			const u32	literal_start( i );
+			u32			equal( 0 );
+			while( i < length && equal < REWIND_MIN_ZERO_RUN )
+			{
+				equal = older[ i ] == newer[ i ] ? equal + 1 : 0;
+				i++;
+			}
+			if( equal == REWIND_MIN_ZERO_RUN )
+			{
+				// Leave the unchanged bytes for the next run.
+				i -= equal;
+			}
+
+			Append< u16 >( data, u16( literal_start - run_start ) );
+			Append< u16 >( data, u16( i - literal_start ) );
+			for( u32 j = literal_start; j < i; ++j )
+			{
+				data.push_back( older[ j ] ^ newer[ j ] );
+			}
+		}
+	}
+
+	void ApplyPage( u8 * dst, const u8 * encoded, u32 length )
+	{
+		const u8 * const	end( encoded + length );
+		while( encoded < end )
+		{
+			const u32	unchanged( Extract< u16 >( encoded ) );
+			const u32	literals( Extract< u16 >( encoded + 2 ) );
+			encoded += 4;
+			dst += unchanged;
+
+			for( u32 j = 0; j < literals; ++j )
+			{
+				dst[ j ] ^= encoded[ j ];
+			}
+			dst += literals;
+			encoded += literals;
+		}
+	}
+
+	void ApplySnapshot( std::vector<u8> & image, const RewindSnapshot & snapshot )
+	{
+		if( snapshot.Data.empty() )
+			return;
+
+		const u8 *			p( &snapshot.Data[0] );
+		const u8 * const	end( p + snapshot.Data.size() );
+		while( p < end )
+		{
+			const u32	page( Extract< u32 >( p ) );
+			const u32	length( Extract< u32 >( p + 4 ) );
+			p += 8;
+
+			ApplyPage( &image[ page * REWIND_PAGE_SIZE ], p, length );
+			p += length;
+		}
+	}
+
+	void ClearSnapshots()
+	{
+		for( std::deque<RewindSnapshot *>::iterator it = sSnapshots.begin(); it != sSnapshots.end(); ++it )
+		{
+			delete *it;
+		}
+		sSnapshots.clear();
+		sSnapshotMemory = 0;
+	}
+
+	void Capture()
+	{
+		SaveState_SaveToMemory( &sScratch );
+
+		if( sHead.size() != sScratch.size() )
+		{
+			ClearSnapshots();
+			sHead.swap( sScratch );
+			sHeadFrame = sFrame;
+			return;
+		}
+
+		RewindSnapshot *	snapshot( new RewindSnapshot );
+		snapshot->Frame = sHeadFrame;
+
+		const u32	image_size( sHead.size() );
+		for( u32 offset = 0; offset < image_size; offset += REWIND_PAGE_SIZE )
+		{
+			const u32	length( Min( image_size - offset, REWIND_PAGE_SIZE ) );
+			u8 *		head( &sHead[ offset ] );
+			const u8 *	current( &sScratch[ offset ] );
+
+			if( memcmp( head, current, length ) == 0 )
+				continue;
+
+			const u32	header_offset( snapshot->Data.size() );
+			Append< u32 >( snapshot->Data, offset / REWIND_PAGE_SIZE );
+			Append< u32 >( snapshot->Data, 0 );
+			EncodePage( snapshot->Data, head, current, length );
+
+			const u32	encoded_length( snapshot->Data.size() - header_offset - 8 );
+			memcpy( &snapshot->Data[ header_offset + 4 ], &encoded_length, sizeof( encoded_length ) );
+
+			memcpy( head, current, length );
+		}
+
+		// Trim the slack left by growing the vector.
+		std::vector<u8>( snapshot->Data ).swap( snapshot->Data );
+
+		sHeadFrame = sFrame;
+		sSnapshots.push_back( snapshot );
+		sSnapshotMemory += snapshot->Data.size();
+
+		while( sSnapshotMemory > REWIND_MEMORY_BUDGET && sSnapshots.size() > 1 )
+		{
+			RewindSnapshot *	oldest( sSnapshots.front() );
+			sSnapshots.pop_front();
+			sSnapshotMemory -= oldest->Data.size();
+			delete oldest;
+		}
+	}
+
+	void Rewind( u32 frames )
+	{
+		if( sHead.empty() )
+			return;
+
+		const u32	target( frames < sFrame ? sFrame - frames : 0 );
+
+		while( sHeadFrame > target && !sSnapshots.empty() )
+		{
+			RewindSnapshot *	snapshot( sSnapshots.back() );
+			sSnapshots.pop_back();
+
+			ApplySnapshot( sHead, *snapshot );
+			sHeadFrame = snapshot->Frame;
+			sSnapshotMemory -= snapshot->Data.size();
+			delete snapshot;
+		}
+
+		if( SaveState_LoadFromMemory( &sHead[0], sHead.size() ) )
+		{
+			CPU_ResetFragmentCache();
+			DBGConsole_Msg( 0, "Rewound %d frames", sFrame - sHeadFrame );
+			sFrame = sHeadFrame;
+			sFramesSinceCapture = 0;
+		}
+	}
+
+	void UpdateStats( u64 capture_ticks )
+	{
+		u64		now;
+		u64		freq;
+		if( !NTiming::GetPreciseTime( &now ) || !NTiming::GetPreciseFrequency( &freq ) )
+			return;
+
+		if( capture_ticks != 0 )
+		{
+			sStatsCaptures++;
+			sStatsCaptureTicks += capture_ticks;
+		}
+
+		if( sStatsStartTime == 0 )
+		{
+			sStatsStartTime = now;
+		}
+		else if( now - sStatsStartTime >= freq )
+		{
+			const f32	seconds( f32( now - sStatsStartTime ) / f32( freq ) );
+
+			sStats.NumSnapshots       = sSnapshots.size();
+			sStats.FramesAvailable    = sFrame - ( sSnapshots.empty() ? sHeadFrame : sSnapshots.front()->Frame );
+			sStats.MemoryUsed         = sSnapshotMemory + sHead.size();
+			sStats.CapturesPerSecond  = u32( sStatsCaptures / seconds );
+			sStats.CaptureMsPerSecond = f32( sStatsCaptureTicks ) * 1000.0f / f32( freq ) / seconds;
+
+#ifdef DAEDALUS_REWIND_LOG_STATS
+			DBGConsole_Msg( 0, "Rewind: %d snapshots, %d frames, %dKB, %d captures/s, %.2fms/s",
+				sStats.NumSnapshots, sStats.FramesAvailable, sStats.MemoryUsed / 1024,
+				sStats.CapturesPerSecond, sStats.CaptureMsPerSecond );
+#endif
+
+			sStatsStartTime = now;
+			sStatsCaptures = 0;
+			sStatsCaptureTicks = 0;
+		}
+	}
+
+	void RewindVblCallback( void * arg )
+	{
+		sFrame++;
+
+		if( sRequestedFrames != 0 )
+		{
+			u32		frames( sRequestedFrames );
+			sRequestedFrames = 0;
+			Rewind( frames );
+			return;
+		}
+
+		u64		capture_ticks( 0 );
+		if( ++sFramesSinceCapture >= REWIND_CAPTURE_INTERVAL )
+		{
+			sFramesSinceCapture = 0;
+
+			u64		start;
+			u64		end;
+			NTiming::GetPreciseTime( &start );
+			Capture();
+			NTiming::GetPreciseTime( &end );
+			capture_ticks = Max< u64 >( end - start, 1 );
+		}
+
+		UpdateStats( capture_ticks );
+	}
+}
+
+bool Rewind_RomOpen()
+{
+	ClearSnapshots();
+	sHead.clear();
+	sHeadFrame = 0;
+	sFrame = 0;
+	sFramesSinceCapture = 0;
+	sRequestedFrames = 0;
+	sStatsStartTime = 0;
+	sStatsCaptures = 0;
+	sStatsCaptureTicks = 0;
+	memset( &sStats, 0, sizeof( sStats ) );
+
+	CPU_RegisterVblCallback( &RewindVblCallback, NULL );
+	return true;
+}
+
+void Rewind_RomClose()
+{
+	CPU_UnregisterVblCallback( &RewindVblCallback, NULL );
+
+	ClearSnapshots();
+	std::vector<u8>().swap( sHead );
+	std::vector<u8>().swap( sScratch );
+}
+
+void Rewind_Request( u32 frames )
+{
+	sRequestedFrames = frames;
+}
+
+void Rewind_GetStats( RewindStats * stats )
+{
+	*stats = sStats;
+}
+
+#endif // DAEDALUS_ENABLE_REWIND
@@ -0,0 +1,49 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef CORE_REWIND_H_
+#define CORE_REWIND_H_
+
+//
+//	Rewind keeps a bounded ring of in-memory snapshots, captured every few
+//	vertical blanks. Only the pages which changed since the previous capture
+//	are kept, XORed against the newer image and run-length encoded.
+//
+
+struct RewindStats
+{
+	u32		NumSnapshots;
+	u32		FramesAvailable;		// How far back we can currently rewind
+	u32		MemoryUsed;				// Bytes, including the current image
+	u32		CapturesPerSecond;
+	f32		CaptureMsPerSecond;
+};
+
+bool	Rewind_RomOpen();
+void	Rewind_RomClose();
+
+// Rewind by at least the specified number of frames on the next vertical blank.
+// Safe to call from any thread.
+void	Rewind_Request( u32 frames );
+
+void	Rewind_GetStats( RewindStats * stats );
+
+#endif // CORE_REWIND_H_
@@ -21,6 +21,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stdio.h>
 
+#include <string>
+#include <vector>
+
 #include "SaveState.h"
 #include "Memory.h"
 #include "CPU.h"
@@ -33,7 +36,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "OSHLE/patch.h"
 #include "OSHLE/ultra_R4300.h"
 #include "System/System.h"
+#include "Utility/Hash.h"
+#include "Utility/LZ4.h"
 #include "Utility/ROMFile.h"
+#include "Utility/Thread.h"
 #include "Utility/ZlibWrapper.h"
 //
 //	SaveState code written initially by Lkb. Seems to be based about Project 64's
@@ -42,16 +48,106 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 const u32 SAVESTATE_PROJECT64_MAGIC_NUMBER = 0x23D8A6C8;
 
-class SaveState_ostream_gzip
+//
+//	Daedalus' own format stores the same image as the Project64 format, but
+//	compressed with LZ4 in 64KB blocks rather than with zlib. The image is
+//	snapshotted on the emulation thread and compressed and written on a worker
+//	thread, so saving doesn't stall the game. Delta states only store the 4KB
+//	pages which differ from a base state.
+//
+const u32 SAVESTATE_DAEDALUS_MAGIC_NUMBER	= 0x31535344;	// 'DSS1'
+const u32 SAVESTATE_DAEDALUS_VERSION		= 1;
+const u32 SAVESTATE_PAGE_SIZE				= 4096;
+const u32 SAVESTATE_MAX_BASE_FILENAME		= 260;
+
+const u32 SAVESTATE_FLAG_DELTA				= 1 << 0;
+
+struct SaveStateHeader
+{
+	u32		Magic;
+	u32		Version;
+	u32		Flags;
+	u32		ImageSize;			// Size of the uncompressed image
+	u32		ImageHash;			// murmur2 chained over each 64KB block, see HashImageBlock()
+	u32		BaseHash;			// For deltas, the hash of the base image
+	u32		RomCRC[2];
+	u32		RomCountryID;
+	char	BaseFilename[ SAVESTATE_MAX_BASE_FILENAME ];
+};
+
+// The PSP can't spare the memory to keep a second copy of RDRAM around,
+// so deltas are always written as full states there, and saves are
+// compressed straight to the file rather than from a snapshot.
+#ifndef DAEDALUS_PSP
+#define DAEDALUS_SAVESTATE_RETAIN_BASE
+#endif
+
+class CMemoryOutStream
+{
+public:
+	explicit CMemoryOutStream( std::vector<u8> & buffer )
+		: mBuffer( buffer )
+	{
+	}
+
+	bool IsOpen() const
+	{
+		return true;
+	}
+
+	bool WriteData( const void * data, u32 length )
+	{
+		const u8 * p( reinterpret_cast< const u8 * >( data ) );
+		mBuffer.insert( mBuffer.end(), p, p + length );
+		return true;
+	}
+
+private:
+	std::vector<u8> &	mBuffer;
+};
+
+class CMemoryInStream
+{
+public:
+	CMemoryInStream( const u8 * data, u32 length )
+		: mData( data )
+		, mLength( length )
+		, mOffset( 0 )
+	{
+	}
+
+	bool IsOpen() const
+	{
+		return true;
+	}
+
+	bool ReadData( void * data, u32 length )
+	{
+		if( length > mLength - mOffset )
+			return false;
+
+		memcpy( data, mData + mOffset, length );
+		mOffset += length;
+		return true;
+	}
+
+private:
+	const u8 *			mData;
+	u32					mLength;
+	u32					mOffset;
+};
+
+template< typename OutStream >
+class SaveState_ostream
 {
 public:
-	SaveState_ostream_gzip( const char * filename )
-		: mStream( filename )
+	explicit SaveState_ostream( OutStream & stream )
+		: mStream( stream )
 	{
 	}
 
 	template<typename T>
-	inline SaveState_ostream_gzip& operator << (const T& data)
+	inline SaveState_ostream& operator << (const T& data)
 	{
 		write(&data, sizeof(T));
 		return *this;
@@ -106,14 +202,15 @@ public:
 	}
 
 private:
-	COutStream		mStream;
+	OutStream &		mStream;
 };
 
-class SaveState_istream_gzip
+template< typename InStream >
+class SaveState_istream
 {
 public:
-	explicit SaveState_istream_gzip( const char * filename )
-		: mStream( filename )
+	explicit SaveState_istream( InStream & stream )
+		: mStream( stream )
 	{}
 
 	inline bool IsValid() const
@@ -122,7 +219,7 @@ public:
 	}
 
 	template<typename T>
-	inline SaveState_istream_gzip& operator >> (T& data)
+	inline SaveState_istream& operator >> (T& data)
 	{
 		if (read(&data, sizeof(data)) != sizeof(data))
 		{
@@ -184,17 +281,13 @@ public:
 	}
 
 private:
-	CInStream			mStream;
+	InStream &			mStream;
 };
 
 
-bool SaveState_SaveToFile( const char * filename )
+template< typename OutStream >
+static void SaveState_Write( SaveState_ostream< OutStream > & stream )
 {
-	SaveState_ostream_gzip stream( filename );
-
-	if( !stream.IsValid() )
-		return false;
-
 	stream << SAVESTATE_PROJECT64_MAGIC_NUMBER;
 	stream << gRamSize;
 	ROMHeader rom_header;
@@ -248,7 +341,6 @@ bool SaveState_SaveToFile( const char * filename )
 	stream.write( g_pMemoryBuffers[MEM_PIF_RAM], 0x40);
 	stream.write( g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
 	stream.write_memory_buffer(MEM_SP_MEM);
-	return true;
 }
 
 // In revision >=715 we were byte swapping PIF RAM in a temp buffer, this broke compatibility with PJ64 saves
@@ -272,13 +364,9 @@ static void Swap_PIF()
 	}
 }
 
-bool SaveState_LoadFromFile( const char * filename )
+template< typename InStream >
+static bool SaveState_Read( SaveState_istream< InStream > & stream )
 {
-	SaveState_istream_gzip stream( filename );
-
-	if( !stream.IsValid() )
-		return false;
-
 	u32 value;
 	stream >> value;
 	if(value != SAVESTATE_PROJECT64_MAGIC_NUMBER)
@@ -396,9 +484,503 @@ bool SaveState_LoadFromFile( const char * filename )
 	return true;
 }
 
+
+namespace
+{
+	struct SaveStateJob
+	{
+		std::string			Filename;
+		bool				Delta;
+		RomID				RomId;
+		std::vector<u8>		Image;
+	};
+
+	ThreadHandle			sSaveThread( kInvalidThreadHandle );
+
+	// The image of the last full state saved or loaded, which deltas are taken against.
+	// Only touched by the save thread while it runs, so joining it is enough to synchronise.
+	std::vector<u8>			sBaseImage;
+	u32						sBaseHash( 0 );
+	std::string				sBaseFilename;
+
+	void SetBaseImage( std::vector<u8> & image, u32 hash, const char * filename )
+	{
+#ifdef DAEDALUS_SAVESTATE_RETAIN_BASE
+		sBaseImage.swap( image );
+		sBaseHash = hash;
+		sBaseFilename = filename;
+#endif
+	}
+
+	bool WriteCompressedBlocks( FILE * fh, const u8 * data, u32 size )
+	{
+		std::vector<u8>		compressed( LZ4_CompressBound( LZ4_MAX_BLOCK_SIZE ) );
+
+		for( u32 offset = 0; offset < size; offset += LZ4_MAX_BLOCK_SIZE )
+		{
+			u32		block_size( Min( size - offset, LZ4_MAX_BLOCK_SIZE ) );
+			u32		compressed_size( LZ4_CompressBlock( data + offset, block_size, &compressed[0], compressed.size() ) );
+
+			if( compressed_size == 0 ||
+				fwrite( &compressed_size, sizeof( compressed_size ), 1, fh ) != 1 ||
+				fwrite( &compressed[0], compressed_size, 1, fh ) != 1 )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReadCompressedBlocks( FILE * fh, u8 * data, u32 size )
+	{
+		std::vector<u8>		compressed( LZ4_CompressBound( LZ4_MAX_BLOCK_SIZE ) );
+
+		for( u32 offset = 0; offset < size; offset += LZ4_MAX_BLOCK_SIZE )
+		{
+			u32		block_size( Min( size - offset, LZ4_MAX_BLOCK_SIZE ) );
+			u32		compressed_size;
+
+			if( fread( &compressed_size, sizeof( compressed_size ), 1, fh ) != 1 ||
+				compressed_size == 0 || compressed_size > compressed.size() ||
+				fread( &compressed[0], compressed_size, 1, fh ) != 1 ||
+				!LZ4_DecompressBlock( &compressed[0], compressed_size, data + offset, block_size ) )
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline u32 GetPageSize( u32 image_size, u32 page )
+	{
+		return Min( image_size - page * SAVESTATE_PAGE_SIZE, SAVESTATE_PAGE_SIZE );
+	}
+
+	// The hash is built up a block at a time, so it can be computed while streaming.
+	inline u32 HashImageBlock( const u8 * data, u32 size, u32 hash )
+	{
+		return murmur2_hash( data, size, hash );
+	}
+
+	u32 HashImage( const u8 * data, u32 size )
+	{
+		u32		hash( 0 );
+		for( u32 offset = 0; offset < size; offset += LZ4_MAX_BLOCK_SIZE )
+		{
+			hash = HashImageBlock( data + offset, Min( size - offset, LZ4_MAX_BLOCK_SIZE ), hash );
+		}
+		return hash;
+	}
+
+	// Compresses the image into LZ4 blocks as it's written, so it never has to be held in memory.
+	class CCompressedOutStream
+	{
+	public:
+		explicit CCompressedOutStream( FILE * fh )
+			: mFile( fh )
+			, mBlock( LZ4_MAX_BLOCK_SIZE )
+			, mBlockSize( 0 )
+			, mImageSize( 0 )
+			, mImageHash( 0 )
+			, mOk( true )
+		{
+		}
+
+		bool IsOpen() const
+		{
+			return mOk;
+		}
+
+		bool WriteData( const void * data, u32 length )
+		{
+			const u8 * p( reinterpret_cast< const u8 * >( data ) );
+			while( length > 0 && mOk )
+			{
+				u32		bytes( Min( length, LZ4_MAX_BLOCK_SIZE - mBlockSize ) );
+				memcpy( &mBlock[ mBlockSize ], p, bytes );
+				mBlockSize += bytes;
+				p += bytes;
+				length -= bytes;
+
+				if( mBlockSize == LZ4_MAX_BLOCK_SIZE )
+				{
+					Flush();
+				}
+			}
+			return mOk;
+		}
+
+		bool Flush()
+		{
+			if( mBlockSize > 0 && mOk )
+			{
+				mImageHash = HashImageBlock( &mBlock[0], mBlockSize, mImageHash );
+				mImageSize += mBlockSize;
+				mOk = WriteCompressedBlocks( mFile, &mBlock[0], mBlockSize );
+				mBlockSize = 0;
+			}
+			return mOk;
+		}
+
+		u32 GetImageSize() const		{ return mImageSize; }
+		u32 GetImageHash() const		{ return mImageHash; }
+
+	private:
+		FILE *				mFile;
+		std::vector<u8>		mBlock;
+		u32					mBlockSize;
+		u32					mImageSize;
+		u32					mImageHash;
+		bool				mOk;
+	};
+
+	void InitHeader( SaveStateHeader * header, const RomID & rom_id )
+	{
+		memset( header, 0, sizeof( *header ) );
+		header->Magic        = SAVESTATE_DAEDALUS_MAGIC_NUMBER;
+		header->Version      = SAVESTATE_DAEDALUS_VERSION;
+		header->RomCRC[0]    = rom_id.CRC[0];
+		header->RomCRC[1]    = rom_id.CRC[1];
+		header->RomCountryID = rom_id.CountryID;
+	}
+
+	// Saves are written to a temporary file so an interrupted save never clobbers a good one.
+	bool CommitTempFile( const std::string & temp_filename, const std::string & filename, bool ok )
+	{
+		if( ok )
+		{
+			remove( filename.c_str() );
+			ok = rename( temp_filename.c_str(), filename.c_str() ) == 0;
+		}
+		if( !ok )
+		{
+			remove( temp_filename.c_str() );
+		}
+		return ok;
+	}
+
+#ifndef DAEDALUS_SAVESTATE_RETAIN_BASE
+	bool WriteDaedalusStateStreamed( const char * filename )
+	{
+		SaveStateHeader		header;
+		InitHeader( &header, g_ROM.mRomID );
+
+		std::string		temp_filename( std::string( filename ) + ".tmp" );
+		FILE *			fh( fopen( temp_filename.c_str(), "wb" ) );
+		if( fh == NULL )
+			return false;
+
+		// Write the header again once the size and hash are known.
+		bool	ok( fwrite( &header, sizeof( header ), 1, fh ) == 1 );
+		if( ok )
+		{
+			CCompressedOutStream						file( fh );
+			SaveState_ostream< CCompressedOutStream >	stream( file );
+			SaveState_Write( stream );
+
+			ok = file.Flush();
+			header.ImageSize = file.GetImageSize();
+			header.ImageHash = file.GetImageHash();
+		}
+		ok = ok && fseek( fh, 0, SEEK_SET ) == 0 && fwrite( &header, sizeof( header ), 1, fh ) == 1;
+		fclose( fh );
+
+		return CommitTempFile( temp_filename, filename, ok );
+	}
+#endif
+
+	bool WriteDaedalusState( SaveStateJob * job )
+	{
+		std::vector<u8> &	image( job->Image );
+		const u32			image_size( image.size() );
+
+		SaveStateHeader		header;
+		InitHeader( &header, job->RomId );
+		header.ImageSize    = image_size;
+		header.ImageHash    = HashImage( &image[0], image_size );
+
+		const u8 *			payload( &image[0] );
+		u32					payload_size( image_size );
+		std::vector<u8>		page_mask;
+		std::vector<u8>		dirty_pages;
+
+		// A delta can't overwrite the state it's based on - write a full state instead.
+		if( job->Delta && sBaseImage.size() == image_size && sBaseFilename.size() < SAVESTATE_MAX_BASE_FILENAME &&
+			job->Filename != sBaseFilename )
+		{
+			header.Flags |= SAVESTATE_FLAG_DELTA;
+			header.BaseHash = sBaseHash;
+			strcpy( header.BaseFilename, sBaseFilename.c_str() );
+
+			const u32	num_pages( ( image_size + SAVESTATE_PAGE_SIZE - 1 ) / SAVESTATE_PAGE_SIZE );
+			page_mask.resize( ( num_pages + 7 ) / 8, 0 );
+
+			for( u32 page = 0; page < num_pages; ++page )
+			{
+				const u32	offset( page * SAVESTATE_PAGE_SIZE );
+				const u32	size( GetPageSize( image_size, page ) );
+
+				if( memcmp( &image[offset], &sBaseImage[offset], size ) != 0 )
+				{
+					page_mask[ page / 8 ] |= u8( 1 << ( page % 8 ) );
+					dirty_pages.insert( dirty_pages.end(), image.begin() + offset, image.begin() + offset + size );
+				}
+			}
+
+			payload = dirty_pages.empty() ? NULL : &dirty_pages[0];
+			payload_size = dirty_pages.size();
+		}
+
+		std::string		temp_filename( job->Filename + ".tmp" );
+		FILE *			fh( fopen( temp_filename.c_str(), "wb" ) );
+		if( fh == NULL )
+			return false;
+
+		bool	ok( fwrite( &header, sizeof( header ), 1, fh ) == 1 );
+		if( ok && !page_mask.empty() )
+		{
+			ok = fwrite( &page_mask[0], page_mask.size(), 1, fh ) == 1;
+		}
+		ok = ok && WriteCompressedBlocks( fh, payload, payload_size );
+		fclose( fh );
+
+		if( !CommitTempFile( temp_filename, job->Filename, ok ) )
+			return false;
+
+		if( ( header.Flags & SAVESTATE_FLAG_DELTA ) == 0 )
+		{
+			SetBaseImage( image, header.ImageHash, job->Filename.c_str() );
+		}
+		return true;
+	}
+
+	u32 DAEDALUS_THREAD_CALL_TYPE SaveStateThread( void * arg )
+	{
+		SaveStateJob * job( static_cast< SaveStateJob * >( arg ) );
+
+		if( !WriteDaedalusState( job ) )
+		{
+			DBGConsole_Msg( 0, "Failed to write savestate '%s'", job->Filename.c_str() );
+		}
+
+		delete job;
+		return 0;
+	}
+
+	bool ReadHeader( FILE * fh, SaveStateHeader * header )
+	{
+		return fread( header, sizeof( *header ), 1, fh ) == 1 &&
+			   header->Magic == SAVESTATE_DAEDALUS_MAGIC_NUMBER &&
+			   header->Version == SAVESTATE_DAEDALUS_VERSION;
+	}
+
+	// Returns true if the file is in Daedalus' own format, and fills in the header.
+	bool ReadHeader( const char * filename, SaveStateHeader * header )
+	{
+		FILE * fh( fopen( filename, "rb" ) );
+		if( fh == NULL )
+			return false;
+
+		bool	ok( ReadHeader( fh, header ) );
+		fclose( fh );
+		return ok;
+	}
+
+	bool ReadDaedalusImage( const char * filename, bool allow_delta, SaveStateHeader * header, std::vector<u8> * image )
+	{
+		FILE * fh( fopen( filename, "rb" ) );
+		if( fh == NULL )
+			return false;
+
+		bool	ok( ReadHeader( fh, header ) );
+		if( ok && ( header->Flags & SAVESTATE_FLAG_DELTA ) )
+		{
+			ok = false;
+			if( !allow_delta )
+			{
+				DBGConsole_Msg( 0, "Savestate base '%s' is itself a delta", filename );
+			}
+			else if( header->BaseHash == sBaseHash && sBaseImage.size() == header->ImageSize )
+			{
+				*image = sBaseImage;
+				ok = true;
+			}
+			else
+			{
+				header->BaseFilename[ SAVESTATE_MAX_BASE_FILENAME - 1 ] = '\0';
+
+				SaveStateHeader		base_header;
+				ok = ReadDaedalusImage( header->BaseFilename, false, &base_header, image ) &&
+					 base_header.ImageHash == header->BaseHash;
+				if( !ok )
+				{
+					DBGConsole_Msg( 0, "Couldn't load base savestate '%s'", header->BaseFilename );
+				}
+			}
+
+			if( ok && image->size() != header->ImageSize )
+			{
+				DBGConsole_Msg( 0, "Savestate base '%s' doesn't match", header->BaseFilename );
+				ok = false;
+			}
+
+			if( ok )
+			{
+				const u32		num_pages( ( header->ImageSize + SAVESTATE_PAGE_SIZE - 1 ) / SAVESTATE_PAGE_SIZE );
+				std::vector<u8>	page_mask( ( num_pages + 7 ) / 8 );
+
+				ok = fread( &page_mask[0], page_mask.size(), 1, fh ) == 1;
+
+				u32		payload_size( 0 );
+				for( u32 page = 0; page < num_pages; ++page )
+				{
+					if( page_mask[ page / 8 ] & ( 1 << ( page % 8 ) ) )
+						payload_size += GetPageSize( header->ImageSize, page );
+				}
+
+				std::vector<u8>	dirty_pages( payload_size );
+				ok = ok && ReadCompressedBlocks( fh, dirty_pages.empty() ? NULL : &dirty_pages[0], payload_size );
+
+				u32		offset( 0 );
+				for( u32 page = 0; ok && page < num_pages; ++page )
+				{
+					if( page_mask[ page / 8 ] & ( 1 << ( page % 8 ) ) )
+					{
+						const u32	size( GetPageSize( header->ImageSize, page ) );
+						memcpy( &(*image)[ page * SAVESTATE_PAGE_SIZE ], &dirty_pages[ offset ], size );
+						offset += size;
+					}
+				}
+			}
+		}
+		else if( ok )
+		{
+			image->resize( header->ImageSize );
+			ok = ReadCompressedBlocks( fh, &(*image)[0], header->ImageSize );
+		}
+		fclose( fh );
+
+		if( ok && HashImage( &(*image)[0], image->size() ) != header->ImageHash )
+		{
+			DBGConsole_Msg( 0, "Savestate '%s' is corrupt", filename );
+			ok = false;
+		}
+		return ok;
+	}
+
+	bool ExportProject64State( const char * filename )
+	{
+		COutStream						file( filename );
+		SaveState_ostream< COutStream >	stream( file );
+
+		if( !stream.IsValid() )
+			return false;
+
+		SaveState_Write( stream );
+		return true;
+	}
+}
+
+void SaveState_Flush()
+{
+	if( sSaveThread != kInvalidThreadHandle )
+	{
+		JoinThread( sSaveThread, -1 );
+		ReleaseThreadHandle( sSaveThread );
+		sSaveThread = kInvalidThreadHandle;
+	}
+}
+
+bool SaveState_SaveToFile( const char * filename, ESaveStateFormat format )
+{
+	if( format == SSF_PROJECT64 )
+		return ExportProject64State( filename );
+
+#ifndef DAEDALUS_SAVESTATE_RETAIN_BASE
+	return WriteDaedalusStateStreamed( filename );
+#else
+	// Only one save is in flight at a time - deltas need the previous base to be settled.
+	SaveState_Flush();
+
+	SaveStateJob *	job( new SaveStateJob );
+	job->Filename = filename;
+	job->Delta = format == SSF_DAEDALUS_DELTA;
+	job->RomId = g_ROM.mRomID;
+	job->Image.reserve( gRamSize + MemoryRegionSizes[MEM_SP_MEM] + 4096 );
+	SaveState_SaveToMemory( &job->Image );
+
+	sSaveThread = CreateThread( "SaveState", &SaveStateThread, job );
+	if( sSaveThread == kInvalidThreadHandle )
+	{
+		// Fall back to saving synchronously.
+		bool	ok( WriteDaedalusState( job ) );
+		delete job;
+		return ok;
+	}
+	return true;
+#endif
+}
+
+void SaveState_SaveToMemory( std::vector<u8> * image )
+{
+	image->clear();
+
+	CMemoryOutStream						memory( *image );
+	SaveState_ostream< CMemoryOutStream >	stream( memory );
+	SaveState_Write( stream );
+}
+
+bool SaveState_LoadFromMemory( const u8 * image, u32 size )
+{
+	CMemoryInStream							memory( image, size );
+	SaveState_istream< CMemoryInStream >	stream( memory );
+	return SaveState_Read( stream );
+}
+
+bool SaveState_LoadFromFile( const char * filename )
+{
+	SaveState_Flush();
+
+	SaveStateHeader		header;
+	if( !ReadHeader( filename, &header ) )
+	{
+		CInStream							file( filename );
+		SaveState_istream< CInStream >		stream( file );
+
+		if( !stream.IsValid() )
+			return false;
+
+		return SaveState_Read( stream );
+	}
+
+	if( g_ROM.mRomID != RomID( header.RomCRC[0], header.RomCRC[1], u8( header.RomCountryID ) ) )
+	{
+		DBGConsole_Msg(0, "Savestate '%s' is for a different ROM", filename);
+		return false;
+	}
+
+	std::vector<u8>		image;
+	if( !ReadDaedalusImage( filename, true, &header, &image ) )
+		return false;
+
+	if( !SaveState_LoadFromMemory( &image[0], image.size() ) )
+		return false;
+
+	if( ( header.Flags & SAVESTATE_FLAG_DELTA ) == 0 )
+	{
+		SetBaseImage( image, header.ImageHash, filename );
+	}
+	return true;
+}
+
 RomID SaveState_GetRomID( const char * filename )
 {
-	SaveState_istream_gzip stream( filename );
+	SaveStateHeader		header;
+	if( ReadHeader( filename, &header ) )
+		return RomID( header.RomCRC[0], header.RomCRC[1], u8( header.RomCountryID ) );
+
+	CInStream							file( filename );
+	SaveState_istream< CInStream >		stream( file );
 
 	if( !stream.IsValid() )
 		return RomID();
@@ -420,24 +1002,9 @@ RomID SaveState_GetRomID( const char * filename )
 
 const char* SaveState_GetRom( const char * filename )
 {
-	SaveState_istream_gzip stream( filename );
-
-	if( !stream.IsValid() )
-		return NULL;
-
-	u32 value;
-	stream >> value;
-	if(value != SAVESTATE_PROJECT64_MAGIC_NUMBER)
+	RomID	rom_id( SaveState_GetRomID( filename ) );
+	if( rom_id.Empty() )
 		return NULL;
 
-	u32 ram_size;
-	stream >> ram_size;
-
-	ROMHeader rom_header;
-	stream >> rom_header;
-	ROMFile::ByteSwap_3210(&rom_header, 64);
-
-	return CRomDB::Get()->QueryFilenameFromID(
-		RomID( rom_header.CRC1, rom_header.CRC2, rom_header.CountryID ));
+	return CRomDB::Get()->QueryFilenameFromID( rom_id );
 }
-
@@ -23,10 +23,24 @@
 #ifndef CORE_SAVESTATE_H_
 #define CORE_SAVESTATE_H_
 
+#include <vector>
+
 class RomID;
 
+enum ESaveStateFormat
+{
+	SSF_DAEDALUS,			// LZ4 compressed, written in the background
+	SSF_DAEDALUS_DELTA,		// As above, but only pages changed since the last full state
+	SSF_PROJECT64,			// Gzipped Project64 format, written synchronously
+};
+
 bool SaveState_LoadFromFile( const char * filename );
-bool SaveState_SaveToFile( const char * filename );
+bool SaveState_SaveToFile( const char * filename, ESaveStateFormat format = SSF_DAEDALUS );
+void SaveState_Flush();		// Wait for any background save to complete
+
+// Snapshot to/from an uncompressed in-memory image, e.g. for rewind.
+void SaveState_SaveToMemory( std::vector<u8> * image );
+bool SaveState_LoadFromMemory( const u8 * image, u32 size );
 RomID SaveState_GetRomID( const char * filename );
 const char* SaveState_GetRom(const char * filename);
 
@@ -69,6 +69,13 @@ class CCodeGenerator
 
 		virtual CJumpLocation		GenerateOpCode(const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump) = 0;
 		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return = false ) = 0;
+
+		// Call a function which doesn't touch the N64 registers, keeping any we have cached intact across the call.
+		virtual void				GenerateNativeCall( CCodeLabel function ) = 0;
+
+		// Call an HLE'd OS function from inside the trace. *p_eret_jump is taken if it returned through ERET,
+		// *p_exit_jump if it returned anywhere other than return_address or left the CPU something to do.
+		virtual void				GenerateInlineNativeCall( CCodeLabel function, u32 return_address, CJumpLocation * p_eret_jump, CJumpLocation * p_exit_jump ) = 0;
 };
 
 extern "C"
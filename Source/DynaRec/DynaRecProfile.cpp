@@ -21,13 +21,221 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "DynaRecProfile.h"
 
 #include "Debug/DebugLog.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
 
 #include "Core/ROM.h"
+#include "Utility/IO.h"
 
 #include <map>
+#include <set>
 #include <vector>
 #include <algorithm>
 
+#if defined( DAEDALUS_LINUX ) || defined( DAEDALUS_OSX )
+#include <unistd.h>
+#endif
+
+namespace DynarecProfile
+{
+
+namespace
+{
+	struct SFragmentTotal
+	{
+		u32		Address;
+		u32		NumOps;
+		u64		HitCount;
+		u64		Instructions;
+		u32		HostCodeLength;
+	};
+
+	typedef std::map< u32, SFragmentTotal >	FragmentTotalMap;
+
+	bool								gEnabled = false;
+	std::set< SFragmentProfile * >		gFragments;			// Profiles of live fragments
+	FragmentTotalMap					gRetiredTotals;		// Counts from fragments which have been destroyed
+	FILE *								gPerfMapFH = NULL;
+
+	// The same address can be assembled several times if the cache is flushed, so these are merged.
+	void AddToTotals( FragmentTotalMap & totals, const SFragmentProfile * profile )
+	{
+		SFragmentTotal & total( totals[ profile->EntryAddress ] );
+		total.Address = profile->EntryAddress;
+		total.NumOps = profile->NumOps;
+		total.HitCount += profile->HitCount;
+		total.Instructions += u64( profile->HitCount ) * profile->NumOps;
+		total.HostCodeLength = profile->HostCodeLength;
+	}
+
+	struct SortByInstructions
+	{
+		bool	operator()( const SFragmentTotal & a, const SFragmentTotal & b ) const
+		{
+			return a.Instructions > b.Instructions;
+		}
+	};
+
+	void OpenPerfMap()
+	{
+		if( gPerfMapFH != NULL )
+			return;
+
+		// perf looks for /tmp/perf-<pid>.map when symbolising JIT code.
+#if defined( DAEDALUS_LINUX ) || defined( DAEDALUS_OSX )
+		char filename[ 64 ];
+		sprintf( filename, "/tmp/perf-%d.map", getpid() );
+#else
+		IO::Filename dir;
+		Dump_GetDumpDirectory( dir, "dynarec" );
+		IO::Filename filename;
+		IO::Path::Combine( filename, dir, "perf.map" );
+#endif
+		gPerfMapFH = fopen( filename, "w" );
+		if( gPerfMapFH == NULL )
+		{
+			DBGConsole_Msg( 0, "Couldn't open [C%s] for writing", filename );
+		}
+	}
+
+	// Live profiles belong to their fragments, so they're only reset here.
+	void Clear()
+	{
+		for( std::set< SFragmentProfile * >::iterator it = gFragments.begin(); it != gFragments.end(); ++it )
+		{
+			(*it)->HitCount = 0;
+		}
+		gRetiredTotals.clear();
+	}
+
+	bool HasCounts()
+	{
+		if( !gRetiredTotals.empty() )
+			return true;
+
+		for( std::set< SFragmentProfile * >::const_iterator it = gFragments.begin(); it != gFragments.end(); ++it )
+		{
+			if( (*it)->HitCount != 0 )
+				return true;
+		}
+		return false;
+	}
+}
+
+void SetEnabled( bool enabled )
+{
+	gEnabled = enabled;
+	if( enabled )
+	{
+		OpenPerfMap();
+	}
+}
+
+bool IsEnabled()
+{
+	return gEnabled;
+}
+
+SFragmentProfile * AddFragment( u32 entry_address, u32 num_ops )
+{
+	if( !gEnabled )
+		return NULL;
+
+	SFragmentProfile * profile( new SFragmentProfile );
+	profile->HitCount = 0;
+	profile->EntryAddress = entry_address;
+	profile->NumOps = num_ops;
+	profile->HostCode = NULL;
+	profile->HostCodeLength = 0;
+
+	gFragments.insert( profile );
+	return profile;
+}
+
+void RemoveFragment( SFragmentProfile * profile )
+{
+	if( profile == NULL )
+		return;
+
+	if( profile->HitCount != 0 )
+	{
+		AddToTotals( gRetiredTotals, profile );
+	}
+	gFragments.erase( profile );
+	delete profile;
+}
+
+void SetHostCode( SFragmentProfile * profile, const void * code, u32 length )
+{
+	profile->HostCode = code;
+	profile->HostCodeLength = length;
+
+	if( gPerfMapFH != NULL )
+	{
+		fprintf( gPerfMapFH, "%lx %x n64_%08x_%d\n", (unsigned long)code, length, profile->EntryAddress, profile->NumOps );
+		fflush( gPerfMapFH );
+	}
+}
+
+void WriteReport( FILE * fh, u32 max_fragments )
+{
+	FragmentTotalMap	totals( gRetiredTotals );
+	for( std::set< SFragmentProfile * >::const_iterator it = gFragments.begin(); it != gFragments.end(); ++it )
+	{
+		AddToTotals( totals, *it );
+	}
+
+	std::vector< SFragmentTotal >	sorted;
+	u64								total_instructions( 0 );
+	for( FragmentTotalMap::const_iterator it = totals.begin(); it != totals.end(); ++it )
+	{
+		sorted.push_back( it->second );
+		total_instructions += it->second.Instructions;
+	}
+	std::sort( sorted.begin(), sorted.end(), SortByInstructions() );
+
+	// Instructions are estimated as entries * trace length, as we don't know which exit was taken.
+	fprintf( fh, "Dynarec profile: %d fragments, ~%llu instructions\n", (u32)sorted.size(), total_instructions );
+	fprintf( fh, "  Address     Entries   Ops  ~Instructions      %%  Host bytes\n" );
+	for( u32 i = 0; i < sorted.size() && i < max_fragments; ++i )
+	{
+		const SFragmentTotal & total( sorted[ i ] );
+		f32 percent( total_instructions > 0 ? 100.0f * f32( total.Instructions ) / f32( total_instructions ) : 0.0f );
+
+		fprintf( fh, "  %08x %10llu %5d %14llu %5.1f%% %10d\n",
+			total.Address, total.HitCount, total.NumOps, total.Instructions, percent, total.HostCodeLength );
+	}
+}
+
+bool RomOpen()
+{
+	Clear();
+	return true;
+}
+
+void RomClose()
+{
+	if( HasCounts() )
+	{
+		WriteReport( stdout, 50 );
+
+		IO::Filename dir;
+		Dump_GetDumpDirectory( dir, "dynarec" );
+		IO::Filename filename;
+		IO::Path::Combine( filename, dir, "profile.txt" );
+		if( FILE * fh = fopen( filename, "w" ) )
+		{
+			WriteReport( fh, 1000 );
+			fclose( fh );
+		}
+	}
+	Clear();
+
+	// NB: the perf map is left open, perf reads it once we've exited.
+}
+
+}
+
 #ifdef DAEDALUS_ENABLE_DYNAREC_PROFILE
 
 namespace DynarecProfile
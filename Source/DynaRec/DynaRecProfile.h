@@ -24,6 +24,42 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 class CFragment;
 
+#include <stdio.h>
+
+//
+//	Runtime fragment profiling. When enabled, each newly assembled fragment
+//	gets an entry counter which the generated code increments, and its host
+//	code range is written to a perf map so that samples in the code buffer can
+//	be attributed to guest addresses.
+//
+struct SFragmentProfile
+{
+	u32				HitCount;			// Incremented by the fragment's entry code
+	u32				EntryAddress;
+	u32				NumOps;
+	const void *	HostCode;
+	u32				HostCodeLength;
+};
+
+namespace DynarecProfile
+{
+	// Only fragments assembled after this is called are counted - reset the fragment cache too.
+	void				SetEnabled( bool enabled );
+	bool				IsEnabled();
+
+	// Returns NULL when profiling is disabled. The fragment owns the profile, and must
+	// pass it to RemoveFragment when it's destroyed (its counts are kept for the report).
+	SFragmentProfile *	AddFragment( u32 entry_address, u32 num_ops );
+	void				RemoveFragment( SFragmentProfile * profile );
+	void				SetHostCode( SFragmentProfile * profile, const void * code, u32 length );
+
+	// Writes the hottest fragments, by estimated guest instructions executed.
+	void				WriteReport( FILE * fh, u32 max_fragments );
+
+	bool				RomOpen();
+	void				RomClose();
+}
+
 #ifdef DAEDALUS_ENABLE_DYNAREC_PROFILE
 namespace DynarecProfile
 {
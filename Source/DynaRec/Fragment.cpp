@@ -38,6 +38,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "DynaRec/CodeBufferManager.h"
 #include "DynaRec/CodeGenerator.h"
+#include "DynaRec/DynaRecProfile.h"
 
 #include "Utility/Macros.h"
 #include "Utility/PrintOpCode.h"
@@ -89,6 +90,10 @@ CFragment::CFragment( CCodeBufferManager * p_manager,
 ,	mOutputLength( 0 )
 ,	mFragmentFunctionLength( 0 )
 ,	mpIndirectExitMap( need_indirect_exit_map ? new CIndirectExitMap : NULL )
+,	mpProfile( DynarecProfile::AddFragment( entry_address, trace.size() ) )
+#ifdef DAEDALUS_ENABLE_OS_HOOKS
+,	mpNativeFunction( NULL )
+#endif
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 ,	mHitCount( 0 )
 ,	mTraceBuffer( trace )
@@ -117,6 +122,8 @@ CFragment::CFragment(CCodeBufferManager * p_manager, u32 entry_address,
 	,	mOutputLength( 0 )
 	,	mFragmentFunctionLength( 0 )
 	,	mpIndirectExitMap( new CIndirectExitMap )
+	,	mpProfile( DynarecProfile::AddFragment( entry_address, function_length ) )
+	,	mpNativeFunction( function_Ptr )
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 	,	mHitCount( 0 )
 	,	mTraceBuffer( NULL )
@@ -136,6 +143,22 @@ CFragment::CFragment(CCodeBufferManager * p_manager, u32 entry_address,
 CFragment::~CFragment()
 {
 	delete mpIndirectExitMap;
+	DynarecProfile::RemoveFragment( mpProfile );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 * CFragment::GetHitCounter()
+{
+	if( mpProfile != NULL )
+		return &mpProfile->HitCount;
+
+#ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
+	return &mHitCount;
+#else
+	return NULL;
+#endif
 }
 
 //*************************************************************************************
@@ -529,6 +552,22 @@ namespace
 		CJumpLocation			Jump;
 		RegisterSnapshotHandle	RegisterSnapshot;
 	};
+
+	struct SNativeCallHandlerInfo
+	{
+		SNativeCallHandlerInfo( u32 index, RegisterSnapshotHandle snapshot )
+			:	Index( index )
+			,	EretJump()
+			,	ExitJump()
+			,	RegisterSnapshot( snapshot )
+		{
+		}
+
+		u32						Index;
+		CJumpLocation			EretJump;
+		CJumpLocation			ExitJump;
+		RegisterSnapshotHandle	RegisterSnapshot;
+	};
 }
 
 //*************************************************************************************
@@ -565,36 +604,15 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 
 	mEntryPoint = p_generator->GetEntryPoint();
 
-#ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
-	p_generator->Initialise( mEntryAddress, exit_address, &mHitCount, &gCPUState, register_usage );
-#else
-	p_generator->Initialise( mEntryAddress, exit_address, NULL, &gCPUState, register_usage );
-#endif
-
-	//Trace: (3 ops, 13 hits)
-	//80317934:  SLT       at = (t7<a0)
-	//BRANCH 0 -> 80317940
-	//80317938:  BNEL      at != r0 --> 0x80317934
-	//8031793c:  LW        t7 <- 0x0000(v0)
-
-	if(trace.size() == 3)
-	{
-		if( trace[0].OpCode._u32 == 0x01E4082A &&
-			trace[1].OpCode._u32 == 0x5420FFFE &&
-			trace[2].OpCode._u32 == 0x8C4F0000)
-		{
-#ifndef DAEDALUS_SILENT
-			printf("Speedhack complex %08x\n", trace[0].Address );
-#endif
-			p_generator->ExecuteNativeFunction( CCodeLabel( reinterpret_cast< const void * >( CPU_SkipToNextEvent ) ) );
-		}
-	}
+	p_generator->Initialise( mEntryAddress, exit_address, GetHitCounter(), &gCPUState, register_usage );
 
 	//
 	//	Keep executing ops until we take a branch
 	//
 	std::vector< CJumpLocation >		exception_handler_jumps;
 	std::vector< SBranchHandlerInfo >	branch_handler_info( branch_details.size() );
+	std::vector< SNativeCallHandlerInfo >	native_call_handler_info;
+	const SBranchDetails *				p_native_call( NULL );
 //	bool								checked_cop1_usable( false );
 
 	for( u32 i = 0; i < trace.size(); ++i )
@@ -638,8 +656,6 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 
 					SprintOpCodeInfo( opinfo, trace[i+1].Address, trace[i+1].OpCode );
 					printf("\t%p: <0x%08x> %s\n", (u32*)trace[i+1].Address, trace[i+1].OpCode._u32, opinfo);
-
-					p_generator->ExecuteNativeFunction( CCodeLabel( reinterpret_cast< const void * >( CPU_SkipToNextEvent ) ) );
 					}
 					break;
 
@@ -670,11 +686,6 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 				default:
 					break;
 			}
-#else
-			if(p_branch->SpeedHack == SHACK_SKIPTOEVENT)
-			{
-				p_generator->ExecuteNativeFunction( CCodeLabel( reinterpret_cast< const void * >( CPU_SkipToNextEvent ) ) );
-			}
 #endif
 		}
 
@@ -691,12 +702,39 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 		}
 #endif
 
+		// The idle loop is skipped only when the branch goes back round the loop -
+		// if it's not taken we've already jumped off to the branch handler.
+		// This sits between the branch and its delay slot, so cached registers must survive it.
+		if( p_branch != NULL && p_branch->SpeedHack == SHACK_SKIPTOEVENT )
+		{
+			p_generator->GenerateNativeCall( CCodeLabel( reinterpret_cast< const void * >( CPU_SkipToNextEvent ) ) );
+		}
+
 		// Check whether we want to invert the status of this branch
 		if( p_branch != NULL )
 		{
 			branch_handler_info[ branch_idx ].Index = i;
 			branch_handler_info[ branch_idx ].Jump = branch_jump;
 			branch_handler_info[ branch_idx ].RegisterSnapshot = p_generator->GetRegisterSnapshot();
+
+			if( p_branch->NativeFunction != NULL )
+			{
+				p_native_call = p_branch;
+			}
+		}
+		else if( p_native_call != NULL && ti.BranchDelaySlot )
+		{
+			// Call the HLE'd function in place of the JAL's target, and carry on after the JAL if it returns normally
+			CJumpLocation	eret_jump;
+			CJumpLocation	exit_jump;
+			p_generator->GenerateInlineNativeCall( CCodeLabel( p_native_call->NativeFunction ), ti.Address + 4, &eret_jump, &exit_jump );
+
+			SNativeCallHandlerInfo	info( i, p_generator->GetRegisterSnapshot() );
+			info.EretJump = eret_jump;
+			info.ExitJump = exit_jump;
+			native_call_handler_info.push_back( info );
+
+			p_native_call = NULL;
 		}
 	}
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
@@ -708,6 +746,21 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 
 	AddPatch( exit_address, exit_jump );
 
+	//
+	//	Generate exits for HLE'd calls that didn't come back to the trace
+	//
+	for( u32 i = 0; i < native_call_handler_info.size(); ++i )
+	{
+		const SNativeCallHandlerInfo &	info( native_call_handler_info[ i ] );
+		u32								num_instructions_executed( info.Index + 1 );
+
+		p_generator->GenerateBranchHandler( info.ExitJump, info.RegisterSnapshot );
+		p_generator->GenerateIndirectExitCode( num_instructions_executed, mpIndirectExitMap );
+
+		p_generator->GenerateBranchHandler( info.EretJump, info.RegisterSnapshot );
+		p_generator->GenerateEretExitCode( num_instructions_executed, mpIndirectExitMap );
+	}
+
 	//
 	//	Generate handlers for each exit branch
 	//
@@ -811,6 +864,11 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 	mFragmentFunctionLength = p_manager->FinaliseCurrentBlock();
 	mOutputLength = mFragmentFunctionLength - ADDITIONAL_OUTPUT_BYTES;
 
+	if( mpProfile != NULL )
+	{
+		DynarecProfile::SetHostCode( mpProfile, mEntryPoint.GetTarget(), mFragmentFunctionLength );
+	}
+
 	delete p_generator;
 }
 
@@ -827,11 +885,7 @@ void CFragment::Assemble( CCodeBufferManager * p_manager, CCodeLabel function_pt
 	mEntryPoint = p_generator->GetEntryPoint();
 
 
-#ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
-		p_generator->Initialise( mEntryAddress, 0, &mHitCount, &gCPUState,  register_usage);
-#else
-		p_generator->Initialise( mEntryAddress, 0, NULL, &gCPUState, register_usage );
-#endif
+	p_generator->Initialise( mEntryAddress, 0, GetHitCounter(), &gCPUState, register_usage );
 
 	CJumpLocation jump = p_generator->ExecuteNativeFunction(function_ptr, true);
 	p_generator->GenerateIndirectExitCode(100, mpIndirectExitMap);
@@ -842,6 +896,11 @@ void CFragment::Assemble( CCodeBufferManager * p_manager, CCodeLabel function_pt
 	mFragmentFunctionLength = p_manager->FinaliseCurrentBlock();
 	mOutputLength = mFragmentFunctionLength - ADDITIONAL_OUTPUT_BYTES;
 
+	if( mpProfile != NULL )
+	{
+		DynarecProfile::SetHostCode( mpProfile, mEntryPoint.GetTarget(), mFragmentFunctionLength );
+	}
+
 	delete p_generator;
 }
 #endif
@@ -26,6 +26,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/R4300Instruction.h"
 
 #include "AssemblyUtils.h"
+#include "DynaRecProfile.h"
 
 #include <vector>
 
@@ -69,6 +70,9 @@ public:
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 		CFragment(CCodeBufferManager * p_manager, u32 entry_address, u32 input_length, void* function_Ptr);
 		void		Assemble( CCodeBufferManager * p_manager, CCodeLabel native_function);
+
+		// The HLE'd OS function this fragment calls, or NULL for a normal trace
+		const void *	GetNativeFunction() const				{ return mpNativeFunction; }
 #endif
 		~CFragment();
 
@@ -91,8 +95,8 @@ public:
 		void		DiscardPatchList()							{ mPatchList.clear(); }
 
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
-		u32			GetHitCount() const							{ return mHitCount; }
-		u32			GetCyclesExecuted() const					{ return mHitCount * mOutputLength / 4; }
+		u32			GetHitCount() const							{ return mpProfile ? mpProfile->HitCount : mHitCount; }
+		u32			GetCyclesExecuted() const					{ return GetHitCount() * mOutputLength / 4; }
 
 		u32			GetExitAddress() const						{ return mExitAddress; }
 #endif
@@ -103,6 +107,9 @@ private:
 
 		void		AddPatch( u32 address, CJumpLocation jump_location );
 
+		// The counter the generated code increments on entry, if any
+		u32 *		GetHitCounter();
+
 #ifdef FRAGMENT_SIMULATE_EXECUTION
 		CFragment *	Simulate();
 #endif
@@ -118,6 +125,10 @@ private:
 		u32								mFragmentFunctionLength;
 
 		CIndirectExitMap *				mpIndirectExitMap;
+		SFragmentProfile *				mpProfile;			// NULL unless DynarecProfile is enabled
+#ifdef DAEDALUS_ENABLE_OS_HOOKS
+		const void *					mpNativeFunction;
+#endif
 
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 		u32								mHitCount;
@@ -1154,6 +1154,67 @@ void StaticAnalysis_Cop1_DInstr( OpCode op_code, RegisterUsage & recorder )
 
 }
 
+namespace
+{
+
+// Ops which can appear in the body of an idle loop - loads and simple alu ops only.
+bool IsIdleLoopBodyOp( OpCode op_code )
+{
+	switch( op_code.op )
+	{
+	case OP_SPECOP:
+		switch( op_code.spec_op )
+		{
+		case SpecOp_SLL:	case SpecOp_SRL:	case SpecOp_SRA:
+		case SpecOp_SLLV:	case SpecOp_SRLV:	case SpecOp_SRAV:
+		case SpecOp_ADDU:	case SpecOp_SUBU:	case SpecOp_DADDU:	case SpecOp_DSUBU:
+		case SpecOp_AND:	case SpecOp_OR:		case SpecOp_XOR:	case SpecOp_NOR:
+		case SpecOp_SLT:	case SpecOp_SLTU:
+		case SpecOp_DSLL:	case SpecOp_DSRL:	case SpecOp_DSRA:
+		case SpecOp_DSLL32:	case SpecOp_DSRL32:	case SpecOp_DSRA32:
+			return true;
+		default:
+			return false;
+		}
+
+	case OP_ADDIU:	case OP_DADDIU:
+	case OP_SLTI:	case OP_SLTIU:
+	case OP_ANDI:	case OP_ORI:	case OP_XORI:	case OP_LUI:
+	case OP_LB:		case OP_LBU:	case OP_LH:		case OP_LHU:
+	case OP_LW:		case OP_LWU:	case OP_LD:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+bool IsIdleLoopBranchOp( OpCode op_code )
+{
+	switch( op_code.op )
+	{
+	case OP_J:
+	case OP_BEQ:	case OP_BNE:	case OP_BLEZ:	case OP_BGTZ:
+	case OP_BEQL:	case OP_BNEL:	case OP_BLEZL:	case OP_BGTZL:
+		return true;
+
+	case OP_REGIMM:
+		switch( op_code.regimm_op )
+		{
+		case RegImmOp_BLTZ:		case RegImmOp_BGEZ:
+		case RegImmOp_BLTZL:	case RegImmOp_BGEZL:
+			return true;
+		default:
+			return false;
+		}
+
+	default:
+		return false;
+	}
+}
+
+}
+
 namespace StaticAnalysis
 {
 
@@ -1163,4 +1224,82 @@ void Analyse( OpCode op_code, RegisterUsage & reg_usage )
 	gStaticAnalysisInstruction[ op_code.op ]( op_code, reg_usage );
 }
 
+bool IsIdleLoop( const OpCode * ops, u32 num_ops )
+{
+	if( num_ops < 2 || num_ops > kMaxIdleLoopOps )
+		return false;
+
+	const u32	branch_idx( num_ops - 2 );
+	u32			reads[ kMaxIdleLoopOps ];
+	u32			writes[ kMaxIdleLoopOps ];
+	u32			loop_writes( 0 );
+
+	for( u32 i = 0; i < num_ops; ++i )
+	{
+		bool valid( i == branch_idx ? IsIdleLoopBranchOp( ops[ i ] ) : IsIdleLoopBodyOp( ops[ i ] ) );
+		if( !valid )
+			return false;
+
+		RegisterUsage usage;
+		Analyse( ops[ i ], usage );
+
+		// r0 is never really written, so doesn't carry anything between iterations
+		reads[ i ] = ( usage.RegReads | usage.RegBase ) & ~1;
+		writes[ i ] = usage.RegWrites & ~1;
+		loop_writes |= writes[ i ];
+	}
+
+	//
+	//	For each register, track which values from the previous iteration it depends on.
+	//	At the top of the loop, registers written in the loop only depend on themselves.
+	//
+	u32 deps[ 32 ];
+	for( u32 r = 0; r < 32; ++r )
+	{
+		deps[ r ] = loop_writes & ( 1 << r );
+	}
+
+	for( u32 i = 0; i < num_ops; ++i )
+	{
+		if( writes[ i ] == 0 )
+			continue;
+
+		u32 d( 0 );
+		for( u32 r = 0; r < 32; ++r )
+		{
+			if( reads[ i ] & ( 1 << r ) )
+				d |= deps[ r ];
+		}
+
+		for( u32 r = 0; r < 32; ++r )
+		{
+			if( writes[ i ] & ( 1 << r ) )
+				deps[ r ] = d;
+		}
+	}
+
+	//
+	//	A register is stable if its value at the end of an iteration only depends on
+	//	other stable registers (e.g. it's reloaded from memory every iteration).
+	//	Counters and the like depend on themselves, so never become stable.
+	//
+	u32		stable( 0 );
+	bool	changed( true );
+	while( changed )
+	{
+		changed = false;
+		for( u32 r = 0; r < 32; ++r )
+		{
+			u32 mask( 1 << r );
+			if( ( loop_writes & ~stable & mask ) && ( deps[ r ] & ~stable ) == 0 )
+			{
+				stable |= mask;
+				changed = true;
+			}
+		}
+	}
+
+	return ( loop_writes & ~stable ) == 0;
+}
+
 }
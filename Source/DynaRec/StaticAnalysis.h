@@ -146,6 +146,16 @@ namespace StaticAnalysis
 	};
 
 	void		Analyse( OpCode op_code, RegisterUsage & reg_usage );
+
+	// Loops with more ops than this (including the branch and delay slot) are never considered idle
+	static const u32 kMaxIdleLoopOps = 8;
+
+	//
+	//	ops runs from the target of a backwards branch up to and including the branch delay slot.
+	//	Returns true if the loop only polls memory or registers it doesn't write itself (and has
+	//	no other side effects), so every iteration is identical until an interrupt changes something.
+	//
+	bool		IsIdleLoop( const OpCode * ops, u32 num_ops );
 }
 
 #endif // DYNAREC_STATICANALYSIS_H_
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <stdafx.h>
+#include "DynaRec/StaticAnalysis.h"
+#include "Core/R4300OpCode.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static bool IsIdle( const u32 * words, u32 num_words )
+{
+	std::vector<OpCode> ops( num_words );
+	for (u32 i = 0; i < num_words; ++i)
+		ops[i]._u32 = words[i];
+
+	return StaticAnalysis::IsIdleLoop( ops.empty() ? NULL : &ops[0], num_words );
+}
+
+TEST(IsIdleLoop, AcceptsBranchToSelf)
+{
+	const u32 ops[] = {
+		0x1000FFFF,		// BEQ   r0 == r0 --> self
+		0x00000000,		// NOP
+	};
+	EXPECT_TRUE(IsIdle( ops, 2 ));
+}
+
+TEST(IsIdleLoop, AcceptsPollingLoad)
+{
+	const u32 ops[] = {
+		0x01E4082A,		// SLT   at = (t7<a0)
+		0x5420FFFE,		// BNEL  at != r0 --> top
+		0x8C4F0000,		// LW    t7 <- 0x0000(v0)
+	};
+	EXPECT_TRUE(IsIdle( ops, 3 ));
+}
+
+TEST(IsIdleLoop, AcceptsLoopInvariantAddress)
+{
+	const u32 ops[] = {
+		0x3C088000,		// LUI   t0 = 0x8000
+		0x8D090000,		// LW    t1 <- 0x0000(t0)
+		0x1120FFFD,		// BEQ   t1 == r0 --> top
+		0x00000000,		// NOP
+	};
+	EXPECT_TRUE(IsIdle( ops, 4 ));
+}
+
+TEST(IsIdleLoop, RejectsCounters)
+{
+	const u32 ops[] = {
+		0x25080001,		// ADDIU t0 = t0 + 0x0001
+		0x1504FFFE,		// BNE   t0 != a0 --> top
+		0x00000000,		// NOP
+	};
+	EXPECT_FALSE(IsIdle( ops, 3 ));
+}
+
+TEST(IsIdleLoop, RejectsStores)
+{
+	const u32 ops[] = {
+		0x8C880000,		// LW    t0 <- 0x0000(a0)
+		0xAC880004,		// SW    t0 -> 0x0004(a0)
+		0x1000FFFD,		// BEQ   r0 == r0 --> top
+		0x00000000,		// NOP
+	};
+	EXPECT_FALSE(IsIdle( ops, 4 ));
+}
+
+TEST(IsIdleLoop, RejectsBadLengths)
+{
+	const u32 branch[] = { 0x1000FFFF };
+	EXPECT_FALSE(IsIdle( branch, 1 ));
+
+	// Too long, even though every op is a nop.
+	std::vector<u32> ops( StaticAnalysis::kMaxIdleLoopOps + 1, 0 );
+	ops[ ops.size() - 2 ] = 0x1000FFF8;		// BEQ   r0 == r0 --> top
+	EXPECT_FALSE(IsIdle( &ops[0], ops.size() ));
+
+	ops.erase( ops.begin() );
+	ops[ ops.size() - 2 ] = 0x1000FFF9;
+	EXPECT_TRUE(IsIdle( &ops[0], ops.size() ));
+}
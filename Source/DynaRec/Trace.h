@@ -50,6 +50,7 @@ struct SBranchDetails
 		,	Direct( false )
 		,	Eret( false )
 		,	SpeedHack( SHACK_NONE )
+		,	NativeFunction( NULL )
 	{
 	}
 
@@ -61,6 +62,7 @@ struct SBranchDetails
 	bool				Direct;
 	bool				Eret;
 	SpeedHackProbe		SpeedHack;
+	const void *		NativeFunction;		// HLE'd OS function called in place of this JAL's target, or NULL
 };
 
 #endif // DYNAREC_TRACE_H_
@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TraceRecorder.h"
 #include "Fragment.h"
 #include "BranchType.h"
+#include "StaticAnalysis.h"
 
 #include "Core/CPU.h"			// For dubious use of PC/NewPC
 #include "Core/Registers.h"
@@ -38,6 +39,12 @@ namespace
 	const u32 INDIRECT_EXIT_ADDRESS = u32( ~0 );
 
 	const u32 MAX_TRACE_LENGTH = 1500;
+
+	// Only short backwards branches can be busy-waits
+	bool IsPossibleIdleLoop( u32 branch_address, u32 target_address )
+	{
+		return branch_address - target_address <= ( StaticAnalysis::kMaxIdleLoopOps - 2 ) * 4;
+	}
 }
 CTraceRecorder				gTraceRecorder;
 
@@ -115,19 +122,27 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 		DAEDALUS_ASSERT( mActiveBranchIdx < mBranchDetails.size(), "Branch index is out of bounds" );
 		mBranchDetails[ mActiveBranchIdx ].DelaySlotTraceIndex = mTraceBuffer.size();
 
-		if (mBranchDetails[ mActiveBranchIdx ].SpeedHack == SHACK_POSSIBLE)
+		SBranchDetails & details( mBranchDetails[ mActiveBranchIdx ] );
+		if (details.SpeedHack == SHACK_POSSIBLE)
 		{
-			if (op_code._u32 == 0)
-			{
-				mBranchDetails[ mActiveBranchIdx ].SpeedHack = SHACK_SKIPTOEVENT;
+			const STraceEntry & branch( mTraceBuffer.back() );
+			u32		loop_target( GetBranchTarget( branch.Address, branch.OpCode, branch.Usage.BranchType ) );
+			bool	self_loop( branch.Address == loop_target );
 
+			if (IsIdleLoop( loop_target, op_code ))
+			{
+				details.SpeedHack = SHACK_SKIPTOEVENT;
 			}
 #ifndef DAEDALUS_SILENT
-			else if (op_code.op == OP_ADDIU || op_code.op == OP_DADDI || op_code.op == OP_ADDI || op_code.op == OP_DADDIU)
+			else if (self_loop && (op_code.op == OP_ADDIU || op_code.op == OP_DADDI || op_code.op == OP_ADDI || op_code.op == OP_DADDIU))
 			{	// We don't handle COPYREG SPEEDHACKS
-				mBranchDetails[ mActiveBranchIdx ].SpeedHack = SHACK_COPYREG;
+				details.SpeedHack = SHACK_COPYREG;
 			}
 #endif
+			else if (!self_loop)
+			{
+				details.SpeedHack = SHACK_NONE;
+			}
 		}
 
 		mActiveBranchIdx = INVALID_IDX;
@@ -191,7 +206,7 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 				mStopTraceAfterDelaySlot = true;
 			}
 
-			if (details.Direct && gCPUState.TargetPC == gCPUState.CurrentPC)
+			if (details.Direct && IsPossibleIdleLoop( gCPUState.CurrentPC, gCPUState.TargetPC ))
 			{
 				details.SpeedHack = SHACK_POSSIBLE;
 			}
@@ -211,7 +226,7 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 					mStopTraceAfterDelaySlot = true;
 				}
 
-				if (gCPUState.TargetPC == gCPUState.CurrentPC)
+				if (IsPossibleIdleLoop( gCPUState.CurrentPC, gCPUState.TargetPC ))
 				{
 					details.SpeedHack = SHACK_POSSIBLE;
 				}
@@ -265,6 +280,32 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 	return UTS_CONTINUE_TRACE;
 }
 
+//*************************************************************************************
+//	Called from the delay slot of a short backwards branch. The loop body has to
+//	have been recorded as part of this trace (it normally starts the trace).
+//*************************************************************************************
+bool	CTraceRecorder::IsIdleLoop( u32 target_address, OpCode delay_op ) const
+{
+	const u32	branch_address( mTraceBuffer.back().Address );
+	const u32	num_ops( ( ( branch_address - target_address ) >> 2 ) + 2 );
+	if( mTraceBuffer.size() < num_ops - 1 )
+		return false;
+
+	OpCode		ops[ StaticAnalysis::kMaxIdleLoopOps ];
+	u32			first_idx( mTraceBuffer.size() - ( num_ops - 1 ) );
+	for( u32 i = 0; i < num_ops - 1; ++i )
+	{
+		const STraceEntry & entry( mTraceBuffer[ first_idx + i ] );
+		if( entry.Address != target_address + i * 4 )
+			return false;
+
+		ops[ i ] = entry.OpCode;
+	}
+	ops[ num_ops - 1 ] = delay_op;
+
+	return StaticAnalysis::IsIdleLoop( ops, num_ops );
+}
+
 //*************************************************************************************
 //
 //*************************************************************************************
@@ -277,6 +318,40 @@ void	CTraceRecorder::StopTrace( u32 exit_address )
 	mExpectedExitTraceAddress = exit_address;
 }
 
+//*************************************************************************************
+//	True if the trace has just executed the delay slot of a JAL to function_address
+//*************************************************************************************
+bool	CTraceRecorder::CanInlineNativeCall( u32 function_address ) const
+{
+	DAEDALUS_ASSERT( mTracing, "We're not tracing" );
+
+	if( mActiveBranchIdx != INVALID_IDX || mBranchDetails.empty() || mTraceBuffer.size() > MAX_TRACE_LENGTH )
+		return false;
+
+	const SBranchDetails &	details( mBranchDetails.back() );
+	if( details.TargetAddress != function_address || details.DelaySlotTraceIndex != s32( mTraceBuffer.size() - 1 ) )
+		return false;
+
+	return mTraceBuffer[ details.DelaySlotTraceIndex - 1 ].OpCode.op == OP_JAL;
+}
+
+//*************************************************************************************
+//	The function called by the last JAL was HLE'd and returned to the caller, so
+//	call it from the generated code and carry on recording after the JAL.
+//*************************************************************************************
+void	CTraceRecorder::InlineNativeCall( const void * p_function )
+{
+	DAEDALUS_ASSERT( mTracing, "We're not tracing" );
+	DAEDALUS_ASSERT( !mBranchDetails.empty(), "There is no JAL to inline" );
+
+	SBranchDetails &	details( mBranchDetails.back() );
+	details.NativeFunction = p_function;
+
+	// The call exits the fragment if it doesn't come back to the JAL's return address
+	mNeedIndirectExitMap = true;
+	mExpectedExitTraceAddress = mTraceBuffer.back().Address + 4;
+}
+
 //*************************************************************************************
 //
 //*************************************************************************************
@@ -47,6 +47,8 @@ public:
 
 	EUpdateTraceStatus	UpdateTrace( u32 address, bool branch_delay_slot, bool branch_taken, OpCode op_code, CFragment * p_fragment );
 	void				StopTrace( u32 exit_address );
+	bool				CanInlineNativeCall( u32 function_address ) const;
+	void				InlineNativeCall( const void * p_function );
 	CFragment *			CreateFragment( CCodeBufferManager * p_manager );
 	void				AbortTrace();
 
@@ -67,6 +69,7 @@ private:
 	bool							mNeedIndirectExitMap;
 
 	void	Analyse(SRegisterUsageInfo & register_usage );
+	bool	IsIdleLoop( u32 target_address, OpCode delay_op ) const;
 };
 extern CTraceRecorder				gTraceRecorder;
 
@@ -0,0 +1,358 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "FrameDump.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <deque>
+
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
+#include "Graphics/PngUtil.h"
+#include "Utility/Cond.h"
+#include "Utility/IO.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+namespace
+{
+	enum EDumpFormat
+	{
+		DF_PNG,
+		DF_Y4M,
+		DF_RGBA,
+	};
+
+	struct SQueuedFrame
+	{
+		u8 *			Pixels;			// RGBA8888, top-down, tightly packed
+		u32				Width;
+		u32				Height;
+		bool			ScreenShot;
+		IO::Filename	Filename;		// Only used for screenshots
+	};
+
+	// Each queued frame is a full copy of the screen, so don't let too many pile up.
+	const u32					kMaxQueuedFrames = 8;
+
+	const char *				gScreenDumpRootPath = "ScreenShots";
+	const char *				gScreenDumpDumpPathFormat = "sd%04d.png";
+
+	ThreadHandle				sWriterThread( kInvalidThreadHandle );
+	Mutex						sQueueMutex;
+	Cond *						sFrameQueuedCond( NULL );
+	Cond *						sFrameTakenCond( NULL );
+	std::deque< SQueuedFrame * >	sQueue;
+	volatile bool				sQuit( false );
+
+	// Owned by the main thread
+	bool						sDumpActive( false );
+	u32							sDumpInterval( 1 );
+	u32							sDisplayedFrames( 0 );
+	u32							sNextScreenShot( 0 );
+
+	// Owned by the writer thread once it's running
+	EDumpFormat					sDumpFormat( DF_PNG );
+	IO::Filename				sDumpPath;
+	FILE *						sStreamFile( NULL );
+	u32							sStreamWidth( 0 );
+	u32							sStreamHeight( 0 );
+	u32							sFramesWritten( 0 );
+	u8 *						sYUVBuffer( NULL );
+
+	void	WriteY4MFrame( const SQueuedFrame * frame )
+	{
+		if( sStreamWidth == 0 )
+		{
+			sStreamWidth  = frame->Width;
+			sStreamHeight = frame->Height;
+			sYUVBuffer    = (u8 *)malloc( sStreamWidth * sStreamHeight * 3 );
+
+			// Frames are taken every sDumpInterval vbls of a nominally 60Hz display
+			fprintf( sStreamFile, "YUV4MPEG2 W%d H%d F60:%d Ip A1:1 C444\n", sStreamWidth, sStreamHeight, sDumpInterval );
+		}
+		else if( frame->Width != sStreamWidth || frame->Height != sStreamHeight )
+		{
+			// y4m can't change size mid stream
+			DBGConsole_Msg( 0, "Dropping %dx%d frame from %dx%d video dump", frame->Width, frame->Height, sStreamWidth, sStreamHeight );
+			return;
+		}
+
+		u32		num_pixels( sStreamWidth * sStreamHeight );
+		u8 *	y_plane( sYUVBuffer );
+		u8 *	u_plane( sYUVBuffer + num_pixels );
+		u8 *	v_plane( sYUVBuffer + num_pixels * 2 );
+
+		// BT.601, studio range
+		const u8 *	src( frame->Pixels );
+		for( u32 i = 0; i < num_pixels; ++i, src += 4 )
+		{
+			s32 r = src[0];
+			s32 g = src[1];
+			s32 b = src[2];
+
+			y_plane[i] = u8( ( (  66 * r + 129 * g +  25 * b + 128 ) >> 8 ) +  16 );
+			u_plane[i] = u8( ( ( -38 * r -  74 * g + 112 * b + 128 ) >> 8 ) + 128 );
+			v_plane[i] = u8( ( ( 112 * r -  94 * g -  18 * b + 128 ) >> 8 ) + 128 );
+		}
+
+		fputs( "FRAME\n", sStreamFile );
+		fwrite( sYUVBuffer, 1, num_pixels * 3, sStreamFile );
+	}
+
+	void	WriteFrame( const SQueuedFrame * frame )
+	{
+		if( frame->ScreenShot )
+		{
+			PngSaveImage( frame->Filename, frame->Pixels, NULL, TexFmt_8888, frame->Width * 4, frame->Width, frame->Height, false );
+			return;
+		}
+
+		switch( sDumpFormat )
+		{
+		case DF_PNG:
+			{
+				char			name[ 32 ];
+				IO::Filename	filename;
+				sprintf( name, "frame%06d.png", sFramesWritten );
+				IO::Path::Combine( filename, sDumpPath, name );
+
+				PngSaveImage( filename, frame->Pixels, NULL, TexFmt_8888, frame->Width * 4, frame->Width, frame->Height, false );
+			}
+			break;
+		case DF_Y4M:
+			WriteY4MFrame( frame );
+			break;
+		case DF_RGBA:
+			fwrite( frame->Pixels, 1, frame->Width * frame->Height * 4, sStreamFile );
+			break;
+		}
+
+		++sFramesWritten;
+	}
+
+	u32 DAEDALUS_THREAD_CALL_TYPE FrameWriterThread( void * arg )
+	{
+		for( ;; )
+		{
+			SQueuedFrame *	frame;
+			{
+				MutexLock	lock( &sQueueMutex );
+				while( sQueue.empty() && !sQuit )
+				{
+					CondWait( sFrameQueuedCond, &sQueueMutex, kTimeoutInfinity );
+				}
+
+				// Drain everything that was queued before we were asked to stop
+				if( sQueue.empty() )
+					break;
+
+				frame = sQueue.front();
+				sQueue.pop_front();
+				CondSignal( sFrameTakenCond );
+			}
+
+			WriteFrame( frame );
+
+			free( frame->Pixels );
+			delete frame;
+		}
+
+		return 0;
+	}
+
+	bool	EnsureWriterThread()
+	{
+		if( sWriterThread != kInvalidThreadHandle )
+			return true;
+
+		if( sFrameQueuedCond == NULL )
+		{
+			sFrameQueuedCond = CondCreate();
+			sFrameTakenCond  = CondCreate();
+		}
+
+		sQuit = false;
+		sWriterThread = CreateThread( "FrameWriter", &FrameWriterThread, NULL );
+		return sWriterThread != kInvalidThreadHandle;
+	}
+}
+
+bool FrameDump_Start( const char * path, u32 interval )
+{
+	DAEDALUS_ASSERT( !sDumpActive, "Already dumping frames" );
+
+	const char *	ext( IO::Path::FindExtension( path ) );
+	if( ext != NULL && _strcmpi( ext, ".y4m" ) == 0 )
+	{
+		sDumpFormat = DF_Y4M;
+	}
+	else if( ext != NULL && _strcmpi( ext, ".rgba" ) == 0 )
+	{
+		sDumpFormat = DF_RGBA;
+	}
+	else
+	{
+		sDumpFormat = DF_PNG;
+	}
+
+	if( sDumpFormat == DF_PNG )
+	{
+		if( !IO::Directory::EnsureExists( path ) )
+		{
+			DBGConsole_Msg( 0, "Couldn't create frame dump directory [C%s]", path );
+			return false;
+		}
+	}
+	else
+	{
+		sStreamFile = fopen( path, "wb" );
+		if( sStreamFile == NULL )
+		{
+			DBGConsole_Msg( 0, "Couldn't open [C%s] for writing", path );
+			return false;
+		}
+	}
+
+	IO::Path::Assign( sDumpPath, path );
+	sStreamWidth     = 0;
+	sStreamHeight    = 0;
+	sFramesWritten   = 0;
+	sDisplayedFrames = 0;
+	sDumpInterval    = interval > 0 ? interval : 1;
+
+	if( !EnsureWriterThread() )
+	{
+		if( sStreamFile != NULL )
+		{
+			fclose( sStreamFile );
+			sStreamFile = NULL;
+		}
+		return false;
+	}
+
+	sDumpActive = true;
+	return true;
+}
+
+void FrameDump_Stop()
+{
+	if( sWriterThread != kInvalidThreadHandle )
+	{
+		{
+			MutexLock	lock( &sQueueMutex );
+			sQuit = true;
+			CondSignal( sFrameQueuedCond );
+		}
+
+		JoinThread( sWriterThread, -1 );
+		ReleaseThreadHandle( sWriterThread );
+		sWriterThread = kInvalidThreadHandle;
+	}
+
+	if( sStreamFile != NULL )
+	{
+		fclose( sStreamFile );
+		sStreamFile = NULL;
+	}
+
+	if( sYUVBuffer != NULL )
+	{
+		free( sYUVBuffer );
+		sYUVBuffer = NULL;
+	}
+
+	if( sFrameQueuedCond != NULL )
+	{
+		CondDestroy( sFrameQueuedCond );
+		CondDestroy( sFrameTakenCond );
+		sFrameQueuedCond = NULL;
+		sFrameTakenCond  = NULL;
+	}
+
+	sDumpActive = false;
+}
+
+bool FrameDump_IsActive()
+{
+	return sDumpActive;
+}
+
+bool FrameDump_ShouldCaptureFrame()
+{
+	if( !sDumpActive )
+		return false;
+
+	return ( sDisplayedFrames++ % sDumpInterval ) == 0;
+}
+
+void FrameDump_SubmitFrame( const void * pixels, s32 pitch, u32 width, u32 height, const char * filename )
+{
+	if( !EnsureWriterThread() )
+		return;
+
+	SQueuedFrame *	frame( new SQueuedFrame );
+	u32				row_bytes( width * 4 );
+
+	frame->Pixels     = (u8 *)malloc( row_bytes * height );
+	frame->Width      = width;
+	frame->Height     = height;
+	frame->ScreenShot = filename != NULL;
+	IO::Path::Assign( frame->Filename, filename != NULL ? filename : "" );
+
+	const u8 *	src( static_cast< const u8 * >( pixels ) );
+	for( u32 y = 0; y < height; ++y )
+	{
+		memcpy( frame->Pixels + y * row_bytes, src, row_bytes );
+		src += pitch;
+	}
+
+	MutexLock	lock( &sQueueMutex );
+	while( sQueue.size() >= kMaxQueuedFrames )
+	{
+		CondWait( sFrameTakenCond, &sQueueMutex, kTimeoutInfinity );
+	}
+
+	sQueue.push_back( frame );
+	CondSignal( sFrameQueuedCond );
+}
+
+void FrameDump_GetScreenShotFilename( char * p_filename )
+{
+	IO::Filename dumpdir;
+	IO::Path::Combine(dumpdir, g_ROM.settings.GameName.c_str(), gScreenDumpRootPath);
+
+	IO::Filename filepath;
+	Dump_GetDumpDirectory(filepath, dumpdir);
+
+	// Screenshots are written asynchronously, so the last one might not be on disk yet.
+	do
+	{
+		IO::Filename test_name;
+
+		sprintf(test_name, gScreenDumpDumpPathFormat, sNextScreenShot++);
+		IO::Path::Combine( p_filename, filepath, test_name );
+
+	} while( IO::File::Exists( p_filename ) );
+}
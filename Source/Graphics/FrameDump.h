@@ -0,0 +1,48 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef GRAPHICS_FRAMEDUMP_H_
+#define GRAPHICS_FRAMEDUMP_H_
+
+#include "Utility/DaedalusTypes.h"
+
+//
+//	Frames are encoded and written out on a background thread, so the graphics
+//	contexts only have to get the pixels back into system memory.
+//
+//	A path ending in .y4m is written as a YUV4MPEG2 video and one ending in .rgba
+//	as raw RGBA8888 frames. Any other path is treated as a directory of numbered PNGs.
+//
+bool	FrameDump_Start( const char * path, u32 interval );
+void	FrameDump_Stop();
+bool	FrameDump_IsActive();
+
+// Called once per displayed frame. Returns true if this frame should be passed to FrameDump_SubmitFrame.
+bool	FrameDump_ShouldCaptureFrame();
+
+// Copies an RGBA8888 image and queues it for writing. Use a negative pitch for bottom-up images.
+// If filename is NULL the frame is added to the dump, otherwise it's saved as a standalone PNG.
+// Blocks if the writer thread has fallen too far behind.
+void	FrameDump_SubmitFrame( const void * pixels, s32 pitch, u32 width, u32 height, const char * filename );
+
+// Generates the next unused screenshot filename for the current rom.
+void	FrameDump_GetScreenShotFilename( char * p_filename );
+
+#endif // GRAPHICS_FRAMEDUMP_H_
@@ -60,6 +60,25 @@ class CNativeTexture : public CRefCounted
 		inline const void *				GetData() const					{ return mpData; }
 		inline void *					GetData()						{ return mpData; }
 
+#ifdef DAEDALUS_GL
+		// Textures are stored as a layer of a GL_TEXTURE_2D_ARRAY. Small textures share arrays
+		// with others of the same size, so switching between them doesn't need a rebind.
+		inline GLuint					GetTextureId() const			{ return mTextureId; }
+		inline u32						GetLayer() const				{ return mLayer; }
+		void							InstallTexture( u32 unit ) const;
+
+		// Upload an RGBA8888 image detail times the corrected size in each dimension, e.g. a hi-res
+		// replacement. The texture keeps its N64 dimensions, and the next SetData reverts to them.
+		void							SetDetailData( const void * data, u32 detail );
+		inline u32						GetDetail() const				{ return mDetail; }
+#endif
+
+#ifdef DAEDALUS_SOFTWARE_RENDERER
+		// RGBA8888 copy of the texture for the rasterizer to sample from (aliases mpData for TexFmt_8888).
+		inline const u32 *				GetTexels() const				{ return mpTexels; }
+		inline u32						GetTexelPitch() const			{ return mTexelPitch; }
+#endif
+
 #ifdef DAEDALUS_PSP
 		inline f32						GetScaleX() const				{ return mScale.x; }
 		inline f32						GetScaleY() const				{ return mScale.y; }
@@ -81,6 +100,16 @@ class CNativeTexture : public CRefCounted
 
 #ifdef DAEDALUS_GL
 		GLuint				mTextureId;
+		u32					mLayer;
+		u32					mDetail;				// Texels per N64 texel, in each dimension
+
+		void				AllocateStorage( u32 detail );
+		void				ReleaseStorage();
+#endif
+
+#ifdef DAEDALUS_SOFTWARE_RENDERER
+		u32 *				mpTexels;
+		u32					mTexelPitch;			// In texels
 #endif
 
 #ifdef DAEDALUS_PSP
@@ -23,6 +23,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureCache.h"
 #include "RDPStateManager.h"
 #include "DLDebug.h"
+#include "DLStats.h"
+#include "TnLCache.h"
 
 #include "Graphics/NativeTexture.h"
 #include "Graphics/GraphicsContext.h"
@@ -34,6 +36,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Core/Memory.h"		// We access the memory buffers
 #include "Core/ROM.h"
+#include "Config/ConfigOptions.h"
 
 #include "OSHLE/ultra_gbi.h"
 
@@ -42,6 +45,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Utility/Profiler.h"
 #include "Utility/AuxFunc.h"
+#include "Utility/Hash.h"
+#include "Test/Benchmark.h"
 
 #include <vector>
 
@@ -60,7 +65,7 @@ struct TempVerts
 
 	~TempVerts()
 	{
-#ifdef DAEDALUS_GL
+#if defined(DAEDALUS_GL) || defined(DAEDALUS_SOFTWARE_RENDERER)
 		free(Verts);
 #endif
 	}
@@ -71,7 +76,7 @@ struct TempVerts
 #ifdef DAEDALUS_PSP
 		Verts = static_cast<DaedalusVtx*>(sceGuGetMemory(bytes));
 #endif
-#ifdef DAEDALUS_GL
+#if defined(DAEDALUS_GL) || defined(DAEDALUS_SOFTWARE_RENDERER)
 		Verts = static_cast<DaedalusVtx*>(malloc(bytes));
 #endif
 
@@ -178,6 +183,8 @@ BaseRenderer::BaseRenderer()
 	mTnL.TextureScaleY = 1.0f;
 
 	memset( mTnL.Lights, 0, sizeof(mTnL.Lights) );
+
+	TnLCache_Reset();
 }
 
 //*****************************************************************************
@@ -280,6 +287,14 @@ void BaseRenderer::EndScene()
 	}
 }
 
+//*****************************************************************************
+//
+//*****************************************************************************
+void BaseRenderer::GetTargetSize( u32 * width, u32 * height ) const
+{
+	CGraphicsContext::Get()->ViewportType( width, height );
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -292,7 +307,7 @@ void BaseRenderer::InitViewport()
 	// Get the current display dimensions. This might change frame by frame e.g. if the window is resized.
 	u32 display_width  = 0;
 	u32 display_height = 0;
-	CGraphicsContext::Get()->ViewportType(&display_width, &display_height);
+	GetTargetSize(&display_width, &display_height);
 
 	DAEDALUS_ASSERT( display_width && display_height, "Unhandled viewport type" );
 
@@ -386,6 +401,8 @@ void BaseRenderer::UpdateViewport()
 	sceGuViewport(vx + vp_x, vy + vp_y, vp_w, vp_h);
 #elif defined(DAEDALUS_GL)
 	glViewport(vp_x, (s32)mScreenHeight - (vp_h + vp_y), vp_w, vp_h);
+#elif defined(DAEDALUS_SOFTWARE_RENDERER)
+	SoftRenderer_SetViewport(vp_x, vp_y, vp_w, vp_h);
 #else
 	DAEDALUS_ERROR("Code to set viewport not implemented on this platform");
 #endif
@@ -458,6 +475,8 @@ bool BaseRenderer::AddTri(u32 v0, u32 v1, u32 v2)
 	++mNumTrisRendered;
 #endif
 
+	++gDLStatsNumTris;
+
 	DAEDALUS_ASSERT( mNumIndices + 3 < kMaxIndices, "Array overflow, too many Indices" );
 
 	mIndexBuffer[ mNumIndices++ ] = (u16)v0;
@@ -848,6 +867,8 @@ void BaseRenderer::PrepareTrisUnclipped( TempVerts * temp_verts ) const
 #ifdef DAEDALUS_PSP_USE_VFPU
 void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	const FiddledVtx * const pVtxBase( (const FiddledVtx*)(g_pu8RamBase + address) );
 
 	UpdateWorldProject();
@@ -1011,8 +1032,24 @@ v3 BaseRenderer::LightPointVert( const v4 & w ) const
 //*****************************************************************************
 // Standard rendering pipeline using FPU/CPU
 //*****************************************************************************
+u32 BaseRenderer::HashTnLState() const
+{
+	u32 hash = murmur2_hash( &mWorldProject, sizeof(Matrix4x4), mTnL.Flags._u32 );
+	hash = murmur2_hash( &mModelViewStack[mModelViewTop], sizeof(Matrix4x4), hash );
+	hash = murmur2_hash( &mTnL.TextureScaleX, 2 * sizeof(float), hash );
+
+	// Ambient is stored after the last light.
+	if ( mTnL.Flags.Light )
+	{
+		hash = murmur2_hash( mTnL.Lights, (mTnL.NumLights + 1) * sizeof(DaedalusLight), hash ^ mTnL.NumLights );
+	}
+	return hash;
+}
+
 void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	const FiddledVtx * pVtxBase = (const FiddledVtx*)(g_pu8RamBase + address);
 	UpdateWorldProject();
 	PokeWorldProject();
@@ -1023,6 +1060,29 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 	DL_PF( "    Ambient color RGB[%f][%f][%f] Texture scale X[%f] Texture scale Y[%f]", mTnL.Lights[mTnL.NumLights].Colour.x, mTnL.Lights[mTnL.NumLights].Colour.y, mTnL.Lights[mTnL.NumLights].Colour.z, mTnL.TextureScaleX, mTnL.TextureScaleY);
 	DL_PF( "    Light[%s] Texture[%s] EnvMap[%s] Fog[%s]", (mTnL.Flags.Light)? "On":"Off", (mTnL.Flags.Texture)? "On":"Off", (mTnL.Flags.TexGen)? (mTnL.Flags.TexGenLin)? "Linear":"Spherical":"Off", (mTnL.Flags.Fog)? "On":"Off");
 
+	u64 start_ticks = 0;
+	if ( gBenchmarkRunning )
+		NTiming::GetPreciseTime( &start_ticks );
+
+	// Static geometry is usually loaded with the same matrices and lights every frame
+	STnLCacheKey cache_key;
+	const bool cacheable = gTnLCacheEnabled && n >= kTnLCacheMinVerts;
+	if ( cacheable )
+	{
+		TnLCache_MakeKey( address, n, HashTnLState(), &cache_key );
+		if ( TnLCache_Find( cache_key, &mVtxProjected[v0] ) )
+		{
+			DL_PF( "    TnL cache hit" );
+			if ( start_ticks != 0 )
+			{
+				u64 now;
+				NTiming::GetPreciseTime( &now );
+				TnLCache_AddTime( true, now - start_ticks );
+			}
+			return;
+		}
+	}
+
 	// Transform and Project + Lighting or Transform and Project with Colour
 	//
 	for (u32 i = v0; i < v0 + n; i++)
@@ -1145,6 +1205,17 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 		}
 		*/
 	}
+
+	if ( cacheable )
+	{
+		TnLCache_Add( cache_key, &mVtxProjected[v0] );
+		if ( start_ticks != 0 )
+		{
+			u64 now;
+			NTiming::GetPreciseTime( &now );
+			TnLCache_AddTime( false, now - start_ticks );
+		}
+	}
 }
 
 #endif // Transform VFPU/FPU
@@ -1155,6 +1226,8 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 #ifdef DAEDALUS_PSP_USE_VFPU
 void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	const FiddledVtx * const pVtxBase( (const FiddledVtx*)(g_pu8RamBase + address) );
 	const Matrix4x4 & mat_project = mProjectionMat;
 	const Matrix4x4 & mat_world = mModelViewStack[mModelViewTop];
@@ -1173,6 +1246,8 @@ void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 
 void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	//DBGConsole_Msg(0, "In SetNewVertexInfo");
 	const FiddledVtx * const pVtxBase( (const FiddledVtx*)(g_pu8RamBase + address) );
 	const Matrix4x4 & mat_project = mProjectionMat;
@@ -1332,6 +1407,8 @@ void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 //*****************************************************************************
 void BaseRenderer::SetNewVertexInfoDKR(u32 address, u32 v0, u32 n, bool billboard)
 {
+	gDLStatsNumVerts += n;
+
 	u32 pVtxBase = u32(g_pu8RamBase + address);
 	const Matrix4x4 & mat_world_project = mModelViewStack[mDKRMatIdx];
 
@@ -1445,6 +1522,8 @@ void BaseRenderer::SetNewVertexInfoDKR(u32 address, u32 v0, u32 n, bool billboar
 #ifdef DAEDALUS_PSP_USE_VFPU
 void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	const FiddledVtxPD * const pVtxBase = (const FiddledVtxPD*)(g_pu8RamBase + address);
 
 	const Matrix4x4 & mat_world = mModelViewStack[mModelViewTop];
@@ -1462,6 +1541,8 @@ void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 #else
 void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 {
+	gDLStatsNumVerts += n;
+
 	const FiddledVtxPD * const pVtxBase = (const FiddledVtxPD*)(g_pu8RamBase + address);
 
 	const Matrix4x4 & mat_world = mModelViewStack[mModelViewTop];
@@ -1688,7 +1769,7 @@ void BaseRenderer::UpdateTileSnapshots( u32 tile_idx )
 		// LOD is disabled - use two textures
 		UpdateTileSnapshot( 1, tile_idx + 1 );
 	}
-#elif defined(DAEDALUS_GL) || defined(RDP_USE_TEXEL1)
+#elif defined(DAEDALUS_GL) || defined(DAEDALUS_SOFTWARE_RENDERER) || defined(RDP_USE_TEXEL1)
 // FIXME(strmnnrmn): What's RDP_USE_TEXEL1? Can we remove it?
 
 	if (gRDPOtherMode.cycle_type == CYCLE_2CYCLE)
@@ -1792,6 +1873,8 @@ void BaseRenderer::UpdateTileSnapshot( u32 index, u32 tile_idx )
 		}
 		else
 		{
+			PrepareTextureLoad( ti );
+
 			CRefPtr<CNativeTexture> texture = CTextureCache::Get()->GetOrCreateTexture( ti );
 
 			if( texture != NULL && texture != mBoundTexture[ index ] )
@@ -1920,7 +2003,7 @@ void BaseRenderer::PrepareTexRectUVs(TexCoord * puv0, TexCoord * puv1)
 	if (rdp_tile.mirror_s)	size_x *= 2;
 	if (rdp_tile.mirror_t)	size_y *= 2;
 
-#ifdef DAEDALUS_GL
+#if defined(DAEDALUS_GL) || defined(DAEDALUS_SOFTWARE_RENDERER)
 	// If using shift, we need to take it into account here.
 	offset.s = ApplyShift(offset.s, rdp_tile.shift_s);
 	offset.t = ApplyShift(offset.t, rdp_tile.shift_t);
@@ -1940,6 +2023,8 @@ void BaseRenderer::PrepareTexRectUVs(TexCoord * puv0, TexCoord * puv1)
 //*****************************************************************************
 CRefPtr<CNativeTexture> BaseRenderer::LoadTextureDirectly( const TextureInfo & ti )
 {
+	PrepareTextureLoad( ti );
+
 	CRefPtr<CNativeTexture> texture = CTextureCache::Get()->GetOrCreateTexture( ti );
 	DAEDALUS_ASSERT( texture, "texture is NULL" );
 
@@ -1983,6 +2068,8 @@ void BaseRenderer::SetScissor( u32 x0, u32 y0, u32 x1, u32 y1 )
 	s32 w = Max<s32>( r - l, 0 );
 	s32 h = Max<s32>( b - t, 0 );
 	glScissor( l, (s32)mScreenHeight - (t + h), w, h );
+#elif defined(DAEDALUS_SOFTWARE_RENDERER)
+	SoftRenderer_SetScissor( l, t, r, b );
 #else
 	DAEDALUS_ERROR("Need to implement scissor for this platform.")
 #endif
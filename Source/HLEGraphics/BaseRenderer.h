@@ -30,8 +30,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Graphics/ColourValue.h"
 #include "Utility/Preferences.h"
 
-#ifdef DAEDALUS_PSP
+#if defined(DAEDALUS_PSP)
 #include <pspgu.h>
+#elif defined(DAEDALUS_SOFTWARE_RENDERER)
+#include "SysSoft/Soft.h"
 #else
 #include "SysGL/GL.h"
 #endif
@@ -39,6 +41,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define HD_SCALE                          0.754166f
 
 class CNativeTexture;
+struct SImageDescriptor;
 struct TempVerts;
 
 // FIXME - this is for the PSP only.
@@ -259,7 +262,12 @@ public:
 
 	// Viewport stuff
 	void				SetN64Viewport( const v2 & scale, const v2 & trans );
-	void				SetScissor( u32 x0, u32 y0, u32 x1, u32 y1 );
+	virtual void		SetScissor( u32 x0, u32 y0, u32 x1, u32 y1 );
+
+	// Framebuffer stuff. Renderers that keep colour images on the GPU use these to
+	// switch render targets, and to resolve them before a texture is read from RDRAM.
+	virtual void		SetColourImage( const SImageDescriptor & ci )	{}
+	virtual void		PrepareTextureLoad( const TextureInfo & ti )	{}
 
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	void				PrintActive();
@@ -330,6 +338,11 @@ protected:
 #ifdef DAEDALUS_GL
 	inline void			UpdateFogEnable()						{ if(gFogEnabled) mTnL.Flags.Fog ? glEnable(GL_FOG) : glDisable(GL_FOG); }
 	inline void			UpdateShadeModel()						{ glShadeModel( mTnL.Flags.Shade ? GL_SMOOTH : GL_FLAT ); }
+#endif
+#ifdef DAEDALUS_SOFTWARE_RENDERER
+	// The software rasterizer doesn't do fog, and always interpolates colours.
+	inline void			UpdateFogEnable()						{}
+	inline void			UpdateShadeModel()						{}
 #endif
 	void				UpdateTileSnapshots( u32 tile_idx );
 	void				UpdateTileSnapshot( u32 index, u32 tile_idx );
@@ -338,6 +351,9 @@ protected:
 
 	virtual void		RestoreRenderStates() = 0;
 
+	// Size of the surface we render into. By default this is the display.
+	virtual void		GetTargetSize( u32 * width, u32 * height ) const;
+
 	//*****************************************************************************
 	// We round these value here, so that when we scale up the coords to our screen
 	// coords we don't get any gaps.
@@ -369,6 +385,7 @@ private:
 
 	inline void			UpdateWorldProject();
 	inline void 		PokeWorldProject();
+	u32					HashTnLState() const;				// Everything but the vertices that SetNewVertexInfo's output depends on
 
 protected:
 	static const u32 kMaxN64Vertices = 80;		// F3DLP.Rej supports up to 80 verts!
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureInfo.h"
 #include "ConvertImage.h"
 #include "ConvertTile.h"
+#include "TexelCache.h"
 #include "Graphics/ColourValue.h"
 #include "Graphics/NativePixelFormat.h"
 #include "Graphics/NativeTexture.h"
@@ -57,7 +58,7 @@ static const bool kUpdateTexturesEveryFrame = true;
 #endif
 
 
-#if defined(DAEDALUS_GL) || defined(DAEDALUS_ACCURATE_TMEM)
+#if defined(DAEDALUS_GL) || defined(DAEDALUS_SOFTWARE_RENDERER) || defined(DAEDALUS_ACCURATE_TMEM)
 static ETextureFormat SelectNativeFormat(const TextureInfo & ti)
 {
 	// On OSX, always use RGBA 8888 textures.
@@ -137,8 +138,25 @@ static bool GenerateTexels(void ** p_texels,
 	}
 #endif
 
+#ifdef DAEDALUS_TEXEL_CACHE
+	u64 key;
+	const bool cacheable = texture_format == TexFmt_8888 && TexelCache_MakeKey( ti, &key );
+	if (cacheable && TexelCache_Load( key, ti, texels, pitch ))
+	{
+		*p_texels  = texels;
+		*p_palette = palette;
+		return true;
+	}
+#endif
+
 	if (ConvertTexture(ti, texels, palette, texture_format, pitch))
 	{
+#ifdef DAEDALUS_TEXEL_CACHE
+		if (cacheable)
+		{
+			TexelCache_Store( key, ti, texels, pitch );
+		}
+#endif
 		*p_texels  = texels;
 		*p_palette = palette;
 		return true;
@@ -215,6 +233,10 @@ CachedTexture::CachedTexture( const TextureInfo & ti )
 ,	mTextureContentsHash( 0 )
 ,	mFrameLastUpToDate( gRDPFrame )
 ,	mFrameLastUsed( gRDPFrame )
+#ifdef DAEDALUS_TEXTURE_PACKS
+,	mReplacementKey( 0 )
+,	mReplacementPending( false )
+#endif
 {
 }
 
@@ -245,6 +267,14 @@ bool CachedTexture::Initialise()
 		}
 		UpdateTextureHash();
 		UpdateTexture( mTextureInfo, mpTexture );
+
+#ifdef DAEDALUS_TEXTURE_PACKS
+		FindReplacement();
+		if( mReplacementPending )
+		{
+			ApplyReplacement();
+		}
+#endif
 	}
 
 	return mpTexture != NULL;
@@ -273,6 +303,9 @@ void CachedTexture::UpdateIfNecessary()
 		if (UpdateTextureHash())
 		{
 			UpdateTexture( mTextureInfo, mpTexture );
+#ifdef DAEDALUS_TEXTURE_PACKS
+			FindReplacement();
+#endif
 		}
 
 		// FIXME(strmnrmn): should probably recreate mpWhiteTexture if it exists, else it may have stale data.
@@ -280,9 +313,61 @@ void CachedTexture::UpdateIfNecessary()
 		mFrameLastUpToDate = gRDPFrame;
 	}
 
+#ifdef DAEDALUS_TEXTURE_PACKS
+	// Check once a frame whether the replacement has been decoded yet.
+	if( mReplacementPending && gRDPFrame != mFrameLastUsed )
+	{
+		ApplyReplacement();
+	}
+#endif
+
 	mFrameLastUsed = gRDPFrame;
 }
 
+#ifdef DAEDALUS_TEXTURE_PACKS
+// Called whenever the texels are regenerated, as that reverts the texture to its N64 resolution.
+void CachedTexture::FindReplacement()
+{
+	mReplacementPending = false;
+
+	// Recoloured and mirrored textures don't match the texels the replacement was made from.
+	if( !TexturePack_IsActive() || mpTexture == NULL || !mpTexture->HasData() ||
+		mpTexture->GetFormat() != TexFmt_8888 || mTextureInfo.GetWhite() ||
+		mTextureInfo.GetEmulateMirrorS() || mTextureInfo.GetEmulateMirrorT() )
+	{
+		return;
+	}
+
+	u32 width  = mTextureInfo.GetWidth();
+	u32 height = mTextureInfo.GetHeight();
+
+	mReplacementKey     = TexturePack_MakeKey( mpTexture->GetData(), mpTexture->GetStride(), width, height );
+	mReplacementPending = true;
+
+	TexturePack_Dump( mReplacementKey, mpTexture->GetData(), mpTexture->GetStride(), width, height );
+}
+
+void CachedTexture::ApplyReplacement()
+{
+	STexturePackImage image;
+	switch( TexturePack_Lookup( mReplacementKey, mTextureInfo.GetWidth(), mTextureInfo.GetHeight(),
+								mpTexture->GetCorrectedWidth(), mpTexture->GetCorrectedHeight(), &image ) )
+	{
+	case TPR_PENDING:
+		return;
+
+	case TPR_READY:
+		mpTexture->SetDetailData( image.Texels, image.Detail );
+		break;
+
+	case TPR_NONE:
+		break;
+	}
+
+	mReplacementPending = false;
+}
+#endif // DAEDALUS_TEXTURE_PACKS
+
 // IsFresh - has this cached texture been updated recently?
 bool CachedTexture::IsFresh() const
 {
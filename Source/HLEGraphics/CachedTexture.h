@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Graphics/NativeTexture.h"
 #include "TextureInfo.h"
+#include "TexturePack.h"
 
 extern u32 gRDPFrame;
 
@@ -53,6 +54,11 @@ class CachedTexture
 		bool							IsFresh() const;
 		bool							UpdateTextureHash();
 
+#ifdef DAEDALUS_TEXTURE_PACKS
+		void							FindReplacement();
+		void							ApplyReplacement();
+#endif
+
 	private:
 		const TextureInfo				mTextureInfo;
 
@@ -61,6 +67,11 @@ class CachedTexture
 		u32								mTextureContentsHash;
 		u32								mFrameLastUpToDate;	// Frame # that this was last updated
 		u32								mFrameLastUsed;		// Frame # that this was last used
+
+#ifdef DAEDALUS_TEXTURE_PACKS
+		u64								mReplacementKey;
+		bool							mReplacementPending;	// Waiting for the replacement to be decoded
+#endif
 };
 
 
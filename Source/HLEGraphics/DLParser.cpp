@@ -27,6 +27,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "N64PixelFormat.h"
 #include "Graphics/NativePixelFormat.h"
 #include "RDP.h"
+#include "DLStats.h"
 #include "RDPStateManager.h"
 #include "TextureCache.h"
 #include "ConvertImage.h"			// Convert555ToRGBA
@@ -47,6 +48,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "OSHLE/ultra_sptask.h"
 #include "Plugins/GraphicsPlugin.h"
 #include "Test/BatchTest.h"
+#include "Utility/Frameskip.h"
 #include "Utility/IO.h"
 #include "Utility/Profiler.h"
 
@@ -455,7 +457,17 @@ static u32 DLParser_ProcessDList(u32 instruction_limit)
 
 		PROFILE_DL_CMD( command.inst.cmd );
 
-		gUcodeFunc[ command.inst.cmd ]( command );
+		if( DAEDALUS_EXPECT_UNLIKELY( gDLStatsEnabled ) )
+		{
+			SDLStatsCounters start;
+			DLStats_BeginCommand( &start );
+			gUcodeFunc[ command.inst.cmd ]( command );
+			DLStats_EndCommand( command.inst.cmd, start );
+		}
+		else
+		{
+			gUcodeFunc[ command.inst.cmd ]( command );
+		}
 
 		DL_END_INSTR();
 
@@ -555,12 +567,36 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 
 	if(!gFrameskipActive)
 	{
+		u64 render_start;
+		NTiming::GetPreciseTime( &render_start );
+
 		gRenderer->SetVIScales();
 		gRenderer->ResetMatrices(stack_size);
 		gRenderer->Reset();
 		gRenderer->BeginScene();
+
+		const bool stats_enabled = gDLStatsEnabled;
+		if (stats_enabled)
+		{
+#if defined(DAEDALUS_DEBUG_DISPLAYLIST) || defined(DAEDALUS_ENABLE_PROFILING)
+			DLStats_BeginDisplayList(gUcodeName);
+#else
+			DLStats_BeginDisplayList(NULL);
+#endif
+		}
+
 		count = DLParser_ProcessDList(instruction_limit);
+
+		if (stats_enabled)
+		{
+			DLStats_EndDisplayList();
+		}
+
 		gRenderer->EndScene();
+
+		u64 render_end;
+		NTiming::GetPreciseTime( &render_end );
+		Frameskip_AddRenderTime( render_end - render_start );
 	}
 
 	// Hack for Chameleon Twist 2, only works if screen is update at last
@@ -877,6 +913,7 @@ void DLParser_SetTImg( MicroCodeCommand command )
 //*****************************************************************************
 void DLParser_LoadBlock( MicroCodeCommand command )
 {
+	++gDLStatsNumTextureLoads;
 	gRDPStateManager.LoadBlock( command.loadtile );
 }
 
@@ -885,6 +922,7 @@ void DLParser_LoadBlock( MicroCodeCommand command )
 //*****************************************************************************
 void DLParser_LoadTile( MicroCodeCommand command )
 {
+	++gDLStatsNumTextureLoads;
 	gRDPStateManager.LoadTile( command.loadtile );
 }
 
@@ -893,6 +931,7 @@ void DLParser_LoadTile( MicroCodeCommand command )
 //*****************************************************************************
 void DLParser_LoadTLut( MicroCodeCommand command )
 {
+	++gDLStatsNumTextureLoads;
 	gRDPStateManager.LoadTlut( command.loadtile );
 }
 
@@ -1184,6 +1223,12 @@ void DLParser_SetCImg( MicroCodeCommand command )
 	//g_CI.Bpl		= g_CI.Width << g_CI.Size >> 1;
 
 	DL_PF("    CImg Adr[0x%08x] Format[%s] Size[%s] Width[%d]", RDPSegAddr(command.inst.cmd1), gFormatNames[ g_CI.Format ], gSizeNames[ g_CI.Size ], g_CI.Width);
+
+	// Depth buffer clears are handled by DLParser_FillRect, don't treat them as a new render target.
+	if (g_CI.Address != g_DI.Address)
+	{
+		gRenderer->SetColourImage( g_CI );
+	}
 }
 
 //*****************************************************************************
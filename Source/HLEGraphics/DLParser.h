@@ -30,6 +30,9 @@ class DLDebugOutput;
 bool DLParser_Initialise();
 void DLParser_Finalise();
 
+// Set by the graphics plugin to skip rendering (but not processing) the next display lists.
+extern bool gFrameskipActive;
+
 const u32 kUnlimitedInstructionCount = u32( ~0 );
 u32 DLParser_Process(u32 instruction_limit = kUnlimitedInstructionCount, DLDebugOutput * debug_output = NULL);
 
@@ -0,0 +1,188 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "DLStats.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "Debug/DBGConsole.h"
+#include "Utility/Mutex.h"
+
+bool	gDLStatsEnabled = false;
+
+u32		gDLStatsNumTris = 0;
+u32		gDLStatsNumVerts = 0;
+u32		gDLStatsNumTextureLoads = 0;
+
+namespace
+{
+
+struct SDLCommandStats
+{
+	u32		Count;
+	u64		Ticks;
+	u32		Tris;
+	u32		Verts;
+	u32		TextureLoads;
+};
+
+const u32				kNumCommands = 256;
+
+// Written by the display list parser while a list is being processed.
+SDLCommandStats			sCurrent[ kNumCommands ];
+const char * const *	sCurrentNames = NULL;
+
+// Totals since the last reset. Guarded by sMutex, as the web debugger reads these.
+Mutex					sMutex;
+SDLCommandStats			sTotals[ kNumCommands ];
+const char *			sNames[ kNumCommands ];
+u32						sNumFrames = 0;
+
+}
+
+void DLStats_EndCommand( u32 cmd, const SDLStatsCounters & start )
+{
+	u64 now;
+	NTiming::GetPreciseTime( &now );
+
+	SDLCommandStats & stats( sCurrent[ cmd ] );
+	stats.Count++;
+	stats.Ticks += now - start.Ticks;
+	stats.Tris += gDLStatsNumTris - start.Tris;
+	stats.Verts += gDLStatsNumVerts - start.Verts;
+	stats.TextureLoads += gDLStatsNumTextureLoads - start.TextureLoads;
+}
+
+void DLStats_BeginDisplayList( const char * const * names )
+{
+	memset( sCurrent, 0, sizeof( sCurrent ) );
+	sCurrentNames = names;
+}
+
+void DLStats_EndDisplayList()
+{
+	MutexLock lock( &sMutex );
+
+	for( u32 i = 0; i < kNumCommands; ++i )
+	{
+		const SDLCommandStats & current( sCurrent[ i ] );
+		if( current.Count == 0 )
+			continue;
+
+		SDLCommandStats & total( sTotals[ i ] );
+		total.Count += current.Count;
+		total.Ticks += current.Ticks;
+		total.Tris += current.Tris;
+		total.Verts += current.Verts;
+		total.TextureLoads += current.TextureLoads;
+
+		if( sCurrentNames != NULL )
+			sNames[ i ] = sCurrentNames[ i ];
+	}
+	sNumFrames++;
+}
+
+void DLStats_SetEnabled( bool enabled )
+{
+	if( enabled && !gDLStatsEnabled )
+	{
+		DLStats_Reset();
+	}
+	gDLStatsEnabled = enabled;
+}
+
+void DLStats_Reset()
+{
+	MutexLock lock( &sMutex );
+
+	memset( sTotals, 0, sizeof( sTotals ) );
+	memset( sNames, 0, sizeof( sNames ) );
+	sNumFrames = 0;
+}
+
+void DLStats_Snapshot( std::vector< SDLStatsEntry > * entries, u32 * num_frames )
+{
+	MutexLock lock( &sMutex );
+
+	u64 frequency;
+	NTiming::GetPreciseFrequency( &frequency );
+	const f64	ms_per_tick = 1000.0 / f64( frequency );
+
+	entries->clear();
+	for( u32 i = 0; i < kNumCommands; ++i )
+	{
+		const SDLCommandStats & total( sTotals[ i ] );
+		if( total.Count == 0 )
+			continue;
+
+		SDLStatsEntry entry = { i, sNames[ i ], total.Count, f64( total.Ticks ) * ms_per_tick, total.Tris, total.Verts, total.TextureLoads };
+		entries->push_back( entry );
+	}
+	*num_frames = sNumFrames;
+}
+
+void DLStats_GetCSV( std::string * csv )
+{
+	std::vector< SDLStatsEntry >	entries;
+	u32								num_frames;
+	DLStats_Snapshot( &entries, &num_frames );
+
+	const f64	frames = num_frames > 0 ? f64( num_frames ) : 1.0;
+
+	*csv = "cmd,name,count,total_ms,count_per_frame,ms_per_frame,tris_per_frame,verts_per_frame,texture_loads_per_frame\n";
+
+	for( u32 i = 0; i < entries.size(); ++i )
+	{
+		const SDLStatsEntry & entry( entries[ i ] );
+
+		char line[ 256 ];
+		snprintf( line, sizeof( line ), "0x%02x,%s,%u,%.3f,%.1f,%.4f,%.1f,%.1f,%.1f\n",
+			entry.Cmd,
+			entry.Name ? entry.Name : "",
+			entry.Count,
+			entry.TotalMs,
+			f64( entry.Count ) / frames,
+			entry.TotalMs / frames,
+			f64( entry.Tris ) / frames,
+			f64( entry.Verts ) / frames,
+			f64( entry.TextureLoads ) / frames );
+		*csv += line;
+	}
+}
+
+bool DLStats_DumpCSV( const char * filename )
+{
+	FILE * fh( fopen( filename, "w" ) );
+	if( fh == NULL )
+	{
+		DBGConsole_Msg( 0, "Couldn't open [C%s] for writing", filename );
+		return false;
+	}
+
+	std::string csv;
+	DLStats_GetCSV( &csv );
+	fwrite( csv.c_str(), 1, csv.length(), fh );
+	fclose( fh );
+
+	DBGConsole_Msg( 0, "Wrote display list stats to [C%s]", filename );
+	return true;
+}
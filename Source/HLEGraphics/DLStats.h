@@ -0,0 +1,83 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef HLEGRAPHICS_DLSTATS_H_
+#define HLEGRAPHICS_DLSTATS_H_
+
+#include "Utility/Timing.h"
+
+#include <string>
+#include <vector>
+
+//
+//	Per-GBI-command counters. These are always compiled in, but only cost a
+//	flag test per command unless they've been switched on.
+//
+extern bool	gDLStatsEnabled;
+
+// Running totals, bumped by the renderer and texture loaders.
+extern u32	gDLStatsNumTris;
+extern u32	gDLStatsNumVerts;
+extern u32	gDLStatsNumTextureLoads;
+
+struct SDLStatsCounters
+{
+	u64		Ticks;
+	u32		Tris;
+	u32		Verts;
+	u32		TextureLoads;
+};
+
+inline void DLStats_BeginCommand( SDLStatsCounters * start )
+{
+	start->Tris = gDLStatsNumTris;
+	start->Verts = gDLStatsNumVerts;
+	start->TextureLoads = gDLStatsNumTextureLoads;
+	NTiming::GetPreciseTime( &start->Ticks );
+}
+
+void		DLStats_EndCommand( u32 cmd, const SDLStatsCounters & start );
+
+// names may be NULL if the build doesn't include ucode names.
+void		DLStats_BeginDisplayList( const char * const * names );
+void		DLStats_EndDisplayList();
+
+void		DLStats_SetEnabled( bool enabled );
+void		DLStats_Reset();
+
+struct SDLStatsEntry
+{
+	u32				Cmd;
+	const char *	Name;			// NULL if unknown
+	u32				Count;
+	f64				TotalMs;
+	u32				Tris;
+	u32				Verts;
+	u32				TextureLoads;
+};
+
+// The totals since the last reset, for each command seen.
+void		DLStats_Snapshot( std::vector< SDLStatsEntry > * entries, u32 * num_frames );
+
+// CSV of the totals since the last reset, one row per command seen.
+void		DLStats_GetCSV( std::string * csv );
+bool		DLStats_DumpCSV( const char * filename );
+
+#endif // HLEGRAPHICS_DLSTATS_H_
@@ -0,0 +1,157 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "DLStatsWebDebug.h"
+
+#include "DLStats.h"
+
+#include "SysOSX/Debug/WebDebug.h"
+#include "SysOSX/Debug/WebDebugTemplate.h"
+
+#include <algorithm>
+
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+struct SortByTime
+{
+	bool operator()( const SDLStatsEntry & a, const SDLStatsEntry & b ) const
+	{
+		return a.TotalMs > b.TotalMs;
+	}
+};
+
+static void DLStatsCSVHandler(void * arg, WebDebugConnection * connection)
+{
+	std::string csv;
+	DLStats_GetCSV( &csv );
+
+	connection->BeginResponse(200, csv.length(), "text/csv");
+	connection->WriteString(csv.c_str());
+	connection->EndResponse();
+}
+
+static void DLStatsHandler(void * arg, WebDebugConnection * connection)
+{
+	const WebDebugConnection::QueryParams & params = connection->GetQueryParams();
+	for (size_t i = 0; i < params.size(); ++i)
+	{
+		if (params[i].Key == "action")
+		{
+			if (params[i].Value == "enable")
+				DLStats_SetEnabled(true);
+			else if (params[i].Value == "disable")
+				DLStats_SetEnabled(false);
+			else if (params[i].Value == "reset")
+				DLStats_Reset();
+		}
+	}
+
+	std::vector<SDLStatsEntry>	entries;
+	u32							num_frames;
+	DLStats_Snapshot(&entries, &num_frames);
+	std::sort(entries.begin(), entries.end(), SortByTime());
+
+	f64 total_ms = 0.0;
+	for (size_t i = 0; i < entries.size(); ++i)
+		total_ms += entries[i].TotalMs;
+
+	const f64 frames = num_frames > 0 ? f64(num_frames) : 1.0;
+
+	connection->BeginResponse(200, -1, "text/html" );
+
+	WriteStandardHeader(connection, "Display List Stats");
+
+	connection->WriteString(
+		"<div class=\"container\">\n"
+		"	<div class=\"row\">\n"
+		"		<div class=\"span12\">\n"
+	);
+	connection->WriteString("<h1>Display List Stats</h1>\n");
+	connection->WriteF("<p>%s over %d frames. ", gDLStatsEnabled ? "Recording" : "Stopped", num_frames);
+	connection->WriteF("<a href=\"/dl_stats?action=%s\">%s</a> | ", gDLStatsEnabled ? "disable" : "enable", gDLStatsEnabled ? "Stop" : "Start");
+	connection->WriteString("<a href=\"/dl_stats?action=reset\">Reset</a> | ");
+	connection->WriteString("<a href=\"/dl_stats.csv\">CSV</a></p>\n");
+
+	connection->WriteString("<table class=\"table table-condensed\">");
+	connection->WriteString("<thead>");
+	connection->WriteString(
+		"<tr>"
+		"<th>Cmd</th>"
+		"<th>Name</th>"
+		"<th>Calls/frame</th>"
+		"<th>ms/frame</th>"
+		"<th>% time</th>"
+		"<th>Tris/frame</th>"
+		"<th>Verts/frame</th>"
+		"<th>Loads/frame</th>"
+		"</tr>"
+		"\n" );
+	connection->WriteString("</thead>");
+	connection->WriteString("<tbody>");
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		const SDLStatsEntry & entry = entries[i];
+
+		connection->WriteF(
+			"<tr>"
+			"<td>0x%02x</td>"
+			"<td>%s</td>"
+			"<td>%.1f</td>"
+			"<td>%.3f</td>"
+			"<td>%.1f</td>"
+			"<td>%.1f</td>"
+			"<td>%.1f</td>"
+			"<td>%.1f</td>"
+			"</tr>"
+			"\n",
+			entry.Cmd,
+			entry.Name ? entry.Name : "?",
+			f64(entry.Count) / frames,
+			entry.TotalMs / frames,
+			total_ms > 0.0 ? 100.0 * entry.TotalMs / total_ms : 0.0,
+			f64(entry.Tris) / frames,
+			f64(entry.Verts) / frames,
+			f64(entry.TextureLoads) / frames
+		);
+	}
+
+	connection->WriteString("</tbody>");
+	connection->WriteString("</table>");
+
+	connection->WriteString(
+		"		</div>\n"
+		"	</div>\n"
+		"</div>\n"
+	);
+
+	WriteStandardFooter(connection);
+	connection->EndResponse();
+}
+#endif // DAEDALUS_DEBUG_DISPLAYLIST
+
+bool DLStats_RegisterWebDebug()
+{
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+	WebDebug_Register( "/dl_stats", &DLStatsHandler, NULL );
+	WebDebug_Register( "/dl_stats.csv", &DLStatsCSVHandler, NULL );
+#endif
+	return true;
+}
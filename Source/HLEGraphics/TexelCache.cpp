@@ -0,0 +1,444 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "HLEGraphics/TexelCache.h"
+
+#ifdef DAEDALUS_TEXEL_CACHE
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Config/ConfigOptions.h"
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+#include "HLEGraphics/TextureInfo.h"
+#include "OSHLE/ultra_gbi.h"
+#include "System/Paths.h"
+#include "Utility/Hash.h"
+#include "Utility/IO.h"
+
+namespace
+{
+
+const u32	kMinCachedBytes	= 16 * 1024;		// Smaller textures are quicker to convert than to load
+const u32	kEntryMagic		= 0x31435854;		// 'TXC1'
+const u32	kIndexMagic		= 0x31495854;		// 'TXI1'
+
+struct SEntryHeader
+{
+	u32		Magic;
+	u32		Width;
+	u32		Height;
+	u32		Reserved;
+};
+
+struct SIndexRecord
+{
+	u64		Key;
+	u32		Size;
+	u32		LastUse;
+};
+
+struct SEntry
+{
+	u32		Size;				// Including the header
+	u32		LastUse;
+};
+
+typedef std::map< u64, SEntry >	EntryMap;
+
+bool			gLoaded = false;
+EntryMap		gEntries;
+u64				gTotalBytes = 0;
+u32				gClock = 0;
+u32				gHits = 0;
+u32				gMisses = 0;
+IO::Filename	gCacheDir;
+
+// Hashed along with the texels, so the same bytes in a different format get their own entry.
+struct SKeyFields
+{
+	u16		Width;
+	u16		Height;
+	u16		Pitch;
+	u8		Format;
+	u8		Size;
+	u8		TLutFmt;
+	u8		Swapped;
+	u8		Pad[6];
+};
+
+void GetIndexFilename( char * filename )
+{
+	IO::Path::Combine( filename, gCacheDir, "index.bin" );
+}
+
+void GetEntryFilename( char * filename, u64 key )
+{
+	char name[ 32 ];
+	sprintf( name, "%08x%08x.bin", u32( key >> 32 ), u32( key ) );
+	IO::Path::Combine( filename, gCacheDir, name );
+}
+
+u64 GetLimitBytes()
+{
+	return u64( gTexelCacheSizeMB ) * 1024 * 1024;
+}
+
+void DeleteEntry( EntryMap::iterator it )
+{
+	IO::Filename filename;
+	GetEntryFilename( filename, it->first );
+	IO::File::Delete( filename );
+
+	gTotalBytes -= it->second.Size;
+	gEntries.erase( it );
+}
+
+bool OlderThan( const EntryMap::iterator & a, const EntryMap::iterator & b )
+{
+	return a->second.LastUse < b->second.LastUse;
+}
+
+// Evict least recently used entries until we're comfortably under the limit.
+void Evict()
+{
+	const u64 limit = GetLimitBytes();
+	if( gTotalBytes <= limit )
+		return;
+
+	std::vector< EntryMap::iterator > entries;
+	entries.reserve( gEntries.size() );
+	for( EntryMap::iterator it = gEntries.begin(); it != gEntries.end(); ++it )
+	{
+		entries.push_back( it );
+	}
+	std::sort( entries.begin(), entries.end(), OlderThan );
+
+	const u64 target = limit - limit / 8;
+	for( u32 i = 0; i < entries.size() && gTotalBytes > target; ++i )
+	{
+		DeleteEntry( entries[i] );
+	}
+}
+
+void LoadIndex()
+{
+	IO::Filename filename;
+	GetIndexFilename( filename );
+
+	FILE * fh = fopen( filename, "rb" );
+	if( fh == NULL )
+		return;
+
+	u32 header[3];
+	if( fread( header, sizeof( header ), 1, fh ) == 1 && header[0] == kIndexMagic )
+	{
+		gClock = header[2];
+
+		SIndexRecord record;
+		for( u32 i = 0; i < header[1] && fread( &record, sizeof( record ), 1, fh ) == 1; ++i )
+		{
+			SEntry & entry( gEntries[ record.Key ] );
+			entry.Size    = record.Size;
+			entry.LastUse = record.LastUse;
+			gTotalBytes += record.Size;
+		}
+	}
+	fclose( fh );
+}
+
+// The index is only saved when a rom closes, so a session that crashed or was
+// killed leaves entries on disk that it doesn't know about. Adopt them as the
+// least recently used, so they count towards the limit and get evicted first.
+void AdoptUnindexedEntries()
+{
+	IO::FindHandleT		find_handle;
+	IO::FindDataT		find_data;
+	if( !IO::FindFileOpen( gCacheDir, &find_handle, find_data ) )
+		return;
+
+	std::vector< std::string >	stale;
+	do
+	{
+		const char * name = find_data.Name;
+		const char * ext  = strrchr( name, '.' );
+		if( ext == NULL )
+			continue;
+
+		IO::Filename filename;
+		IO::Path::Combine( filename, gCacheDir, name );
+
+		u32 hi, lo;
+		if( _strcmpi( ext, ".tmp" ) == 0 )
+		{
+			// Left by an interrupted write
+			stale.push_back( filename );
+		}
+		else if( _strcmpi( ext, ".bin" ) == 0 && ext - name == 16 && sscanf( name, "%8x%8x", &hi, &lo ) == 2 )
+		{
+			u64 key = ( u64( hi ) << 32 ) | lo;
+			if( gEntries.find( key ) != gEntries.end() )
+				continue;
+
+			u32 size = 0;
+			u64 mtime;
+			if( !IO::File::GetInfo( filename, &size, &mtime ) || size < sizeof( SEntryHeader ) )
+			{
+				stale.push_back( filename );
+				continue;
+			}
+
+			SEntry & entry( gEntries[ key ] );
+			entry.Size    = size;
+			entry.LastUse = 0;
+			gTotalBytes += size;
+		}
+	}
+	while( IO::FindFileNext( find_handle, find_data ) );
+
+	IO::FindFileClose( find_handle );
+
+	for( u32 i = 0; i < stale.size(); ++i )
+	{
+		IO::File::Delete( stale[i].c_str() );
+	}
+}
+
+void SaveIndex()
+{
+	IO::Filename filename;
+	IO::Filename temp_filename;
+	GetIndexFilename( filename );
+	IO::Path::Assign( temp_filename, filename );
+	IO::Path::SetExtension( temp_filename, ".tmp" );
+
+	FILE * fh = fopen( temp_filename, "wb" );
+	if( fh == NULL )
+		return;
+
+	u32 header[3] = { kIndexMagic, u32( gEntries.size() ), gClock };
+	bool ok = fwrite( header, sizeof( header ), 1, fh ) == 1;
+	for( EntryMap::const_iterator it = gEntries.begin(); ok && it != gEntries.end(); ++it )
+	{
+		SIndexRecord record;
+		record.Key     = it->first;
+		record.Size    = it->second.Size;
+		record.LastUse = it->second.LastUse;
+		ok = fwrite( &record, sizeof( record ), 1, fh ) == 1;
+	}
+	fclose( fh );
+
+	if( ok )
+	{
+		IO::File::Delete( filename );
+		IO::File::Move( temp_filename, filename );
+	}
+	else
+	{
+		IO::File::Delete( temp_filename );
+	}
+}
+
+}
+
+bool TexelCache_RomOpen()
+{
+	gHits   = 0;
+	gMisses = 0;
+
+	if( gTexelCacheSizeMB == 0 || gLoaded )
+		return true;
+
+	IO::Path::Combine( gCacheDir, gDaedalusExePath, "TexelCache" );
+	if( !IO::Directory::EnsureExists( gCacheDir ) )
+	{
+		DBGConsole_Msg( 0, "Couldn't create the texel cache [C%s]", gCacheDir );
+		return true;
+	}
+
+	LoadIndex();
+	AdoptUnindexedEntries();
+	Evict();			// In case the limit has been lowered
+	gLoaded = true;
+	return true;
+}
+
+void TexelCache_RomClose()
+{
+	if( !gLoaded )
+		return;
+
+	DBGConsole_Msg( 0, "Texel cache: %d hits, %d misses, %d entries (%dKB)", gHits, gMisses, u32( gEntries.size() ), u32( gTotalBytes / 1024 ) );
+
+	// Written once a session, rather than every time an entry is used.
+	SaveIndex();
+}
+
+bool TexelCache_MakeKey( const TextureInfo & ti, u64 * key )
+{
+	if( !gLoaded )
+		return false;
+
+	const u32 texel_bytes = ti.GetWidth() * ti.GetHeight() * 4;
+	if( texel_bytes < kMinCachedBytes )
+		return false;
+
+	const u32 address = ti.GetLoadAddress();
+	const u32 length  = ti.GetPitch() * ti.GetHeight();
+	if( address >= gRamSize || length > gRamSize - address )
+		return false;
+
+	SKeyFields fields;
+	memset( &fields, 0, sizeof( fields ) );
+	fields.Width   = ti.GetWidth();
+	fields.Height  = ti.GetHeight();
+	fields.Pitch   = ti.GetPitch();
+	fields.Format  = ti.GetFormat();
+	fields.Size    = ti.GetSize();
+	fields.TLutFmt = ti.GetTLutFormat();
+	fields.Swapped = ti.IsSwapped();
+
+	u64 hash = murmur2_64_hash( &fields, sizeof( fields ), 0 );
+	hash = murmur2_64_hash( g_pu8RamBase + address, length, hash );
+
+	if( ti.GetFormat() == G_IM_FMT_CI )
+	{
+		// ConvertTexture gives up without a palette, so there's nothing to cache.
+		if( ti.GetTlutAddress() < 0x1000 )
+			return false;
+
+		const u32 num_entries = ti.GetSize() == G_IM_SIZ_4b ? 16 : 256;
+		hash = murmur2_64_hash( reinterpret_cast< const void * >( ti.GetTlutAddress() ), num_entries * sizeof( u16 ), hash );
+	}
+
+	*key = hash;
+	return true;
+}
+
+bool TexelCache_Load( u64 key, const TextureInfo & ti, void * texels, u32 pitch )
+{
+	EntryMap::iterator it = gEntries.find( key );
+	if( it == gEntries.end() )
+	{
+		++gMisses;
+		return false;
+	}
+
+	IO::Filename filename;
+	GetEntryFilename( filename, key );
+
+	const u32 width  = ti.GetWidth();
+	const u32 height = ti.GetHeight();
+	const u32 row_bytes = width * 4;
+
+	u32 mapped_size = 0;
+	const u8 * p_data = static_cast< const u8 * >( IO::File::Map( filename, &mapped_size ) );
+	bool ok = false;
+	if( p_data != NULL )
+	{
+		const SEntryHeader * header = reinterpret_cast< const SEntryHeader * >( p_data );
+		if( mapped_size == sizeof( SEntryHeader ) + row_bytes * height &&
+			header->Magic == kEntryMagic && header->Width == width && header->Height == height )
+		{
+			const u8 * src = p_data + sizeof( SEntryHeader );
+			u8 *       dst = static_cast< u8 * >( texels );
+			for( u32 y = 0; y < height; ++y )
+			{
+				memcpy( dst, src, row_bytes );
+				src += row_bytes;
+				dst += pitch;
+			}
+			ok = true;
+		}
+		IO::File::Unmap( const_cast< u8 * >( p_data ), mapped_size );
+	}
+
+	if( !ok )
+	{
+		// Missing, truncated or a hash collision - drop it and convert as normal.
+		DeleteEntry( it );
+		++gMisses;
+		return false;
+	}
+
+	it->second.LastUse = ++gClock;
+	++gHits;
+	return true;
+}
+
+void TexelCache_Store( u64 key, const TextureInfo & ti, const void * texels, u32 pitch )
+{
+	IO::Filename filename;
+	IO::Filename temp_filename;
+	GetEntryFilename( filename, key );
+	IO::Path::Assign( temp_filename, filename );
+	IO::Path::SetExtension( temp_filename, ".tmp" );
+
+	FILE * fh = fopen( temp_filename, "wb" );
+	if( fh == NULL )
+		return;
+
+	SEntryHeader header;
+	header.Magic    = kEntryMagic;
+	header.Width    = ti.GetWidth();
+	header.Height   = ti.GetHeight();
+	header.Reserved = 0;
+
+	const u32 row_bytes = header.Width * 4;
+	bool ok = fwrite( &header, sizeof( header ), 1, fh ) == 1;
+
+	const u8 * src = static_cast< const u8 * >( texels );
+	for( u32 y = 0; ok && y < header.Height; ++y )
+	{
+		ok = fwrite( src, row_bytes, 1, fh ) == 1;
+		src += pitch;
+	}
+	fclose( fh );
+
+	if( !ok )
+	{
+		IO::File::Delete( temp_filename );
+		return;
+	}
+
+	IO::File::Delete( filename );
+	IO::File::Move( temp_filename, filename );
+
+	EntryMap::iterator it = gEntries.find( key );
+	if( it != gEntries.end() )
+	{
+		gTotalBytes -= it->second.Size;
+	}
+
+	SEntry & entry( gEntries[ key ] );
+	entry.Size    = sizeof( SEntryHeader ) + row_bytes * header.Height;
+	entry.LastUse = ++gClock;
+	gTotalBytes += entry.Size;
+
+	Evict();
+}
+
+#endif // DAEDALUS_TEXEL_CACHE
@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef HLEGRAPHICS_TEXELCACHE_H_
+#define HLEGRAPHICS_TEXELCACHE_H_
+
+#include "Utility/DaedalusTypes.h"
+
+// Needs IO::File::Map
+#ifndef DAEDALUS_PSP
+#define DAEDALUS_TEXEL_CACHE
+#endif
+
+#ifdef DAEDALUS_TEXEL_CACHE
+
+struct TextureInfo;
+
+//
+//	Converted RGBA8888 texels for large textures loaded straight from RDRAM (S2DEX
+//	backgrounds, sprites etc), kept on disk between sessions. Entries are keyed on a
+//	64 bit hash of the source texels, the palette and the format, so they're shared
+//	by every rom which uses the same image. The cache is limited to gTexelCacheSizeMB,
+//	and the least recently used entries are evicted first.
+//
+
+bool		TexelCache_RomOpen();
+void		TexelCache_RomClose();
+
+// Returns false if the texture isn't worth caching (or the cache is disabled).
+bool		TexelCache_MakeKey( const TextureInfo & ti, u64 * key );
+
+// pitch is the stride of texels in bytes.
+bool		TexelCache_Load( u64 key, const TextureInfo & ti, void * texels, u32 pitch );
+void		TexelCache_Store( u64 key, const TextureInfo & ti, const void * texels, u32 pitch );
+
+#endif // DAEDALUS_TEXEL_CACHE
+
+#endif // HLEGRAPHICS_TEXELCACHE_H_
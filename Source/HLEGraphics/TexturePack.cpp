@@ -0,0 +1,570 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "HLEGraphics/TexturePack.h"
+
+#ifdef DAEDALUS_TEXTURE_PACKS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "Config/ConfigOptions.h"
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
+#include "Graphics/NativePixelFormat.h"
+#include "Graphics/PngUtil.h"
+#include "Graphics/TextureTransform.h"
+#include "Math/MathUtil.h"
+#include "System/Paths.h"
+#include "Utility/Cond.h"
+#include "Utility/Hash.h"
+#include "Utility/IO.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+namespace
+{
+
+const u32	kMaxWorkers		= 4;
+const u32	kMaxDetail		= 8;
+const u32	kMaxDimension	= 4096;		// Of the uploaded texture
+const u32	kMaxScanDepth	= 8;
+const u32	kKeyDigits		= 16;
+
+struct SIndexEntry
+{
+	u64		Key;
+	u32		Path;				// Offset into gPaths
+
+	bool operator<( const SIndexEntry & rhs ) const		{ return Key < rhs.Key; }
+	bool operator==( const SIndexEntry & rhs ) const	{ return Key == rhs.Key; }
+};
+
+enum EImageState
+{
+	IS_QUEUED,
+	IS_DECODING,
+	IS_READY,
+	IS_FAILED,
+};
+
+struct SImage
+{
+	// Set when queued, and not changed until it's freed.
+	u32				Path;
+	u32				Width;
+	u32				Height;
+	u32				CorrectedWidth;
+	u32				CorrectedHeight;
+
+	// Written by the decoder threads, under gMutex.
+	EImageState		State;
+	u8 *			Texels;
+	u32				Detail;
+	u32				Bytes;
+
+	u32				LastUse;
+};
+
+typedef std::map< u64, SImage * >	ImageMap;
+
+IO::Filename				gPackDir;
+std::vector< SIndexEntry >	gIndex;
+std::vector< char >			gPaths;			// NUL terminated, relative to gPackDir
+
+ImageMap					gImages;		// Only touched on the emulator thread
+u32							gClock = 0;
+u32							gNumUploaded = 0;
+std::set< u64 >				gDumped;
+
+Mutex						gMutex;
+Cond *						gQueueCond = NULL;
+std::deque< SImage * >		gQueue;
+bool						gQuit = false;
+u64							gResidentBytes = 0;
+u32							gNumFailed = 0;
+
+ThreadHandle				gWorkers[ kMaxWorkers ];
+u32							gNumWorkers = 0;
+
+bool ParseKey( const char * filename, u64 * key )
+{
+	u64 value = 0;
+	for( u32 i = 0; i < kKeyDigits; ++i )
+	{
+		char c = filename[i];
+		u32 digit;
+		if( c >= '0' && c <= '9' )		digit = c - '0';
+		else if( c >= 'a' && c <= 'f' )	digit = c - 'a' + 10;
+		else if( c >= 'A' && c <= 'F' )	digit = c - 'A' + 10;
+		else							return false;
+
+		value = (value << 4) | digit;
+	}
+
+	// Anything can follow the hash, so packs can keep descriptive names.
+	const char * extension = IO::Path::FindExtension( filename );
+	if( extension == NULL || _strcmpi( extension, ".png" ) != 0 )
+		return false;
+
+	*key = value;
+	return true;
+}
+
+void ScanDirectory( const char * relative_dir, u32 depth )
+{
+	IO::Filename dir;
+	IO::Path::Assign( dir, gPackDir );
+	if( relative_dir[0] != '\0' )
+	{
+		IO::Path::Append( dir, relative_dir );
+	}
+
+	IO::FindHandleT		find_handle;
+	IO::FindDataT		find_data;
+	if( !IO::FindFileOpen( dir, &find_handle, find_data ) )
+		return;
+
+	do
+	{
+		IO::Filename relative_path;
+		if( relative_dir[0] != '\0' )
+		{
+			IO::Path::Combine( relative_path, relative_dir, find_data.Name );
+		}
+		else
+		{
+			IO::Path::Assign( relative_path, find_data.Name );
+		}
+
+		IO::Filename path;
+		IO::Path::Combine( path, gPackDir, relative_path );
+
+		u64 key;
+		if( IO::Directory::IsDirectory( path ) )
+		{
+			if( depth < kMaxScanDepth )
+			{
+				ScanDirectory( relative_path, depth + 1 );
+			}
+		}
+		else if( ParseKey( find_data.Name, &key ) )
+		{
+			SIndexEntry entry;
+			entry.Key  = key;
+			entry.Path = gPaths.size();
+			gIndex.push_back( entry );
+
+			gPaths.insert( gPaths.end(), relative_path, relative_path + strlen( relative_path ) + 1 );
+		}
+	}
+	while( IO::FindFileNext( find_handle, find_data ) );
+
+	IO::FindFileClose( find_handle );
+}
+
+const SIndexEntry * FindEntry( u64 key )
+{
+	SIndexEntry entry;
+	entry.Key  = key;
+	entry.Path = 0;
+
+	std::vector< SIndexEntry >::const_iterator it = std::lower_bound( gIndex.begin(), gIndex.end(), entry );
+	if( it != gIndex.end() && it->Key == key )
+		return &*it;
+
+	return NULL;
+}
+
+// Decodes the replacement and pads it out to the corrected size. Returns NULL if it can't be used.
+u8 * DecodeImage( const SImage & image, u32 * p_detail )
+{
+	IO::Filename filename;
+	IO::Path::Combine( filename, gPackDir, &gPaths[ image.Path ] );
+
+	const size_t	SIGNATURE_SIZE = 8;
+	u8	signature[ SIGNATURE_SIZE ];
+
+	FILE * fh = fopen( filename, "rb" );
+	if( fh == NULL )
+		return NULL;
+
+	if( fread( signature, sizeof(u8), SIGNATURE_SIZE, fh ) != SIGNATURE_SIZE || !png_check_sig( signature, SIGNATURE_SIZE ) )
+	{
+		fclose( fh );
+		return NULL;
+	}
+
+	png_struct * p_png_struct = png_create_read_struct( PNG_LIBPNG_VER_STRING, NULL, NULL, NULL );
+	if( p_png_struct == NULL )
+	{
+		fclose( fh );
+		return NULL;
+	}
+
+	png_info * p_png_info = png_create_info_struct( p_png_struct );
+	if( p_png_info == NULL )
+	{
+		png_destroy_read_struct( &p_png_struct, NULL, NULL );
+		fclose( fh );
+		return NULL;
+	}
+
+	if( setjmp( png_jmpbuf( p_png_struct ) ) != 0 )
+	{
+		png_destroy_read_struct( &p_png_struct, &p_png_info, NULL );
+		fclose( fh );
+		return NULL;
+	}
+
+	png_init_io( p_png_struct, fh );
+	png_set_sig_bytes( p_png_struct, SIGNATURE_SIZE );
+	png_read_png( p_png_struct, p_png_info, PNG_TRANSFORM_STRIP_16 | PNG_TRANSFORM_PACKING | PNG_TRANSFORM_EXPAND | PNG_TRANSFORM_GRAY_TO_RGB, NULL );
+	fclose( fh );
+
+	const u32 png_width  = png_get_image_width( p_png_struct, p_png_info );
+	const u32 png_height = png_get_image_height( p_png_struct, p_png_info );
+	const u32 channels   = png_get_channels( p_png_struct, p_png_info );
+	const u32 detail     = png_width / image.Width;
+
+	// Replacements have to line up exactly with the N64 texels, so they can be masked and mirrored.
+	if( detail == 0 || detail > kMaxDetail ||
+		png_width != image.Width * detail || png_height != image.Height * detail ||
+		image.CorrectedWidth * detail > kMaxDimension || image.CorrectedHeight * detail > kMaxDimension ||
+		(channels != 3 && channels != 4) )
+	{
+		png_destroy_read_struct( &p_png_struct, &p_png_info, NULL );
+		return NULL;
+	}
+
+	const u32 stride = image.CorrectedWidth * detail * sizeof( NativePf8888 );
+	u8 * texels = static_cast< u8 * >( malloc( stride * image.CorrectedHeight * detail ) );
+	if( texels != NULL )
+	{
+		png_bytep * rows = png_get_rows( p_png_struct, p_png_info );
+		for( u32 y = 0; y < png_height; ++y )
+		{
+			const u8 *		src = rows[ y ];
+			NativePf8888 *	dst = reinterpret_cast< NativePf8888 * >( texels + y * stride );
+			for( u32 x = 0; x < png_width; ++x )
+			{
+				u8 a = channels == 4 ? src[3] : 0xff;
+				dst[ x ] = NativePf8888( src[0], src[1], src[2], a );
+				src += channels;
+			}
+		}
+
+		ClampTexels( texels, png_width, png_height, image.CorrectedWidth * detail, image.CorrectedHeight * detail, stride, TexFmt_8888 );
+	}
+
+	png_destroy_read_struct( &p_png_struct, &p_png_info, NULL );
+
+	*p_detail = detail;
+	return texels;
+}
+
+u32 DAEDALUS_THREAD_CALL_TYPE DecodeThread( void * arg )
+{
+	for(;;)
+	{
+		SImage * image;
+		{
+			MutexLock lock( &gMutex );
+			while( !gQuit && gQueue.empty() )
+			{
+				CondWait( gQueueCond, &gMutex, kTimeoutInfinity );
+			}
+			if( gQuit )
+				break;
+
+			image = gQueue.front();
+			gQueue.pop_front();
+			image->State = IS_DECODING;
+		}
+
+		u32 detail = 0;
+		u8 * texels = DecodeImage( *image, &detail );
+
+		{
+			MutexLock lock( &gMutex );
+			if( texels != NULL )
+			{
+				image->Texels = texels;
+				image->Detail = detail;
+				image->Bytes  = image->CorrectedWidth * image->CorrectedHeight * detail * detail * sizeof( NativePf8888 );
+				image->State  = IS_READY;
+				gResidentBytes += image->Bytes;
+			}
+			else
+			{
+				image->State = IS_FAILED;
+				++gNumFailed;
+			}
+		}
+	}
+	return 0;
+}
+
+void StartWorkers()
+{
+	gQueueCond = CondCreate();
+	gQuit = false;
+
+	// Leave a core each for the emulator and the renderer.
+	u32 num_cores = std::thread::hardware_concurrency();
+	u32 num_workers = num_cores > 2 ? Min( num_cores - 2, kMaxWorkers ) : 1;
+	for( u32 i = 0; i < num_workers; ++i )
+	{
+		gWorkers[ gNumWorkers ] = CreateThread( "TexturePack", &DecodeThread, NULL );
+		if( gWorkers[ gNumWorkers ] == kInvalidThreadHandle )
+			break;
+
+		++gNumWorkers;
+	}
+}
+
+void StopWorkers()
+{
+	{
+		MutexLock lock( &gMutex );
+		gQuit = true;
+		gQueue.clear();
+		for( u32 i = 0; i < gNumWorkers; ++i )
+		{
+			CondSignal( gQueueCond );
+		}
+	}
+
+	for( u32 i = 0; i < gNumWorkers; ++i )
+	{
+		JoinThread( gWorkers[i], -1 );
+		ReleaseThreadHandle( gWorkers[i] );
+	}
+	gNumWorkers = 0;
+
+	if( gQueueCond != NULL )
+	{
+		CondDestroy( gQueueCond );
+		gQueueCond = NULL;
+	}
+}
+
+void FreeImage( ImageMap::iterator it )
+{
+	SImage * image = it->second;
+	if( image->State == IS_READY )
+	{
+		gResidentBytes -= image->Bytes;
+	}
+	free( image->Texels );
+	delete image;
+
+	gImages.erase( it );
+}
+
+bool UsedBefore( const ImageMap::iterator & a, const ImageMap::iterator & b )
+{
+	return a->second->LastUse < b->second->LastUse;
+}
+
+// Free the least recently used images until we're comfortably under budget. Called with gMutex held.
+void Evict( const SImage * keep )
+{
+	const u64 limit = u64( gTexturePackBudgetMB ) * 1024 * 1024;
+	if( gResidentBytes <= limit )
+		return;
+
+	std::vector< ImageMap::iterator > images;
+	for( ImageMap::iterator it = gImages.begin(); it != gImages.end(); ++it )
+	{
+		// Failed images are kept (they're tiny), so we don't keep trying to decode them.
+		if( it->second->State == IS_READY && it->second != keep )
+		{
+			images.push_back( it );
+		}
+	}
+	std::sort( images.begin(), images.end(), UsedBefore );
+
+	const u64 target = limit - limit / 8;
+	for( u32 i = 0; i < images.size() && gResidentBytes > target; ++i )
+	{
+		FreeImage( images[i] );
+	}
+}
+
+}
+
+bool TexturePack_RomOpen()
+{
+	gClock     = 0;
+	gNumUploaded = 0;
+	gNumFailed = 0;
+	gDumped.clear();
+
+	if( gTexturePackBudgetMB == 0 )
+		return true;
+
+	IO::Path::Combine( gPackDir, gDaedalusExePath, "TexturePacks" );
+	IO::Path::Append( gPackDir, g_ROM.settings.GameName.c_str() );
+	if( !IO::Directory::IsDirectory( gPackDir ) )
+		return true;
+
+	ScanDirectory( "", 0 );
+	// If a replacement appears more than once, the first one found wins.
+	std::stable_sort( gIndex.begin(), gIndex.end() );
+	gIndex.erase( std::unique( gIndex.begin(), gIndex.end() ), gIndex.end() );
+
+	if( !gIndex.empty() )
+	{
+		DBGConsole_Msg( 0, "Texture pack: %d replacements in [C%s]", u32( gIndex.size() ), gPackDir );
+		StartWorkers();
+	}
+
+	return true;
+}
+
+void TexturePack_RomClose()
+{
+	if( gIndex.empty() )
+		return;
+
+	StopWorkers();
+
+	DBGConsole_Msg( 0, "Texture pack: %d replacements uploaded, %d couldn't be used", gNumUploaded, gNumFailed );
+
+	while( !gImages.empty() )
+	{
+		FreeImage( gImages.begin() );
+	}
+	gIndex.clear();
+	gPaths.clear();
+}
+
+bool TexturePack_IsActive()
+{
+	return !gIndex.empty() || gTexturePackDump;
+}
+
+u64 TexturePack_MakeKey( const void * texels, u32 pitch, u32 width, u32 height )
+{
+	u32 dimensions[2] = { width, height };
+	u64 hash = murmur2_64_hash( dimensions, sizeof( dimensions ), 0 );
+
+	const u8 * row = static_cast< const u8 * >( texels );
+	for( u32 y = 0; y < height; ++y )
+	{
+		hash = murmur2_64_hash( row, width * sizeof( NativePf8888 ), hash );
+		row += pitch;
+	}
+	return hash;
+}
+
+void TexturePack_Dump( u64 key, const void * texels, u32 pitch, u32 width, u32 height )
+{
+	if( !gTexturePackDump || !gDumped.insert( key ).second )
+		return;
+
+	IO::Filename dumpdir;
+	IO::Filename filepath;
+	IO::Path::Combine( dumpdir, g_ROM.settings.GameName.c_str(), "TexturePack" );
+	Dump_GetDumpDirectory( filepath, dumpdir );
+
+	char filename[ 32 ];
+	sprintf( filename, "%08x%08x.png", u32( key >> 32 ), u32( key ) );
+	IO::Path::Append( filepath, filename );
+
+	if( !IO::File::Exists( filepath ) )
+	{
+		PngSaveImage( filepath, texels, NULL, TexFmt_8888, pitch, width, height, true );
+	}
+}
+
+ETexturePackResult TexturePack_Lookup( u64 key, u32 width, u32 height, u32 corrected_width, u32 corrected_height,
+									   STexturePackImage * p_image )
+{
+	ImageMap::iterator it = gImages.find( key );
+	if( it == gImages.end() )
+	{
+		const SIndexEntry * entry = FindEntry( key );
+		if( entry == NULL )
+			return TPR_NONE;
+
+		SImage * image = new SImage;
+		image->Path            = entry->Path;
+		image->Width           = width;
+		image->Height          = height;
+		image->CorrectedWidth  = corrected_width;
+		image->CorrectedHeight = corrected_height;
+		image->State           = IS_QUEUED;
+		image->Texels          = NULL;
+		image->Detail          = 0;
+		image->Bytes           = 0;
+		image->LastUse         = ++gClock;
+		gImages[ key ] = image;
+
+		MutexLock lock( &gMutex );
+		gQueue.push_back( image );
+		CondSignal( gQueueCond );
+
+		// Images can finish decoding after their texture has been purged, so check the budget here too.
+		Evict( NULL );
+		return TPR_PENDING;
+	}
+
+	SImage * image = it->second;
+
+	MutexLock lock( &gMutex );
+	switch( image->State )
+	{
+	case IS_QUEUED:
+	case IS_DECODING:
+		return TPR_PENDING;
+
+	case IS_FAILED:
+		return TPR_NONE;
+
+	case IS_READY:
+		break;
+	}
+
+	// The key covers the texels and size, so this only fails if we're handed a different corrected size.
+	if( image->CorrectedWidth != corrected_width || image->CorrectedHeight != corrected_height )
+		return TPR_NONE;
+
+	++gNumUploaded;
+	image->LastUse = ++gClock;
+	Evict( image );
+
+	p_image->Texels = image->Texels;
+	p_image->Detail = image->Detail;
+	return TPR_READY;
+}
+
+#endif // DAEDALUS_TEXTURE_PACKS
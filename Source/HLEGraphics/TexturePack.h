@@ -0,0 +1,73 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef HLEGRAPHICS_TEXTUREPACK_H_
+#define HLEGRAPHICS_TEXTUREPACK_H_
+
+#include "Utility/DaedalusTypes.h"
+
+// Replacements are sampled at a multiple of the N64 resolution, which only the GL renderer handles.
+#ifdef DAEDALUS_GL
+#define DAEDALUS_TEXTURE_PACKS
+#endif
+
+#ifdef DAEDALUS_TEXTURE_PACKS
+
+//
+//	Hi-res replacement textures, loaded from TexturePacks/<game name>/ (and any subdirectories).
+//	Each replacement is a png named after the 64 bit hash of the texels it replaces (as written
+//	out by -dump-texture-pack), and must be the same integer multiple of the N64 texture's width
+//	and height. The pack is indexed when the rom is opened, and images are decoded on background
+//	threads the first time they're needed - the N64 texture is used until then. Decoded images
+//	are kept for reuse up to gTexturePackBudgetMB, and the least recently used are freed first.
+//
+
+struct STexturePackImage
+{
+	const void *	Texels;			// RGBA8888, packed rows of corrected width * Detail texels
+	u32				Detail;			// Replacement texels per N64 texel, in each dimension
+};
+
+enum ETexturePackResult
+{
+	TPR_NONE,			// There's no (usable) replacement
+	TPR_PENDING,		// Still being decoded - try again later
+	TPR_READY,
+};
+
+bool				TexturePack_RomOpen();
+void				TexturePack_RomClose();
+
+// False if there's no pack for this rom and we're not dumping textures, so there's no need to hash them.
+bool				TexturePack_IsActive();
+
+u64					TexturePack_MakeKey( const void * texels, u32 pitch, u32 width, u32 height );
+
+// Saves the texels as a png named for key, when -dump-texture-pack is set.
+void				TexturePack_Dump( u64 key, const void * texels, u32 pitch, u32 width, u32 height );
+
+// corrected_width/height are the dimensions of the texture the replacement will be uploaded to.
+// The image is valid until the next call.
+ETexturePackResult	TexturePack_Lookup( u64 key, u32 width, u32 height, u32 corrected_width, u32 corrected_height,
+										STexturePackImage * image );
+
+#endif // DAEDALUS_TEXTURE_PACKS
+
+#endif // HLEGRAPHICS_TEXTUREPACK_H_
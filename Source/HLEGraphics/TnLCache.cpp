@@ -0,0 +1,121 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "HLEGraphics/TnLCache.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "Core/Memory.h"
+#include "HLEGraphics/BaseRenderer.h"
+#include "HLEGraphics/DaedalusVtx.h"
+#include "Utility/Hash.h"
+
+namespace
+{
+
+// Direct mapped - a new load simply replaces whatever was in its slot.
+const u32	kNumEntries = 1024;
+
+struct STnLCacheEntry
+{
+	STnLCacheKey				Key;
+	bool						Valid;
+	std::vector<DaedalusVtx4>	Verts;
+};
+
+STnLCacheEntry	gEntries[kNumEntries];
+STnLCacheStats	gStats;
+
+inline bool operator==( const STnLCacheKey & a, const STnLCacheKey & b )
+{
+	return a.Address == b.Address && a.NumVerts == b.NumVerts &&
+		   a.VertexHash == b.VertexHash && a.StateHash == b.StateHash;
+}
+
+inline STnLCacheEntry & GetEntry( const STnLCacheKey & key )
+{
+	u32 idx = (key.Address >> 4) ^ key.VertexHash ^ key.StateHash;
+	return gEntries[idx & (kNumEntries - 1)];
+}
+
+}
+
+void TnLCache_Reset()
+{
+	for( u32 i = 0; i < kNumEntries; ++i )
+	{
+		gEntries[i].Valid = false;
+		gEntries[i].Verts.clear();
+	}
+}
+
+void TnLCache_MakeKey( u32 address, u32 num_verts, u32 state_hash, STnLCacheKey * key )
+{
+	key->Address    = address;
+	key->NumVerts   = num_verts;
+	key->VertexHash = murmur2_hash( g_pu8RamBase + address, num_verts * sizeof( FiddledVtx ), address );
+	key->StateHash  = state_hash;
+}
+
+bool TnLCache_Find( const STnLCacheKey & key, DaedalusVtx4 * out )
+{
+	const STnLCacheEntry & entry( GetEntry( key ) );
+	if( !entry.Valid || !(entry.Key == key) )
+	{
+		++gStats.Misses;
+		gStats.MissVerts += key.NumVerts;
+		return false;
+	}
+
+	memcpy( out, &entry.Verts[0], key.NumVerts * sizeof( DaedalusVtx4 ) );
+
+	++gStats.Hits;
+	gStats.HitVerts += key.NumVerts;
+	return true;
+}
+
+void TnLCache_Add( const STnLCacheKey & key, const DaedalusVtx4 * verts )
+{
+	STnLCacheEntry & entry( GetEntry( key ) );
+	entry.Key   = key;
+	entry.Valid = true;
+	entry.Verts.assign( verts, verts + key.NumVerts );
+}
+
+void TnLCache_AddTime( bool hit, u64 ticks )
+{
+	if( hit )
+		gStats.HitTicks += ticks;
+	else
+		gStats.MissTicks += ticks;
+}
+
+void TnLCache_GetStats( STnLCacheStats * stats )
+{
+	*stats = gStats;
+}
+
+void TnLCache_ResetStats()
+{
+	memset( &gStats, 0, sizeof( gStats ) );
+}
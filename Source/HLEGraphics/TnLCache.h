@@ -0,0 +1,70 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef HLEGRAPHICS_TNLCACHE_H_
+#define HLEGRAPHICS_TNLCACHE_H_
+
+#include "Utility/DaedalusTypes.h"
+
+struct DaedalusVtx4;
+
+//
+//	Most games load the same vertices with the same matrices and lights every
+//	frame (HUDs, skyboxes, static level geometry). This remembers the transformed
+//	and lit output of each vertex load, so a repeat can be copied straight back.
+//
+//	Entries are keyed on a hash of the vertex data as well as its address, so
+//	any write to the vertices - from the CPU or DMA - misses the cache.
+//
+
+struct STnLCacheKey
+{
+	u32		Address;
+	u32		NumVerts;
+	u32		VertexHash;
+	u32		StateHash;		// Matrices, lights and texture scale - everything else the output depends on
+};
+
+// Loads smaller than this cost more to hash than to transform.
+const u32	kTnLCacheMinVerts = 8;
+
+void		TnLCache_Reset();
+
+void		TnLCache_MakeKey( u32 address, u32 num_verts, u32 state_hash, STnLCacheKey * key );
+
+// Copies num_verts vertices to out and returns true on a hit.
+bool		TnLCache_Find( const STnLCacheKey & key, DaedalusVtx4 * out );
+void		TnLCache_Add( const STnLCacheKey & key, const DaedalusVtx4 * verts );
+
+struct STnLCacheStats
+{
+	u32		Hits;
+	u32		Misses;
+	u64		HitVerts;
+	u64		MissVerts;
+	u64		HitTicks;		// Only timed while a benchmark is running
+	u64		MissTicks;
+};
+
+void		TnLCache_AddTime( bool hit, u64 ticks );
+void		TnLCache_GetStats( STnLCacheStats * stats );
+void		TnLCache_ResetStats();
+
+#endif // HLEGRAPHICS_TNLCACHE_H_
@@ -79,7 +79,24 @@ static inline void DrawFrameBuffer(u32 origin, const CNativeTexture * texture)
 			src_offset += 2;
 		}
 	}
+#if defined(DAEDALUS_SOFTWARE_RENDERER) || defined(DAEDALUS_GL)
+	// The rasterizer samples the texture's own copy of the texels, and GL textures are layers of
+	// an array we can't glTexImage2D into, so expand and go through SetData for both.
+	u32 stride = texture->GetStride();
+	u8 * texels = (u8*)malloc(stride * FB_HEIGHT);
+	for (u32 y = 0; y < FB_HEIGHT; ++y)
+	{
+		NativePf8888 * dst = reinterpret_cast< NativePf8888 * >( texels + y * stride );
+		for (u32 x = 0; x < FB_WIDTH; ++x)
+		{
+			dst[x] = NativePf8888::Make( N64Pf5551( pixels[y * FB_WIDTH + x] ) );
+		}
+	}
+	const_cast< CNativeTexture * >( texture )->SetData( texels, NULL );
+	free(texels);
+#else
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FB_WIDTH, FB_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_SHORT_5_5_5_1, pixels);
+#endif
 
 	//ToDO: Implement me PSP
 	//Doesn't work
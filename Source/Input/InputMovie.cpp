@@ -0,0 +1,211 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "InputMovie.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "Core/CPU.h"
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+
+//
+//	R4300 reads of C0_RAND aren't emulated (they return the register's fixed
+//	value), so the controller state is the only external input to record.
+//
+
+namespace
+{
+	const u32 INPUT_MOVIE_MAGIC_NUMBER	= 0x31564D44;	// 'DMV1'
+	const u32 INPUT_MOVIE_VERSION		= 1;
+
+	struct InputMovieHeader
+	{
+		u32			Magic;
+		u32			Version;
+		u32			RomCRC[2];
+		u32			RomCountryID;
+	};
+
+	struct InputMovieRecord
+	{
+		u32			VerticalInterrupt;
+		OSContPad	Pads[4];
+	};
+
+	EInputMovieMode		sMode( IMM_NONE );
+	std::string			sFilename;
+	FILE *				sFH( NULL );
+	bool				sFinished( false );
+	u32					sNumDesyncs( 0 );
+
+	bool ReadHeader( FILE * fh, InputMovieHeader * header )
+	{
+		return fread( header, sizeof( *header ), 1, fh ) == 1 &&
+			   header->Magic == INPUT_MOVIE_MAGIC_NUMBER &&
+			   header->Version == INPUT_MOVIE_VERSION;
+	}
+}
+
+void InputMovie_StartRecording( const char * filename )
+{
+	sMode = IMM_RECORD;
+	sFilename = filename;
+}
+
+void InputMovie_StartReplay( const char * filename )
+{
+	sMode = IMM_REPLAY;
+	sFilename = filename;
+}
+
+void InputMovie_Stop()
+{
+	InputMovie_RomClose();
+	sMode = IMM_NONE;
+	sFilename.clear();
+}
+
+EInputMovieMode InputMovie_GetMode()
+{
+	return sMode;
+}
+
+bool InputMovie_IsFinished()
+{
+	return sFinished;
+}
+
+u32 InputMovie_GetNumDesyncs()
+{
+	return sNumDesyncs;
+}
+
+RomID InputMovie_GetRomID( const char * filename )
+{
+	RomID	rom_id;
+
+	FILE *	fh( fopen( filename, "rb" ) );
+	if( fh != NULL )
+	{
+		InputMovieHeader	header;
+		if( ReadHeader( fh, &header ) )
+		{
+			rom_id = RomID( header.RomCRC[0], header.RomCRC[1], u8( header.RomCountryID ) );
+		}
+		fclose( fh );
+	}
+
+	return rom_id;
+}
+
+bool InputMovie_RomOpen()
+{
+	sFinished = false;
+	sNumDesyncs = 0;
+
+	if( sMode == IMM_RECORD )
+	{
+		sFH = fopen( sFilename.c_str(), "wb" );
+		if( sFH == NULL )
+		{
+			DBGConsole_Msg( 0, "Couldn't open input movie '%s' for writing", sFilename.c_str() );
+			return true;
+		}
+
+		InputMovieHeader	header;
+		header.Magic        = INPUT_MOVIE_MAGIC_NUMBER;
+		header.Version      = INPUT_MOVIE_VERSION;
+		header.RomCRC[0]    = g_ROM.mRomID.CRC[0];
+		header.RomCRC[1]    = g_ROM.mRomID.CRC[1];
+		header.RomCountryID = g_ROM.mRomID.CountryID;
+		fwrite( &header, sizeof( header ), 1, sFH );
+	}
+	else if( sMode == IMM_REPLAY )
+	{
+		sFH = fopen( sFilename.c_str(), "rb" );
+
+		InputMovieHeader	header;
+		if( sFH == NULL || !ReadHeader( sFH, &header ) )
+		{
+			DBGConsole_Msg( 0, "Couldn't read input movie '%s'", sFilename.c_str() );
+			InputMovie_RomClose();
+			sFinished = true;
+		}
+		else if( g_ROM.mRomID != RomID( header.RomCRC[0], header.RomCRC[1], u8( header.RomCountryID ) ) )
+		{
+			DBGConsole_Msg( 0, "Input movie '%s' was recorded with a different rom", sFilename.c_str() );
+			InputMovie_RomClose();
+			sFinished = true;
+		}
+	}
+
+	// A broken movie shouldn't stop the rom from running.
+	return true;
+}
+
+void InputMovie_RomClose()
+{
+	if( sFH != NULL )
+	{
+		fclose( sFH );
+		sFH = NULL;
+	}
+}
+
+void InputMovie_Process( OSContPad pads[4] )
+{
+	if( sFH == NULL )
+		return;
+
+	InputMovieRecord	record;
+
+	if( sMode == IMM_RECORD )
+	{
+		record.VerticalInterrupt = CPU_GetVerticalInterruptCount();
+		memcpy( record.Pads, pads, sizeof( record.Pads ) );
+		fwrite( &record, sizeof( record ), 1, sFH );
+	}
+	else
+	{
+		if( fread( &record, sizeof( record ), 1, sFH ) != 1 )
+		{
+			DBGConsole_Msg( 0, "Input movie finished, %d desyncs", sNumDesyncs );
+			InputMovie_RomClose();
+			sFinished = true;
+			return;
+		}
+
+		u32		vertical_interrupt( CPU_GetVerticalInterruptCount() );
+		if( record.VerticalInterrupt != vertical_interrupt )
+		{
+			if( sNumDesyncs == 0 )
+			{
+				DBGConsole_Msg( 0, "Input movie desynced at VI %d (recorded at %d)", vertical_interrupt, record.VerticalInterrupt );
+			}
+			++sNumDesyncs;
+		}
+
+		memcpy( pads, record.Pads, sizeof( record.Pads ) );
+	}
+}
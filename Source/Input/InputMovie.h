@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef INPUT_INPUTMOVIE_H_
+#define INPUT_INPUTMOVIE_H_
+
+#include "OSHLE/ultra_os.h"
+
+class RomID;
+
+//
+//	Input movies record the controller state seen by each PIF poll, keyed by
+//	the vertical interrupt count, so the same session can be replayed
+//	deterministically from power on (e.g. to compare frame times between builds).
+//
+
+enum EInputMovieMode
+{
+	IMM_NONE,
+	IMM_RECORD,
+	IMM_REPLAY,
+};
+
+// These take effect when the next rom is opened.
+void			InputMovie_StartRecording( const char * filename );
+void			InputMovie_StartReplay( const char * filename );
+void			InputMovie_Stop();
+
+EInputMovieMode	InputMovie_GetMode();
+bool			InputMovie_IsFinished();			// Replay has run out of input
+u32				InputMovie_GetNumDesyncs();			// Polls which didn't happen on the recorded vertical interrupt
+RomID			InputMovie_GetRomID( const char * filename );
+
+bool			InputMovie_RomOpen();
+void			InputMovie_RomClose();
+
+// Called for every controller poll. Records pads, or overwrites them when replaying.
+void			InputMovie_Process( OSContPad pads[4] );
+
+#endif // INPUT_INPUTMOVIE_H_
@@ -31,15 +31,25 @@
 #include "Debug/DBGConsole.h"
 #include "Math/MathUtil.h"
 #include "System/Paths.h"
+#include "Utility/Hash.h"
 #include "Utility/IO.h"
+#include "Utility/Mutex.h"
 #include "Utility/ROMFile.h"
 #include "Utility/Stream.h"
+#include "Utility/Thread.h"
 
 static const u64 ROMDB_MAGIC_NO	= 0x42444D5244454144LL; //DAEDRMDB		// 44 41 45 44 52 4D 44 42
-static const u32 ROMDB_CURRENT_VERSION = 4;
+static const u32 ROMDB_CURRENT_VERSION = 5;
 
-static const u32 MAX_SENSIBLE_FILES = 2048;
-static const u32 MAX_SENSIBLE_DETAILS = 2048;
+static const u32 MAX_SENSIBLE_RECORDS = 64 * 1024;
+
+// Identifying a rom is dominated by waiting on the filesystem (often a network share),
+// so it's worth having more threads than cores.
+#ifdef DAEDALUS_PSP
+static const u32 NUM_SCAN_THREADS = 1;
+#else
+static const u32 NUM_SCAN_THREADS = 8;
+#endif
 
 CRomDB::~CRomDB()
 {
@@ -66,106 +76,183 @@ class IRomDB : public CRomDB
 	private:
 		void			AddRomFile(const char * filename);
 
-		void			AddRomEntry( const char * filename, const RomID & id, u32 rom_size, ECicType cic_type );
+		void			AddRomEntry( const char * filename, u32 file_size, u64 file_time, const RomID & id, u32 rom_size, ECicType cic_type );
+		bool			IsUpToDate( const char * filename, u32 file_size, u64 file_time ) const;
 		bool			OpenDB( const char * filename );
 
+		static u32 DAEDALUS_THREAD_CALL_TYPE ScanThread( void * arg );
+
 	private:
 
-		// For serialisation we used a fixed size struct for ease of reading
-		struct RomFilesKeyValue
+		// Each record describes one file. For serialisation we used a fixed size struct for ease of reading.
+		// The db file is a journal of these - changed entries are appended, and the last record for a filename wins.
+		struct RomFileRecord
 		{
-			RomFilesKeyValue()
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-			}
-			RomFilesKeyValue( const RomFilesKeyValue & rhs )
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, rhs.FileName );
-				ID = rhs.ID;
-			}
-			RomFilesKeyValue & operator=( const RomFilesKeyValue & rhs )
+			RomFileRecord()
+				:	FileTime( 0 )
+				,	FileSize( 0 )
+				,	RomSize( 0 )
+				,	ID()
+				,	CicType( CIC_UNKNOWN )
 			{
-				if( this == &rhs )
-					return *this;
 				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, rhs.FileName );
-				ID = rhs.ID;
-				return *this;
 			}
 
-			RomFilesKeyValue( const char * filename, const RomID & id )
-			{
-				memset( FileName, 0, sizeof( FileName ) );
-				strcpy( FileName, filename );
-				ID = id;
-			}
+			u64			FileTime;		// Size and modification time of the file when it was identified
+			u32			FileSize;
+			u32			RomSize;
+			RomID		ID;
+			ECicType	CicType;
 
 			// This is actually IO::Path::kMaxPathLen+1, but we need to ensure that it doesn't change if we ever change the kMaxPathLen constant.
 			static const u32 kMaxFilenameLen = 260;
 			char		FileName[ kMaxFilenameLen + 1 ];
-			RomID		ID;
 		};
 
-		struct SSortByFilename
+		typedef std::vector< RomFileRecord >	RecordVec;
+
+		//
+		// Open addressed hash index into mRomFiles. Each slot holds the full hash of
+		// its key and the record index + 1, so that zero marks an empty slot.
+		//
+		class CRecordIndex
 		{
-			bool operator()( const RomFilesKeyValue & a, const RomFilesKeyValue & b ) const
-			{
-				return strcmp( a.FileName, b.FileName ) < 0;
-			}
-			bool operator()( const char * a, const RomFilesKeyValue & b ) const
-			{
-				return strcmp( a, b.FileName ) < 0;
-			}
-			bool operator()( const RomFilesKeyValue & a, const char * b ) const
-			{
-				return strcmp( a.FileName, b ) < 0;
-			}
+			public:
+				static const u32 kInvalidIdx = u32(~0);
+
+				CRecordIndex() : mNumUsed( 0 ) {}
+
+				void Clear()
+				{
+					mSlots.clear();
+					mNumUsed = 0;
+				}
+
+				template< typename Pred > u32 Find( u32 hash, const Pred & matches ) const
+				{
+					if( mSlots.empty() )
+						return kInvalidIdx;
+
+					u32 mask( mSlots.size() - 1 );
+					for( u32 i = hash & mask; mSlots[ i ].Value != 0; i = (i + 1) & mask )
+					{
+						if( mSlots[ i ].Hash == hash && matches( mSlots[ i ].Value - 1 ) )
+							return mSlots[ i ].Value - 1;
+					}
+					return kInvalidIdx;
+				}
+
+				// Points the slot for the key at idx, adding a new slot if needed
+				template< typename Pred > void Set( u32 hash, u32 idx, const Pred & matches )
+				{
+					if( (mNumUsed + 1) * 2 > mSlots.size() )
+					{
+						Grow();
+					}
+
+					u32 mask( mSlots.size() - 1 );
+					u32 i( hash & mask );
+					for( ; mSlots[ i ].Value != 0; i = (i + 1) & mask )
+					{
+						if( mSlots[ i ].Hash == hash && matches( mSlots[ i ].Value - 1 ) )
+						{
+							mSlots[ i ].Value = idx + 1;
+							return;
+						}
+					}
+
+					mSlots[ i ].Hash  = hash;
+					mSlots[ i ].Value = idx + 1;
+					mNumUsed++;
+				}
+
+			private:
+				void Grow()
+				{
+					std::vector< Slot >	old_slots;
+					old_slots.swap( mSlots );
+					mSlots.resize( Max< u32 >( 64, old_slots.size() * 2 ) );
+
+					u32 mask( mSlots.size() - 1 );
+					for( u32 j = 0; j < old_slots.size(); ++j )
+					{
+						if( old_slots[ j ].Value == 0 )
+							continue;
+
+						u32 i( old_slots[ j ].Hash & mask );
+						while( mSlots[ i ].Value != 0 )
+						{
+							i = (i + 1) & mask;
+						}
+						mSlots[ i ] = old_slots[ j ];
+					}
+				}
+
+			private:
+				struct Slot
+				{
+					Slot() : Hash( 0 ), Value( 0 ) {}
+
+					u32		Hash;
+					u32		Value;
+				};
+
+				std::vector< Slot >	mSlots;
+				u32					mNumUsed;
 		};
 
-		struct RomDetails
+		struct SMatchFilename
 		{
-			RomDetails()
-				:	ID()
-				,	RomSize( 0 )
-				,	CicType( CIC_UNKNOWN )
-			{
-			}
+			SMatchFilename( const RecordVec & records, const char * filename ) : Records( records ), FileName( filename ) {}
+			bool operator()( u32 idx ) const		{ return strcmp( Records[ idx ].FileName, FileName ) == 0; }
 
-			RomDetails( const RomID & id, u32 rom_size, ECicType cic_type )
-				:	ID( id )
-				,	RomSize( rom_size )
-				,	CicType( cic_type )
-			{
-			}
+			const RecordVec &	Records;
+			const char *		FileName;
+		};
+
+		struct SMatchID
+		{
+			SMatchID( const RecordVec & records, const RomID & id ) : Records( records ), ID( id ) {}
+			bool operator()( u32 idx ) const		{ return Records[ idx ].ID == ID; }
 
+			const RecordVec &	Records;
+			const RomID &		ID;
+		};
+
+		static u32 HashFilename( const char * filename )	{ return murmur2_hash( filename, strlen( filename ), 0 ); }
+		static u32 HashID( const RomID & id )				{ return murmur2_hash( id.CRC, sizeof( id.CRC ), id.CountryID ); }
+
+		u32				FindRecord( const char * filename ) const;
+		void			AddRecord( const RomFileRecord & record );
+
+		// A single file to identify while scanning a directory
+		struct SScanJob
+		{
+			IO::Filename		FileName;
+			bool				Changed;
+			u32					FileSize;
+			u64					FileTime;
 			RomID				ID;
 			u32					RomSize;
 			ECicType			CicType;
 		};
 
-		struct SSortDetailsByID
+		struct SScanContext
 		{
-			bool operator()( const RomDetails & a, const RomDetails & b ) const
-			{
-				return a.ID < b.ID;
-			}
-			bool operator()( const RomID & a, const RomDetails & b ) const
-			{
-				return a < b.ID;
-			}
-			bool operator()( const RomDetails & a, const RomID & b ) const
-			{
-				return a.ID < b;
-			}
+			const IRomDB *			DB;
+			std::vector< SScanJob >	Jobs;
+			Mutex					JobMutex;
+			u32						NextJob;
 		};
 
-		typedef std::vector< RomFilesKeyValue >	FilenameVec;
-		typedef std::vector< RomDetails >		DetailsVec;
-
 		IO::Filename					mRomDBFileName;
-		FilenameVec						mRomFiles;
-		DetailsVec						mRomDetails;
+		RecordVec						mRomFiles;
+		CRecordIndex					mFilenameIndex;
+		CRecordIndex					mIDIndex;
+
+		std::vector< u32 >				mPendingRecords;	// Records which have changed since the last Commit
+		u32								mNumFileRecords;	// Number of records in the db file, including ones which have since been replaced
+		bool							mRewriteRequired;
 		bool							mDirty;
 };
 
@@ -184,7 +271,9 @@ template<> bool	CSingleton< CRomDB >::Create()
 }
 
 IRomDB::IRomDB()
-:	mDirty( false )
+:	mNumFileRecords( 0 )
+,	mRewriteRequired( true )
+,	mDirty( false )
 {
 	mRomDBFileName[ 0 ] = '\0';
 }
@@ -197,10 +286,37 @@ IRomDB::~IRomDB()
 void IRomDB::Reset()
 {
 	mRomFiles.clear();
-	mRomDetails.clear();
+	mFilenameIndex.Clear();
+	mIDIndex.Clear();
+	mPendingRecords.clear();
+	mRewriteRequired = true;
 	mDirty = true;
 }
 
+u32 IRomDB::FindRecord( const char * filename ) const
+{
+	return mFilenameIndex.Find( HashFilename( filename ), SMatchFilename( mRomFiles, filename ) );
+}
+
+void IRomDB::AddRecord( const RomFileRecord & record )
+{
+	u32 filename_hash( HashFilename( record.FileName ) );
+	u32 idx( mFilenameIndex.Find( filename_hash, SMatchFilename( mRomFiles, record.FileName ) ) );
+	if( idx == CRecordIndex::kInvalidIdx )
+	{
+		idx = mRomFiles.size();
+		mRomFiles.push_back( record );
+		mFilenameIndex.Set( filename_hash, idx, SMatchFilename( mRomFiles, record.FileName ) );
+	}
+	else
+	{
+		mRomFiles[ idx ] = record;
+	}
+
+	// If the file's id has changed, the slot for the old id becomes stale. Find() skips those as the id no longer matches.
+	mIDIndex.Set( HashID( record.ID ), idx, SMatchID( mRomFiles, record.ID ) );
+}
+
 bool IRomDB::OpenDB( const char * filename )
 {
 	u32 num_read;
@@ -239,50 +355,29 @@ bool IRomDB::OpenDB( const char * filename )
 		goto fail;
 	}
 
-	u32		num_files;
-	num_read = fread( &num_files, sizeof( num_files ), 1, fh );
-	if ( num_read != 1 )
-	{
-		DBGConsole_Msg( 0, "RomDB EOF reading number of files." );
-		goto fail;
-	}
-	else if ( num_files > MAX_SENSIBLE_FILES )
-	{
-		DBGConsole_Msg( 0, "RomDB has unexpectedly large number of files (%d).", num_files );
-		goto fail;
-	}
-
-	mRomFiles.resize( num_files );
-	if( fread( &mRomFiles[0], sizeof(RomFilesKeyValue), num_files, fh ) != num_files )
-	{
-		goto fail;
-	}
-	// Redundant?
-	std::sort( mRomFiles.begin(), mRomFiles.end(), SSortByFilename() );
-
-	u32		num_details;
-	num_read = fread( &num_details, sizeof( num_details ), 1, fh );
-	if ( num_read != 1 )
-	{
-		DBGConsole_Msg( 0, "RomDB EOF reading number of details." );
-		goto fail;
-	}
-	else if ( num_details > MAX_SENSIBLE_DETAILS )
+	//
+	// Replay the journal. A partially written record at the end is just ignored.
+	//
 	{
-		DBGConsole_Msg( 0, "RomDB has unexpectedly large number of details (%d).", num_details );
-		goto fail;
-	}
+		RomFileRecord	record;
+		while( fread( &record, sizeof( RomFileRecord ), 1, fh ) == 1 )
+		{
+			if ( mNumFileRecords >= MAX_SENSIBLE_RECORDS )
+			{
+				DBGConsole_Msg( 0, "RomDB has unexpectedly large number of records (%d).", mNumFileRecords );
+				Reset();
+				goto fail;
+			}
 
-	mRomDetails.resize( num_details );
-	if( fread( &mRomDetails[0], sizeof(RomDetails), num_details, fh ) != num_details )
-	{
-		goto fail;
+			record.FileName[ RomFileRecord::kMaxFilenameLen ] = '\0';
+			AddRecord( record );
+			mNumFileRecords++;
+		}
 	}
-	// Redundant?
-	std::sort( mRomDetails.begin(), mRomDetails.end(), SSortDetailsByID() );
 
-	DBGConsole_Msg( 0, "RomDB initialised with %d files and %d details.", mRomFiles.size(), mRomDetails.size() );
+	DBGConsole_Msg( 0, "RomDB initialised with %d files from %d records.", mRomFiles.size(), mNumFileRecords );
 
+	mRewriteRequired = false;
 	fclose( fh );
 	return true;
 
@@ -302,102 +397,78 @@ bool IRomDB::Commit()
 	if ( strlen( mRomDBFileName ) <= 0 )
 		return false;
 
-	FILE * fh = fopen( mRomDBFileName, "wb" );
-
-	if ( !fh )
-		return false;
-
 	//
-	// Write the magic
+	// Append the changed records, unless replaced records make up most of the file
 	//
-	fwrite( &ROMDB_MAGIC_NO, sizeof( ROMDB_MAGIC_NO ), 1, fh );
+	std::sort( mPendingRecords.begin(), mPendingRecords.end() );
+	mPendingRecords.erase( std::unique( mPendingRecords.begin(), mPendingRecords.end() ), mPendingRecords.end() );
 
-	//
-	// Write the version
-	//
-	fwrite( &ROMDB_CURRENT_VERSION, sizeof( ROMDB_CURRENT_VERSION ), 1, fh );
+	bool	rewrite( mRewriteRequired || mNumFileRecords + mPendingRecords.size() > 2 * mRomFiles.size() );
 
-	{
-		u32 num_files( mRomFiles.size() );
-		fwrite( &num_files, sizeof( num_files ), 1, fh );
-		fwrite( &mRomFiles[0], sizeof(RomFilesKeyValue), num_files, fh );
-	}
+	FILE * fh = fopen( mRomDBFileName, rewrite ? "wb" : "ab" );
 
-	{
-		u32 num_details( mRomDetails.size() );
-		fwrite( &num_details, sizeof( num_details ), 1, fh );
-		fwrite( &mRomDetails[0], sizeof(RomDetails), num_details, fh );
-	}
+	if ( !fh )
+		return false;
 
-	fclose( fh );
+	if( rewrite )
+	{
+		//
+		// Write the magic
+		//
+		fwrite( &ROMDB_MAGIC_NO, sizeof( ROMDB_MAGIC_NO ), 1, fh );
 
-	mDirty = true;
-	return true;
-}
+		//
+		// Write the version
+		//
+		fwrite( &ROMDB_CURRENT_VERSION, sizeof( ROMDB_CURRENT_VERSION ), 1, fh );
 
-void IRomDB::AddRomEntry( const char * filename, const RomID & id, u32 rom_size, ECicType cic_type )
-{
-	// Update filename/id map
-	FilenameVec::iterator fit( std::lower_bound( mRomFiles.begin(), mRomFiles.end(), filename, SSortByFilename() ) );
-	if( fit != mRomFiles.end() && strcmp( fit->FileName, filename ) == 0 )
-	{
-		fit->ID = id;
+		if( !mRomFiles.empty() )
+		{
+			fwrite( &mRomFiles[0], sizeof(RomFileRecord), mRomFiles.size(), fh );
+		}
+		mNumFileRecords = mRomFiles.size();
 	}
 	else
 	{
-		RomFilesKeyValue	filename_id( filename, id );
-		mRomFiles.insert( fit, filename_id );
+		for( u32 i = 0; i < mPendingRecords.size(); ++i )
+		{
+			fwrite( &mRomFiles[ mPendingRecords[ i ] ], sizeof(RomFileRecord), 1, fh );
+		}
+		mNumFileRecords += mPendingRecords.size();
 	}
 
-	// Update id/details map
-	DetailsVec::iterator dit( std::lower_bound( mRomDetails.begin(), mRomDetails.end(), id, SSortDetailsByID() ) );
-	if( dit != mRomDetails.end() && dit->ID == id )
-	{
-		dit->RomSize = rom_size;
-		dit->CicType = cic_type;
-	}
-	else
-	{
-		RomDetails	id_details( id, rom_size, cic_type );
-		mRomDetails.insert( dit, id_details );
-	}
+	fclose( fh );
 
-	mDirty = true;
+	mPendingRecords.clear();
+	mRewriteRequired = false;
+	mDirty = false;
+	return true;
 }
 
-void IRomDB::AddRomDirectory(const char * directory)
+void IRomDB::AddRomEntry( const char * filename, u32 file_size, u64 file_time, const RomID & id, u32 rom_size, ECicType cic_type )
 {
-	DBGConsole_Msg(0, "Adding roms directory [C%s]", directory);
-	std::string			full_path;
-
-	IO::FindHandleT		find_handle;
-	IO::FindDataT		find_data;
-	if(IO::FindFileOpen( directory, &find_handle, find_data ))
-	{
-		do
-		{
-			const char * rom_filename = find_data.Name;
-			if(IsRomfilename( rom_filename ))
-			{
-				IO::Filename full_path;
-				IO::Path::Combine(full_path, directory, rom_filename);
+	RomFileRecord	record;
+	IO::Path::Assign( record.FileName, filename );
+	record.FileSize = file_size;
+	record.FileTime = file_time;
+	record.ID       = id;
+	record.RomSize  = rom_size;
+	record.CicType  = cic_type;
 
-				AddRomFile(full_path);
-			}
-		}
-		while(IO::FindFileNext( find_handle, find_data ));
+	AddRecord( record );
 
-		IO::FindFileClose( find_handle );
-	}
+	mPendingRecords.push_back( FindRecord( record.FileName ) );
+	mDirty = true;
 }
 
-void IRomDB::AddRomFile(const char * filename)
+bool IRomDB::IsUpToDate( const char * filename, u32 file_size, u64 file_time ) const
 {
-	RomID id;
-	u32 rom_size;
-	ECicType boot_type;
+	u32 idx( FindRecord( filename ) );
+	if( idx == CRecordIndex::kInvalidIdx )
+		return false;
 
-	QueryByFilename(filename, &id, &rom_size, &boot_type);
+	const RomFileRecord & record( mRomFiles[ idx ] );
+	return record.FileSize == file_size && record.FileTime == file_time;
 }
 
 static bool GenerateRomDetails( const char * filename, RomID * id, u32 * rom_size, ECicType * cic_type )
@@ -421,16 +492,14 @@ static bool GenerateRomDetails( const char * filename, RomID * id, u32 * rom_siz
 
 	//
 	// They weren't there - so we need to find this info out for ourselves
-	// Only read in the header + bootcode
+	// Only read in the header + bootcode, which is all we need for the id and cic type
 	//
+	u8		bytes[ RAMROM_GAME_OFFSET ];
 	u32		bytes_to_read( RAMROM_GAME_OFFSET );
-	u32		size_aligned( AlignPow2( bytes_to_read, 4 ) );	// Needed?
-	u8 *	bytes( new u8[size_aligned] );
 
 	if( !rom_file->LoadData( bytes_to_read, bytes, messages ) )
 	{
 		// Lots of files don't have any info - don't worry about it
-		delete [] bytes;
 		delete rom_file;
 		return false;
 	}
@@ -457,22 +526,130 @@ static bool GenerateRomDetails( const char * filename, RomID * id, u32 * rom_siz
 	const ROMHeader * prh( reinterpret_cast<const ROMHeader *>( bytes ) );
 	*id = RomID( prh->CRC1, prh->CRC2, prh->CountryID );
 
-	delete [] bytes;
 	delete rom_file;
 	return true;
 }
 
+u32 IRomDB::ScanThread( void * arg )
+{
+	SScanContext * context( static_cast< SScanContext * >( arg ) );
+
+	while( true )
+	{
+		u32	job_idx;
+		{
+			MutexLock lock( &context->JobMutex );
+			job_idx = context->NextJob++;
+		}
+
+		if( job_idx >= context->Jobs.size() )
+			break;
+
+		// The db is only read while the scan is running, so this doesn't need locking
+		SScanJob & job( context->Jobs[ job_idx ] );
+		job.Changed = false;
+
+		if( !IO::File::GetInfo( job.FileName, &job.FileSize, &job.FileTime ) )
+			continue;
+
+		if( context->DB->IsUpToDate( job.FileName, job.FileSize, job.FileTime ) )
+			continue;
+
+		job.Changed = GenerateRomDetails( job.FileName, &job.ID, &job.RomSize, &job.CicType );
+	}
+
+	return 0;
+}
+
+void IRomDB::AddRomDirectory(const char * directory)
+{
+	DBGConsole_Msg(0, "Adding roms directory [C%s]", directory);
+
+	SScanContext		context;
+	context.DB      = this;
+	context.NextJob = 0;
+
+	IO::FindHandleT		find_handle;
+	IO::FindDataT		find_data;
+	if(IO::FindFileOpen( directory, &find_handle, find_data ))
+	{
+		do
+		{
+			const char * rom_filename = find_data.Name;
+			if(IsRomfilename( rom_filename ))
+			{
+				context.Jobs.push_back( SScanJob() );
+				IO::Path::Combine( context.Jobs.back().FileName, directory, rom_filename );
+			}
+		}
+		while(IO::FindFileNext( find_handle, find_data ));
+
+		IO::FindFileClose( find_handle );
+	}
+
+	//
+	//	Identify the files on a pool of threads. This thread takes jobs too.
+	//
+	std::vector< ThreadHandle >	threads;
+	u32 num_threads( Min< u32 >( NUM_SCAN_THREADS, context.Jobs.size() ) );
+	for( u32 i = 1; i < num_threads; ++i )
+	{
+		ThreadHandle handle( CreateThread( "RomScan", &IRomDB::ScanThread, &context ) );
+		if( handle != kInvalidThreadHandle )
+		{
+			threads.push_back( handle );
+		}
+	}
+
+	ScanThread( &context );
+
+	for( u32 i = 0; i < threads.size(); ++i )
+	{
+		JoinThread( threads[ i ], -1 );
+		ReleaseThreadHandle( threads[ i ] );
+	}
+
+	u32 num_changed( 0 );
+	for( u32 i = 0; i < context.Jobs.size(); ++i )
+	{
+		const SScanJob & job( context.Jobs[ i ] );
+		if( job.Changed )
+		{
+			AddRomEntry( job.FileName, job.FileSize, job.FileTime, job.ID, job.RomSize, job.CicType );
+			num_changed++;
+		}
+	}
+
+	DBGConsole_Msg(0, "Scanned %d files, %d new or changed", context.Jobs.size(), num_changed);
+}
+
+void IRomDB::AddRomFile(const char * filename)
+{
+	RomID id;
+	u32 rom_size;
+	ECicType boot_type;
+
+	QueryByFilename(filename, &id, &rom_size, &boot_type);
+}
+
 bool IRomDB::QueryByFilename( const char * filename, RomID * id, u32 * rom_size, ECicType * cic_type )
 {
 	//
-	// First of all, check if we have these details cached in the rom database
+	// First of all, check if we have these details cached in the rom database, and the file hasn't changed since
 	//
-	FilenameVec::const_iterator fit( std::lower_bound( mRomFiles.begin(), mRomFiles.end(), filename, SSortByFilename() ) );
-	if( fit != mRomFiles.end() && strcmp( fit->FileName, filename ) == 0 )
+	u32	file_size( 0 );
+	u64	file_time( 0 );
+	IO::File::GetInfo( filename, &file_size, &file_time );
+
+	u32 idx( FindRecord( filename ) );
+	if( idx != CRecordIndex::kInvalidIdx )
 	{
-		if( QueryByID( fit->ID, rom_size, cic_type ) )
+		const RomFileRecord & record( mRomFiles[ idx ] );
+		if( record.FileSize == file_size && record.FileTime == file_time )
 		{
-			*id = fit->ID;
+			*id       = record.ID;
+			*rom_size = record.RomSize;
+			*cic_type = record.CicType;
 			return true;
 		}
 	}
@@ -482,7 +659,7 @@ bool IRomDB::QueryByFilename( const char * filename, RomID * id, u32 * rom_size,
 		//
 		// Store this information for future reference
 		//
-		AddRomEntry( filename, *id, *rom_size, *cic_type );
+		AddRomEntry( filename, file_size, file_time, *id, *rom_size, *cic_type );
 		return true;
 	}
 
@@ -491,11 +668,11 @@ bool IRomDB::QueryByFilename( const char * filename, RomID * id, u32 * rom_size,
 
 bool IRomDB::QueryByID( const RomID & id, u32 * rom_size, ECicType * cic_type ) const
 {
-	DetailsVec::const_iterator it( std::lower_bound( mRomDetails.begin(), mRomDetails.end(), id, SSortDetailsByID() ) );
-	if( it != mRomDetails.end() && it->ID == id )
+	u32 idx( mIDIndex.Find( HashID( id ), SMatchID( mRomFiles, id ) ) );
+	if( idx != CRecordIndex::kInvalidIdx )
 	{
-		*rom_size = it->RomSize;
-		*cic_type = it->CicType;
+		*rom_size = mRomFiles[ idx ].RomSize;
+		*cic_type = mRomFiles[ idx ].CicType;
 		return true;
 	}
 
@@ -505,12 +682,10 @@ bool IRomDB::QueryByID( const RomID & id, u32 * rom_size, ECicType * cic_type )
 
 const char * IRomDB::QueryFilenameFromID( const RomID & id ) const
 {
-	for( u32 i = 0; i < mRomFiles.size(); ++i )
+	u32 idx( mIDIndex.Find( HashID( id ), SMatchID( mRomFiles, id ) ) );
+	if( idx != CRecordIndex::kInvalidIdx )
 	{
-		if( mRomFiles[ i ].ID == id )
-		{
-			return mRomFiles[ i ].FileName;
-		}
+		return mRomFiles[ idx ].FileName;
 	}
 
 	return NULL;
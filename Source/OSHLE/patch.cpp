@@ -24,6 +24,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stddef.h>		// offsetof
 
+#include <algorithm>
+#include <vector>
+
 #include "patch_symbols.h"
 #include "OS.h"
 #include "OSMesgQueue.h"
@@ -50,6 +53,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Utility/Endian.h"
 #include "Utility/FastMemcpy.h"
 #include "Utility/Profiler.h"
+#include "Utility/Timing.h"
 
 #ifdef DAEDALUS_PSP
 #include "Graphics/GraphicsContext.h"
@@ -98,8 +102,8 @@ u32 gNumOfOSFunctions;
 #define PATCH_RET_JR_RA RET_JR_RA()
 #define PATCH_RET_ERET RET_JR_ERET()
 
-// Increase this number every time we changed the symbol table
-static const u32 MAGIC_HEADER = 0x80000146;
+// Increase this number every time the cache format changes (changes to the symbol table are detected automatically)
+static const u32 MAGIC_HEADER = 0x80000147;
 
 static bool gPatchesApplied = false;
 
@@ -108,11 +112,21 @@ static bool gPatchesApplied = false;
 
 
 void Patch_ResetSymbolTable();
+typedef std::vector< u32 >	SignatureCandidates;
+
 void Patch_RecurseAndFind();
-static bool Patch_LocateFunction(PatchSymbol * ps);
+static void Patch_ScanForSignatures(const std::vector< PatchSignature * > & signatures, std::vector< SignatureCandidates > & candidates);
+static bool Patch_LocateFunction(PatchSymbol * ps, const SignatureCandidates * candidates);
 static bool Patch_VerifyLocation(PatchSymbol * ps, u32 index);
 static bool Patch_VerifyLocation_CheckSignature(PatchSymbol * ps, PatchSignature * psig, u32 index);
-static bool Patch_GetCache();
+enum EPatchCacheResult
+{
+	PCR_MISSING,		// No usable cache, do a full scan
+	PCR_PARTIAL,		// Some symbols have moved, scan for them
+	PCR_VALID,			// All cached symbols verified
+};
+
+static EPatchCacheResult Patch_GetCache();
 static void Patch_FlushCache();
 
 static void Patch_ApplyPatch(u32 i);
@@ -152,8 +166,9 @@ void Patch_ApplyPatches()
 	if (!gOSHooksEnabled)
 		return;
 
-	if (!Patch_GetCache())
+	if (Patch_GetCache() != PCR_VALID)
 	{
+		// Any symbols verified from the cache are skipped
 		Patch_RecurseAndFind();
 
 		// Tip : Disable this when working on oshle funcs, you save the time to delete hle cache everyttime you need to test :p
@@ -486,17 +501,13 @@ bool Patch_Hacks( PatchSymbol * ps )
 }
 
 
-//ToDo: Add Status bar for loading OSHLE Patch Symbols.
 void Patch_RecurseAndFind()
 {
 	s32 nFound;
 	u32 first;
 	u32 last;
 
-	DBGConsole_Msg(0, "Searching for os functions. This may take several seconds...");
-
-	// Keep looping until a pass does not resolve any more symbols
-	nFound = 0;
+	DBGConsole_Msg(0, "Searching for os functions...");
 
 #ifdef DAEDALUS_DEBUG_CONSOLE
 	CDebugConsole::Get()->MsgOverwriteStart();
@@ -505,39 +516,62 @@ void Patch_RecurseAndFind()
 	// Load our font here, Intrafont used in UI is destroyed when emulation starts
 	intraFont* ltn8  = intraFontLoad( "flash0:/font/ltn8.pgf", INTRAFONT_CACHE_ASCII);
 	intraFontSetStyle( ltn8, 1.0f, 0xFF000000, 0xFFFFFFFF, INTRAFONT_ALIGN_CENTER );
+
+	CGraphicsContext::Get()->BeginFrame();
+	CGraphicsContext::Get()->ClearToBlack();
+	intraFontPrintf( ltn8, 480/2, (272>>1), "Searching for os functions..." );
+	CGraphicsContext::Get()->EndFrame();
+	CGraphicsContext::Get()->UpdateFrame( true );
 #endif
 #endif
 
-	// Loops through all symbols, until name is null
-	for (u32 i = 0; i < nPatchSymbols && !gCPUState.IsJobSet( CPU_STOP_RUNNING ); i++)
+	u64 start_time;
+	NTiming::GetPreciseTime( &start_time );
+
+	//
+	//	Find every location matching the start of each signature in a single pass over ram.
+	//	Signatures are stored in symbol order, so each symbol's candidates are contiguous.
+	//
+	std::vector< PatchSignature * >		signatures;
+	std::vector< u32 >					first_signature( nPatchSymbols );
+	for (u32 i = 0; i < nPatchSymbols; i++)
 	{
+		first_signature[i] = signatures.size();
+		if (g_PatchSymbols[i]->Found)
+			continue;
+
+		for (PatchSignature * psig = g_PatchSymbols[i]->Signatures; psig->NumOps != 0; psig++)
+		{
+			signatures.push_back( psig );
+		}
+	}
 
+	std::vector< SignatureCandidates >	candidates( signatures.size() );
+	Patch_ScanForSignatures( signatures, candidates );
+
+	// Now check the candidates properly, resolving any dependencies between symbols
+	nFound = 0;
+	for (u32 i = 0; i < nPatchSymbols && !gCPUState.IsJobSet( CPU_STOP_RUNNING ); i++)
+	{
 #ifdef DAEDALUS_DEBUG_CONSOLE
 		CDebugConsole::Get()->MsgOverwrite(0, "OS HLE: %d / %d Looking for [G%s]",
 			i, nPatchSymbols, g_PatchSymbols[i]->Name);
 		fflush(stdout);
-#else
-#ifdef DAEDALUS_PSP
-		//Update patching progress on PSPscreen
-		CGraphicsContext::Get()->BeginFrame();
-		CGraphicsContext::Get()->ClearToBlack();
-		//intraFontPrintf( ltn8, 480/2, (272>>1)-50, "Searching for os functions. This may take several seconds...");
-		intraFontPrintf( ltn8, 480/2, (272>>1), "OS HLE Patching: %d%%", i * 100 / (nPatchSymbols-1));
-		intraFontPrintf( ltn8, 480/2, (272>>1)-50, "Searching for %s", g_PatchSymbols[i]->Name );
-		CGraphicsContext::Get()->EndFrame();
-		CGraphicsContext::Get()->UpdateFrame( true );
 #endif
-#endif //DAEDALUS_DEBUG_CONSOLE
-		// Skip symbol if already found, or if it is a variable
+		// Skip symbol if already found (e.g. as a dependency of an earlier symbol)
 		if (g_PatchSymbols[i]->Found)
 			continue;
 
 		// Symbol not found, attempt to locate on this pass. This may
 		// fail if all dependent symbols are not found
-		if (Patch_LocateFunction(g_PatchSymbols[i]))
+		if (Patch_LocateFunction(g_PatchSymbols[i], &candidates[ first_signature[i] ]))
 			nFound++;
 	}
 
+	u64 end_time;
+	NTiming::GetPreciseTime( &end_time );
+	DBGConsole_Msg(0, "Searching for os functions took %dms", (u32)NTiming::ToMilliseconds( end_time - start_time ));
+
 	if ( gCPUState.IsJobSet( CPU_STOP_RUNNING ) )
 	{
 #ifdef DAEDALUS_DEBUG_CONSOLE
@@ -606,21 +640,21 @@ void Patch_RecurseAndFind()
 				nFound++;
 			}
 		}
+	}
 #ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg(0, "%d/%d symbols identified, in range 0x%08x -> 0x%08x",
+	DBGConsole_Msg(0, "%d/%d symbols identified, in range 0x%08x -> 0x%08x",
 		nFound, nPatchSymbols, first, last);
 #else
 #ifdef DAEDALUS_PSP
-		//Update patching progress on PSPscreen
-		CGraphicsContext::Get()->BeginFrame();
-		CGraphicsContext::Get()->ClearToBlack();
-		intraFontPrintf( ltn8, 480/2, (272>>1), "Symbols Identified: %d%%", 100 * nFound / (nPatchSymbols-1));
-		intraFontPrintf( ltn8, 480/2, (272>>1)+50, "Range 0x%08x -> 0x%08x", first, last );
-		CGraphicsContext::Get()->EndFrame();
-		CGraphicsContext::Get()->UpdateFrame( true );
+	//Update patching progress on PSPscreen
+	CGraphicsContext::Get()->BeginFrame();
+	CGraphicsContext::Get()->ClearToBlack();
+	intraFontPrintf( ltn8, 480/2, (272>>1), "Symbols Identified: %d%%", 100 * nFound / (nPatchSymbols-1));
+	intraFontPrintf( ltn8, 480/2, (272>>1)+50, "Range 0x%08x -> 0x%08x", first, last );
+	CGraphicsContext::Get()->EndFrame();
+	CGraphicsContext::Get()->UpdateFrame( true );
 #endif
 #endif
-	}
 
 	nFound = 0;
 	for (u32 i = 0; i < nPatchVariables; i++)
@@ -648,19 +682,19 @@ void Patch_RecurseAndFind()
 
 			nFound++;
 		}
+	}
 #ifdef DAEDALUS_DEBUG_CONSOLE
-		DBGConsole_Msg(0, "%d/%d variables identified", nFound, nPatchVariables);
+	DBGConsole_Msg(0, "%d/%d variables identified", nFound, nPatchVariables);
 #else
 #ifdef DAEDALUS_PSP
-		//Update patching progress on PSPscreen
-		CGraphicsContext::Get()->BeginFrame();
-		CGraphicsContext::Get()->ClearToBlack();
-		intraFontPrintf( ltn8, 480/2, 272>>1, "Variables Identified: %d%%", 100 * nFound / (nPatchVariables-1) );
-		CGraphicsContext::Get()->EndFrame();
-		CGraphicsContext::Get()->UpdateFrame( true );
+	//Update patching progress on PSPscreen
+	CGraphicsContext::Get()->BeginFrame();
+	CGraphicsContext::Get()->ClearToBlack();
+	intraFontPrintf( ltn8, 480/2, 272>>1, "Variables Identified: %d%%", 100 * nFound / (nPatchVariables-1) );
+	CGraphicsContext::Get()->EndFrame();
+	CGraphicsContext::Get()->UpdateFrame( true );
 #endif
 #endif
-	}
 
 #ifndef DAEDALUS_DEBUG_CONSOLE
 #ifdef DAEDALUS_PSP
@@ -671,33 +705,199 @@ void Patch_RecurseAndFind()
 
 }
 
-// Attempt to locate this symbol.
-bool Patch_LocateFunction(PatchSymbol * ps)
+namespace
 {
-	OpCode op;
-	const u32 * code_base( g_pu32RamBase );
+	// How each op covered by the partial crc is masked before it's added to the crc
+	enum EPartialOpMask
+	{
+		POM_NONE,			// Only J targets are masked
+		POM_JUMP,			// Must be a J/JAL, target masked
+		POM_HALFWORD,		// Low halfword masked (variable reference)
+	};
 
-	for (u32 s = 0; s < ps->Signatures[s].NumOps; s++)
+	typedef std::pair< u32, u32 >	PartialCRCSignature;		// Partial crc, signature index
+
+	struct SPartialCRCGroup
 	{
-		PatchSignature * psig;
-		psig = &ps->Signatures[s];
+		u8									Masks[ PATCH_PARTIAL_CRC_LEN ];
+		std::vector< PartialCRCSignature >	Signatures;				// Sorted by crc
+	};
+
+	// Signatures too short to have a partial crc are checked against their full crc in place
+	struct SShortSignature
+	{
+		u32									Index;
+		u32									NumOps;
+		u32									CRC;
+		u8									Masks[ PATCH_PARTIAL_CRC_LEN ];
+	};
+
+	void BuildPartialOpMasks( const PatchSignature * psig, u8 * masks )
+	{
+		memset( masks, POM_NONE, PATCH_PARTIAL_CRC_LEN );
+		for (const PatchCrossRef * pcr = psig->CrossRefs; pcr != NULL && pcr->Offset != u32(~0); pcr++)
+		{
+			if (pcr->Offset < PATCH_PARTIAL_CRC_LEN)
+			{
+				masks[pcr->Offset] = pcr->Type == PX_JUMP ? POM_JUMP : POM_HALFWORD;
+			}
+		}
+	}
+
+	// Returns false if an op which should be a jump isn't one.
+	bool CalcMaskedCRC( const OpCode * ops, const u8 * masks, u32 num_ops, u32 * p_crc )
+	{
+		u32 crc( 0 );
+		for (u32 m = 0; m < num_ops; m++)
+		{
+			OpCode masked( ops[m] );
+			if (masks[m] == POM_JUMP)
+			{
+				if (masked.op != OP_JAL && masked.op != OP_J)
+					return false;
+				masked.target = 0;
+			}
+			else if (masks[m] == POM_HALFWORD)
+			{
+				masked._u32 &= ~0x0000ffff;
+			}
+			else if (masked.op == OP_J)
+			{
+				masked.target = 0;
+			}
+			crc = daedalus_crc32(crc, (u8*)&masked, 4);
+		}
+		*p_crc = crc;
+		return true;
+	}
+}
+
+//
+//	Builds a table of signatures keyed on their first op and partial crc, then sweeps
+//	through ram once, computing the partial crc for each location that has a matching
+//	first op. This only filters on the first few ops - cross references and the full
+//	crc are checked later by Patch_VerifyLocation_CheckSignature.
+//
+static void Patch_ScanForSignatures(const std::vector< PatchSignature * > & signatures, std::vector< SignatureCandidates > & candidates)
+{
+	std::vector< SPartialCRCGroup >	groups[ 64 ];
+	std::vector< SShortSignature >	short_signatures[ 64 ];
+
+	for (u32 idx = 0; idx < signatures.size(); idx++)
+	{
+		const PatchSignature * psig( signatures[idx] );
+		u32 first_op( psig->FirstOp & 0x3F );
+
+		u8 masks[ PATCH_PARTIAL_CRC_LEN ];
+		BuildPartialOpMasks( psig, masks );
+
+		if (psig->NumOps < PATCH_PARTIAL_CRC_LEN)
+		{
+			SShortSignature	short_sig;
+			short_sig.Index = idx;
+			short_sig.NumOps = psig->NumOps;
+			short_sig.CRC = psig->CRC;
+			memcpy( short_sig.Masks, masks, sizeof( masks ) );
+			short_signatures[first_op].push_back( short_sig );
+			continue;
+		}
+
+		std::vector< SPartialCRCGroup > & op_groups( groups[first_op] );
+		u32 g;
+		for (g = 0; g < op_groups.size(); g++)
+		{
+			if (memcmp( op_groups[g].Masks, masks, sizeof( masks ) ) == 0)
+				break;
+		}
+		if (g == op_groups.size())
+		{
+			op_groups.push_back( SPartialCRCGroup() );
+			memcpy( op_groups[g].Masks, masks, sizeof( masks ) );
+		}
+		op_groups[g].Signatures.push_back( PartialCRCSignature( psig->PartialCRC, idx ) );
+	}
+
+	for (u32 op = 0; op < 64; op++)
+	{
+		for (u32 g = 0; g < groups[op].size(); g++)
+		{
+			std::sort( groups[op][g].Signatures.begin(), groups[op][g].Signatures.end() );
+		}
+	}
+
+	const u32 *	code_base( g_pu32RamBase );
+	const u32	num_words( gRamSize >> 2 );
+	for (u32 i = 0; i < num_words; i++)
+	{
+		OpCode op;
+		op._u32 = code_base[i];
+		op = GetCorrectOp( op );
+
+		const std::vector< SShortSignature > & shorts( short_signatures[op.op] );
+		const std::vector< SPartialCRCGroup > & op_groups( groups[op.op] );
+		if (shorts.empty() && op_groups.empty())
+			continue;
+
+		// Only fetch as many ops as are left in ram - anything that needs more can't match here.
+		const u32 num_ops( Min( num_words - i, PATCH_PARTIAL_CRC_LEN ) );
+
+		OpCode ops[ PATCH_PARTIAL_CRC_LEN ];
+		ops[0] = op;
+		for (u32 m = 1; m < num_ops; m++)
+		{
+			ops[m]._u32 = code_base[i+m];
+			ops[m] = GetCorrectOp( ops[m] );
+		}
+
+		// Short signatures match on their full crc, so only real matches are kept as candidates
+		// (some, like sqrtf, start with an op as common as a nop).
+		for (u32 c = 0; c < shorts.size(); c++)
+		{
+			const SShortSignature & short_sig( shorts[c] );
+
+			u32 crc;
+			if (short_sig.NumOps <= num_ops && CalcMaskedCRC( ops, short_sig.Masks, short_sig.NumOps, &crc ) && crc == short_sig.CRC)
+			{
+				candidates[ short_sig.Index ].push_back( i );
+			}
+		}
+
+		if (num_ops < PATCH_PARTIAL_CRC_LEN)
+			continue;
 
-		// Sweep through OS range
-		for (u32 i = 0; i < (gRamSize>>2); i++)
+		for (u32 g = 0; g < op_groups.size(); g++)
 		{
-			op._u32 = code_base[i];
-			op = GetCorrectOp( op );
+			const SPartialCRCGroup & group( op_groups[g] );
 
-			// First op must match!
-			if ( psig->FirstOp != op.op )
+			u32 crc;
+			if (!CalcMaskedCRC( ops, group.Masks, PATCH_PARTIAL_CRC_LEN, &crc ))
 				continue;
 
+			std::vector< PartialCRCSignature >::const_iterator it( std::lower_bound( group.Signatures.begin(), group.Signatures.end(), PartialCRCSignature( crc, 0 ) ) );
+			for ( ; it != group.Signatures.end() && it->first == crc; ++it)
+			{
+				candidates[ it->second ].push_back( i );
+			}
+		}
+	}
+}
+
+// Attempt to locate this symbol, given the candidate locations for each of its signatures.
+bool Patch_LocateFunction(PatchSymbol * ps, const SignatureCandidates * candidates)
+{
+	for (u32 s = 0; ps->Signatures[s].NumOps != 0; s++)
+	{
+		PatchSignature * psig;
+		psig = &ps->Signatures[s];
+
+		const SignatureCandidates & indices( candidates[s] );
+		for (u32 c = 0; c < indices.size(); c++)
+		{
 			// See if function i exists at this location
-			if (Patch_VerifyLocation_CheckSignature(ps, psig, i))
+			if (Patch_VerifyLocation_CheckSignature(ps, psig, indices[c]))
 			{
 				return true;
 			}
-
 		}
 	}
 
@@ -936,6 +1136,55 @@ fail_find:
 	return false;
 }
 
+//
+//	The cache stores, for each symbol, the location and signature it was found with and a
+//	crc of the code there. Everything is verified against ram when it's loaded, so a stale
+//	cache (e.g. a different overlay, or a hacked rom with the same filename) only costs a
+//	scan for the symbols which moved.
+//
+//	Layout: MAGIC_HEADER, table hash, num symbols, num variables,
+//	then Location/Signature/CodeCRC per symbol and Location per variable.
+//
+struct SPatchCacheSymbol
+{
+	u32		Location;		// 0 if not found
+	u32		Signature;
+	u32		CodeCRC;
+};
+
+static const u32 kPatchCacheHeaderWords = 4;
+
+// Hash the parts of the symbol table used for matching, so any changes invalidate the cache.
+static u32 Patch_GetSymbolTableHash()
+{
+	u32 hash = 0;
+	for (u32 i = 0; i < nPatchSymbols; i++)
+	{
+		const PatchSymbol * ps = g_PatchSymbols[i];
+		hash = daedalus_crc32(hash, (const u8 *)ps->Name, strlen(ps->Name));
+
+		for (const PatchSignature * psig = ps->Signatures; psig->NumOps != 0; psig++)
+		{
+			u32 sig[4] = { psig->NumOps, psig->FirstOp, psig->PartialCRC, psig->CRC };
+			hash = daedalus_crc32(hash, (const u8 *)sig, sizeof(sig));
+		}
+	}
+	for (u32 i = 0; i < nPatchVariables; i++)
+	{
+		hash = daedalus_crc32(hash, (const u8 *)g_PatchVariables[i]->Name, strlen(g_PatchVariables[i]->Name));
+	}
+	return hash;
+}
+
+static bool Patch_GetCodeCRC(u32 location, u32 num_ops, u32 * crc)
+{
+	if (location + num_ops * 4 > gRamSize)
+		return false;
+
+	*crc = daedalus_crc32(0, g_pu8RamBase + location, num_ops * 4);
+	return true;
+}
+
 static void Patch_FlushCache()
 {
 	IO::Filename name;
@@ -943,108 +1192,164 @@ static void Patch_FlushCache()
 	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".hle");
 	DBGConsole_Msg(0, "Write OSHLE cache: %s", name);
 
-	FILE *fp = fopen(name, "wb");
+	std::vector< u32 > data;
+	data.push_back( MAGIC_HEADER );
+	data.push_back( Patch_GetSymbolTableHash() );
+	data.push_back( nPatchSymbols );
+	data.push_back( nPatchVariables );
 
-	if (fp != NULL)
+	for (u32 i = 0; i < nPatchSymbols; i++)
 	{
-		u32 data = MAGIC_HEADER;
-		fwrite(&data, 1, sizeof(data), fp);
+		const PatchSymbol * ps = g_PatchSymbols[i];
+		SPatchCacheSymbol entry = { 0, 0, 0 };
 
-		for (u32 i = 0; i < nPatchSymbols; i++)
+		if (ps->Found)
 		{
-			if (g_PatchSymbols[i]->Found )
+			u32 s;
+			for (s = 0; ps->Signatures[s].Function != ps->Function; s++)
 			{
-				data = g_PatchSymbols[i]->Location;
-				fwrite(&data, 1, sizeof(data), fp);
-				for(data = 0; ;data++)
-				{
-					if (g_PatchSymbols[i]->Signatures[data].Function ==
-						g_PatchSymbols[i]->Function)
-						break;
-				}
-				fwrite(&data, 1, sizeof(data), fp);
 			}
-			else
+
+			if (Patch_GetCodeCRC(ps->Location, ps->Signatures[s].NumOps, &entry.CodeCRC))
 			{
-				data = 0;
-				fwrite(&data, 1, sizeof(data), fp);
+				entry.Location = ps->Location;
+				entry.Signature = s;
 			}
-
-
 		}
 
-		for (u32 i = 0; i < nPatchVariables; i++)
-		{
-			if (g_PatchVariables[i]->Found )
-			{
-				data = g_PatchVariables[i]->Location;
-			}
-			else
-			{
-				data = 0;
-			}
+		data.push_back( entry.Location );
+		data.push_back( entry.Signature );
+		data.push_back( entry.CodeCRC );
+	}
 
-			fwrite(&data, 1, sizeof(data), fp);
-		}
+	for (u32 i = 0; i < nPatchVariables; i++)
+	{
+		data.push_back( g_PatchVariables[i]->Found ? g_PatchVariables[i]->Location : 0 );
+	}
 
+	FILE *fp = fopen(name, "wb");
+	if (fp != NULL)
+	{
+		fwrite(&data[0], sizeof(u32), data.size(), fp);
 		fclose(fp);
 	}
 }
 
 
-static bool Patch_GetCache()
+static EPatchCacheResult Patch_GetCache()
 {
 	IO::Filename name;
 
 	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".hle");
 	FILE *fp = fopen(name, "rb");
 
-	if (fp != NULL)
+	if (fp == NULL)
+		return PCR_MISSING;
+
+	DBGConsole_Msg(0, "Read from OSHLE cache: %s", name);
+
+	// Read the whole thing in one go
+	u32 expected_words = kPatchCacheHeaderWords + nPatchSymbols * 3 + nPatchVariables;
+	std::vector< u32 > data( expected_words );
+	u32 num_read = fread(&data[0], sizeof(u32), expected_words, fp);
+	fclose(fp);
+
+	if (num_read != expected_words ||
+		data[0] != MAGIC_HEADER ||
+		data[1] != Patch_GetSymbolTableHash() ||
+		data[2] != nPatchSymbols ||
+		data[3] != nPatchVariables)
+	{
+		DBGConsole_Msg(0, "OSHLE cache is out of date");
+		return PCR_MISSING;
+	}
+
+	const SPatchCacheSymbol * symbols = reinterpret_cast< const SPatchCacheSymbol * >( &data[kPatchCacheHeaderWords] );
+	const u32 * variables = &data[kPatchCacheHeaderWords + nPatchSymbols * 3];
+
+	// Check the code at every cached location still matches
+	u32 num_moved = 0;
+	for (u32 i = 0; i < nPatchSymbols; i++)
 	{
-		DBGConsole_Msg(0, "Read from OSHLE cache: %s", name);
-		u32 data;
+		PatchSymbol * ps = g_PatchSymbols[i];
+		const SPatchCacheSymbol & entry( symbols[i] );
 
-		fread(&data, 1, sizeof(data), fp);
-		if (data != MAGIC_HEADER)
+		ps->Found = false;
+		if (entry.Location == 0)
+			continue;
+
+		u32 num_signatures = 0;
+		while (ps->Signatures[num_signatures].NumOps != 0)
+			num_signatures++;
+
+		u32 crc;
+		if (entry.Signature < num_signatures &&
+			Patch_GetCodeCRC(entry.Location, ps->Signatures[entry.Signature].NumOps, &crc) &&
+			crc == entry.CodeCRC)
+		{
+			ps->Found = true;
+			ps->Location = entry.Location;
+			ps->Function = ps->Signatures[entry.Signature].Function;
+		}
+		else
 		{
-			fclose(fp);
-			return false;
+			num_moved++;
 		}
+	}
+
+	//
+	//	Variable addresses are embedded in the code of the functions which reference them, so
+	//	they're only trusted if one of the verified functions references them. The others are
+	//	left to be found again by the scan.
+	//
+	std::vector< bool > variable_verified( nPatchVariables, false );
+	for (u32 i = 0; i < nPatchSymbols; i++)
+	{
+		const PatchSymbol * ps = g_PatchSymbols[i];
+		if (!ps->Found)
+			continue;
 
-		for (u32 i = 0; i < nPatchSymbols; i++)
+		for (const PatchCrossRef * pcr = ps->Signatures[symbols[i].Signature].CrossRefs; pcr != NULL && pcr->Offset != u32(~0); pcr++)
 		{
-			fread(&data, 1, sizeof(data), fp);
-			if (data != 0)
+			if (pcr->Variable == NULL)
+				continue;
+
+			for (u32 v = 0; v < nPatchVariables; v++)
 			{
-				g_PatchSymbols[i]->Found = true;
-				g_PatchSymbols[i]->Location = data;
-				fread(&data, 1, sizeof(data), fp);
-				g_PatchSymbols[i]->Function = g_PatchSymbols[i]->Signatures[data].Function;
+				if (g_PatchVariables[v] == pcr->Variable)
+					variable_verified[v] = true;
 			}
-			else
-				g_PatchSymbols[i]->Found = false;
 		}
+	}
 
-		for (u32 i = 0; i < nPatchVariables; i++)
+	for (u32 i = 0; i < nPatchVariables; i++)
+	{
+		PatchVariable * pv = g_PatchVariables[i];
+		if (variables[i] != 0 && variable_verified[i])
 		{
-			fread(&data, 1, sizeof(data), fp);
-			if (data != 0)
-			{
-				g_PatchVariables[i]->Found = true;
-				g_PatchVariables[i]->Location = data;
-			}
-			else
-			{
-				g_PatchVariables[i]->Found = false;
-				g_PatchVariables[i]->Location = 0;
-			}
+			pv->Found = true;
+			pv->FoundHi = true;
+			pv->FoundLo = true;
+			pv->Location = variables[i];
+			pv->HiWord = (u16)((variables[i] + 0x8000) >> 16);
+			pv->LoWord = (u16)(variables[i] & 0xFFFF);
+		}
+		else
+		{
+			pv->Found = false;
+			pv->FoundHi = false;
+			pv->FoundLo = false;
+			pv->Location = 0;
 		}
+	}
 
-		fclose(fp);
-		return true;
+	if (num_moved > 0)
+	{
+		DBGConsole_Msg(0, "OSHLE cache: %d symbols have moved", num_moved);
+		return PCR_PARTIAL;
 	}
 
-	return false;
+	return PCR_VALID;
 }
 
 static u32 RET_NOT_PROCESSED(PatchSymbol* ps)
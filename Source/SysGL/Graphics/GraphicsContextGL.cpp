@@ -4,9 +4,13 @@
 #include <stdio.h>
 
 #include "SysGL/GL.h"
+#include "SysGL/HLEGraphics/FrameBufferCacheGL.h"
 #include "Graphics/GraphicsContext.h"
 
 #include "Graphics/ColourValue.h"
+#include "Graphics/FrameDump.h"
+#include "Config/ConfigOptions.h"
+#include "Utility/IO.h"
 
 
 static u32 SCR_WIDTH = 640;
@@ -15,9 +19,26 @@ static u32 SCR_HEIGHT = 480;
 // FIXME: This is global to lots of SysGL stuff. Wrap it up elsewhere, and keep this file for the graphics side of things.
 GLFWwindow * gWindow = NULL;
 
+// Captured frames are read back into a ring of pixel buffers, and only mapped
+// once their fence has signalled. We only wait on the GPU if the ring is full.
+static const u32	kNumCaptureBuffers = 3;
+static const GLuint64	kCaptureTimeoutNs = 1000000000;
+
+struct SCaptureBuffer
+{
+	GLuint			PBO;
+	GLsync			Fence;
+	u32				Width;
+	u32				Height;
+	u32				Size;
+	bool			ScreenShot;
+	IO::Filename	Filename;
+};
+
 class GraphicsContextGL : public CGraphicsContext
 {
 public:
+	GraphicsContextGL();
 	virtual ~GraphicsContextGL();
 
 
@@ -37,8 +58,18 @@ public:
 	virtual void ViewportType(u32 * width, u32 * height) const;
 
 	virtual void SetDebugScreenTarget( ETargetSurface buffer ) {}
-	virtual void DumpNextScreen() {}
-	virtual void DumpScreenShot() {}
+	virtual void DumpNextScreen() { mDumpNextScreen = true; }
+	virtual void DumpScreenShot();
+
+private:
+	void CaptureFrame( const char * filename );
+	void ProcessCaptures( bool wait );
+	bool ReadBackCapture( SCaptureBuffer & buffer, bool wait );
+
+private:
+	bool			mDumpNextScreen;
+	SCaptureBuffer	mCaptureBuffers[ kNumCaptureBuffers ];
+	u32				mNextCapture;
 };
 
 template<> bool CSingleton< CGraphicsContext >::Create()
@@ -50,8 +81,30 @@ template<> bool CSingleton< CGraphicsContext >::Create()
 }
 
 
+GraphicsContextGL::GraphicsContextGL()
+:	mDumpNextScreen( false )
+,	mNextCapture( 0 )
+{
+	memset( mCaptureBuffers, 0, sizeof( mCaptureBuffers ) );
+}
+
 GraphicsContextGL::~GraphicsContextGL()
 {
+	// Hand over any frames still in flight before the context goes away.
+	if (gWindow)
+	{
+		ProcessCaptures( true );
+
+		for (u32 i = 0; i < kNumCaptureBuffers; ++i)
+		{
+			SCaptureBuffer & buffer = mCaptureBuffers[i];
+			if (buffer.Fence)
+				glDeleteSync( buffer.Fence );
+			if (buffer.PBO)
+				glDeleteBuffers( 1, &buffer.PBO );
+		}
+	}
+
 	// glew
 
 	// FIXME: would be better in an separate SysGL file.
@@ -93,6 +146,12 @@ bool GraphicsContextGL::Initialise()
 #endif
 
 	glfwWindowHint(GLFW_DEPTH_BITS, 24);
+
+	// Headless runs still need a context to render into, just not a visible one.
+	if (gHeadlessMode)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+	}
 	//glfwWindowHint(GLFW_STENCIL_BITS, 0);
 
 	// Open a window and create its OpenGL context
@@ -113,7 +172,7 @@ bool GraphicsContextGL::Initialise()
 	//glfwEnable( GLFW_STICKY_KEYS );
 
 	// Enable vertical sync (on cards that support it)
-	glfwSwapInterval( 1 );
+	glfwSwapInterval( gHeadlessMode ? 0 : 1 );
 
 	// Initialise GLEW
 	//glewExperimental = GL_TRUE;
@@ -206,9 +265,133 @@ void GraphicsContextGL::EndFrame()
 
 void GraphicsContextGL::UpdateFrame( bool wait_for_vbl )
 {
+	// Pick up any earlier captures which have finished, then queue this frame's while it's still in the backbuffer.
+	ProcessCaptures( false );
+
+	if (mDumpNextScreen)
+	{
+		mDumpNextScreen = false;
+		DumpScreenShot();
+	}
+
+	if (FrameDump_ShouldCaptureFrame())
+	{
+		CaptureFrame( NULL );
+	}
+
 	glfwSwapBuffers(gWindow);
 //	if( gCleanSceneEnabled ) //TODO: This should be optional
 	{
 		ClearColBuffer( c32(0xff000000) ); // ToDo : Use gFillColor instead?
 	}
 }
+
+void GraphicsContextGL::DumpScreenShot()
+{
+	IO::Filename filename;
+	FrameDump_GetScreenShotFilename( filename );
+
+	CaptureFrame( filename );
+}
+
+void GraphicsContextGL::CaptureFrame( const char * filename )
+{
+	SCaptureBuffer & buffer = mCaptureBuffers[mNextCapture];
+
+	// If the oldest capture still hasn't completed, the ring is full and we have no choice but to wait.
+	if (buffer.Fence)
+	{
+		ProcessCaptures( true );
+
+		if (buffer.Fence)
+		{
+			DAEDALUS_ERROR( "Timed out waiting for frame capture - dropping frame" );
+			return;
+		}
+	}
+
+	// Capture at the resolution we rendered at, rather than whatever the window is scaled to.
+	GLuint	framebuffer = 0;
+	u32		width, height;
+	if (!FrameBufferCache_GetDisplayedImage( &framebuffer, &width, &height ))
+	{
+		GetScreenSize(&width, &height);
+	}
+
+	if (buffer.PBO == 0)
+	{
+		glGenBuffers( 1, &buffer.PBO );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, buffer.PBO );
+
+	u32 size = width * height * 4;
+	if (size != buffer.Size)
+	{
+		glBufferData( GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ );
+		buffer.Size = size;
+	}
+
+	// With a pack buffer bound this just queues the copy, rather than waiting for the frame to finish.
+	glPixelStorei( GL_PACK_ALIGNMENT, 4 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, framebuffer );
+	glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0 );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	buffer.Fence      = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	buffer.Width      = width;
+	buffer.Height     = height;
+	buffer.ScreenShot = filename != NULL;
+	IO::Path::Assign( buffer.Filename, filename != NULL ? filename : "" );
+
+	mNextCapture = (mNextCapture + 1) % kNumCaptureBuffers;
+}
+
+void GraphicsContextGL::ProcessCaptures( bool wait )
+{
+	// mNextCapture is the oldest slot, so walking forward from there keeps the frames in order.
+	for (u32 i = 0; i < kNumCaptureBuffers; ++i)
+	{
+		SCaptureBuffer & buffer = mCaptureBuffers[(mNextCapture + i) % kNumCaptureBuffers];
+		if (buffer.Fence && !ReadBackCapture( buffer, wait ))
+		{
+			break;
+		}
+	}
+}
+
+bool GraphicsContextGL::ReadBackCapture( SCaptureBuffer & buffer, bool wait )
+{
+	GLenum result = glClientWaitSync( buffer.Fence,
+									  wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+									  wait ? kCaptureTimeoutNs : 0 );
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		return false;
+	}
+
+	glDeleteSync( buffer.Fence );
+	buffer.Fence = 0;
+
+	if (result == GL_WAIT_FAILED)
+	{
+		DAEDALUS_ERROR( "Failed to wait for frame capture" );
+		return true;
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, buffer.PBO );
+
+	const u8 * pixels = static_cast< const u8 * >( glMapBufferRange( GL_PIXEL_PACK_BUFFER, 0, buffer.Size, GL_MAP_READ_BIT ) );
+	if (pixels)
+	{
+		// GL's rows are bottom-up.
+		s32 pitch = buffer.Width * 4;
+		FrameDump_SubmitFrame( pixels + (buffer.Height - 1) * pitch, -pitch, buffer.Width, buffer.Height,
+							   buffer.ScreenShot ? buffer.Filename : NULL );
+		glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+	}
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	return true;
+}
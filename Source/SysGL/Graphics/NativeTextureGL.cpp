@@ -27,9 +27,142 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <stdlib.h>
 #include <png.h>
 
+#include <vector>
+
 static const u32 kPalette4BytesRequired = 16 * sizeof( NativePf8888 );
 static const u32 kPalette8BytesRequired = 256 * sizeof( NativePf8888 );
 
+namespace
+{
+	// Textures up to this size share arrays with others of the same corrected size.
+	const u32	kMaxPooledDimension	= 64;
+	const u32	kLayersPerPage		= 64;
+
+	// Uploads are done on the last unit, so they don't disturb the textures bound for drawing.
+	const u32	kNumTrackedUnits	= 4;
+	const u32	kUploadUnit			= kNumTrackedUnits - 1;
+
+	struct STexturePage
+	{
+		GLuint		Id;
+		u32			Width;
+		u32			Height;
+		u64			UsedLayers;
+	};
+
+	std::vector< STexturePage >	gPages;
+
+	// Nothing else binds GL_TEXTURE_2D_ARRAY, so we can skip redundant binds.
+	GLuint						gUnitArrays[ kNumTrackedUnits ];
+
+	inline bool IsPooled( u32 width, u32 height )
+	{
+		return width <= kMaxPooledDimension && height <= kMaxPooledDimension;
+	}
+
+	void BindArray( u32 unit, GLuint id )
+	{
+		if( gUnitArrays[ unit ] != id )
+		{
+			glActiveTexture( GL_TEXTURE0 + unit );
+			glBindTexture( GL_TEXTURE_2D_ARRAY, id );
+			gUnitArrays[ unit ] = id;
+		}
+	}
+
+	void BindArrayForUpload( GLuint id )
+	{
+		glActiveTexture( GL_TEXTURE0 + kUploadUnit );
+		if( gUnitArrays[ kUploadUnit ] != id )
+		{
+			glBindTexture( GL_TEXTURE_2D_ARRAY, id );
+			gUnitArrays[ kUploadUnit ] = id;
+		}
+	}
+
+	GLuint CreateArray( u32 width, u32 height, u32 layers )
+	{
+		GLuint id = 0;
+		glGenTextures( 1, &id );
+		if( id == 0 )
+			return 0;
+
+		BindArrayForUpload( id );
+
+		// Everything is sampled with texelFetch, so there's no need to change these per draw.
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0 );
+		glTexImage3D( GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, width, height, layers,
+					  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, NULL );
+		return id;
+	}
+
+	void DeleteArray( GLuint id )
+	{
+		glDeleteTextures( 1, &id );
+
+		// Deleting a texture unbinds it.
+		for( u32 i = 0; i < kNumTrackedUnits; ++i )
+		{
+			if( gUnitArrays[i] == id )
+				gUnitArrays[i] = 0;
+		}
+	}
+
+	GLuint AllocateLayer( u32 width, u32 height, u32 * p_layer )
+	{
+		for( u32 i = 0; i < gPages.size(); ++i )
+		{
+			STexturePage & page( gPages[i] );
+			if( page.Width == width && page.Height == height && page.UsedLayers != ~u64( 0 ) )
+			{
+				u32 layer = 0;
+				while( page.UsedLayers & (u64( 1 ) << layer) )
+					++layer;
+
+				page.UsedLayers |= u64( 1 ) << layer;
+				*p_layer = layer;
+				return page.Id;
+			}
+		}
+
+		STexturePage page;
+		page.Id         = CreateArray( width, height, kLayersPerPage );
+		page.Width      = width;
+		page.Height     = height;
+		page.UsedLayers = 1;
+		if( page.Id == 0 )
+			return 0;
+
+		gPages.push_back( page );
+		*p_layer = 0;
+		return page.Id;
+	}
+
+	void FreeLayer( GLuint id, u32 layer )
+	{
+		for( u32 i = 0; i < gPages.size(); ++i )
+		{
+			STexturePage & page( gPages[i] );
+			if( page.Id == id )
+			{
+				page.UsedLayers &= ~(u64( 1 ) << layer);
+				if( page.UsedLayers == 0 )
+				{
+					DeleteArray( id );
+					gPages.erase( gPages.begin() + i );
+				}
+				return;
+			}
+		}
+
+		DAEDALUS_ERROR( "Freeing a layer from an unknown texture array" );
+	}
+}
+
 static u32 GetTextureBlockWidth( u32 dimension, ETextureFormat texture_format )
 {
 	DAEDALUS_ASSERT( GetNextPowerOf2( dimension ) == dimension, "This is not a power of 2" );
@@ -64,8 +197,10 @@ CNativeTexture::CNativeTexture( u32 w, u32 h, ETextureFormat texture_format )
 ,	mpData( NULL )
 ,	mpPalette( NULL )
 ,	mTextureId( 0 )
+,	mLayer( 0 )
+,	mDetail( 1 )
 {
-	glGenTextures( 1, &mTextureId );
+	AllocateStorage( 1 );
 
 	size_t data_len = GetBytesRequired();
 	mpData = malloc(data_len);
@@ -88,7 +223,40 @@ CNativeTexture::~CNativeTexture()
 	if (mpPalette)
 		free(mpPalette);
 
-	glDeleteTextures( 1, &mTextureId );
+	ReleaseStorage();
+}
+
+void CNativeTexture::AllocateStorage( u32 detail )
+{
+	u32 width  = mCorrectedWidth * detail;
+	u32 height = mCorrectedHeight * detail;
+
+	if( IsPooled( width, height ) )
+	{
+		mTextureId = AllocateLayer( width, height, &mLayer );
+	}
+	else
+	{
+		mTextureId = CreateArray( width, height, 1 );
+		mLayer     = 0;
+	}
+	mDetail = detail;
+}
+
+void CNativeTexture::ReleaseStorage()
+{
+	if( mTextureId == 0 )
+		return;
+
+	if( IsPooled( mCorrectedWidth * mDetail, mCorrectedHeight * mDetail ) )
+	{
+		FreeLayer( mTextureId, mLayer );
+	}
+	else
+	{
+		DeleteArray( mTextureId );
+	}
+	mTextureId = 0;
 }
 
 bool CNativeTexture::HasData() const
@@ -98,7 +266,13 @@ bool CNativeTexture::HasData() const
 
 void CNativeTexture::InstallTexture() const
 {
-	glBindTexture( GL_TEXTURE_2D, mTextureId );
+	InstallTexture( 0 );
+}
+
+void CNativeTexture::InstallTexture( u32 unit ) const
+{
+	DAEDALUS_ASSERT( unit < kUploadUnit, "Texture unit %d is reserved for uploads", unit );
+	BindArray( unit, mTextureId );
 }
 
 
@@ -274,6 +448,13 @@ void CNativeTexture::SetData( void * data, void * palette )
 	size_t data_len = GetBytesRequired();
 	memcpy(mpData, data, data_len);
 
+	// Revert to the N64 resolution (and back into a shared array, if it's small enough).
+	if (mDetail != 1)
+	{
+		ReleaseStorage();
+		AllocateStorage( 1 );
+	}
+
 	if (mTextureFormat == TexFmt_CI4_8888)
 	{
 		memcpy(mpPalette, palette, kPalette4BytesRequired);
@@ -285,31 +466,31 @@ void CNativeTexture::SetData( void * data, void * palette )
 
 	if (HasData())
 	{
-		glBindTexture( GL_TEXTURE_2D, mTextureId );
+		BindArrayForUpload( mTextureId );
 		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
 
 		switch (mTextureFormat)
 		{
 		case TexFmt_5650:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGB, GL_UNSIGNED_SHORT_5_6_5_REV, data );
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+						  mCorrectedWidth, mCorrectedHeight, 1,
+						  GL_RGB, GL_UNSIGNED_SHORT_5_6_5_REV, data );
 			break;
 		case TexFmt_5551:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, data );
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+						  mCorrectedWidth, mCorrectedHeight, 1,
+						  GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, data );
 			break;
 		case TexFmt_4444:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4_REV, data );
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+						  mCorrectedWidth, mCorrectedHeight, 1,
+						  GL_RGBA, GL_UNSIGNED_SHORT_4_4_4_4_REV, data );
 
 			break;
 		case TexFmt_8888:
-			glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-						  mCorrectedWidth, mCorrectedHeight,
-						  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, data );
+			glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+						  mCorrectedWidth, mCorrectedHeight, 1,
+						  GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, data );
 
 			break;
 		case TexFmt_CI4_8888:
@@ -337,9 +518,9 @@ void CNativeTexture::SetData( void * data, void * palette )
 					pix_ptr = reinterpret_cast<const NativePfCI44 *>( reinterpret_cast<const u8 *>(pix_ptr) + pitch );
 				}
 
-				glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-							  mCorrectedWidth, mCorrectedHeight,
-							  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
+				glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+							  mCorrectedWidth, mCorrectedHeight, 1,
+							  GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
 
 				free(out);
 			}
@@ -369,9 +550,9 @@ void CNativeTexture::SetData( void * data, void * palette )
 					pix_ptr = reinterpret_cast<const NativePfCI8 *>( reinterpret_cast<const u8 *>(pix_ptr) + pitch );
 				}
 
-				glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA,
-							  mCorrectedWidth, mCorrectedHeight,
-							  0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
+				glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+							  mCorrectedWidth, mCorrectedHeight, 1,
+							  GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, out );
 
 				free(out);
 			}
@@ -385,6 +566,26 @@ void CNativeTexture::SetData( void * data, void * palette )
 	}
 }
 
+void CNativeTexture::SetDetailData( const void * data, u32 detail )
+{
+	DAEDALUS_ASSERT( mTextureFormat == TexFmt_8888, "Detail textures must be RGBA 8888" );
+
+	if (detail != mDetail)
+	{
+		ReleaseStorage();
+		AllocateStorage( detail );
+	}
+
+	if (HasData())
+	{
+		BindArrayForUpload( mTextureId );
+		glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+		glTexSubImage3D( GL_TEXTURE_2D_ARRAY, 0, 0, 0, mLayer,
+						 mCorrectedWidth * detail, mCorrectedHeight * detail, 1,
+						 GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, data );
+	}
+}
+
 u32	CNativeTexture::GetStride() const
 {
 	return CalcBytesRequired( mTextureBlockWidth, mTextureFormat );
@@ -0,0 +1,687 @@
+#include "stdafx.h"
+#include "FrameBufferCacheGL.h"
+
+#include <vector>
+
+#include "Config/ConfigOptions.h"
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+#include "Graphics/GraphicsContext.h"
+#include "Graphics/NativeTexture.h"
+#include "HLEGraphics/N64PixelFormat.h"
+#include "HLEGraphics/RDP.h"
+#include "HLEGraphics/TextureInfo.h"
+#include "Math/MathUtil.h"
+#include "OSHLE/ultra_gbi.h"
+#include "SysGL/GL.h"
+#include "Utility/Profiler.h"
+
+// Targets are screen sized, so keep the number small.
+static const u32	kMaxTargets = 8;
+
+// Only serve textures from targets rendered in the last frame or so - older
+// targets have most likely had their memory reused for something else.
+static const u32	kMaxServeAge = 1;
+
+struct SRenderTarget
+{
+	GLuint		Framebuffer;		// Single sampled, with Texture as its colour buffer
+	GLuint		Texture;
+	GLuint		RenderFramebuffer;	// What we draw into. Same as Framebuffer unless multisampled
+	GLuint		RenderColour;
+	u32			Samples;
+	bool		NeedsResolve;
+
+	u32			Address;
+	u32			Size;
+	u32			Width;
+	u32			Height;			// Lowest scissor bottom seen, in N64 lines
+
+	u32			ScreenWidth;
+	u32			ScreenHeight;
+	v2			Scale;
+	v2			Translate;
+
+	bool		Dirty;			// Rendered to since it was last written back to RDRAM
+	u32			LastUsedFrame;
+
+	inline u32	GetPitch() const		{ return (Width << Size) >> 1; }
+	inline u32	GetEndAddress() const	{ return Address + GetPitch() * Height; }
+
+	u32			GetMaxHeight() const
+	{
+		if (Address >= gRamSize)
+			return 0;
+
+		f32 rows = (f32(ScreenHeight) - Translate.y) / Scale.y;
+		u32 max_height = rows > 0.f ? u32(rows) : 0;
+
+		u32 ram_rows = (gRamSize - Address) / GetPitch();
+		return Min( max_height, ram_rows );
+	}
+};
+
+static SRenderTarget	sTargets[ kMaxTargets ];
+static SRenderTarget *	sCurrentTarget = NULL;
+static u32				sScissorBottom = 0;
+static u32				sFrame = 0;
+
+static const SRenderTarget *	sDisplayedTarget = NULL;
+static bool				sOffscreenFailed = false;
+
+static GLuint			sDepthBuffer = 0;
+static u32				sDepthWidth = 0;
+static u32				sDepthHeight = 0;
+static u32				sDepthSamples = 0;
+
+static GLuint			sCopyFramebuffer = 0;
+static GLuint			sReadbackFramebuffer = 0;
+static GLuint			sReadbackBuffer = 0;
+static u32				sReadbackWidth = 0;
+static u32				sReadbackHeight = 0;
+static std::vector<u8>	sReadbackPixels;
+
+static void OnRDRAMRead( u32 address );
+
+//*****************************************************************************
+// Blits change the framebuffer bindings and are clipped by the scissor, so
+// save the renderer's state around them.
+//*****************************************************************************
+class CAutoFramebufferState
+{
+public:
+	CAutoFramebufferState()
+	{
+		glGetIntegerv( GL_READ_FRAMEBUFFER_BINDING, &mReadFramebuffer );
+		glGetIntegerv( GL_DRAW_FRAMEBUFFER_BINDING, &mDrawFramebuffer );
+		mScissorEnabled = glIsEnabled( GL_SCISSOR_TEST );
+		glDisable( GL_SCISSOR_TEST );
+	}
+
+	~CAutoFramebufferState()
+	{
+		glBindFramebuffer( GL_READ_FRAMEBUFFER, mReadFramebuffer );
+		glBindFramebuffer( GL_DRAW_FRAMEBUFFER, mDrawFramebuffer );
+		if (mScissorEnabled)
+			glEnable( GL_SCISSOR_TEST );
+	}
+
+private:
+	GLint		mReadFramebuffer;
+	GLint		mDrawFramebuffer;
+	GLboolean	mScissorEnabled;
+};
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void FrameBufferCache_Initialise()
+{
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		sTargets[i] = SRenderTarget();
+	}
+	sCurrentTarget = NULL;
+	sDisplayedTarget = NULL;
+	sOffscreenFailed = false;
+	sScissorBottom = 0;
+	sFrame = 0;
+
+	Memory_SetRDRAMReadWatchCallback( OnRDRAMRead );
+}
+
+static void DestroyTarget( SRenderTarget & target )
+{
+	if (sCurrentTarget == &target)
+	{
+		glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+		sCurrentTarget = NULL;
+	}
+	if (sDisplayedTarget == &target)
+		sDisplayedTarget = NULL;
+
+	if (target.RenderFramebuffer && target.RenderFramebuffer != target.Framebuffer)
+		glDeleteFramebuffers( 1, &target.RenderFramebuffer );
+	if (target.RenderColour)
+		glDeleteRenderbuffers( 1, &target.RenderColour );
+	if (target.Framebuffer)
+		glDeleteFramebuffers( 1, &target.Framebuffer );
+	if (target.Texture)
+		glDeleteTextures( 1, &target.Texture );
+
+	target = SRenderTarget();
+}
+
+void FrameBufferCache_Finalise()
+{
+	Memory_SetRDRAMReadWatchCallback( NULL );
+
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		DestroyTarget( sTargets[i] );
+	}
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	if (sDepthBuffer)
+		glDeleteRenderbuffers( 1, &sDepthBuffer );
+	if (sCopyFramebuffer)
+		glDeleteFramebuffers( 1, &sCopyFramebuffer );
+	if (sReadbackFramebuffer)
+		glDeleteFramebuffers( 1, &sReadbackFramebuffer );
+	if (sReadbackBuffer)
+		glDeleteRenderbuffers( 1, &sReadbackBuffer );
+
+	sDepthBuffer = sCopyFramebuffer = sReadbackFramebuffer = sReadbackBuffer = 0;
+	sDepthWidth = sDepthHeight = sDepthSamples = sReadbackWidth = sReadbackHeight = 0;
+	sReadbackPixels.clear();
+}
+
+//*****************************************************************************
+// Resolve a multisampled target into its texture before reading from it.
+//*****************************************************************************
+static void ResolveTarget( SRenderTarget & target )
+{
+	if (!target.NeedsResolve)
+		return;
+
+	DAEDALUS_PROFILE( "FrameBufferCache_ResolveTarget" );
+
+	CAutoFramebufferState state;
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, target.RenderFramebuffer );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, target.Framebuffer );
+	glBlitFramebuffer( 0, 0, target.ScreenWidth, target.ScreenHeight,
+					   0, 0, target.ScreenWidth, target.ScreenHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+
+	target.NeedsResolve = false;
+}
+
+//*****************************************************************************
+// Copy a target back into RDRAM at native resolution.
+//*****************************************************************************
+static void WriteBackTarget( SRenderTarget & target )
+{
+	DAEDALUS_PROFILE( "FrameBufferCache_WriteBackTarget" );
+
+	target.Dirty = false;
+
+	u32 width  = target.Width;
+	u32 height = Min( target.Height, target.GetMaxHeight() );
+	if (width == 0 || height == 0)
+		return;
+
+	ResolveTarget( target );
+
+	CAutoFramebufferState state;
+
+	if (sReadbackFramebuffer == 0)
+	{
+		glGenFramebuffers( 1, &sReadbackFramebuffer );
+		glGenRenderbuffers( 1, &sReadbackBuffer );
+	}
+
+	if (width > sReadbackWidth || height > sReadbackHeight)
+	{
+		sReadbackWidth  = Max( width, sReadbackWidth );
+		sReadbackHeight = Max( height, sReadbackHeight );
+
+		glBindRenderbuffer( GL_RENDERBUFFER, sReadbackBuffer );
+		glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, sReadbackWidth, sReadbackHeight );
+		glBindFramebuffer( GL_FRAMEBUFFER, sReadbackFramebuffer );
+		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, sReadbackBuffer );
+	}
+
+	// Flip vertically, so the first row we read is the first N64 line.
+	s32 sx0 = s32( target.Translate.x );
+	s32 sx1 = s32( f32(width)  * target.Scale.x + target.Translate.x );
+	s32 sy0 = s32( target.Translate.y );
+	s32 sy1 = s32( f32(height) * target.Scale.y + target.Translate.y );
+	s32 screen_height = target.ScreenHeight;
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, target.Framebuffer );
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, sReadbackFramebuffer );
+	glBlitFramebuffer( sx0, screen_height - sy1, sx1, screen_height - sy0,
+					   0, height, width, 0, GL_COLOR_BUFFER_BIT, GL_NEAREST );
+
+	sReadbackPixels.resize( width * height * 4 );
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, sReadbackFramebuffer );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &sReadbackPixels[0] );
+
+	const u8 * src = &sReadbackPixels[0];
+	u32 address = target.Address;
+	u32 pitch   = target.GetPitch();
+
+	for (u32 y = 0; y < height; ++y, address += pitch)
+	{
+		if (target.Size == G_IM_SIZ_16b)
+		{
+			for (u32 x = 0; x < width; ++x, src += 4)
+			{
+				// N64 framebuffers use the alpha bit for coverage, so treat everything as fully covered.
+				*(u16 *)(g_pu8RamBase + ((address + x * 2) ^ U16_TWIDDLE)) = N64Pf5551::Make( src[0], src[1], src[2], 0xff );
+			}
+		}
+		else
+		{
+			for (u32 x = 0; x < width; ++x, src += 4)
+			{
+				*(u32 *)(g_pu8RamBase + address + x * 4) = (src[0] << 24) | (src[1] << 16) | (src[2] << 8) | src[3];
+			}
+		}
+	}
+}
+
+static inline bool Overlaps( const SRenderTarget & target, u32 start, u32 end )
+{
+	return target.Framebuffer != 0 && start < target.GetEndAddress() && target.Address < end;
+}
+
+static void OnRDRAMRead( u32 address )
+{
+	u32 page_start = address & ~0x3FFFF;
+	u32 page_end   = page_start + 0x40000;
+
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Dirty && Overlaps( target, page_start, page_end ))
+		{
+			WriteBackTarget( target );
+		}
+	}
+}
+
+static void WatchTarget( const SRenderTarget & target )
+{
+	Memory_WatchRDRAMReads( target.Address, target.GetEndAddress() - target.Address );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static bool EnsureDepthBuffer( u32 width, u32 height, u32 samples )
+{
+	if (sDepthBuffer != 0 && sDepthWidth == width && sDepthHeight == height && sDepthSamples == samples)
+		return false;
+
+	if (sDepthBuffer == 0)
+		glGenRenderbuffers( 1, &sDepthBuffer );
+
+	glBindRenderbuffer( GL_RENDERBUFFER, sDepthBuffer );
+	glRenderbufferStorageMultisample( GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height );
+
+	sDepthWidth   = width;
+	sDepthHeight  = height;
+	sDepthSamples = samples;
+	return true;
+}
+
+static bool CreateTarget( SRenderTarget & target, const SImageDescriptor & ci,
+						  u32 screen_width, u32 screen_height, u32 samples, const v2 & scale, const v2 & translate )
+{
+	// Resizing the shared depth buffer leaves the other targets pointing at the old storage,
+	// and targets with a different sample count can't use it at all.
+	if (EnsureDepthBuffer( screen_width, screen_height, samples ))
+	{
+		for (u32 i = 0; i < kMaxTargets; ++i)
+		{
+			if (sTargets[i].Framebuffer && &sTargets[i] != &target)
+			{
+				if (sTargets[i].Samples == samples)
+				{
+					glBindFramebuffer( GL_FRAMEBUFFER, sTargets[i].RenderFramebuffer );
+					glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sDepthBuffer );
+				}
+				else
+				{
+					if (sTargets[i].Dirty)
+						WriteBackTarget( sTargets[i] );
+					DestroyTarget( sTargets[i] );
+				}
+			}
+		}
+	}
+
+	glGenTextures( 1, &target.Texture );
+	glBindTexture( GL_TEXTURE_2D, target.Texture );
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, screen_width, screen_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+
+	glGenFramebuffers( 1, &target.Framebuffer );
+	glBindFramebuffer( GL_FRAMEBUFFER, target.Framebuffer );
+	glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.Texture, 0 );
+
+	bool complete = glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+
+	if (samples > 0)
+	{
+		glGenRenderbuffers( 1, &target.RenderColour );
+		glBindRenderbuffer( GL_RENDERBUFFER, target.RenderColour );
+		glRenderbufferStorageMultisample( GL_RENDERBUFFER, samples, GL_RGBA8, screen_width, screen_height );
+
+		glGenFramebuffers( 1, &target.RenderFramebuffer );
+		glBindFramebuffer( GL_FRAMEBUFFER, target.RenderFramebuffer );
+		glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.RenderColour );
+	}
+	else
+	{
+		target.RenderFramebuffer = target.Framebuffer;
+	}
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, sDepthBuffer );
+
+	complete &= glCheckFramebufferStatus( GL_FRAMEBUFFER ) == GL_FRAMEBUFFER_COMPLETE;
+
+	if (!complete)
+	{
+		DBGConsole_Msg( 0, "Couldn't create a %dx%d (%dx MSAA) framebuffer for colour image 0x%08x",
+						screen_width, screen_height, samples, ci.Address );
+		DestroyTarget( target );
+		glBindFramebuffer( GL_FRAMEBUFFER, sCurrentTarget ? sCurrentTarget->RenderFramebuffer : 0 );
+		return false;
+	}
+
+	GLboolean scissor_enabled = glIsEnabled( GL_SCISSOR_TEST );
+	glDisable( GL_SCISSOR_TEST );
+	glClearColor( 0.f, 0.f, 0.f, 1.f );
+	glClear( GL_COLOR_BUFFER_BIT );
+	if (scissor_enabled)
+		glEnable( GL_SCISSOR_TEST );
+
+	target.Samples       = samples;
+	target.NeedsResolve  = samples > 0;
+	target.Address       = ci.Address;
+	target.Size          = ci.Size;
+	target.Width         = ci.Width;
+	target.Height        = 0;
+	target.ScreenWidth   = screen_width;
+	target.ScreenHeight  = screen_height;
+	target.Scale         = scale;
+	target.Translate     = translate;
+	target.Dirty         = false;
+	target.LastUsedFrame = sFrame;
+	return true;
+}
+
+static SRenderTarget * AllocateTarget()
+{
+	SRenderTarget * oldest = NULL;
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Framebuffer == 0)
+			return &target;
+
+		if (&target != sCurrentTarget && (oldest == NULL || target.LastUsedFrame < oldest->LastUsedFrame))
+			oldest = &target;
+	}
+
+	if (oldest->Dirty)
+		WriteBackTarget( *oldest );
+	DestroyTarget( *oldest );
+	return oldest;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void FrameBufferCache_SetColourImage( const SImageDescriptor & ci, u32 screen_width, u32 screen_height,
+									  const v2 & scale, const v2 & translate )
+{
+	DAEDALUS_PROFILE( "FrameBufferCache_SetColourImage" );
+
+	// Only RGBA images are rendered - anything else carries on drawing to the current target.
+	if (ci.Format != G_IM_FMT_RGBA || ci.Size < G_IM_SIZ_16b || ci.Width == 0)
+		return;
+
+	if (sOffscreenFailed)
+		return;
+
+	static GLint max_samples = -1;
+	if (max_samples < 0)
+		glGetIntegerv( GL_MAX_SAMPLES, &max_samples );
+
+	u32 samples = gInternalResolutionSamples > 1 ? Min<u32>( gInternalResolutionSamples, max_samples ) : 0;
+
+	SRenderTarget * found = NULL;
+
+	// We don't know the height yet, so assume 4:3 for the overlap test.
+	u32 start = ci.Address;
+	u32 end   = start + ci.GetPitch() * Max( 1u, (ci.Width * 3) / 4 );
+
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Framebuffer == 0)
+			continue;
+
+		if (target.Address == ci.Address && target.Size == ci.Size && target.Width == ci.Width &&
+			target.ScreenWidth == screen_width && target.ScreenHeight == screen_height && target.Samples == samples &&
+			target.Scale.x == scale.x && target.Scale.y == scale.y &&
+			target.Translate.x == translate.x && target.Translate.y == translate.y)
+		{
+			found = &target;
+		}
+		else if (target.Address == ci.Address || Overlaps( target, start, end ))
+		{
+			// The memory has been reused for a different image.
+			if (target.Dirty)
+				WriteBackTarget( target );
+			DestroyTarget( target );
+		}
+	}
+
+	if (found == NULL)
+	{
+		found = AllocateTarget();
+
+		// Fall back to single sampled, and then to drawing straight to the window at its own resolution.
+		if (!CreateTarget( *found, ci, screen_width, screen_height, samples, scale, translate ) &&
+			(samples == 0 || !CreateTarget( *found, ci, screen_width, screen_height, 0, scale, translate )))
+		{
+			DBGConsole_Msg( 0, "Offscreen rendering is unavailable - rendering to the window" );
+			sOffscreenFailed = true;
+			return;
+		}
+	}
+
+	sCurrentTarget = found;
+	sCurrentTarget->LastUsedFrame = sFrame;
+
+	glBindFramebuffer( GL_FRAMEBUFFER, sCurrentTarget->RenderFramebuffer );
+
+	FrameBufferCache_SetScissorBottom( sScissorBottom );
+	FrameBufferCache_MarkDirty();
+}
+
+void FrameBufferCache_SetScissorBottom( u32 y1 )
+{
+	sScissorBottom = y1;
+
+	if (sCurrentTarget == NULL)
+		return;
+
+	u32 height = Min( y1, sCurrentTarget->GetMaxHeight() );
+	if (height > sCurrentTarget->Height)
+	{
+		sCurrentTarget->Height = height;
+		if (sCurrentTarget->Dirty)
+			WatchTarget( *sCurrentTarget );
+	}
+}
+
+void FrameBufferCache_BindCurrent()
+{
+	glBindFramebuffer( GL_FRAMEBUFFER, sCurrentTarget ? sCurrentTarget->RenderFramebuffer : 0 );
+}
+
+bool FrameBufferCache_IsAvailable()
+{
+	return !sOffscreenFailed;
+}
+
+void FrameBufferCache_MarkDirty()
+{
+	if (sCurrentTarget == NULL)
+		return;
+
+	sCurrentTarget->NeedsResolve = sCurrentTarget->Samples > 0;
+	if (!sCurrentTarget->Dirty)
+	{
+		sCurrentTarget->Dirty = true;
+		WatchTarget( *sCurrentTarget );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static SRenderTarget * FindServableTarget( const TextureInfo & ti )
+{
+	u32 load_address = ti.GetLoadAddress() & (MAX_RAM_ADDRESS-1);
+
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Framebuffer == 0 || &target == sCurrentTarget)
+			continue;
+		if (load_address < target.Address || load_address >= target.GetEndAddress())
+			continue;
+
+		if (ti.GetFormat() == G_IM_FMT_RGBA && ti.GetSize() == target.Size && ti.GetPitch() == target.GetPitch() &&
+			sFrame - target.LastUsedFrame <= kMaxServeAge)
+		{
+			return &target;
+		}
+	}
+	return NULL;
+}
+
+void FrameBufferCache_PrepareTextureLoad( const TextureInfo & ti )
+{
+	u32 start = ti.GetLoadAddress() & (MAX_RAM_ADDRESS-1);
+	u32 end   = start + ti.GetPitch() * ti.GetHeight();
+
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Dirty && Overlaps( target, start, end ) && FindServableTarget( ti ) != &target)
+		{
+			WriteBackTarget( target );
+		}
+	}
+}
+
+bool FrameBufferCache_CopyToTexture( const TextureInfo & ti, const CNativeTexture * texture )
+{
+	SRenderTarget * target = FindServableTarget( ti );
+	if (target == NULL)
+		return false;
+
+	DAEDALUS_PROFILE( "FrameBufferCache_CopyToTexture" );
+
+	ResolveTarget( *target );
+
+	// NB: the texture cache may re-upload stale RDRAM contents into this texture
+	// at any time, so we copy on every draw rather than trying to skip unchanged ones.
+	u32 load_address = ti.GetLoadAddress() & (MAX_RAM_ADDRESS-1);
+	u32 offset = load_address - target->Address;
+	u32 pitch  = target->GetPitch();
+	f32 x      = f32( ((offset % pitch) << 1) >> target->Size );
+	f32 y      = f32( offset / pitch );
+	u32 width  = ti.GetWidth();
+	u32 height = ti.GetHeight();
+
+	s32 sx0 = s32( x * target->Scale.x + target->Translate.x );
+	s32 sx1 = s32( (x + width) * target->Scale.x + target->Translate.x );
+	s32 sy0 = s32( y * target->Scale.y + target->Translate.y );
+	s32 sy1 = s32( (y + height) * target->Scale.y + target->Translate.y );
+	s32 screen_height = target->ScreenHeight;
+
+	CAutoFramebufferState state;
+
+	if (sCopyFramebuffer == 0)
+		glGenFramebuffers( 1, &sCopyFramebuffer );
+
+	glBindFramebuffer( GL_DRAW_FRAMEBUFFER, sCopyFramebuffer );
+	glFramebufferTextureLayer( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture->GetTextureId(), 0, texture->GetLayer() );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, target->Framebuffer );
+
+	// Row 0 of the texture is the first N64 line, which is at the top of the screen.
+	// Hi-res replacements are sampled at detail texels per N64 texel, so fill the whole image.
+	u32 detail = texture->GetDetail();
+	glBlitFramebuffer( sx0, screen_height - sy1, sx1, screen_height - sy0,
+					   0, height * detail, width * detail, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR );
+
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void FrameBufferCache_Present( u32 origin )
+{
+	DAEDALUS_PROFILE( "FrameBufferCache_Present" );
+
+	origin &= (MAX_RAM_ADDRESS-1);
+
+	SRenderTarget * displayed = NULL;
+	for (u32 i = 0; i < kMaxTargets; ++i)
+	{
+		SRenderTarget & target = sTargets[i];
+		if (target.Framebuffer == 0)
+			continue;
+
+		if (origin >= target.Address && origin < Max( target.GetEndAddress(), target.Address + target.GetPitch() ))
+		{
+			displayed = &target;
+			break;
+		}
+	}
+
+	// Fall back to whatever we drew to last if the VI is showing something we didn't render.
+	if (displayed == NULL)
+		displayed = sCurrentTarget;
+
+	sFrame++;
+	sDisplayedTarget = displayed;
+
+	if (displayed != NULL)
+		ResolveTarget( *displayed );
+
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	if (displayed == NULL)
+		return;
+
+	u32 screen_width, screen_height;
+	CGraphicsContext::Get()->GetScreenSize( &screen_width, &screen_height );
+
+	bool same_size = displayed->ScreenWidth == screen_width && displayed->ScreenHeight == screen_height;
+
+	GLboolean scissor_enabled = glIsEnabled( GL_SCISSOR_TEST );
+	glDisable( GL_SCISSOR_TEST );
+
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, displayed->Framebuffer );
+	glBlitFramebuffer( 0, 0, displayed->ScreenWidth, displayed->ScreenHeight,
+					   0, 0, screen_width, screen_height,
+					   GL_COLOR_BUFFER_BIT, same_size ? GL_NEAREST : GL_LINEAR );
+	glBindFramebuffer( GL_READ_FRAMEBUFFER, 0 );
+
+	if (scissor_enabled)
+		glEnable( GL_SCISSOR_TEST );
+}
+
+bool FrameBufferCache_GetDisplayedImage( GLuint * framebuffer, u32 * width, u32 * height )
+{
+	if (sDisplayedTarget == NULL)
+		return false;
+
+	*framebuffer = sDisplayedTarget->Framebuffer;
+	*width       = sDisplayedTarget->ScreenWidth;
+	*height      = sDisplayedTarget->ScreenHeight;
+	return true;
+}
@@ -0,0 +1,40 @@
+#ifndef SYSGL_HLEGRAPHICS_FRAMEBUFFERCACHEGL_H_
+#define SYSGL_HLEGRAPHICS_FRAMEBUFFERCACHEGL_H_
+
+#include "Math/Vector2.h"
+#include "SysGL/GL.h"
+
+class CNativeTexture;
+struct SImageDescriptor;
+struct TextureInfo;
+
+// Each RGBA colour image the display list renders to gets its own framebuffer object.
+// Textures loaded from a colour image are copied across on the GPU, and the image is
+// only read back into RDRAM when the CPU (or a texture we can't serve) reads it.
+void	FrameBufferCache_Initialise();
+void	FrameBufferCache_Finalise();
+
+// screen_width/height is the size the renderer draws at, and scale/translate map
+// N64 pixels to it for the current viewport.
+void	FrameBufferCache_SetColourImage( const SImageDescriptor & ci, u32 screen_width, u32 screen_height,
+										 const v2 & scale, const v2 & translate );
+void	FrameBufferCache_SetScissorBottom( u32 y1 );
+void	FrameBufferCache_BindCurrent();
+
+// False once we've failed to create a framebuffer, and are drawing straight to the window.
+bool	FrameBufferCache_IsAvailable();
+
+// Call before each draw - the current colour image is about to change.
+void	FrameBufferCache_MarkDirty();
+
+// Resolve any colour image ti overlaps which CopyToTexture can't serve.
+void	FrameBufferCache_PrepareTextureLoad( const TextureInfo & ti );
+// Returns true if the texture was filled from a colour image.
+bool	FrameBufferCache_CopyToTexture( const TextureInfo & ti, const CNativeTexture * texture );
+
+// Blit the colour image containing the VI origin to the default framebuffer, and leave that bound.
+void	FrameBufferCache_Present( u32 origin );
+// The (resolved) image last presented, at the resolution it was rendered at.
+bool	FrameBufferCache_GetDisplayedImage( GLuint * framebuffer, u32 * width, u32 * height );
+
+#endif // SYSGL_HLEGRAPHICS_FRAMEBUFFERCACHEGL_H_
@@ -15,9 +15,13 @@
 
 #include "Plugins/GraphicsPlugin.h"
 
+#include "Test/Benchmark.h"
+
+#include "Utility/Frameskip.h"
 #include "Utility/Timing.h"
 
 #include "SysGL/GL.h"
+#include "SysGL/HLEGraphics/FrameBufferCacheGL.h"
 
 EFrameskipValue     gFrameskipValue = FV_DISABLED;
 u32                 gVISyncRate     = 1500;
@@ -38,6 +42,34 @@ namespace
 	FILE *				gFramerateFile = NULL;
 #endif
 
+	// While benchmarking, the GPU time for each display list is measured with timer
+	// queries. They're read back a few lists later so we never wait on the GPU for them.
+	const u32			kNumGPUTimers = 4;
+	GLuint				gGPUTimers[ kNumGPUTimers ] = { 0 };
+	bool				gGPUTimerPending[ kNumGPUTimers ] = { false };
+	u32					gNextGPUTimer = 0;
+
+static void CollectGPUTimers( bool wait )
+{
+	for (u32 i = 0; i < kNumGPUTimers; ++i)
+	{
+		if (!gGPUTimerPending[i])
+			continue;
+
+		GLint available = GL_FALSE;
+		if (!wait)
+			glGetQueryObjectiv( gGPUTimers[i], GL_QUERY_RESULT_AVAILABLE, &available );
+
+		if (wait || available)
+		{
+			GLuint64 ns = 0;
+			glGetQueryObjectui64v( gGPUTimers[i], GL_QUERY_RESULT, &ns );
+			Benchmark_AddGPUTime( ns );
+			gGPUTimerPending[i] = false;
+		}
+	}
+}
+
 static void	UpdateFramerate()
 {
 #ifdef DAEDALUS_FRAMERATE_ANALYSIS
@@ -141,6 +173,22 @@ bool CGraphicsPluginImpl::Initialise()
 
 void CGraphicsPluginImpl::ProcessDList()
 {
+	GLuint timer = 0;
+	if (gBenchmarkRunning)
+	{
+		CollectGPUTimers( false );
+
+		// If the oldest query still hasn't completed, just skip timing this list.
+		if (!gGPUTimerPending[gNextGPUTimer])
+		{
+			if (gGPUTimers[gNextGPUTimer] == 0)
+				glGenQueries( 1, &gGPUTimers[gNextGPUTimer] );
+
+			timer = gGPUTimers[gNextGPUTimer];
+			glBeginQuery( GL_TIME_ELAPSED, timer );
+		}
+	}
+
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	if (!DLDebugger_Process())
 	{
@@ -149,6 +197,13 @@ void CGraphicsPluginImpl::ProcessDList()
 #else
 	DLParser_Process();
 #endif
+
+	if (timer != 0)
+	{
+		glEndQuery( GL_TIME_ELAPSED );
+		gGPUTimerPending[gNextGPUTimer] = true;
+		gNextGPUTimer = (gNextGPUTimer + 1) % kNumGPUTimers;
+	}
 }
 
 void CGraphicsPluginImpl::UpdateScreen()
@@ -159,9 +214,17 @@ void CGraphicsPluginImpl::UpdateScreen()
 	{
 		UpdateFramerate();
 
-		// FIXME: safe printf
-		char string[22];
-		sprintf(string, "Daedalus | FPS %#.1f", gCurrentFramerate);
+		char string[64];
+		if (gFrameskipValue == FV_ADAPTIVE)
+		{
+			SFrameskipStats stats;
+			Frameskip_GetStats(&stats);
+			snprintf(string, sizeof(string), "Daedalus | FPS %#.1f | Skip %u%%", gCurrentFramerate, u32(stats.SkipRate * 100.0f + 0.5f));
+		}
+		else
+		{
+			snprintf(string, sizeof(string), "Daedalus | FPS %#.1f", gCurrentFramerate);
+		}
 
 		glfwSetWindowTitle(gWindow, string);
 
@@ -171,8 +234,14 @@ void CGraphicsPluginImpl::UpdateScreen()
 			gTakeScreenshot = false;
 		}
 
+		FrameBufferCache_Present(current_origin);
+
 		CGraphicsContext::Get()->UpdateFrame( false );
 
+		FrameBufferCache_BindCurrent();
+
+		gFrameskipActive = gFrameskipValue == FV_ADAPTIVE && Frameskip_ShouldSkipNextFrame();
+
 		LastOrigin = current_origin;
 	}
 }
@@ -180,6 +249,15 @@ void CGraphicsPluginImpl::UpdateScreen()
 void CGraphicsPluginImpl::RomClosed()
 {
 	DBGConsole_Msg(0, "Finalising GLGraphics");
+
+	CollectGPUTimers( true );
+	for (u32 i = 0; i < kNumGPUTimers; ++i)
+	{
+		if (gGPUTimers[i] != 0)
+			glDeleteQueries( 1, &gGPUTimers[i] );
+		gGPUTimers[i] = 0;
+	}
+
 	DLParser_Finalise();
 	CTextureCache::Destroy();
 	DestroyRenderer();
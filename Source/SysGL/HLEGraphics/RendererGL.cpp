@@ -1,8 +1,10 @@
 #include "stdafx.h"
 #include "RendererGL.h"
+#include "FrameBufferCacheGL.h"
 
 #include <vector>
 
+#include "Config/ConfigOptions.h"
 #include "Core/ROM.h"
 #include "Debug/DBGConsole.h"
 #include "Graphics/ColourValue.h"
@@ -10,6 +12,7 @@
 #include "Graphics/NativeTexture.h"
 #include "HLEGraphics/DLDebug.h"
 #include "HLEGraphics/RDPStateManager.h"
+#include "Math/MathUtil.h"
 #include "OSHLE/ultra_gbi.h"
 #include "SysGL/GL.h"
 #include "System/Paths.h"
@@ -200,6 +203,8 @@ struct ShaderProgram
 	GLint				uloc_tilemirror[kNumTextures];
 
 	GLint				uloc_texscale[kNumTextures];
+	GLint				uloc_texdetail[kNumTextures];
+	GLint				uloc_texlayer[kNumTextures];
 	GLint				uloc_texture[kNumTextures];
 
 	GLint				uloc_foo;
@@ -421,15 +426,15 @@ static void SprintShader(char (&frag_shader)[2048], const ShaderConfiguration &
 	}
 	else if (cycle_type == CYCLE_COPY)
 	{
-		strcpy(body, "\tcol = fetchCopy(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexScale0);\n");
+		strcpy(body, "\tcol = fetchCopy(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexLayer0, uTexScale0, uTexDetail0);\n");
 	}
 	else if (cycle_type == CYCLE_1CYCLE)
 	{
 		const char * filter0 = GetFilter(config.BilerpFilter, config.ClampS0, config.ClampT0);
 		const char * filter1 = GetFilter(config.BilerpFilter, config.ClampS1, config.ClampT1);
 
-		sprintf(body, "\tvec4 tex0 = %s(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexScale0);\n"
-					  "\tvec4 tex1 = %s(sti, uTileShift1, uTileMirror1, uTileMask1, uTileTL1, uTileBR1, uTileClampEnable1, uTexture1, uTexScale1);\n"
+		sprintf(body, "\tvec4 tex0 = %s(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexLayer0, uTexScale0, uTexDetail0);\n"
+					  "\tvec4 tex1 = %s(sti, uTileShift1, uTileMirror1, uTileMask1, uTileTL1, uTileBR1, uTileClampEnable1, uTexture1, uTexLayer1, uTexScale1, uTexDetail1);\n"
 					  "\tcol.rgb = (%s - %s) * %s + %s;\n"
 					  "\tcol.a   = (%s - %s) * %s + %s;\n",
 					  filter0, filter1,
@@ -441,8 +446,8 @@ static void SprintShader(char (&frag_shader)[2048], const ShaderConfiguration &
 		const char * filter0 = GetFilter(config.BilerpFilter, config.ClampS0, config.ClampT0);
 		const char * filter1 = GetFilter(config.BilerpFilter, config.ClampS1, config.ClampT1);
 
-		sprintf(body, "\tvec4 tex0 = %s(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexScale0);\n"
-					  "\tvec4 tex1 = %s(sti, uTileShift1, uTileMirror1, uTileMask1, uTileTL1, uTileBR1, uTileClampEnable1, uTexture1, uTexScale1);\n"
+		sprintf(body, "\tvec4 tex0 = %s(sti, uTileShift0, uTileMirror0, uTileMask0, uTileTL0, uTileBR0, uTileClampEnable0, uTexture0, uTexLayer0, uTexScale0, uTexDetail0);\n"
+					  "\tvec4 tex1 = %s(sti, uTileShift1, uTileMirror1, uTileMask1, uTileTL1, uTileBR1, uTileClampEnable1, uTexture1, uTexLayer1, uTexScale1, uTexDetail1);\n"
 					  "\tcol.rgb = (%s - %s) * %s + %s;\n"
 					  "\tcol.a   = (%s - %s) * %s + %s;\n"
 					  "\tcombined = col;\n"
@@ -483,6 +488,8 @@ static void InitShaderProgram(ShaderProgram * program, const ShaderConfiguration
 	program->uloc_tilemask[0]   = glGetUniformLocation(shader_program, "uTileMask0");
 	program->uloc_tilemirror[0] = glGetUniformLocation(shader_program, "uTileMirror0");
 	program->uloc_texscale[0]   = glGetUniformLocation(shader_program, "uTexScale0");
+	program->uloc_texdetail[0]  = glGetUniformLocation(shader_program, "uTexDetail0");
+	program->uloc_texlayer[0]   = glGetUniformLocation(shader_program, "uTexLayer0");
 	program->uloc_texture [0]   = glGetUniformLocation(shader_program, "uTexture0");
 
 	program->uloc_tileclamp[1]  = glGetUniformLocation(shader_program, "uTileClampEnable1");
@@ -492,6 +499,8 @@ static void InitShaderProgram(ShaderProgram * program, const ShaderConfiguration
 	program->uloc_tilemask[1]   = glGetUniformLocation(shader_program, "uTileMask1");
 	program->uloc_tilemirror[1] = glGetUniformLocation(shader_program, "uTileMirror1");
 	program->uloc_texscale[1]   = glGetUniformLocation(shader_program, "uTexScale1");
+	program->uloc_texdetail[1]  = glGetUniformLocation(shader_program, "uTexDetail1");
+	program->uloc_texlayer[1]   = glGetUniformLocation(shader_program, "uTexLayer1");
 	program->uloc_texture[1]    = glGetUniformLocation(shader_program, "uTexture1");
 
 	GLuint attrloc;
@@ -610,7 +619,10 @@ void RendererGL::RestoreRenderStates()
 	glDisable(GL_CULL_FACE);
 
 	u32 width, height;
-	CGraphicsContext::Get()->GetScreenSize(&width, &height);
+	GetTargetSize(&width, &height);
+
+	// Carry on drawing into the current colour image, if we have one.
+	FrameBufferCache_BindCurrent();
 
 	glScissor(0,0, width,height);
 	glEnable(GL_SCISSOR_TEST);
@@ -638,6 +650,43 @@ void RendererGL::RestoreRenderStates()
 	glEnable(GL_POLYGON_OFFSET_FILL);
 }
 
+void RendererGL::SetScissor(u32 x0, u32 y0, u32 x1, u32 y1)
+{
+	BaseRenderer::SetScissor(x0, y0, x1, y1);
+
+	// The scissor is the best guess we have for the height of the colour image.
+	FrameBufferCache_SetScissorBottom(y1);
+}
+
+void RendererGL::SetColourImage(const SImageDescriptor & ci)
+{
+	FrameBufferCache_SetColourImage(ci, (u32)mScreenWidth, (u32)mScreenHeight, mN64ToScreenScale, mN64ToScreenTranslate);
+}
+
+void RendererGL::PrepareTextureLoad(const TextureInfo & ti)
+{
+	FrameBufferCache_PrepareTextureLoad(ti);
+}
+
+extern u32 uViWidth;
+extern u32 uViHeight;
+
+void RendererGL::GetTargetSize(u32 * width, u32 * height) const
+{
+	// Render at a multiple of the N64 resolution if we can draw offscreen, otherwise at the window's resolution.
+	if (gInternalResolutionScale > 0 && FrameBufferCache_IsAvailable())
+	{
+		u32 scale = Clamp<u32>(gInternalResolutionScale, 1, 8);
+
+		*width  = Clamp<u32>(uViWidth  + 1, 1, 1024) * scale;
+		*height = Clamp<u32>(uViHeight + 1, 1, 1024) * scale;
+	}
+	else
+	{
+		BaseRenderer::GetTargetSize(width, height);
+	}
+}
+
 // Strip out vertex stream into separate buffers.
 // TODO(strmnnrmn): Renderer should support generating this data directly.
 void RendererGL::RenderDaedalusVtx(int prim, const DaedalusVtx * vertices, int count)
@@ -877,6 +926,8 @@ void RendererGL::PrepareRenderState(const float (&mat_project)[16], bool disable
 {
 	DAEDALUS_PROFILE( "RendererGL::PrepareRenderState" );
 
+	FrameBufferCache_MarkDirty();
+
 	if ( disable_zbuffer )
 	{
 		glDisable(GL_DEPTH_TEST);
@@ -957,9 +1008,11 @@ extern u32 gRDPFrame;
 
 		if (texture != NULL)
 		{
-			glActiveTexture(GL_TEXTURE0 + i);
+			// Textures loaded from a colour image we rendered are copied from the GPU, as RDRAM is stale.
+			FrameBufferCache_CopyToTexture(mBoundTextureInfo[i], texture);
 
-			texture->InstallTexture();
+			// Small textures share arrays, so this is often already bound and only the layer changes.
+			texture->InstallTexture(i);
 
 			u8 tile_idx = mActiveTile[i];
 			const RDP_Tile &     rdp_tile  = gRDPStateManager.GetTile( tile_idx );
@@ -987,20 +1040,11 @@ extern u32 gRDPFrame;
 			glUniform2i(program->uloc_tilebr[i], tile_size.right,   tile_size.bottom);
 
 			glUniform2f(program->uloc_texscale[i], 1.f / texture->GetCorrectedWidth(), 1.f / texture->GetCorrectedHeight());
+			glUniform1i(program->uloc_texdetail[i], texture->GetDetail());
+			glUniform1i(program->uloc_texlayer[i], texture->GetLayer());
 
-			if( (gRDPOtherMode.text_filt != G_TF_POINT) | (gGlobalPreferences.ForceLinearFilter) )
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			}
-			else
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			}
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mTexWrap[i].u);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mTexWrap[i].v);
+			// NB: filtering and wrapping are done in the shader (see the fetch functions in n64.psh),
+			// so there's no sampler state to update here.
 		}
 	}
 }
@@ -1191,10 +1235,6 @@ void RendererGL::Draw2DTexture(f32 x0, f32 y0, f32 x1, f32 y1,
 	PrepareRenderState(mScreenToDevice.mRaw, false /* disable_depth */);
 
 	glEnable(GL_BLEND);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	float sx0 = N64ToScreenX(x0);
 	float sy0 = N64ToScreenY(y0);
@@ -1242,10 +1282,6 @@ void RendererGL::Draw2DTextureR(f32 x0, f32 y0,
 	PrepareRenderState(mScreenToDevice.mRaw, false /* disable_depth */);
 
 	glEnable(GL_BLEND);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	const f32 depth = 0.0f;
 
@@ -1278,10 +1314,12 @@ bool CreateRenderer()
 	DAEDALUS_ASSERT_Q(gRenderer == NULL);
 	gRendererGL = new RendererGL();
 	gRenderer   = gRendererGL;
+	FrameBufferCache_Initialise();
 	return true;
 }
 void DestroyRenderer()
 {
+	FrameBufferCache_Finalise();
 	delete gRendererGL;
 	gRendererGL = NULL;
 	gRenderer   = NULL;
@@ -8,6 +8,10 @@ class RendererGL : public BaseRenderer
 public:
 	virtual void		RestoreRenderStates();
 
+	virtual void		SetScissor(u32 x0, u32 y0, u32 x1, u32 y1);
+	virtual void		SetColourImage(const SImageDescriptor & ci);
+	virtual void		PrepareTextureLoad(const TextureInfo & ti);
+
 	virtual void		RenderTriangles(DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer);
 
 	virtual void		TexRect(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
@@ -20,6 +24,9 @@ public:
 									   f32 x2, f32 y2, f32 x3, f32 y3,
 									   f32 s, f32 t);
 
+protected:
+	virtual void		GetTargetSize(u32 * width, u32 * height) const;
+
 private:
 	void 				MakeShaderConfigFromCurrentState(struct ShaderConfiguration * config) const;
 
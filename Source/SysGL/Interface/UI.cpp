@@ -4,15 +4,38 @@
 #include <stdio.h>
 
 #include "Core/CPU.h"
+#include "Core/Dynamo.h"
+#include "Core/GuestProfiler.h"
 #include "Core/ROM.h"
+#include "Core/Rewind.h"
+#include "Debug/Dump.h"
+#include "DynaRec/DynaRecProfile.h"
+#include "HLEGraphics/DLStats.h"
 
 #include "SysGL/GL.h"
 #include "System/Paths.h"
 #include "Utility/IO.h"
+#include "Utility/Profiler.h"
 #include "Utility/Thread.h"
 
 //static bool toggle_fullscreen = false;
 
+// Find an unused filename of the form <dump dir>/<subdir>/<prefix>NNNN.<extension>
+static void MakeDumpFilename(IO::Filename & filename, const char * subdir, const char * prefix, const char * extension)
+{
+	IO::Filename dir;
+	Dump_GetDumpDirectory(dir, subdir);
+
+	u32 count = 0;
+	do
+	{
+		char name[64];
+		sprintf(name, "%s%04d.%s", prefix, count++, extension);
+		IO::Path::Combine(filename, dir, name);
+	}
+	while (IO::File::Exists(filename));
+}
+
 static void HandleKeys(GLFWwindow * window, int key, int scancode, int action, int mods)
 {
 	if (action == GLFW_PRESS)
@@ -22,9 +45,12 @@ static void HandleKeys(GLFWwindow * window, int key, int scancode, int action, i
 			int idx = key - '0';
 
 			bool ctrl_down = (mods & GLFW_MOD_CONTROL) != 0;
+			bool shift_down = (mods & GLFW_MOD_SHIFT) != 0;
+			bool alt_down = (mods & GLFW_MOD_ALT) != 0;
 
+			// Deltas get their own file, so they never overwrite the full state they're based on.
 			char filename_ss[64];
-			sprintf( filename_ss, "saveslot%u.ss", idx );
+			sprintf( filename_ss, shift_down && !alt_down ? "saveslot%u.delta.ss" : "saveslot%u.ss", idx );
 
 			IO::Filename path_sub;
 			sprintf( path_sub, "SaveStates\\%s", g_ROM.settings.GameName.c_str());
@@ -38,7 +64,10 @@ static void HandleKeys(GLFWwindow * window, int key, int scancode, int action, i
 
 			if (ctrl_down)
 			{
-				CPU_RequestSaveState(filename);
+				// Shift saves a delta against the last full state, Alt exports in Project64 format.
+				// Without Ctrl, Shift loads the slot's delta.
+				ESaveStateFormat format = alt_down ? SSF_PROJECT64 : shift_down ? SSF_DAEDALUS_DELTA : SSF_DAEDALUS;
+				CPU_RequestSaveState(filename, format);
 			}
 			else
 			{
@@ -48,6 +77,62 @@ static void HandleKeys(GLFWwindow * window, int key, int scancode, int action, i
 				}
 			}
 		}
+#ifdef DAEDALUS_ENABLE_REWIND
+		// Backspace rewinds by a second.
+		if (key == GLFW_KEY_BACKSPACE)
+		{
+			Rewind_Request(60);
+		}
+#endif
+#ifdef DAEDALUS_ENABLE_PROFILING
+		// F9 captures a few seconds of profile data as a Chrome trace.
+		if (key == GLFW_KEY_F9 && !CProfiler::Get()->IsCapturingTrace())
+		{
+			IO::Filename filename;
+			MakeDumpFilename(filename, "profile", "trace", "json");
+			CProfiler::Get()->CaptureTrace(300, filename);
+		}
+#endif
+		// F7 toggles counting fragment entries. The cache is flushed so every fragment is reassembled with (or without) a counter.
+		if (key == GLFW_KEY_F7)
+		{
+			bool enable = !DynarecProfile::IsEnabled();
+			if (!enable)
+			{
+				DynarecProfile::WriteReport(stdout, 50);
+			}
+			DynarecProfile::SetEnabled(enable);
+			CPU_ResetFragmentCache();
+		}
+		// F6 starts sampling the emulated PC, and prints the report when pressed again.
+		if (key == GLFW_KEY_F6)
+		{
+			if (GuestProfiler_IsRunning())
+			{
+				GuestProfiler_Stop();
+				GuestProfiler_WriteReport(stdout, 30);
+			}
+			else
+			{
+				GuestProfiler_Start();
+			}
+		}
+		// F8 starts recording display list command stats, and writes them out when pressed again.
+		if (key == GLFW_KEY_F8)
+		{
+			if (gDLStatsEnabled)
+			{
+				DLStats_SetEnabled(false);
+
+				IO::Filename filename;
+				MakeDumpFilename(filename, "dl_stats", "stats", "csv");
+				DLStats_DumpCSV(filename);
+			}
+			else
+			{
+				DLStats_SetEnabled(true);
+			}
+		}
 // Proper full screen toggle still not fully implemented in GLF3
 // BUT is in the roadmap for future 3XX release
 #if 0
@@ -17,6 +17,7 @@
         'sources': [
           'Graphics/GraphicsContextGL.cpp',
           'Graphics/NativeTextureGL.cpp',
+          'HLEGraphics/FrameBufferCacheGL.cpp',
           'HLEGraphics/GraphicsPluginGL.cpp',
           'HLEGraphics/RendererGL.cpp',
           'Input/InputManagerGL.cpp',
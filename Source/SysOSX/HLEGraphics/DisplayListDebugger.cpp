@@ -22,7 +22,11 @@
 #include "Utility/Thread.h"
 #include "Utility/Mutex.h"
 
+#ifdef DAEDALUS_SOFTWARE_RENDERER
+#include "SysSoft/Graphics/SoftRasterizer.h"
+#else
 #include "SysGL/GL.h"
+#endif
 
 static bool gDebugging = false;
 
@@ -268,10 +272,16 @@ void DLDebugger_ProcessDebugTask()
 				// Make the BYTE array, factor of 3 because it's RBG.
 				void * pixels = malloc( 4 * width * height );
 
+#ifdef DAEDALUS_SOFTWARE_RENDERER
+				// The software framebuffer is stored top down, so no need to flip it.
+				SoftRasterizer_ReadPixels(pixels);
+				s32 pitch = static_cast<s32>(width * 4);
+#else
 				glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
 
 				// NB, pass a negative pitch, to render the screenshot the right way up.
 				s32 pitch = -static_cast<s32>(width * 4);
+#endif
 
 				PngSaveImage(connection, pixels, NULL, TexFmt_8888, pitch, width, height, false);
 
@@ -30,6 +30,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 
 #define DAEDALUS_COMPRESSED_ROM_SUPPORT
+#define DAEDALUS_ENABLE_REWIND
+#define DAEDALUS_BATCH_TEST_WORKERS
 #define DAEDALUS_ENABLE_OS_HOOKS
 
 #define DAEDALUS_ENDIAN_MODE DAEDALUS_ENDIAN_LITTLE
@@ -43,6 +45,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define DAEDALUS_HALT			__builtin_trap()
 //#define DAEDALUS_HALT			__builtin_debugger()
+
+// Builds configured with -Drenderer=soft use the SysSoft rasterizer instead of OpenGL.
+#ifndef DAEDALUS_SOFTWARE_RENDERER
 #define DAEDALUS_GL
+#endif
 
 #endif // SYSOSX_INCLUDE_PLATFORM_H_
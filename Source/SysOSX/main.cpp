@@ -19,18 +19,26 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "stdafx.h"
 
+#include "Config/ConfigOptions.h"
 #include "Core/CPU.h"
 #include "Debug/DBGConsole.h"
+#include "Graphics/FrameDump.h"
+#include "Input/InputMovie.h"
 #include "Interface/RomDB.h"
 #include "System/Paths.h"
 #include "System/System.h"
 #include "Test/BatchTest.h"
+#include "Test/Benchmark.h"
 #include "Utility/IO.h"
 
 #ifdef DAEDALUS_LINUX
 #include <linux/limits.h>
 #endif
 
+#include <ctype.h>
+
+static const u32 kDefaultBenchmarkVbls = 3000;
+
 int main(int argc, char **argv)
 {
 	int result = 0;
@@ -51,6 +59,15 @@ int main(int argc, char **argv)
 
 	//ReadConfiguration();
 
+	// Headless mode has to be known before System_Init creates the window.
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp( argv[i], "--bench" ) == 0)
+		{
+			gHeadlessMode = true;
+		}
+	}
+
 	if (!System_Init())
 		return 1;
 
@@ -64,6 +81,10 @@ int main(int argc, char **argv)
 	{
 		bool 			batch_test = false;
 		const char *	filename   = NULL;
+		u32				bench_vbls = 0;
+		const char *	bench_out  = NULL;
+		const char *	dump_path  = NULL;
+		u32				dump_interval = 1;
 
 		for (int i = 1; i < argc; ++i)
 		{
@@ -76,6 +97,97 @@ int main(int argc, char **argv)
 					batch_test = true;
 					break;
 				}
+				else if (strcmp( arg, "-record" ) == 0 || strcmp( arg, "-replay" ) == 0 )
+				{
+					if (i+1 < argc)
+					{
+						const char * movie = argv[i+1];
+						++i;
+
+						if (strcmp( arg, "-record" ) == 0)
+							InputMovie_StartRecording(movie);
+						else
+							InputMovie_StartReplay(movie);
+					}
+				}
+				else if (strcmp( arg, "-bench" ) == 0 )
+				{
+					bench_vbls = kDefaultBenchmarkVbls;
+
+					// Optional number of vertical blanks to run for.
+					if (i+1 < argc && isdigit(argv[i+1][0]))
+					{
+						bench_vbls = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-bench-out" ) == 0 )
+				{
+					if (i+1 < argc)
+					{
+						bench_out = argv[i+1];
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-dump-frames" ) == 0 )
+				{
+					if (i+1 < argc)
+					{
+						dump_path = argv[i+1];
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-dump-interval" ) == 0 )
+				{
+					if (i+1 < argc)
+					{
+						dump_interval = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-internal-scale" ) == 0 )
+				{
+					// Render at N times the N64 resolution, independent of the window size (0 to use the window's).
+					if (i+1 < argc)
+					{
+						gInternalResolutionScale = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-msaa" ) == 0 )
+				{
+					if (i+1 < argc)
+					{
+						gInternalResolutionSamples = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-no-tnl-cache" ) == 0 )
+				{
+					gTnLCacheEnabled = false;
+				}
+				else if (strcmp( arg, "-texel-cache" ) == 0 )
+				{
+					// Size limit in MB of the on-disk cache of converted textures.
+					if (i+1 < argc)
+					{
+						gTexelCacheSizeMB = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-texture-pack-budget" ) == 0 )
+				{
+					// MB of decoded hi-res replacements to keep in memory (0 to ignore texture packs).
+					if (i+1 < argc)
+					{
+						gTexturePackBudgetMB = atoi(argv[i+1]);
+						++i;
+					}
+				}
+				else if (strcmp( arg, "-dump-texture-pack" ) == 0 )
+				{
+					gTexturePackDump = true;
+				}
 				else if (strcmp( arg, "-roms" ) == 0 )
 				{
 					if (i+1 < argc)
@@ -96,14 +208,35 @@ int main(int argc, char **argv)
 			}
 		}
 
+		if (dump_path && !FrameDump_Start(dump_path, dump_interval))
+		{
+			fprintf(stderr, "Couldn't start dumping frames to '%s'\n", dump_path);
+		}
+
 		if (batch_test)
 		{
 			#ifdef DAEDALUS_BATCH_TEST_ENABLED
-				BatchTestMain(argc, argv);
+				result = BatchTestMain(argc, argv);
 			#else
 				fprintf(stderr, "BatchTest mode is not present in this build.\n");
 			#endif
 		}
+		else if (filename && bench_vbls > 0)
+		{
+			FILE * fh = bench_out ? fopen(bench_out, "w") : stdout;
+			if (fh == NULL)
+			{
+				fprintf(stderr, "Couldn't open '%s' for writing\n", bench_out);
+				result = 1;
+			}
+			else
+			{
+				if (!Benchmark_Run(filename, bench_vbls, fh))
+					result = 1;
+				if (fh != stdout)
+					fclose(fh);
+			}
+		}
 		else if (filename)
 		{
 			System_Open( filename );
@@ -123,6 +256,9 @@ int main(int argc, char **argv)
 
 	System_Finalize();
 
+	// After System_Finalize, so the graphics context has handed over its last frames.
+	FrameDump_Stop();
+
 	return result;
 }
 
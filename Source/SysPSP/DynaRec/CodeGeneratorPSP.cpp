@@ -1815,6 +1815,44 @@ CJumpLocation CCodeGeneratorPSP::ExecuteNativeFunction( CCodeLabel speed_hack, b
 
 }
 
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorPSP::GenerateNativeCall( CCodeLabel function )
+{
+	// The temporary registers don't survive the call, so write back anything
+	// cached in them, and reload it afterwards so the register cache is unchanged
+	CN64RegisterCachePSP current_regs( mRegisterCache );
+	FlushAllRegisters( mRegisterCache, false );
+	FlushAllTemporaryRegisters( mRegisterCache, true );
+
+	JAL( function, true );
+
+	RestoreAllRegisters( mRegisterCache, current_regs );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorPSP::GenerateInlineNativeCall( CCodeLabel function, u32 return_address, CJumpLocation * p_eret_jump, CJumpLocation * p_exit_jump )
+{
+	mPreviousLoadBase = N64Reg_R0;	//Invalidate
+	mPreviousStoreBase = N64Reg_R0;	//Invalidate
+
+	// The patch works directly on gGPR etc, so flush everything and reload it afterwards
+	FlushAllRegisters( mRegisterCache, true );
+
+	*p_eret_jump = ExecuteNativeFunction( function, true );
+
+	// Stay on trace only if TargetPC == return_address and StuffToDo == 0
+	GetVar( PspReg_V0, &gCPUState.TargetPC );
+	LoadConstant( PspReg_A0, return_address );
+	XOR( PspReg_V0, PspReg_V0, PspReg_A0 );
+	GetVar( PspReg_A0, const_cast< const u32 * >( &gCPUState.StuffToDo ) );
+	OR( PspReg_V0, PspReg_V0, PspReg_A0 );
+	*p_exit_jump = BNE( PspReg_V0, PspReg_R0, CCodeLabel( NULL ), true );
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -57,6 +57,8 @@ class CCodeGeneratorPSP : public CCodeGenerator, public CAssemblyWriterPSP
 		virtual CJumpLocation		GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump);
 
 		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return = false );
+		virtual void				GenerateNativeCall( CCodeLabel function );
+		virtual void				GenerateInlineNativeCall( CCodeLabel function, u32 return_address, CJumpLocation * p_eret_jump, CJumpLocation * p_exit_jump );
 
 private:
 		// Not virtual base
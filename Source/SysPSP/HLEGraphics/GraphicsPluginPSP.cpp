@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Utility/Profiler.h"
 #include "Utility/FramerateLimiter.h"
+#include "Utility/Frameskip.h"
 #include "Utility/Preferences.h"
 #include "Utility/Timing.h"
 
@@ -215,7 +216,16 @@ void CGraphicsPluginImpl::UpdateScreen()
 						pspDebugScreenPrintf( "%#.1f  ", gCurrentFramerate );
 						break;
 					case 2:
-						pspDebugScreenPrintf( "FPS[%#.1f] VB[%d/%d] Sync[%#.1f%%]   ", gCurrentFramerate, u32( Fsync * f32( FramerateLimiter_GetTvFrequencyHz() ) ), FramerateLimiter_GetTvFrequencyHz(), Fsync * 100.0f );
+						if( gFrameskipValue == FV_ADAPTIVE )
+						{
+							SFrameskipStats stats;
+							Frameskip_GetStats( &stats );
+							pspDebugScreenPrintf( "FPS[%#.1f] VB[%d/%d] Sync[%#.1f%%] Skip[%d%%]   ", gCurrentFramerate, u32( Fsync * f32( FramerateLimiter_GetTvFrequencyHz() ) ), FramerateLimiter_GetTvFrequencyHz(), Fsync * 100.0f, u32( stats.SkipRate * 100.0f + 0.5f ) );
+						}
+						else
+						{
+							pspDebugScreenPrintf( "FPS[%#.1f] VB[%d/%d] Sync[%#.1f%%]   ", gCurrentFramerate, u32( Fsync * f32( FramerateLimiter_GetTvFrequencyHz() ) ), FramerateLimiter_GetTvFrequencyHz(), Fsync * 100.0f );
+						}
 						break;
 					case 3:
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
@@ -260,6 +270,9 @@ void CGraphicsPluginImpl::UpdateScreen()
 			if((!Old_FrameskipActive | !Older_FrameskipActive) && (Fsync < 0.965f)) gFrameskipActive = true;
 			else gFrameskipActive = false;
 			break;
+		case FV_ADAPTIVE:
+			gFrameskipActive = Frameskip_ShouldSkipNextFrame();
+			break;
 		default:
 			gFrameskipActive = (current_frame % (gFrameskipValue - 1)) != 0;
 			break;
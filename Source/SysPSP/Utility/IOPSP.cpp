@@ -65,6 +65,20 @@ namespace IO
 		{
 			return sceIoGetstat ( p_file, stat );
 		}
+
+		bool	GetInfo( const char * p_file, u32 * p_size, u64 * p_mtime )
+		{
+			SceIoStat	stat;
+			if( sceIoGetstat( p_file, &stat ) < 0 )
+				return false;
+
+			const ScePspDateTime & t( stat.st_mtime );
+			*p_size  = u32( stat.st_size );
+			*p_mtime = (u64( t.year ) << 40) | (u64( t.month ) << 36) | (u64( t.day ) << 31) |
+					   (u64( t.hour ) << 26) | (u64( t.minute ) << 20) | (u64( t.second ) << 14) |
+					   u64( t.microsecond / 1000 );
+			return true;
+		}
 	}
 	namespace Directory
 	{
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "stdafx.h"
 #include "Utility/Thread.h"
+#include "Utility/Profiler.h"
 
 #include <pspthreadman.h>
 
@@ -56,6 +57,10 @@ static int StartThreadFunc( SceSize args, void *argp )
 		result = thread_details->ThreadFunction( thread_details->Argument );
 	}
 
+#ifdef DAEDALUS_ENABLE_PROFILING
+	CProfiler::ThreadExit();
+#endif
+
 	return result;
 }
 
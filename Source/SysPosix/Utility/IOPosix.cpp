@@ -20,10 +20,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "Utility/IO.h"
 
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <unistd.h>
 
 namespace IO
 {
@@ -54,6 +57,48 @@ namespace IO
 				return false;
 			}
 		}
+
+		bool	GetInfo( const char * p_file, u32 * p_size, u64 * p_mtime )
+		{
+			struct stat		s;
+			if( stat( p_file, &s ) != 0 )
+				return false;
+
+			*p_size  = u32( s.st_size );
+			*p_mtime = u64( s.st_mtime );
+			return true;
+		}
+
+		void *	Map( const char * p_file, u32 * p_size )
+		{
+			int fd = open( p_file, O_RDONLY );
+			if( fd < 0 )
+				return NULL;
+
+			struct stat		s;
+			void *			p_data( NULL );
+			if( fstat( fd, &s ) == 0 && s.st_size > 0 )
+			{
+				p_data = mmap( NULL, s.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+				if( p_data == MAP_FAILED )
+				{
+					p_data = NULL;
+				}
+				else
+				{
+					*p_size = u32( s.st_size );
+				}
+			}
+
+			// The mapping keeps its own reference to the file
+			close( fd );
+			return p_data;
+		}
+
+		void	Unmap( void * p_data, u32 size )
+		{
+			munmap( p_data, size );
+		}
 	}
 	namespace Directory
 	{
@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "stdafx.h"
 #include "Utility/Thread.h"
+#include "Utility/Profiler.h"
 
 #include <pthread.h>
 #include <unistd.h>
@@ -67,6 +68,10 @@ void * StartThreadFunc( void * arg )
 
 	int result = thread_details->ThreadFunction( thread_details->Argument );
 
+#ifdef DAEDALUS_ENABLE_PROFILING
+	CProfiler::ThreadExit();
+#endif
+
 	delete thread_details;
 
 	pthread_exit( &result );
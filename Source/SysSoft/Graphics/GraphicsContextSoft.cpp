@@ -0,0 +1,183 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "Graphics/GraphicsContext.h"
+
+#include <stdio.h>
+
+#include "Graphics/ColourValue.h"
+#include "Graphics/FrameDump.h"
+#include "SysSoft/Graphics/SoftRasterizer.h"
+#include "Utility/IO.h"
+
+static const u32 SCR_WIDTH = 640;
+static const u32 SCR_HEIGHT = 480;
+
+// There's no window - frames are only ever seen via screenshots or the display list debugger.
+class GraphicsContextSoft : public CGraphicsContext
+{
+public:
+	GraphicsContextSoft();
+	virtual ~GraphicsContextSoft();
+
+
+	virtual bool Initialise();
+	virtual bool IsInitialised() const { return true; }
+
+	virtual void ClearAllSurfaces();
+	virtual void ClearZBuffer();
+	virtual void ClearColBuffer(const c32 & colour);
+	virtual void ClearToBlack();
+	virtual void ClearColBufferAndDepth(const c32 & colour);
+	virtual	void BeginFrame();
+	virtual void EndFrame();
+	virtual void UpdateFrame( bool wait_for_vbl );
+
+	virtual void GetScreenSize(u32 * width, u32 * height) const;
+	virtual void ViewportType(u32 * width, u32 * height) const;
+
+	virtual void SetDebugScreenTarget( ETargetSurface buffer ) {}
+	virtual void DumpNextScreen() { mDumpNextScreen = true; }
+	virtual void DumpScreenShot();
+
+private:
+	void CaptureFrame( const char * filename );
+
+private:
+	bool mDumpNextScreen;
+};
+
+template<> bool CSingleton< CGraphicsContext >::Create()
+{
+	DAEDALUS_ASSERT_Q(mpInstance == NULL);
+
+	mpInstance = new GraphicsContextSoft();
+	return mpInstance->Initialise();
+}
+
+GraphicsContextSoft::GraphicsContextSoft()
+:	mDumpNextScreen( false )
+{
+}
+
+GraphicsContextSoft::~GraphicsContextSoft()
+{
+	SoftRasterizer_Finalise();
+}
+
+bool GraphicsContextSoft::Initialise()
+{
+	if (!SoftRasterizer_Initialise( SCR_WIDTH, SCR_HEIGHT ))
+	{
+		fprintf( stderr, "Failed to initialise the software rasterizer\n" );
+		return false;
+	}
+
+	ClearAllSurfaces();
+	return true;
+}
+
+void GraphicsContextSoft::GetScreenSize(u32 * width, u32 * height) const
+{
+	SoftRasterizer_GetSize(width, height);
+}
+
+void GraphicsContextSoft::ViewportType(u32 * width, u32 * height) const
+{
+	GetScreenSize(width, height);
+}
+
+void GraphicsContextSoft::ClearAllSurfaces()
+{
+	ClearToBlack();
+}
+
+void GraphicsContextSoft::ClearToBlack()
+{
+	SoftRasterizer_ClearColour( c32(0x00000000) );
+	SoftRasterizer_ClearDepth();
+}
+
+void GraphicsContextSoft::ClearZBuffer()
+{
+	SoftRasterizer_ClearDepth();
+}
+
+void GraphicsContextSoft::ClearColBuffer(const c32 & colour)
+{
+	SoftRasterizer_ClearColour( colour );
+}
+
+void GraphicsContextSoft::ClearColBufferAndDepth(const c32 & colour)
+{
+	SoftRasterizer_ClearColour( colour );
+	SoftRasterizer_ClearDepth();
+}
+
+void GraphicsContextSoft::BeginFrame()
+{
+}
+
+void GraphicsContextSoft::EndFrame()
+{
+	// Let the render thread get on with this frame while we emulate the next.
+	SoftRasterizer_Submit();
+}
+
+void GraphicsContextSoft::UpdateFrame( bool wait_for_vbl )
+{
+	if (mDumpNextScreen)
+	{
+		mDumpNextScreen = false;
+		DumpScreenShot();
+	}
+
+	if (FrameDump_ShouldCaptureFrame())
+	{
+		CaptureFrame( NULL );
+	}
+
+//	if( gCleanSceneEnabled ) //TODO: This should be optional
+	{
+		ClearColBuffer( c32(0xff000000) ); // ToDo : Use gFillColor instead?
+	}
+}
+
+void GraphicsContextSoft::DumpScreenShot()
+{
+	IO::Filename filename;
+	FrameDump_GetScreenShotFilename( filename );
+
+	CaptureFrame( filename );
+}
+
+void GraphicsContextSoft::CaptureFrame( const char * filename )
+{
+	u32 width, height;
+	GetScreenSize(&width, &height);
+
+	void * pixels = malloc( 4 * width * height );
+	SoftRasterizer_ReadPixels( pixels );
+
+	FrameDump_SubmitFrame( pixels, width * 4, width, height, filename );
+
+	free( pixels );
+}
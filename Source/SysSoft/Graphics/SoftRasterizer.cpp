@@ -0,0 +1,1177 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "SysSoft/Graphics/SoftRasterizer.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <thread>
+#include <vector>
+
+#include "HLEGraphics/BaseRenderer.h"
+#include "Math/MathUtil.h"
+#include "Utility/AtomicPrimitives.h"
+#include "Utility/Cond.h"
+#include "Utility/Mutex.h"
+#include "Utility/Profiler.h"
+#include "Utility/Thread.h"
+
+namespace
+{
+
+const u32	kTileSize		= 64;
+const u32	kMaxWorkers		= 15;
+const u32	kMaxTriangles	= 32 * 1024;		// Pending triangles before we're forced to flush
+const u32	kMaxDraws		= 4 * 1024;
+const u32	kMaxArenaDraws		= 4 * 1024;		// Recorded draws before we hand the arena to the render thread
+const u32	kMaxArenaVertices	= 96 * 1024;
+
+// Equivalent of the glPolygonOffset(-1,-1) used for decals by RendererGL.
+const float	kDecalBias		= 1.f / 65536.f;
+
+struct SPlane
+{
+	float	DX;
+	float	DY;
+	float	C;
+
+	inline float At( float x, float y ) const	{ return DX * x + DY * y + C; }
+};
+
+struct STriangle
+{
+	u32		Draw;
+	s32		MinX;
+	s32		MinY;
+	s32		MaxX;						// Inclusive
+	s32		MaxY;
+
+	SPlane	Edge[3];
+	bool	TopLeft[3];
+
+	SPlane	Z;
+	SPlane	InvW;
+	SPlane	S;							// All of these are premultiplied by 1/w
+	SPlane	T;
+	SPlane	Colour[4];
+};
+
+//
+//	Colour combiner inputs. The order of the first 8 matches kRGBParams8 and
+//	kAlphaParams8 in RendererGL, so those mux fields can be used directly.
+//
+enum ECombinerInput
+{
+	CI_COMBINED = 0,
+	CI_TEX0,
+	CI_TEX1,
+	CI_PRIM,
+	CI_SHADE,
+	CI_ENV,
+	CI_ONE,
+	CI_ZERO,
+	CI_COMBINED_ALPHA,
+	CI_TEX0_ALPHA,
+	CI_TEX1_ALPHA,
+	CI_PRIM_ALPHA,
+	CI_SHADE_ALPHA,
+	CI_ENV_ALPHA,
+	CI_LOD_FRAC,
+	CI_PRIM_LOD_FRAC,
+	CI_K5,
+
+	CI_NUM_INPUTS,
+};
+
+const u8 kRGBInputs16[16] =
+{
+	CI_COMBINED,		CI_TEX0,			CI_TEX1,			CI_PRIM,
+	CI_SHADE,			CI_ENV,				CI_ONE,				CI_COMBINED_ALPHA,
+	CI_TEX0_ALPHA,		CI_TEX1_ALPHA,		CI_PRIM_ALPHA,		CI_SHADE_ALPHA,
+	CI_ENV_ALPHA,		CI_LOD_FRAC,		CI_PRIM_LOD_FRAC,	CI_ZERO,
+};
+
+const u8 kRGBInputs32[32] =
+{
+	CI_COMBINED,		CI_TEX0,			CI_TEX1,			CI_PRIM,
+	CI_SHADE,			CI_ENV,				CI_ONE,				CI_COMBINED_ALPHA,
+	CI_TEX0_ALPHA,		CI_TEX1_ALPHA,		CI_PRIM_ALPHA,		CI_SHADE_ALPHA,
+	CI_ENV_ALPHA,		CI_LOD_FRAC,		CI_PRIM_LOD_FRAC,	CI_K5,
+	CI_ZERO,			CI_ZERO,			CI_ZERO,			CI_ZERO,
+	CI_ZERO,			CI_ZERO,			CI_ZERO,			CI_ZERO,
+	CI_ZERO,			CI_ZERO,			CI_ZERO,			CI_ZERO,
+	CI_ZERO,			CI_ZERO,			CI_ZERO,			CI_ZERO,
+};
+
+struct SColour
+{
+	s32		C[4];						// r, g, b, a - 0..255, but may be out of range mid-combine
+};
+
+struct SDraw
+{
+	const SSoftDrawState *	State;		// Owned by the arena being rendered
+
+	u32				NumCycles;
+	u8				RGB[2][4];			// a, b, c, d for each cycle
+	u8				Alpha[2][4];
+	bool			SampleTexture[2];
+
+	SColour			Inputs[CI_NUM_INPUTS];	// Constant inputs are filled in once
+};
+
+std::vector<SDraw>		gDraws;
+std::vector<STriangle>	gTriangles;
+std::vector<u32> *		gBins = NULL;		// Triangle indices for each tile, in submission order
+
+u32						gWidth = 0;
+u32						gHeight = 0;
+u32						gTilesX = 0;
+u32						gTilesY = 0;
+u32 *					gColourBuffer = NULL;
+float *					gDepthBuffer = NULL;
+
+//
+//	The worker pool. Flush() publishes a new generation of work, and every thread
+//	(including the caller) pulls tiles off gNextTile until they run out.
+//
+ThreadHandle			gWorkers[kMaxWorkers];
+u32						gNumWorkers = 0;
+Mutex					gWorkMutex;
+Cond *					gWorkCond = NULL;		// Signalled when a new generation is published
+Cond *					gDoneCond = NULL;		// Signalled when a worker goes idle or the last tile completes
+u32						gWorkGeneration = 0;
+u32						gActiveWorkers = 0;
+bool					gQuit = false;
+
+std::vector<u32>		gWorkTiles;				// Non-empty tiles for this generation
+volatile u32			gNextTile = 0;
+volatile u32			gTilesDone = 0;
+
+//
+//	Commands are recorded into one arena while the render thread works through the
+//	other. Arenas are only ever cleared on the recording thread, so the texture
+//	references they hold are never released by the render thread.
+//
+enum ECommandType
+{
+	CMD_DRAW,
+	CMD_CLEAR_COLOUR,
+	CMD_CLEAR_DEPTH,
+};
+
+struct SCommand
+{
+	ECommandType	Type;
+	u32				State;				// CMD_DRAW
+	u32				FirstVertex;
+	u32				NumVertices;
+	u32				Colour;				// CMD_CLEAR_COLOUR
+};
+
+struct SArena
+{
+	std::vector<SCommand>		Commands;
+	std::vector<SSoftDrawState>	States;
+	std::vector<SSoftVertex>	Vertices;
+
+	bool	IsEmpty() const		{ return Commands.empty(); }
+	void	Clear()				{ Commands.clear(); States.clear(); Vertices.clear(); }
+};
+
+SArena					gArenas[2];
+u32						gRecordArena = 0;
+
+ThreadHandle			gRenderThread = kInvalidThreadHandle;
+Mutex					gRenderMutex;
+Cond *					gSubmitCond = NULL;		// Signalled when an arena is submitted
+Cond *					gRenderedCond = NULL;	// Signalled when the render thread finishes an arena
+const SArena *			gSubmittedArena = NULL;	// Non-NULL until the render thread has finished with it
+bool					gRenderQuit = false;
+
+inline void UnpackColour( u32 colour, SColour & out )
+{
+	out.C[0] = (colour      ) & 0xff;
+	out.C[1] = (colour >>  8) & 0xff;
+	out.C[2] = (colour >> 16) & 0xff;
+	out.C[3] = (colour >> 24);
+}
+
+inline void SetColour( SColour & out, s32 r, s32 g, s32 b, s32 a )
+{
+	out.C[0] = r;
+	out.C[1] = g;
+	out.C[2] = b;
+	out.C[3] = a;
+}
+
+inline void ReplicateAlpha( const SColour & in, SColour & out )
+{
+	SetColour( out, in.C[3], in.C[3], in.C[3], in.C[3] );
+}
+
+//*****************************************************************************
+// Texel fetch - this is a port of the fetch functions in SysGL's n64.psh
+//*****************************************************************************
+inline s32 ApplyTileShift( s32 coord, float shift_scale )
+{
+	return s32( float( coord ) * shift_scale );
+}
+
+inline s32 ApplyTileMask( s32 coord, u32 mirror_bits, u32 mask_bits )
+{
+	if( coord & mirror_bits )
+		coord = ~coord;
+	return coord & mask_bits;
+}
+
+inline u32 FetchTexel( const SSoftTile & tile, s32 u, s32 v )
+{
+	// texelFetch returns undefined values outside the texture, we just need to avoid reading off the end.
+	u = Clamp< s32 >( u, 0, tile.Width - 1 );
+	v = Clamp< s32 >( v, 0, tile.Height - 1 );
+	return tile.Texels[ v * tile.Pitch + u ];
+}
+
+void FetchPoint( const SSoftTile & tile, s32 s, s32 t, SColour & out )
+{
+	s32 uv[2] = { s, t };
+	for( u32 i = 0; i < 2; ++i )
+	{
+		s32 c = ApplyTileShift( uv[i], tile.ShiftScale[i] );
+		if( tile.Clamp[i] )
+			c = Clamp< s32 >( c, tile.TopLeft[i] << 3, tile.BottomRight[i] << 3 );
+
+		// NB: discard fractional bits.
+		c = ((c >> 3) - tile.TopLeft[i]) >> 2;
+		uv[i] = ApplyTileMask( c, tile.Mirror[i], tile.Mask[i] );
+	}
+
+	UnpackColour( FetchTexel( tile, uv[0], uv[1] ), out );
+}
+
+void FetchCopy( const SSoftTile & tile, s32 s, s32 t, SColour & out )
+{
+	// For cycle type Copy - there is no clamping.
+	s32 uv[2] = { s, t };
+	for( u32 i = 0; i < 2; ++i )
+	{
+		s32 c = ApplyTileShift( uv[i], tile.ShiftScale[i] );
+		c = (((c >> 3) - tile.TopLeft[i]) >> 2) & 0x1fff;
+		uv[i] = ApplyTileMask( c, tile.Mirror[i], tile.Mask[i] );
+	}
+
+	UnpackColour( FetchTexel( tile, uv[0], uv[1] ), out );
+}
+
+void FetchBilinear( const SSoftTile & tile, s32 s, s32 t, SColour & out )
+{
+	s32 uv0[2] = { s, t };
+	s32 uv1[2];
+	s32 frac[2];
+	for( u32 i = 0; i < 2; ++i )
+	{
+		s32 c = ApplyTileShift( uv0[i], tile.ShiftScale[i] );
+		if( tile.Clamp[i] )
+			c = Clamp< s32 >( c, tile.TopLeft[i] << 3, tile.BottomRight[i] << 3 );
+
+		// NB: retain fractional bits.
+		c -= tile.TopLeft[i] << 3;
+		frac[i] = c & 0x1f;
+
+		s32 c0 = ApplyTileMask( c >> 5,       tile.Mirror[i], tile.Mask[i] );
+		s32 c1 = ApplyTileMask( (c >> 5) + 1, tile.Mirror[i], tile.Mask[i] );
+
+		// Don't filter across the edge of a clamped texture.
+		if( tile.WrapClamp[i] && c1 < c0 )
+			frac[i] = 0;
+
+		uv0[i] = c0;
+		uv1[i] = c1;
+	}
+
+	SColour c00, c01, c10, c11;
+	UnpackColour( FetchTexel( tile, uv0[0], uv0[1] ), c00 );
+	UnpackColour( FetchTexel( tile, uv0[0], uv1[1] ), c01 );
+	UnpackColour( FetchTexel( tile, uv1[0], uv0[1] ), c10 );
+	UnpackColour( FetchTexel( tile, uv1[0], uv1[1] ), c11 );
+
+	for( u32 i = 0; i < 4; ++i )
+	{
+		s32 a = c00.C[i] + (((c10.C[i] - c00.C[i]) * frac[0]) >> 5);
+		s32 b = c01.C[i] + (((c11.C[i] - c01.C[i]) * frac[0]) >> 5);
+		out.C[i] = a + (((b - a) * frac[1]) >> 5);
+	}
+}
+
+inline void Fetch( const SDraw & draw, u32 idx, s32 s, s32 t, SColour & out )
+{
+	const SSoftTile & tile( draw.State->Tiles[idx] );
+	if( tile.Texels == NULL )
+	{
+		SetColour( out, 0, 0, 0, 0 );
+	}
+	else if( draw.State->BilerpFilter )
+	{
+		FetchBilinear( tile, s, t, out );
+	}
+	else
+	{
+		FetchPoint( tile, s, t, out );
+	}
+}
+
+//*****************************************************************************
+// Colour combiner
+//*****************************************************************************
+void DecodeCombiner( SDraw & draw )
+{
+	const SSoftDrawState & state( *draw.State );
+
+	u32 mux0 = (u32)(state.Mux >> 32);
+	u32 mux1 = (u32)(state.Mux);
+
+	draw.RGB[0][0]   = kRGBInputs16[(mux0 >> 20) & 0x0F];
+	draw.RGB[0][1]   = kRGBInputs16[(mux1 >> 28) & 0x0F];
+	draw.RGB[0][2]   = kRGBInputs32[(mux0 >> 15) & 0x1F];
+	draw.RGB[0][3]   = (mux1 >> 15) & 0x07;
+
+	draw.Alpha[0][0] = (mux0 >> 12) & 0x07;
+	draw.Alpha[0][1] = (mux1 >> 12) & 0x07;
+	draw.Alpha[0][2] = (mux0 >>  9) & 0x07;
+	draw.Alpha[0][3] = (mux1 >>  9) & 0x07;
+
+	draw.RGB[1][0]   = kRGBInputs16[(mux0 >>  5) & 0x0F];
+	draw.RGB[1][1]   = kRGBInputs16[(mux1 >> 24) & 0x0F];
+	draw.RGB[1][2]   = kRGBInputs32[(mux0      ) & 0x1F];
+	draw.RGB[1][3]   = (mux1 >>  6) & 0x07;
+
+	draw.Alpha[1][0] = (mux1 >> 21) & 0x07;
+	draw.Alpha[1][1] = (mux1 >>  3) & 0x07;
+	draw.Alpha[1][2] = (mux1 >> 18) & 0x07;
+	draw.Alpha[1][3] = (mux1      ) & 0x07;
+
+	draw.NumCycles = state.CycleType == CYCLE_2CYCLE ? 2 : 1;
+
+	// NB: tex0 becomes tex1 on the second cycle - see mame.
+	for( u32 i = 0; i < 4; ++i )
+	{
+		if( draw.RGB[1][i]   == CI_TEX0 )			draw.RGB[1][i]   = CI_TEX1;
+		if( draw.RGB[1][i]   == CI_TEX0_ALPHA )		draw.RGB[1][i]   = CI_TEX1_ALPHA;
+		if( draw.Alpha[1][i] == CI_TEX0 )			draw.Alpha[1][i] = CI_TEX1;
+	}
+
+	draw.SampleTexture[0] = state.CycleType == CYCLE_COPY;
+	draw.SampleTexture[1] = false;
+	if( state.CycleType < CYCLE_COPY )
+	{
+		for( u32 c = 0; c < draw.NumCycles; ++c )
+		{
+			for( u32 i = 0; i < 4; ++i )
+			{
+				u8 rgb   = draw.RGB[c][i];
+				u8 alpha = draw.Alpha[c][i];
+				draw.SampleTexture[0] |= rgb == CI_TEX0 || rgb == CI_TEX0_ALPHA || alpha == CI_TEX0;
+				draw.SampleTexture[1] |= rgb == CI_TEX1 || rgb == CI_TEX1_ALPHA || alpha == CI_TEX1;
+			}
+		}
+	}
+
+	SColour * inputs = draw.Inputs;
+	UnpackColour( state.PrimColour.GetColour(), inputs[CI_PRIM] );
+	UnpackColour( state.EnvColour.GetColour(),  inputs[CI_ENV] );
+	ReplicateAlpha( inputs[CI_PRIM], inputs[CI_PRIM_ALPHA] );
+	ReplicateAlpha( inputs[CI_ENV],  inputs[CI_ENV_ALPHA] );
+	SetColour( inputs[CI_ONE],  255, 255, 255, 255 );
+	SetColour( inputs[CI_ZERO],   0,   0,   0,   0 );
+	SetColour( inputs[CI_LOD_FRAC], 0, 0, 0, 0 );		// FIXME, as in RendererGL
+	SetColour( inputs[CI_K5],       0, 0, 0, 0 );
+	s32 plf = state.PrimLODFrac;
+	SetColour( inputs[CI_PRIM_LOD_FRAC], plf, plf, plf, plf );
+}
+
+// (a - b) * c + d, with c scaled so that 255 is 1.0
+inline s32 CombineChannel( s32 a, s32 b, s32 c, s32 d )
+{
+	c += c >> 7;
+	return (((a - b) * c) >> 8) + d;
+}
+
+inline void Combine( SColour * inputs, const u8 (&rgb)[4], const u8 (&alpha)[4], SColour & out )
+{
+	const SColour & a( inputs[rgb[0]] );
+	const SColour & b( inputs[rgb[1]] );
+	const SColour & c( inputs[rgb[2]] );
+	const SColour & d( inputs[rgb[3]] );
+
+	for( u32 i = 0; i < 3; ++i )
+	{
+		out.C[i] = CombineChannel( a.C[i], b.C[i], c.C[i], d.C[i] );
+	}
+
+	out.C[3] = CombineChannel( inputs[alpha[0]].C[3], inputs[alpha[1]].C[3], inputs[alpha[2]].C[3], inputs[alpha[3]].C[3] );
+}
+
+//*****************************************************************************
+// Pixel pipeline
+//*****************************************************************************
+inline u32 PackColour( const SColour & col )
+{
+	return c32::Make( Clamp< s32 >( col.C[0], 0, 255 ),
+					  Clamp< s32 >( col.C[1], 0, 255 ),
+					  Clamp< s32 >( col.C[2], 0, 255 ),
+					  Clamp< s32 >( col.C[3], 0, 255 ) );
+}
+
+inline u32 Blend( ESoftBlendMode mode, u32 src, u32 dst )
+{
+	u32 a = src >> 24;
+	u32 inv_a = 255 - a;
+
+	u32 out = 0;
+	for( u32 shift = 0; shift < 32; shift += 8 )
+	{
+		u32 s = (src >> shift) & 0xff;
+		u32 d = (dst >> shift) & 0xff;
+		u32 c;
+		if( mode == SOFT_BLEND_ALPHA_TRANS )
+			c = (s * a + d * inv_a + 127) / 255;
+		else
+			c = (d * inv_a + 127) / 255;
+		out |= c << shift;
+	}
+	return out;
+}
+
+void ShadeSpan( const SDraw & draw, const STriangle & tri, s32 y, s32 x0, s32 x1 )
+{
+	const SSoftDrawState & state( *draw.State );
+
+	u32 *	colour_row = gColourBuffer + y * gWidth;
+	float *	depth_row  = gDepthBuffer  + y * gWidth;
+	float	py = float( y ) + 0.5f;
+
+	// Local copy, as the per-pixel inputs are written to.
+	SColour inputs[CI_NUM_INPUTS];
+	memcpy( inputs, draw.Inputs, sizeof( inputs ) );
+	SetColour( inputs[CI_COMBINED], 0, 0, 0, 255 );
+	ReplicateAlpha( inputs[CI_COMBINED], inputs[CI_COMBINED_ALPHA] );
+
+	for( s32 x = x0; x <= x1; ++x )
+	{
+		float px = float( x ) + 0.5f;
+
+		float z = tri.Z.At( px, py );
+		if( state.DepthTest )
+		{
+			float test_z = state.DepthDecal ? z - kDecalBias : z;
+			if( test_z > depth_row[x] )
+				continue;
+		}
+
+		float w = 1.f / tri.InvW.At( px, py );
+
+		SColour & shade( inputs[CI_SHADE] );
+		for( u32 i = 0; i < 4; ++i )
+		{
+			shade.C[i] = Clamp< s32 >( s32( tri.Colour[i].At( px, py ) * w + 0.5f ), 0, 255 );
+		}
+
+		s32 s = s32( tri.S.At( px, py ) * w );
+		s32 t = s32( tri.T.At( px, py ) * w );
+
+		SColour col;
+		if( state.CycleType == CYCLE_FILL )
+		{
+			col = shade;
+		}
+		else if( state.CycleType == CYCLE_COPY )
+		{
+			if( state.Tiles[0].Texels == NULL )
+				continue;
+			FetchCopy( state.Tiles[0], s, t, col );
+		}
+		else
+		{
+			ReplicateAlpha( shade, inputs[CI_SHADE_ALPHA] );
+			if( draw.SampleTexture[0] )
+			{
+				Fetch( draw, 0, s, t, inputs[CI_TEX0] );
+				ReplicateAlpha( inputs[CI_TEX0], inputs[CI_TEX0_ALPHA] );
+			}
+			if( draw.SampleTexture[1] )
+			{
+				Fetch( draw, 1, s, t, inputs[CI_TEX1] );
+				ReplicateAlpha( inputs[CI_TEX1], inputs[CI_TEX1_ALPHA] );
+			}
+
+			Combine( inputs, draw.RGB[0], draw.Alpha[0], col );
+			if( draw.NumCycles == 2 )
+			{
+				inputs[CI_COMBINED] = col;
+				ReplicateAlpha( col, inputs[CI_COMBINED_ALPHA] );
+				Combine( inputs, draw.RGB[1], draw.Alpha[1], col );
+			}
+		}
+
+		if( col.C[3] < s32( state.AlphaThreshold ) )
+			continue;
+
+		u32 src = PackColour( col );
+		colour_row[x] = state.BlendMode == SOFT_BLEND_OPAQUE ? src : Blend( state.BlendMode, src, colour_row[x] );
+
+		if( state.DepthWrite )
+			depth_row[x] = z;
+	}
+}
+
+void RasterizeTriangle( const STriangle & tri, s32 tile_x0, s32 tile_y0, s32 tile_x1, s32 tile_y1 )
+{
+	const SDraw & draw( gDraws[tri.Draw] );
+
+	s32 x0 = Max( tri.MinX, tile_x0 );
+	s32 y0 = Max( tri.MinY, tile_y0 );
+	s32 x1 = Min( tri.MaxX, tile_x1 );
+	s32 y1 = Min( tri.MaxY, tile_y1 );
+
+	for( s32 y = y0; y <= y1; ++y )
+	{
+		float px = float( x0 ) + 0.5f;
+		float py = float( y ) + 0.5f;
+
+		float e0 = tri.Edge[0].At( px, py );
+		float e1 = tri.Edge[1].At( px, py );
+		float e2 = tri.Edge[2].At( px, py );
+
+		// Find the covered span on this row, then shade it in one go.
+		s32 span_start = -1;
+		s32 span_end   = -1;
+		for( s32 x = x0; x <= x1; ++x )
+		{
+			bool inside = (e0 > 0.f || (e0 == 0.f && tri.TopLeft[0])) &&
+						  (e1 > 0.f || (e1 == 0.f && tri.TopLeft[1])) &&
+						  (e2 > 0.f || (e2 == 0.f && tri.TopLeft[2]));
+			if( inside )
+			{
+				if( span_start < 0 )
+					span_start = x;
+				span_end = x;
+			}
+			else if( span_start >= 0 )
+			{
+				break;		// Triangles are convex, so we're done with this row
+			}
+
+			e0 += tri.Edge[0].DX;
+			e1 += tri.Edge[1].DX;
+			e2 += tri.Edge[2].DX;
+		}
+
+		if( span_start >= 0 )
+		{
+			ShadeSpan( draw, tri, y, span_start, span_end );
+		}
+	}
+}
+
+void RasterizeTile( u32 tile_idx )
+{
+	s32 tile_x0 = (tile_idx % gTilesX) * kTileSize;
+	s32 tile_y0 = (tile_idx / gTilesX) * kTileSize;
+	s32 tile_x1 = Min< s32 >( tile_x0 + kTileSize, gWidth )  - 1;
+	s32 tile_y1 = Min< s32 >( tile_y0 + kTileSize, gHeight ) - 1;
+
+	const std::vector<u32> & bin( gBins[tile_idx] );
+	for( u32 i = 0; i < bin.size(); ++i )
+	{
+		RasterizeTriangle( gTriangles[bin[i]], tile_x0, tile_y0, tile_x1, tile_y1 );
+	}
+}
+
+void ProcessTiles()
+{
+	u32 num_tiles = gWorkTiles.size();
+	for(;;)
+	{
+		u32 idx = AtomicIncrement( &gNextTile ) - 1;
+		if( idx >= num_tiles )
+			break;
+
+		RasterizeTile( gWorkTiles[idx] );
+
+		if( AtomicIncrement( &gTilesDone ) == num_tiles )
+		{
+			MutexLock lock( &gWorkMutex );
+			CondSignal( gDoneCond );
+		}
+	}
+}
+
+u32 DAEDALUS_THREAD_CALL_TYPE WorkerThread( void * arg )
+{
+	u32 generation = 0;
+	for(;;)
+	{
+		{
+			MutexLock lock( &gWorkMutex );
+			while( !gQuit && gWorkGeneration == generation )
+			{
+				CondWait( gWorkCond, &gWorkMutex, kTimeoutInfinity );
+			}
+			if( gQuit )
+				break;
+
+			generation = gWorkGeneration;
+			++gActiveWorkers;
+		}
+
+		ProcessTiles();
+
+		{
+			MutexLock lock( &gWorkMutex );
+			--gActiveWorkers;
+			CondSignal( gDoneCond );
+		}
+	}
+	return 0;
+}
+
+//*****************************************************************************
+// Triangle setup
+//*****************************************************************************
+void MakePlane( const SSoftVertex & v0, const SSoftVertex & v1, const SSoftVertex & v2,
+				float a0, float a1, float a2, float inv_area, SPlane & plane )
+{
+	plane.DX = ((a1 - a0) * (v2.Y - v0.Y) - (a2 - a0) * (v1.Y - v0.Y)) * inv_area;
+	plane.DY = ((a2 - a0) * (v1.X - v0.X) - (a1 - a0) * (v2.X - v0.X)) * inv_area;
+	plane.C  = a0 - plane.DX * v0.X - plane.DY * v0.Y;
+}
+
+void MakeEdge( const SSoftVertex & a, const SSoftVertex & b, SPlane & edge, bool & top_left )
+{
+	edge.DX = a.Y - b.Y;
+	edge.DY = b.X - a.X;
+	edge.C  = -(edge.DX * a.X + edge.DY * a.Y);
+
+	// The interior is on the side where the edge function increases.
+	top_left = edge.DX > 0.f || (edge.DX == 0.f && edge.DY > 0.f);
+}
+
+inline float VertexColour( const SSoftVertex & v, u32 channel )
+{
+	return float( (v.Colour >> (channel * 8)) & 0xff ) * v.InvW;
+}
+
+bool SetupTriangle( u32 draw_idx, const SSoftVertex & v0, const SSoftVertex & in_v1, const SSoftVertex & in_v2, STriangle & tri )
+{
+	const SSoftDrawState & state( *gDraws[draw_idx].State );
+
+	const SSoftVertex * p1 = &in_v1;
+	const SSoftVertex * p2 = &in_v2;
+
+	float area = (p1->X - v0.X) * (p2->Y - v0.Y) - (p2->X - v0.X) * (p1->Y - v0.Y);
+	if( area == 0.f )
+		return false;
+
+	// Culling is done by BaseRenderer, so accept either winding.
+	if( area < 0.f )
+	{
+		Swap( p1, p2 );
+		area = -area;
+	}
+	const SSoftVertex & v1( *p1 );
+	const SSoftVertex & v2( *p2 );
+
+	float min_x = Min( v0.X, Min( v1.X, v2.X ) );
+	float min_y = Min( v0.Y, Min( v1.Y, v2.Y ) );
+	float max_x = Max( v0.X, Max( v1.X, v2.X ) );
+	float max_y = Max( v0.Y, Max( v1.Y, v2.Y ) );
+
+	// Pixels are sampled at their centres. Clamp before converting, as vertices close to
+	// the near plane can be a very long way off screen.
+	tri.MinX = Max< s32 >( s32( ceilf( Max( min_x - 0.5f, 0.f ) ) ),                Max< s32 >( state.Scissor[0], 0 ) );
+	tri.MinY = Max< s32 >( s32( ceilf( Max( min_y - 0.5f, 0.f ) ) ),                Max< s32 >( state.Scissor[1], 0 ) );
+	tri.MaxX = Min< s32 >( s32( floorf( Min( max_x - 0.5f, float( gWidth ) ) ) ),  Min< s32 >( state.Scissor[2], gWidth ) - 1 );
+	tri.MaxY = Min< s32 >( s32( floorf( Min( max_y - 0.5f, float( gHeight ) ) ) ), Min< s32 >( state.Scissor[3], gHeight ) - 1 );
+	if( tri.MinX > tri.MaxX || tri.MinY > tri.MaxY )
+		return false;
+
+	tri.Draw = draw_idx;
+
+	MakeEdge( v0, v1, tri.Edge[2], tri.TopLeft[2] );
+	MakeEdge( v1, v2, tri.Edge[0], tri.TopLeft[0] );
+	MakeEdge( v2, v0, tri.Edge[1], tri.TopLeft[1] );
+
+	float inv_area = 1.f / area;
+	MakePlane( v0, v1, v2, v0.Z,              v1.Z,              v2.Z,              inv_area, tri.Z );
+	MakePlane( v0, v1, v2, v0.InvW,           v1.InvW,           v2.InvW,           inv_area, tri.InvW );
+	MakePlane( v0, v1, v2, v0.S * v0.InvW,    v1.S * v1.InvW,    v2.S * v2.InvW,    inv_area, tri.S );
+	MakePlane( v0, v1, v2, v0.T * v0.InvW,    v1.T * v1.InvW,    v2.T * v2.InvW,    inv_area, tri.T );
+	for( u32 i = 0; i < 4; ++i )
+	{
+		MakePlane( v0, v1, v2, VertexColour( v0, i ), VertexColour( v1, i ), VertexColour( v2, i ), inv_area, tri.Colour[i] );
+	}
+	return true;
+}
+
+// Returns false if the triangle can't touch any pixel in the tile.
+bool TriangleOverlapsTile( const STriangle & tri, s32 tile_x0, s32 tile_y0, s32 tile_x1, s32 tile_y1 )
+{
+	for( u32 i = 0; i < 3; ++i )
+	{
+		const SPlane & e( tri.Edge[i] );
+
+		// Test the pixel centre with the largest edge value.
+		float x = (e.DX > 0.f ? tile_x1 : tile_x0) + 0.5f;
+		float y = (e.DY > 0.f ? tile_y1 : tile_y0) + 0.5f;
+		if( e.At( x, y ) < 0.f )
+			return false;
+	}
+	return true;
+}
+
+void BinTriangle( u32 tri_idx )
+{
+	const STriangle & tri( gTriangles[tri_idx] );
+
+	u32 tx0 = tri.MinX / kTileSize;
+	u32 ty0 = tri.MinY / kTileSize;
+	u32 tx1 = tri.MaxX / kTileSize;
+	u32 ty1 = tri.MaxY / kTileSize;
+
+	bool single_tile = tx0 == tx1 && ty0 == ty1;
+
+	for( u32 ty = ty0; ty <= ty1; ++ty )
+	{
+		for( u32 tx = tx0; tx <= tx1; ++tx )
+		{
+			s32 x0 = tx * kTileSize;
+			s32 y0 = ty * kTileSize;
+			if( single_tile || TriangleOverlapsTile( tri, x0, y0, x0 + kTileSize - 1, y0 + kTileSize - 1 ) )
+			{
+				gBins[ty * gTilesX + tx].push_back( tri_idx );
+			}
+		}
+	}
+}
+
+//*****************************************************************************
+// Render thread
+//*****************************************************************************
+// Rasterize everything binned so far.
+void RasterizeBins()
+{
+	if( gTriangles.empty() )
+	{
+		gDraws.clear();
+		return;
+	}
+
+	DAEDALUS_PROFILE( "SoftRasterizer_RasterizeBins" );
+
+	u32 num_tiles = gTilesX * gTilesY;
+
+	{
+		MutexLock lock( &gWorkMutex );
+
+		// Workers which woke up late for the last generation may still be running.
+		while( gActiveWorkers != 0 )
+		{
+			CondWait( gDoneCond, &gWorkMutex, kTimeoutInfinity );
+		}
+
+		gWorkTiles.clear();
+		for( u32 i = 0; i < num_tiles; ++i )
+		{
+			if( !gBins[i].empty() )
+				gWorkTiles.push_back( i );
+		}
+		gNextTile  = 0;
+		gTilesDone = 0;
+
+		++gWorkGeneration;
+		for( u32 i = 0; i < gNumWorkers; ++i )
+		{
+			CondSignal( gWorkCond );
+		}
+	}
+
+	ProcessTiles();
+
+	{
+		MutexLock lock( &gWorkMutex );
+		while( gTilesDone != gWorkTiles.size() )
+		{
+			CondWait( gDoneCond, &gWorkMutex, kTimeoutInfinity );
+		}
+	}
+
+	for( u32 i = 0; i < num_tiles; ++i )
+	{
+		gBins[i].clear();
+	}
+	gTriangles.clear();
+	gDraws.clear();
+}
+
+void FillColour( u32 value )
+{
+	for( u32 i = 0; i < gWidth * gHeight; ++i )
+	{
+		gColourBuffer[i] = value;
+	}
+}
+
+void FillDepth()
+{
+	for( u32 i = 0; i < gWidth * gHeight; ++i )
+	{
+		gDepthBuffer[i] = 1.f;
+	}
+}
+
+void AddDraw( const SSoftDrawState & state, const SSoftVertex * vertices, u32 num_vertices )
+{
+	if( gDraws.size() >= kMaxDraws || gTriangles.size() + num_vertices / 3 > kMaxTriangles )
+	{
+		RasterizeBins();
+	}
+
+	u32 draw_idx = gDraws.size();
+	gDraws.resize( draw_idx + 1 );
+	SDraw & draw( gDraws.back() );
+	draw.State = &state;
+	DecodeCombiner( draw );
+
+	for( u32 i = 0; i + 2 < num_vertices; i += 3 )
+	{
+		u32 tri_idx = gTriangles.size();
+		gTriangles.resize( tri_idx + 1 );
+
+		if( SetupTriangle( draw_idx, vertices[i], vertices[i+1], vertices[i+2], gTriangles.back() ) )
+		{
+			BinTriangle( tri_idx );
+		}
+		else
+		{
+			gTriangles.pop_back();
+		}
+	}
+}
+
+void RenderArena( const SArena & arena )
+{
+	DAEDALUS_PROFILE( "SoftRasterizer_RenderArena" );
+
+	for( u32 i = 0; i < arena.Commands.size(); ++i )
+	{
+		const SCommand & cmd( arena.Commands[i] );
+		switch( cmd.Type )
+		{
+		case CMD_DRAW:
+			AddDraw( arena.States[cmd.State], &arena.Vertices[cmd.FirstVertex], cmd.NumVertices );
+			break;
+		case CMD_CLEAR_COLOUR:
+			RasterizeBins();
+			FillColour( cmd.Colour );
+			break;
+		case CMD_CLEAR_DEPTH:
+			RasterizeBins();
+			FillDepth();
+			break;
+		}
+	}
+
+	// gDraws points into the arena, so nothing can be left binned once we're done with it.
+	RasterizeBins();
+}
+
+u32 DAEDALUS_THREAD_CALL_TYPE RenderThread( void * arg )
+{
+	for(;;)
+	{
+		const SArena * arena;
+		{
+			MutexLock lock( &gRenderMutex );
+			while( !gRenderQuit && gSubmittedArena == NULL )
+			{
+				CondWait( gSubmitCond, &gRenderMutex, kTimeoutInfinity );
+			}
+			if( gRenderQuit )
+				break;
+
+			arena = gSubmittedArena;
+		}
+
+		RenderArena( *arena );
+
+		{
+			MutexLock lock( &gRenderMutex );
+			gSubmittedArena = NULL;
+			CondSignal( gRenderedCond );
+		}
+	}
+	return 0;
+}
+
+void WaitForRenderThread()
+{
+	MutexLock lock( &gRenderMutex );
+	while( gSubmittedArena != NULL )
+	{
+		CondWait( gRenderedCond, &gRenderMutex, kTimeoutInfinity );
+	}
+}
+
+SCommand & AddCommand( ECommandType type )
+{
+	SArena & arena( gArenas[gRecordArena] );
+	arena.Commands.resize( arena.Commands.size() + 1 );
+
+	SCommand & cmd( arena.Commands.back() );
+	memset( &cmd, 0, sizeof( cmd ) );
+	cmd.Type = type;
+	return cmd;
+}
+
+bool ArenaReferencesTexture( const SArena & arena, const CNativeTexture * texture )
+{
+	for( u32 i = 0; i < arena.States.size(); ++i )
+	{
+		const SSoftDrawState & state( arena.States[i] );
+		if( state.Textures[0] == texture || state.Textures[1] == texture )
+			return true;
+	}
+	return false;
+}
+
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool SoftRasterizer_Initialise( u32 width, u32 height )
+{
+	DAEDALUS_ASSERT( gColourBuffer == NULL, "Already initialised" );
+
+	gWidth  = width;
+	gHeight = height;
+	gTilesX = (width  + kTileSize - 1) / kTileSize;
+	gTilesY = (height + kTileSize - 1) / kTileSize;
+
+	gColourBuffer = new u32[ width * height ];
+	gDepthBuffer  = new float[ width * height ];
+	gBins         = new std::vector<u32>[ gTilesX * gTilesY ];
+
+	gDraws.reserve( kMaxDraws );
+	gTriangles.reserve( kMaxTriangles );
+	gWorkTiles.reserve( gTilesX * gTilesY );
+	for( u32 i = 0; i < 2; ++i )
+	{
+		gArenas[i].Commands.reserve( kMaxArenaDraws );
+		gArenas[i].States.reserve( kMaxArenaDraws );
+		gArenas[i].Vertices.reserve( kMaxArenaVertices );
+	}
+	gRecordArena = 0;
+
+	FillColour( 0xff000000 );
+	FillDepth();
+
+	gWorkCond = CondCreate();
+	gDoneCond = CondCreate();
+	gQuit = false;
+
+	gSubmitCond   = CondCreate();
+	gRenderedCond = CondCreate();
+	gSubmittedArena = NULL;
+	gRenderQuit = false;
+
+	// If this fails, arenas are rendered on the emulator thread when they're submitted.
+	gRenderThread = CreateThread( "SoftRender", &RenderThread, NULL );
+
+	// Leave a core each for the emulator thread and the render thread (which rasterizes too while it waits).
+	u32 num_cores = std::thread::hardware_concurrency();
+	gNumWorkers = num_cores > 2 ? Min( num_cores - 2, kMaxWorkers ) : 0;
+	for( u32 i = 0; i < gNumWorkers; ++i )
+	{
+		gWorkers[i] = CreateThread( "SoftRasterizer", &WorkerThread, NULL );
+		if( gWorkers[i] == kInvalidThreadHandle )
+		{
+			gNumWorkers = i;
+			break;
+		}
+	}
+
+	return true;
+}
+
+void SoftRasterizer_Finalise()
+{
+	if( gColourBuffer == NULL )
+		return;
+
+	SoftRasterizer_Flush();
+
+	if( gRenderThread != kInvalidThreadHandle )
+	{
+		{
+			MutexLock lock( &gRenderMutex );
+			gRenderQuit = true;
+			CondSignal( gSubmitCond );
+		}
+		JoinThread( gRenderThread, -1 );
+		ReleaseThreadHandle( gRenderThread );
+		gRenderThread = kInvalidThreadHandle;
+	}
+	CondDestroy( gSubmitCond );
+	CondDestroy( gRenderedCond );
+	gSubmitCond   = NULL;
+	gRenderedCond = NULL;
+
+	for( u32 i = 0; i < 2; ++i )
+	{
+		gArenas[i].Clear();
+	}
+
+	{
+		MutexLock lock( &gWorkMutex );
+		gQuit = true;
+		for( u32 i = 0; i < gNumWorkers; ++i )
+		{
+			CondSignal( gWorkCond );
+		}
+	}
+	for( u32 i = 0; i < gNumWorkers; ++i )
+	{
+		JoinThread( gWorkers[i], -1 );
+		ReleaseThreadHandle( gWorkers[i] );
+	}
+	gNumWorkers = 0;
+
+	CondDestroy( gWorkCond );
+	CondDestroy( gDoneCond );
+	gWorkCond = NULL;
+	gDoneCond = NULL;
+
+	delete [] gColourBuffer;
+	delete [] gDepthBuffer;
+	delete [] gBins;
+	gColourBuffer = NULL;
+	gDepthBuffer  = NULL;
+	gBins         = NULL;
+}
+
+void SoftRasterizer_GetSize( u32 * width, u32 * height )
+{
+	*width  = gWidth;
+	*height = gHeight;
+}
+
+void SoftRasterizer_DrawTriangles( const SSoftDrawState & state, const SSoftVertex * vertices, u32 num_vertices )
+{
+	DAEDALUS_PROFILE( "SoftRasterizer_DrawTriangles" );
+
+	if( num_vertices < 3 )
+		return;
+
+	SArena * arena( &gArenas[gRecordArena] );
+	if( arena->States.size() >= kMaxArenaDraws || arena->Vertices.size() + num_vertices > kMaxArenaVertices )
+	{
+		SoftRasterizer_Submit();
+		arena = &gArenas[gRecordArena];
+	}
+
+	SCommand & cmd( AddCommand( CMD_DRAW ) );
+	cmd.State       = arena->States.size();
+	cmd.FirstVertex = arena->Vertices.size();
+	cmd.NumVertices = num_vertices;
+
+	arena->States.push_back( state );
+	arena->Vertices.insert( arena->Vertices.end(), vertices, vertices + num_vertices );
+}
+
+void SoftRasterizer_Submit()
+{
+	SArena & arena( gArenas[gRecordArena] );
+	if( arena.IsEmpty() )
+		return;
+
+	DAEDALUS_PROFILE( "SoftRasterizer_Submit" );
+
+	if( gRenderThread == kInvalidThreadHandle )
+	{
+		RenderArena( arena );
+		arena.Clear();
+		return;
+	}
+
+	// The other arena has to be finished with before we can record into it.
+	WaitForRenderThread();
+
+	{
+		MutexLock lock( &gRenderMutex );
+		gSubmittedArena = &arena;
+		CondSignal( gSubmitCond );
+	}
+
+	gRecordArena ^= 1;
+	gArenas[gRecordArena].Clear();
+}
+
+void SoftRasterizer_Flush()
+{
+	SoftRasterizer_Submit();
+	WaitForRenderThread();
+}
+
+void SoftRasterizer_FlushTexture( const CNativeTexture * texture )
+{
+	const SArena * in_flight;
+	{
+		MutexLock lock( &gRenderMutex );
+		in_flight = gSubmittedArena;
+	}
+
+	// Only wait if a draw which hasn't been rasterized yet may sample it.
+	if( ArenaReferencesTexture( gArenas[gRecordArena], texture ) ||
+		(in_flight != NULL && ArenaReferencesTexture( *in_flight, texture )) )
+	{
+		SoftRasterizer_Flush();
+	}
+}
+
+void SoftRasterizer_ClearColour( c32 colour )
+{
+	SCommand & cmd( AddCommand( CMD_CLEAR_COLOUR ) );
+	cmd.Colour = colour.GetColour();
+}
+
+void SoftRasterizer_ClearDepth()
+{
+	AddCommand( CMD_CLEAR_DEPTH );
+}
+
+void SoftRasterizer_ReadPixels( void * pixels )
+{
+	SoftRasterizer_Flush();
+	memcpy( pixels, gColourBuffer, gWidth * gHeight * sizeof( u32 ) );
+}
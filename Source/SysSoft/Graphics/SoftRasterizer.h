@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef SYSSOFT_GRAPHICS_SOFTRASTERIZER_H_
+#define SYSSOFT_GRAPHICS_SOFTRASTERIZER_H_
+
+#include "Graphics/ColourValue.h"
+#include "Graphics/NativeTexture.h"
+#include "Utility/DaedalusTypes.h"
+#include "Utility/RefCounted.h"
+
+//
+//	Draws and clears are recorded into a command arena, which is handed to a render
+//	thread when it's submitted (once a frame, or when it fills up). While that runs,
+//	the emulator thread records into the other arena, and only waits when it needs
+//	the results - reading the framebuffer back, or changing a texture which is still
+//	in use.
+//
+//	The render thread bins triangles into screen tiles and rasterizes them in
+//	submission order. Tiles are handed out to a pool of worker threads, so each tile
+//	is only ever touched by one thread.
+//
+//	The framebuffer is RGBA8888 (c32 layout), stored top down.
+//
+
+struct SSoftVertex
+{
+	float		X;				// Pixels
+	float		Y;
+	float		Z;				// Depth, 0..1
+	float		InvW;			// 1/w, for perspective correct interpolation
+	float		S;				// 10.5 texels
+	float		T;
+	u32			Colour;
+};
+
+// Sampler state for one of the two texture units. Mirrors the uniforms used by n64.psh.
+struct SSoftTile
+{
+	const u32 *	Texels;			// NULL if no texture is bound
+	u32			Width;
+	u32			Height;
+	u32			Pitch;			// In texels
+
+	s32			TopLeft[2];		// 10.2
+	s32			BottomRight[2];	// 10.2
+	float		ShiftScale[2];
+	u32			Mask[2];
+	u32			Mirror[2];
+	bool		Clamp[2];		// Tile clamp (clamp_s/t, or mask == 0)
+	bool		WrapClamp[2];	// Wrap mode is GU_CLAMP - don't filter across the edge
+};
+
+enum ESoftBlendMode
+{
+	SOFT_BLEND_OPAQUE,
+	SOFT_BLEND_ALPHA_TRANS,
+	SOFT_BLEND_FADE,
+};
+
+struct SSoftDrawState
+{
+	u64						Mux;
+	u32						CycleType;
+	bool					BilerpFilter;
+	u8						AlphaThreshold;		// Discard pixels with alpha below this (0 disables the test)
+
+	c32						PrimColour;
+	c32						EnvColour;
+	u8						PrimLODFrac;
+
+	ESoftBlendMode			BlendMode;
+	bool					DepthTest;
+	bool					DepthWrite;
+	bool					DepthDecal;
+
+	s32						Scissor[4];			// Left, top, right, bottom (exclusive)
+
+	SSoftTile				Tiles[2];
+	CRefPtr<CNativeTexture>	Textures[2];		// Keeps Tiles[].Texels alive until the draw is flushed
+};
+
+bool			SoftRasterizer_Initialise( u32 width, u32 height );
+void			SoftRasterizer_Finalise();
+
+void			SoftRasterizer_GetSize( u32 * width, u32 * height );
+
+// Vertices are a triangle list. The state and vertices are copied into the arena.
+void			SoftRasterizer_DrawTriangles( const SSoftDrawState & state, const SSoftVertex * vertices, u32 num_vertices );
+
+// Hand everything recorded so far to the render thread, without waiting for it.
+void			SoftRasterizer_Submit();
+
+// Rasterize everything that has been recorded so far, and wait for it to finish.
+void			SoftRasterizer_Flush();
+
+// Flushes if any draw still to be rasterized samples texture. Must be called before it's modified.
+void			SoftRasterizer_FlushTexture( const CNativeTexture * texture );
+
+void			SoftRasterizer_ClearColour( c32 colour );
+void			SoftRasterizer_ClearDepth();
+
+// Flushes and copies out the framebuffer (width * height * 4 bytes).
+void			SoftRasterizer_ReadPixels( void * pixels );
+
+#endif // SYSSOFT_GRAPHICS_SOFTRASTERIZER_H_
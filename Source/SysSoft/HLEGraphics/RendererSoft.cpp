@@ -0,0 +1,692 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "RendererSoft.h"
+
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+#include "Graphics/ColourValue.h"
+#include "Graphics/GraphicsContext.h"
+#include "Graphics/NativeTexture.h"
+#include "HLEGraphics/DLDebug.h"
+#include "HLEGraphics/RDPStateManager.h"
+#include "OSHLE/ultra_gbi.h"
+#include "SysSoft/Graphics/SoftRasterizer.h"
+#include "SysSoft/Soft.h"
+#include "Math/MathUtil.h"
+#include "Utility/Macros.h"
+#include "Utility/Preferences.h"
+#include "Utility/Profiler.h"
+
+
+BaseRenderer * gRenderer     = NULL;
+RendererSoft * gRendererSoft = NULL;
+
+static const float kShiftScales[] = {
+    1.f / (float)(1 << 0),
+    1.f / (float)(1 << 1),
+    1.f / (float)(1 << 2),
+    1.f / (float)(1 << 3),
+    1.f / (float)(1 << 4),
+    1.f / (float)(1 << 5),
+    1.f / (float)(1 << 6),
+    1.f / (float)(1 << 7),
+    1.f / (float)(1 << 8),
+    1.f / (float)(1 << 9),
+    1.f / (float)(1 << 10),
+    (float)(1 << 5),
+    (float)(1 << 4),
+    (float)(1 << 3),
+    (float)(1 << 2),
+    (float)(1 << 1),
+};
+DAEDALUS_STATIC_ASSERT(ARRAYSIZE(kShiftScales) == 16);
+
+// Triangles need at most one extra vertex per clip plane.
+static const u32 kMaxClipVertices = 3 + 2;
+
+static ScePspFMatrix4	gProjection;
+static s32				gViewport[4] = { 0, 0, 640, 480 };		// x, y, w, h
+static s32				gScissor[4]  = { 0, 0, 640, 480 };		// left, top, right, bottom
+
+
+void sceGuFog(float mn, float mx, u32 col)
+{
+	//DAEDALUS_ERROR( "%s: Not implemented", __FUNCTION__ );
+}
+
+void sceGuSetMatrix(EGuMatrixType type, const ScePspFMatrix4 * mtx)
+{
+	if (type == GU_PROJECTION)
+	{
+		memcpy(&gProjection, mtx, sizeof(gProjection));
+	}
+}
+
+void SoftRenderer_SetViewport(s32 x, s32 y, s32 w, s32 h)
+{
+	gViewport[0] = x;
+	gViewport[1] = y;
+	gViewport[2] = w;
+	gViewport[3] = h;
+}
+
+void SoftRenderer_SetScissor(s32 left, s32 top, s32 right, s32 bottom)
+{
+	gScissor[0] = left;
+	gScissor[1] = top;
+	gScissor[2] = right;
+	gScissor[3] = bottom;
+}
+
+//*****************************************************************************
+// This mirrors InitBlenderMode in RendererGL - see there for the games which use each mode.
+//*****************************************************************************
+static ESoftBlendMode GetBlendMode()
+{
+	u32 cycle_type    = gRDPOtherMode.cycle_type;
+	u32 cvg_x_alpha   = gRDPOtherMode.cvg_x_alpha;
+	u32 alpha_cvg_sel = gRDPOtherMode.alpha_cvg_sel;
+	u32 blendmode     = gRDPOtherMode.blender;
+
+	// NB: If we're running in 1cycle mode, ignore the 2nd cycle.
+	u32 active_mode = (cycle_type == CYCLE_2CYCLE) ? blendmode : (blendmode & 0xcccc);
+
+	ESoftBlendMode type = SOFT_BLEND_OPAQUE;
+
+	switch (active_mode)
+	{
+	case 0x0040: // In * AIn + Mem * 1-A
+	case 0x0050: // In * AIn + Mem * 1-A | In * AIn + Mem * 1-A
+	case 0x0440: // In * AFog + Mem * 1-A
+	case 0x04d0: // In * AFog + Fog * 1-A | In * AIn + Mem * 1-A
+	case 0x0150: // In * AIn + Mem * 1-A | In * AFog + Mem * 1-A
+	case 0x0c18: // In * 0 + In * 1 | In * AIn + Mem * 1-A
+	case 0x8410: // Bl * AFog + In * 1-A | In * AIn + Mem * 1-A
+	case 0xc410: // Fog * AFog + In * 1-A | In * AIn + Mem * 1-A
+	case 0xc440: // Fog * AFog + Mem * 1-A
+	case 0xc810: // Fog * AShade + In * 1-A | In * AIn + Mem * 1-A
+		type = SOFT_BLEND_ALPHA_TRANS;
+		break;
+	case 0x0c40: // In * 0 + Mem * 1-A
+	case 0x4c40: // Mem * 0 + Mem * 1-A
+		type = SOFT_BLEND_FADE;
+		break;
+	case 0x0c08: // In * 0 + In * 1
+	case 0x0f0a: // In * 0 + In * 1 | In * 0 + In * 1
+	case 0xc800: // Fog * AShade + In * 1-A
+		type = SOFT_BLEND_OPAQUE;
+		break;
+	default:
+		DL_PF( "		 Blend: SRCALPHA/INVSRCALPHA (default: 0x%04x)", active_mode );
+		break;
+	}
+
+	// NB: we only have alpha in the blender is alpha_cvg_sel is 0 or cvg_x_alpha is 1.
+	bool have_alpha = !alpha_cvg_sel || cvg_x_alpha;
+
+	if (type == SOFT_BLEND_ALPHA_TRANS && !have_alpha)
+		type = SOFT_BLEND_OPAQUE;
+
+	return type;
+}
+
+inline u32 MakeMask(u32 m)
+{
+	return m ? ((1<<m)-1) : 0xffffffff;
+}
+
+inline u32 MakeMirror(u32 mirror, u32 m)
+{
+	return (mirror && m) ? (1<<m) : 0;
+}
+
+void RendererSoft::MakeTileState(SSoftDrawState * state, u32 idx) const
+{
+	SSoftTile & tile = state->Tiles[idx];
+
+	CNativeTexture * texture = mBoundTexture[idx];
+	state->Textures[idx] = texture;
+	if (texture == NULL)
+	{
+		tile.Texels = NULL;
+		return;
+	}
+
+	u8 tile_idx = mActiveTile[idx];
+	const RDP_Tile &     rdp_tile  = gRDPStateManager.GetTile( tile_idx );
+	const RDP_TileSize & tile_size = gRDPStateManager.GetTileSize( tile_idx );
+
+	tile.Texels = texture->GetTexels();
+	tile.Width  = texture->GetCorrectedWidth();
+	tile.Height = texture->GetCorrectedHeight();
+	tile.Pitch  = texture->GetTexelPitch();
+
+	tile.TopLeft[0]     = mTileTopLeft[idx].s;
+	tile.TopLeft[1]     = mTileTopLeft[idx].t;
+	tile.BottomRight[0] = tile_size.right;
+	tile.BottomRight[1] = tile_size.bottom;
+
+	tile.ShiftScale[0]  = kShiftScales[rdp_tile.shift_s];
+	tile.ShiftScale[1]  = kShiftScales[rdp_tile.shift_t];
+	tile.Mask[0]        = MakeMask(rdp_tile.mask_s);
+	tile.Mask[1]        = MakeMask(rdp_tile.mask_t);
+	tile.Mirror[0]      = MakeMirror(rdp_tile.mirror_s, rdp_tile.mask_s);
+	tile.Mirror[1]      = MakeMirror(rdp_tile.mirror_t, rdp_tile.mask_t);
+	tile.Clamp[0]       = rdp_tile.clamp_s || (rdp_tile.mask_s == 0);
+	tile.Clamp[1]       = rdp_tile.clamp_t || (rdp_tile.mask_t == 0);
+
+	// If running the bilinear filter, check if we need to clamp in S or T.
+	// Really, this is checking to see how we set mTexWrap in PrepareTexRectUVs.
+	tile.WrapClamp[0]   = state->BilerpFilter && mTexWrap[idx].u == GU_CLAMP;
+	tile.WrapClamp[1]   = state->BilerpFilter && mTexWrap[idx].v == GU_CLAMP;
+}
+
+void RendererSoft::MakeDrawState(SSoftDrawState * state, bool disable_zbuffer) const
+{
+	MakeDrawState(state, gRDPOtherMode.cycle_type, disable_zbuffer);
+}
+
+void RendererSoft::MakeDrawState(SSoftDrawState * state, u32 cycle_type, bool disable_zbuffer) const
+{
+	DAEDALUS_PROFILE( "RendererSoft::MakeDrawState" );
+
+	state->Mux            = mMux;
+	state->CycleType      = cycle_type;
+	state->AlphaThreshold = 0;
+	state->PrimColour     = mPrimitiveColour;
+	state->EnvColour      = mEnvColour;
+	state->PrimLODFrac    = (u8)Clamp< s32 >( (s32)(mPrimLODFraction * 255.f), 0, 255 );
+
+	// Initiate Alpha test
+	if( (gRDPOtherMode.alpha_compare == G_AC_THRESHOLD) && !gRDPOtherMode.alpha_cvg_sel )
+	{
+		state->AlphaThreshold = mBlendColour.GetA();
+	}
+	else if (gRDPOtherMode.cvg_x_alpha)
+	{
+		// See RendererGL - going over 0x70 breaks OOT.
+		state->AlphaThreshold = 0x70;
+	}
+
+	// In fill/cycle modes, we ignore the mux.
+	if (cycle_type == CYCLE_FILL || cycle_type == CYCLE_COPY)
+		state->Mux = 0;
+
+	if (cycle_type == CYCLE_FILL)
+		state->AlphaThreshold = 0;
+
+	state->BilerpFilter = (gRDPOtherMode.text_filt != G_TF_POINT) || (gGlobalPreferences.ForceLinearFilter);
+
+	// Initiate Blender
+	if (cycle_type < CYCLE_COPY && gRDPOtherMode.force_bl)
+	{
+		state->BlendMode = GetBlendMode();
+	}
+	else
+	{
+		state->BlendMode = SOFT_BLEND_OPAQUE;
+	}
+
+	if ( disable_zbuffer )
+	{
+		state->DepthTest  = false;
+		state->DepthWrite = false;
+		state->DepthDecal = false;
+	}
+	else
+	{
+		// NB: as with RendererGL, writes are only possible with the depth test enabled.
+		state->DepthTest  = (mTnL.Flags.Zbuffer & gRDPOtherMode.z_cmp) | gRDPOtherMode.z_upd;
+		state->DepthWrite = state->DepthTest && gRDPOtherMode.z_upd;
+		state->DepthDecal = gRDPOtherMode.zmode == 3;
+	}
+
+	for (u32 i = 0; i < 4; ++i)
+	{
+		state->Scissor[i] = gScissor[i];
+	}
+
+	// Second texture is sampled in 2 cycle mode.
+	MakeTileState(state, 0);
+	if (cycle_type == CYCLE_2CYCLE)
+	{
+		MakeTileState(state, 1);
+	}
+	else
+	{
+		state->Tiles[1].Texels = NULL;
+	}
+}
+
+void RendererSoft::RestoreRenderStates()
+{
+	u32 width, height;
+	CGraphicsContext::Get()->GetScreenSize(&width, &height);
+
+	SoftRenderer_SetScissor(0, 0, width, height);
+}
+
+//*****************************************************************************
+// Clipping and projection
+//*****************************************************************************
+struct SClipVertex
+{
+	float	Pos[4];
+	float	S;
+	float	T;
+	float	Colour[4];
+};
+
+static void LerpClipVertex(const SClipVertex & a, const SClipVertex & b, float t, SClipVertex * out)
+{
+	for (u32 i = 0; i < 4; ++i)
+	{
+		out->Pos[i]    = a.Pos[i]    + (b.Pos[i]    - a.Pos[i])    * t;
+		out->Colour[i] = a.Colour[i] + (b.Colour[i] - a.Colour[i]) * t;
+	}
+	out->S = a.S + (b.S - a.S) * t;
+	out->T = a.T + (b.T - a.T) * t;
+}
+
+// Clip a polygon against dist(v) >= 0, where dist is z + w for the near plane, and w - z for the far plane.
+static u32 ClipPolygon(const SClipVertex * in, u32 num_in, float z_sign, SClipVertex * out)
+{
+	u32 num_out = 0;
+	for (u32 i = 0; i < num_in; ++i)
+	{
+		const SClipVertex & a = in[i];
+		const SClipVertex & b = in[(i + 1) % num_in];
+
+		float da = a.Pos[3] + z_sign * a.Pos[2];
+		float db = b.Pos[3] + z_sign * b.Pos[2];
+
+		if (da >= 0.f)
+		{
+			out[num_out++] = a;
+		}
+		if ((da >= 0.f) != (db >= 0.f))
+		{
+			LerpClipVertex(a, b, da / (da - db), &out[num_out++]);
+		}
+	}
+	return num_out;
+}
+
+static void ProjectClipVertex(const SClipVertex & in, SSoftVertex * out)
+{
+	float inv_w = 1.f / in.Pos[3];
+
+	out->X    = gViewport[0] + (in.Pos[0] * inv_w + 1.f) * 0.5f * gViewport[2];
+	out->Y    = gViewport[1] + (1.f - in.Pos[1] * inv_w) * 0.5f * gViewport[3];
+	out->Z    = in.Pos[2] * inv_w * 0.5f + 0.5f;
+	out->InvW = inv_w;
+	out->S    = in.S;
+	out->T    = in.T;
+	out->Colour = c32::Make( (u8)in.Colour[0], (u8)in.Colour[1], (u8)in.Colour[2], (u8)in.Colour[3] );
+}
+
+void RendererSoft::RenderTriangles( DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer )
+{
+	DAEDALUS_PROFILE( "RendererSoft::RenderTriangles" );
+
+	if (mTnL.Flags.Texture)
+	{
+		UpdateTileSnapshots( mTextureTile );
+
+		// FIXME: this should be applied in SetNewVertexInfo, and use TextureScaleX/Y to set the scale
+		if (mTnL.Flags.Light && mTnL.Flags.TexGen)
+		{
+			if (CNativeTexture * texture = mBoundTexture[0])
+			{
+				// See RendererGL - the tile t/l is needed for the Goldeneye Rareware logo.
+				float x = (float)mTileTopLeft[0].s / 4.f;
+				float y = (float)mTileTopLeft[0].t / 4.f;
+				float w = (float)texture->GetCorrectedWidth();
+				float h = (float)texture->GetCorrectedHeight();
+				for (u32 i = 0; i < num_vertices; ++i)
+				{
+					p_vertices[i].Texture.x = (p_vertices[i].Texture.x * w) + x;
+					p_vertices[i].Texture.y = (p_vertices[i].Texture.y * h) + y;
+				}
+			}
+		}
+	}
+
+	SSoftDrawState state;
+	MakeDrawState(&state, disable_zbuffer);
+
+	// Hack to fix the sun in Zelda OOT/MM
+	const f32 scale = ( g_ROM.ZELDA_HACK &&(gRDPOtherMode.L == 0x0c184241) ) ? 16.f : 32.f;
+
+	const float * m = gProjection.m;
+
+	// Worst case, every triangle is clipped into a pentagon - 3 triangles.
+	SSoftVertex * out = static_cast<SSoftVertex *>( malloc(sizeof(SSoftVertex) * num_vertices * 3) );
+	u32 num_out = 0;
+
+	for (u32 i = 0; i + 2 < num_vertices; i += 3)
+	{
+		SClipVertex poly[kMaxClipVertices];
+		for (u32 j = 0; j < 3; ++j)
+		{
+			const DaedalusVtx & vtx = p_vertices[i + j];
+			float x = vtx.Position.x;
+			float y = vtx.Position.y;
+			float z = vtx.Position.z;
+
+			SClipVertex & cv = poly[j];
+			cv.Pos[0] = m[0] * x + m[4] * y + m[ 8] * z + m[12];
+			cv.Pos[1] = m[1] * x + m[5] * y + m[ 9] * z + m[13];
+			cv.Pos[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+			cv.Pos[3] = m[3] * x + m[7] * y + m[11] * z + m[15];
+
+			// FIXME(strmnnrmn): maintain the texture coords in 10.5 format.
+			cv.S = (float)(int)(vtx.Texture.x * scale);
+			cv.T = (float)(int)(vtx.Texture.y * scale);
+
+			cv.Colour[0] = vtx.Colour.GetR();
+			cv.Colour[1] = vtx.Colour.GetG();
+			cv.Colour[2] = vtx.Colour.GetB();
+			cv.Colour[3] = vtx.Colour.GetA();
+		}
+
+		// Clip against the near and far planes. The rest are handled by the scissor.
+		SClipVertex near_clipped[kMaxClipVertices];
+		u32 num_poly = ClipPolygon(poly, 3, 1.f, near_clipped);
+		if (num_poly < 3)
+			continue;
+
+		num_poly = ClipPolygon(near_clipped, num_poly, -1.f, poly);
+		if (num_poly < 3)
+			continue;
+
+		SSoftVertex projected[kMaxClipVertices];
+		for (u32 j = 0; j < num_poly; ++j)
+		{
+			ProjectClipVertex(poly[j], &projected[j]);
+		}
+
+		for (u32 j = 1; j + 1 < num_poly; ++j)
+		{
+			out[num_out++] = projected[0];
+			out[num_out++] = projected[j];
+			out[num_out++] = projected[j + 1];
+		}
+	}
+
+	SoftRasterizer_DrawTriangles(state, out, num_out);
+	free(out);
+}
+
+// Vertices are in screen coordinates, in fan order.
+void RendererSoft::RenderScreenFan(const SSoftDrawState & state, const v2 (&xy)[4], const TexCoord (&uvs)[4], u32 colour, f32 depth)
+{
+	SSoftVertex verts[4];
+	for (u32 i = 0; i < 4; ++i)
+	{
+		verts[i].X      = xy[i].x;
+		verts[i].Y      = xy[i].y;
+		verts[i].Z      = depth * 0.5f + 0.5f;
+		verts[i].InvW   = 1.f;
+		verts[i].S      = uvs[i].s;
+		verts[i].T      = uvs[i].t;
+		verts[i].Colour = colour;
+	}
+
+	SSoftVertex tris[6] = { verts[0], verts[1], verts[2], verts[0], verts[2], verts[3] };
+	SoftRasterizer_DrawTriangles(state, tris, 6);
+}
+
+void RendererSoft::TexRect( u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1 )
+{
+	UpdateTileSnapshots( tile_idx );
+
+	// NB: we have to do this after UpdateTileSnapshot, as it set up mTileTopLeft etc.
+	PrepareTexRectUVs(&st0, &st1);
+
+	SSoftDrawState state;
+	MakeDrawState(&state, gRDPOtherMode.depth_source ? false : true);
+
+	v2 screen0;
+	v2 screen1;
+	ConvertN64ToScreen( xy0, screen0 );
+	ConvertN64ToScreen( xy1, screen1 );
+
+	DL_PF( "    Screen:  %.1f,%.1f -> %.1f,%.1f", screen0.x, screen0.y, screen1.x, screen1.y );
+	DL_PF( "    Texture: %.1f,%.1f -> %.1f,%.1f", st0.s / 32.f, st0.t / 32.f, st1.s / 32.f, st1.t / 32.f );
+
+	const f32 depth = gRDPOtherMode.depth_source ? mPrimDepth : 0.0f;
+
+	v2 positions[] = {
+		v2( screen0.x, screen0.y ),
+		v2( screen1.x, screen0.y ),
+		v2( screen1.x, screen1.y ),
+		v2( screen0.x, screen1.y ),
+	};
+
+	TexCoord uvs[] = {
+		TexCoord( st0.s, st0.t ),
+		TexCoord( st1.s, st0.t ),
+		TexCoord( st1.s, st1.t ),
+		TexCoord( st0.s, st1.t ),
+	};
+
+	RenderScreenFan(state, positions, uvs, 0xffffffff, depth);
+
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+	++mNumRect;
+#endif
+}
+
+void RendererSoft::TexRectFlip( u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1 )
+{
+	UpdateTileSnapshots( tile_idx );
+
+	// NB: we have to do this after UpdateTileSnapshot, as it set up mTileTopLeft etc.
+	PrepareTexRectUVs(&st0, &st1);
+
+	SSoftDrawState state;
+	MakeDrawState(&state, gRDPOtherMode.depth_source ? false : true);
+
+	v2 screen0;
+	v2 screen1;
+	ConvertN64ToScreen( xy0, screen0 );
+	ConvertN64ToScreen( xy1, screen1 );
+
+	DL_PF( "    Screen:  %.1f,%.1f -> %.1f,%.1f", screen0.x, screen0.y, screen1.x, screen1.y );
+	DL_PF( "    Texture: %.1f,%.1f -> %.1f,%.1f", st0.s / 32.f, st0.t / 32.f, st1.s / 32.f, st1.t / 32.f );
+
+	const f32 depth = gRDPOtherMode.depth_source ? mPrimDepth : 0.0f;
+
+	v2 positions[] = {
+		v2( screen0.x, screen0.y ),
+		v2( screen1.x, screen0.y ),
+		v2( screen1.x, screen1.y ),
+		v2( screen0.x, screen1.y ),
+	};
+
+	TexCoord uvs[] = {
+		TexCoord( st0.s, st0.t ),
+		TexCoord( st0.s, st1.t ),
+		TexCoord( st1.s, st1.t ),
+		TexCoord( st1.s, st0.t ),
+	};
+
+	RenderScreenFan(state, positions, uvs, 0xffffffff, depth);
+
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+	++mNumRect;
+#endif
+}
+
+void RendererSoft::FillRect( const v2 & xy0, const v2 & xy1, u32 color )
+{
+	SSoftDrawState state;
+	MakeDrawState(&state, gRDPOtherMode.depth_source ? false : true);
+
+	v2 screen0;
+	v2 screen1;
+	ConvertN64ToScreen( xy0, screen0 );
+	ConvertN64ToScreen( xy1, screen1 );
+
+	DL_PF( "    Screen:  %.1f,%.1f -> %.1f,%.1f", screen0.x, screen0.y, screen1.x, screen1.y );
+
+	const f32 depth = gRDPOtherMode.depth_source ? mPrimDepth : 0.0f;
+
+	v2 positions[] = {
+		v2( screen0.x, screen0.y ),
+		v2( screen1.x, screen0.y ),
+		v2( screen1.x, screen1.y ),
+		v2( screen0.x, screen1.y ),
+	};
+
+	// NB - these aren't needed.
+	TexCoord uvs[] = {
+		TexCoord( 0.f, 0.f ),
+		TexCoord( 1.f, 0.f ),
+		TexCoord( 1.f, 1.f ),
+		TexCoord( 0.f, 1.f ),
+	};
+
+	RenderScreenFan(state, positions, uvs, color, depth);
+
+#ifdef DAEDALUS_DEBUG_DISPLAYLIST
+	++mNumRect;
+#endif
+}
+
+// Set up tile 0 to copy texels straight out of texture, clamping at the edges.
+static void MakeDirectTileState(SSoftDrawState * state, const CNativeTexture * texture)
+{
+	SSoftTile & tile = state->Tiles[0];
+
+	state->Textures[0] = const_cast<CNativeTexture *>( texture );
+	state->Tiles[1].Texels = NULL;
+	if (texture == NULL)
+	{
+		tile.Texels = NULL;
+		return;
+	}
+
+	tile.Texels = texture->GetTexels();
+	tile.Width  = texture->GetCorrectedWidth();
+	tile.Height = texture->GetCorrectedHeight();
+	tile.Pitch  = texture->GetTexelPitch();
+
+	for (u32 i = 0; i < 2; ++i)
+	{
+		tile.TopLeft[i]     = 0;
+		tile.BottomRight[i] = ((i == 0 ? texture->GetWidth() : texture->GetHeight()) - 1) << 2;
+		tile.ShiftScale[i]  = 1.f;
+		tile.Mask[i]        = 0xffffffff;
+		tile.Mirror[i]      = 0;
+		tile.Clamp[i]       = true;
+		tile.WrapClamp[i]   = true;
+	}
+}
+
+void RendererSoft::Draw2DTexture(f32 x0, f32 y0, f32 x1, f32 y1,
+								 f32 u0, f32 v0, f32 u1, f32 v1,
+								 const CNativeTexture * texture)
+{
+	DAEDALUS_PROFILE( "RendererSoft::Draw2DTexture" );
+
+	// S2DEX copies the texture straight to the screen, whatever the other mode says.
+	// The positions are N64 screen coordinates with fractional bits, so unlike TexRect they aren't rounded.
+	SSoftDrawState state;
+	MakeDrawState(&state, CYCLE_COPY, true /* disable_zbuffer */);
+	MakeDirectTileState(&state, texture);
+	state.BlendMode = SOFT_BLEND_ALPHA_TRANS;
+
+	float sx0 = N64ToScreenX(x0);
+	float sy0 = N64ToScreenY(y0);
+
+	float sx1 = N64ToScreenX(x1);
+	float sy1 = N64ToScreenY(y1);
+
+	v2 positions[] = {
+		v2( sx0, sy0 ),
+		v2( sx1, sy0 ),
+		v2( sx1, sy1 ),
+		v2( sx0, sy1 ),
+	};
+
+	TexCoord uvs[] = {
+		TexCoord( u0, v0 ),
+		TexCoord( u1, v0 ),
+		TexCoord( u1, v1 ),
+		TexCoord( u0, v1 ),
+	};
+
+	RenderScreenFan(state, positions, uvs, 0xffffffff, 0.0f);
+}
+
+void RendererSoft::Draw2DTextureR(f32 x0, f32 y0,
+								  f32 x1, f32 y1,
+								  f32 x2, f32 y2,
+								  f32 x3, f32 y3,
+								  f32 s, f32 t)	// With Rotation
+{
+	DAEDALUS_PROFILE( "RendererSoft::Draw2DTextureR" );
+
+	// As Draw2DTexture, with the corners already rotated in N64 screen coordinates.
+	SSoftDrawState state;
+	MakeDrawState(&state, CYCLE_COPY, true /* disable_zbuffer */);
+	MakeDirectTileState(&state, mBoundTexture[0]);
+	state.BlendMode = SOFT_BLEND_ALPHA_TRANS;
+
+	v2 positions[] = {
+		v2( N64ToScreenX(x0), N64ToScreenY(y0) ),
+		v2( N64ToScreenX(x1), N64ToScreenY(y1) ),
+		v2( N64ToScreenX(x2), N64ToScreenY(y2) ),
+		v2( N64ToScreenX(x3), N64ToScreenY(y3) ),
+	};
+
+	TexCoord uvs[] = {
+		TexCoord( 0.f, 0.f ),
+		TexCoord(   s, 0.f ),
+		TexCoord(   s,   t ),
+		TexCoord( 0.f,   t ),
+	};
+
+	RenderScreenFan(state, positions, uvs, 0xffffffff, 0.0f);
+}
+
+bool CreateRenderer()
+{
+	DAEDALUS_ASSERT_Q(gRenderer == NULL);
+
+	// The rasterizer applies mirroring itself, as the GL shaders do.
+	gRDPStateManager.SetEmulateMirror(false);
+
+	gRendererSoft = new RendererSoft();
+	gRenderer     = gRendererSoft;
+	return true;
+}
+void DestroyRenderer()
+{
+	SoftRasterizer_Flush();
+
+	delete gRendererSoft;
+	gRendererSoft = NULL;
+	gRenderer     = NULL;
+}
@@ -0,0 +1,57 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef SYSSOFT_HLEGRAPHICS_RENDERERSOFT_H_
+#define SYSSOFT_HLEGRAPHICS_RENDERERSOFT_H_
+
+#include "HLEGraphics/BaseRenderer.h"
+
+struct SSoftDrawState;
+struct SSoftVertex;
+
+class RendererSoft : public BaseRenderer
+{
+public:
+	virtual void		RestoreRenderStates();
+
+	virtual void		RenderTriangles(DaedalusVtx * p_vertices, u32 num_vertices, bool disable_zbuffer);
+
+	virtual void		TexRect(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
+	virtual void		TexRectFlip(u32 tile_idx, const v2 & xy0, const v2 & xy1, TexCoord st0, TexCoord st1);
+	virtual void		FillRect(const v2 & xy0, const v2 & xy1, u32 color);
+
+	virtual void		Draw2DTexture(f32 x0, f32 y0, f32 x1, f32 y1,
+									  f32 u0, f32 v0, f32 u1, f32 v1, const CNativeTexture * texture);
+	virtual void		Draw2DTextureR(f32 x0, f32 y0, f32 x1, f32 y1,
+									   f32 x2, f32 y2, f32 x3, f32 y3,
+									   f32 s, f32 t);
+
+private:
+	void				MakeDrawState(SSoftDrawState * state, bool disable_zbuffer) const;
+	void				MakeDrawState(SSoftDrawState * state, u32 cycle_type, bool disable_zbuffer) const;
+	void				MakeTileState(SSoftDrawState * state, u32 idx) const;
+
+	void				RenderScreenFan(const SSoftDrawState & state, const v2 (&xy)[4], const TexCoord (&uvs)[4], u32 colour, f32 depth);
+};
+
+// NB: this is equivalent to gRenderer, but points to the implementation class, for platform-specific functionality.
+extern RendererSoft * gRendererSoft;
+
+#endif // SYSSOFT_HLEGRAPHICS_RENDERERSOFT_H_
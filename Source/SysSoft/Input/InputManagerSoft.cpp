@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "Input/InputManager.h"
+
+// The software renderer has no window to read input from, so the pads are always neutral.
+class IInputManager : public CInputManager
+{
+public:
+	IInputManager();
+	virtual ~IInputManager();
+
+	virtual bool				Initialise()	{ return true; }
+	virtual void				Finalise()		{}
+
+	virtual void				GetState( OSContPad pPad[4] );
+
+	virtual u32					GetNumConfigurations() const;
+	virtual const char *		GetConfigurationName( u32 configuration_idx ) const;
+	virtual const char *		GetConfigurationDescription( u32 configuration_idx ) const;
+	virtual void				SetConfiguration( u32 configuration_idx );
+	virtual u32					GetConfigurationFromName( const char * name ) const;
+};
+
+IInputManager::IInputManager()
+{
+}
+
+IInputManager::~IInputManager()
+{
+}
+
+void IInputManager::GetState( OSContPad pPad[4] )
+{
+	for(u32 cont = 0; cont < 4; cont++)
+	{
+		pPad[cont].button = 0;
+		pPad[cont].stick_x = 0;
+		pPad[cont].stick_y = 0;
+	}
+}
+
+template<> bool	CSingleton< CInputManager >::Create()
+{
+	DAEDALUS_ASSERT_Q(mpInstance == NULL);
+
+	IInputManager * manager = new IInputManager();
+
+	if(manager->Initialise())
+	{
+		mpInstance = manager;
+		return true;
+	}
+
+	delete manager;
+	return false;
+}
+
+u32	 IInputManager::GetNumConfigurations() const
+{
+	return 0;
+}
+
+const char * IInputManager::GetConfigurationName( u32 configuration_idx ) const
+{
+	DAEDALUS_ERROR( "Invalid controller config" );
+	return "?";
+}
+
+const char * IInputManager::GetConfigurationDescription( u32 configuration_idx ) const
+{
+	DAEDALUS_ERROR( "Invalid controller config" );
+	return "?";
+}
+
+void IInputManager::SetConfiguration( u32 configuration_idx )
+{
+	DAEDALUS_ERROR( "Invalid controller config" );
+}
+
+u32		IInputManager::GetConfigurationFromName( const char * name ) const
+{
+	// Return the default controller config
+	return 0;
+}
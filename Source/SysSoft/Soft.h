@@ -0,0 +1,53 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#ifndef SYSSOFT_SOFT_H_
+#define SYSSOFT_SOFT_H_
+
+#include "Utility/DaedalusTypes.h"
+
+// Stand-ins for the bits of the PSP GU API that BaseRenderer talks to.
+// These are implemented by RendererSoft.
+
+void sceGuFog(float mn, float mx, u32 col);
+
+enum EGuTextureWrapMode
+{
+	GU_CLAMP			= 0,
+	GU_REPEAT			= 1,
+};
+
+enum EGuMatrixType
+{
+	GU_PROJECTION		= 0,
+};
+
+struct ScePspFMatrix4
+{
+	float m[16];
+};
+
+void sceGuSetMatrix(EGuMatrixType type, const ScePspFMatrix4 * mtx);
+
+// Both of these are in framebuffer pixels, with the origin at the top left.
+void SoftRenderer_SetViewport(s32 x, s32 y, s32 w, s32 h);
+void SoftRenderer_SetScissor(s32 left, s32 top, s32 right, s32 bottom);
+
+#endif // SYSSOFT_SOFT_H_
@@ -0,0 +1,25 @@
+ {
+    'includes': [
+      '../common.gypi',
+    ],
+    'targets': [
+      {
+        'target_name': 'SysSoft',
+        'type': 'static_library',
+        'include_dirs': [
+          '../',
+        ],
+        'dependencies': [
+          '../third_party/libpng/libpng.gyp:libpng',
+        ],
+        'sources': [
+          'Graphics/GraphicsContextSoft.cpp',
+          'Graphics/NativeTextureSoft.cpp',
+          'Graphics/SoftRasterizer.cpp',
+          'HLEGraphics/GraphicsPluginSoft.cpp',
+          'HLEGraphics/RendererSoft.cpp',
+          'Input/InputManagerSoft.cpp',
+        ],
+      },
+    ],
+  }
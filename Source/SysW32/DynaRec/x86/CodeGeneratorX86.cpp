@@ -658,6 +658,31 @@ CJumpLocation CCodeGeneratorX86::ExecuteNativeFunction( CCodeLabel speed_hack, b
 	}
 }
 
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeGeneratorX86::GenerateNativeCall( CCodeLabel function )
+{
+	// Every op is flushed back to gCPUState as it's generated, so there's nothing cached to preserve
+	CALL( function );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeGeneratorX86::GenerateInlineNativeCall( CCodeLabel function, u32 return_address, CJumpLocation * p_eret_jump, CJumpLocation * p_exit_jump )
+{
+	*p_eret_jump = ExecuteNativeFunction( function, true );
+
+	// Stay on trace only if TargetPC == return_address and StuffToDo == 0
+	MOV_REG_MEM( EAX_CODE, &gCPUState.TargetPC );
+	XOR_I32( EAX_CODE, return_address );
+	MOV_REG_MEM( ECX_CODE, const_cast< const u32 * >( &gCPUState.StuffToDo ) );
+	OR( EAX_CODE, ECX_CODE );
+
+	*p_exit_jump = JNELong( CCodeLabel(NULL) );
+}
+
 
 void	CCodeGeneratorX86::GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op )
 {
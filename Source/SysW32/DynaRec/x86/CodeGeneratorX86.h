@@ -58,6 +58,8 @@ class CCodeGeneratorX86 : public CCodeGenerator, public CAssemblyWriterX86
 		virtual CJumpLocation		GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump);
 
 		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return );
+		virtual void				GenerateNativeCall( CCodeLabel function );
+		virtual void				GenerateInlineNativeCall( CCodeLabel function, u32 return_address, CJumpLocation * p_eret_jump, CJumpLocation * p_exit_jump );
 
 	private:
 				void				SetVar( u32 * p_var, u32 value );
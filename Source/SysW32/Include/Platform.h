@@ -39,7 +39,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #undef DAEDALUS_BREAKPOINTS_ENABLED
 #define DAEDALUS_ENABLE_OS_HOOKS
 #define DAEDALUS_COMPRESSED_ROM_SUPPORT
+#define DAEDALUS_ENABLE_REWIND
+#ifndef DAEDALUS_SOFTWARE_RENDERER
 #define DAEDALUS_GL
+#endif
 #define DAEDALUS_ACCURATE_TMEM
 
 #define DAEDALUS_ENDIAN_MODE DAEDALUS_ENDIAN_LITTLE
@@ -53,6 +56,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // Thread functions need to be __stdcall to work with the W32 api
 #define DAEDALUS_THREAD_CALL_TYPE			__stdcall
 
+// Thread-local variables
+#define DAEDALUS_THREAD_LOCAL				__declspec(thread)
+
 // Vararg functions need to be __cdecl
 #define DAEDALUS_VARARG_CALL_TYPE			__cdecl
 
@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <Shlwapi.h>
 #include <io.h>
+#include <sys/stat.h>
 
 
 namespace IO
@@ -42,6 +43,47 @@ namespace IO
 		{
 			return ::PathFileExists( p_path ) ? true : false;
 		}
+
+		bool	GetInfo( const char * p_file, u32 * p_size, u64 * p_mtime )
+		{
+			struct _stat64	s;
+			if( ::_stat64( p_file, &s ) != 0 )
+				return false;
+
+			*p_size  = u32( s.st_size );
+			*p_mtime = u64( s.st_mtime );
+			return true;
+		}
+
+		void *	Map( const char * p_file, u32 * p_size )
+		{
+			HANDLE file( ::CreateFile( p_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL ) );
+			if( file == INVALID_HANDLE_VALUE )
+				return NULL;
+
+			void *	p_data( NULL );
+			DWORD	size( ::GetFileSize( file, NULL ) );
+			HANDLE	mapping( ::CreateFileMapping( file, NULL, PAGE_WRITECOPY, 0, 0, NULL ) );
+			if( mapping != NULL )
+			{
+				p_data = ::MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+				if( p_data != NULL )
+				{
+					*p_size = size;
+				}
+
+				// The view keeps its own reference to the mapping
+				::CloseHandle( mapping );
+			}
+
+			::CloseHandle( file );
+			return p_data;
+		}
+
+		void	Unmap( void * p_data, u32 size )
+		{
+			::UnmapViewOfFile( p_data );
+		}
 	}
 	namespace Directory
 	{
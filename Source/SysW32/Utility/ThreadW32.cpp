@@ -19,6 +19,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "stdafx.h"
 #include "Utility/Thread.h"
+#include "Utility/Profiler.h"
 
 static const int	gThreadPriorities[ TP_NUM_PRIORITIES ] =
 {
@@ -49,6 +50,10 @@ static DWORD WINAPI StartThreadFunc( LPVOID arg )
 
 	DWORD result = thread_details->ThreadFunction( thread_details->Argument );
 
+#ifdef DAEDALUS_ENABLE_PROFILING
+	CProfiler::ThreadExit();
+#endif
+
 	delete thread_details;
 
 	return result;
@@ -21,20 +21,27 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Core/Memory.h"
 #include "Core/CPU.h"
+#include "Core/GuestProfiler.h"
 #include "Core/Save.h"
 #include "Core/PIF.h"
+#include "Core/Rewind.h"
 #include "Core/ROMBuffer.h"
 #include "Core/RomSettings.h"
 
+#include "DynaRec/DynaRecProfile.h"
+
 #include "Interface/RomDB.h"
 #ifdef DAEDALUS_PSP
 #include "Graphics/VideoMemoryManager.h"
 #endif
 
 #include "Graphics/GraphicsContext.h"
+#include "HLEGraphics/TexelCache.h"
+#include "HLEGraphics/TexturePack.h"
 
 #if defined(DAEDALUS_OSX) || defined(DAEDALUS_W32)
 #include "SysOSX/Debug/WebDebug.h"
+#include "HLEGraphics/DLStatsWebDebug.h"
 #include "HLEGraphics/TextureCacheWebDebug.h"
 #include "HLEGraphics/DisplayListDebugger.h"
 #endif
@@ -52,6 +59,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Utility/Translate.h"
 #endif
 #include "Input/InputManager.h"		// CInputManager::Create/Destroy
+#include "Input/InputMovie.h"
 
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
@@ -65,6 +73,10 @@ CAudioPlugin	* gAudioPlugin		= NULL;
 static bool InitAudioPlugin()
 {
 	DAEDALUS_ASSERT( gAudioPlugin == NULL, "Why is there already an audio plugin?" );
+
+	// Headless runs have no audio output. RSP_HLE processes the alists itself.
+	if( gHeadlessMode )
+		return true;
 	CAudioPlugin * audio_plugin = CreateAudioPlugin();
 	if( audio_plugin != NULL )
 	{
@@ -181,6 +193,7 @@ static const SysEntityEntry gSysInitTable[] =
 	{"WebDebug",			WebDebug_Init, 				WebDebug_Fini},
 	{"TextureCacheWebDebug",TextureCache_RegisterWebDebug, 	NULL},
 	{"DLDebuggerWebDebug",	DLDebugger_RegisterWebDebug, 	NULL},
+	{"DLStatsWebDebug",		DLStats_RegisterWebDebug, 		NULL},
 #endif
 #endif
 
@@ -203,13 +216,25 @@ static const RomEntityEntry gRomInitTable[] =
 	{"InputManager",		CInputManager::Init,	CInputManager::Fini},
 	{"Memory",				Memory_Reset,			Memory_Cleanup},
 	{"Audio",				InitAudioPlugin,		DisposeAudioPlugin},
+#ifdef DAEDALUS_TEXEL_CACHE
+	{"TexelCache",			TexelCache_RomOpen,		TexelCache_RomClose},
+#endif
+#ifdef DAEDALUS_TEXTURE_PACKS
+	{"TexturePack",			TexturePack_RomOpen,	TexturePack_RomClose},
+#endif
 	{"Graphics",			InitGraphicsPlugin,		DisposeGraphicsPlugin},
 	{"FramerateLimiter",	FramerateLimiter_Reset,	NULL},
 	//{"RSP", RSP_Reset, NULL},
 	{"CPU",					CPU_RomOpen,			CPU_RomClose},
 	{"ROM",					ROM_ReBoot,				ROM_Unload},
+	{"DynarecProfile",		DynarecProfile::RomOpen,	DynarecProfile::RomClose},
+	{"GuestProfiler",		GuestProfiler_RomOpen,	GuestProfiler_RomClose},
 	{"Controller",			CController::Reset,		CController::RomClose},
+	{"InputMovie",			InputMovie_RomOpen,		InputMovie_RomClose},
 	{"Save",				Save_Reset,				Save_Fini},
+#ifdef DAEDALUS_ENABLE_REWIND
+	{"Rewind",				Rewind_RomOpen,			Rewind_RomClose},
+#endif
 #ifdef DAEDALUS_ENABLE_SYNCHRONISATION
 	{"CSynchroniser",		CSynchroniser::InitialiseSynchroniser, CSynchroniser::Destroy},
 #endif
@@ -28,15 +28,29 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <string>
 #include <algorithm>
 
+#ifdef DAEDALUS_BATCH_TEST_WORKERS
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef DAEDALUS_OSX
+#include <mach-o/dyld.h>
+#endif
+#endif
+
 #include "Config/ConfigOptions.h"
 #include "Core/CPU.h"
 #include "Core/ROM.h"
 #include "Debug/Dump.h"
 #include "HLEGraphics/DLParser.h"
+#include "Input/InputMovie.h"
+#include "Math/MathUtil.h"
+#include "System/Paths.h"
 #include "System/System.h"
 #include "Utility/Hash.h"
 #include "Utility/IO.h"
 #include "Utility/ROMFile.h"
+#include "Utility/Thread.h"
 #include "Utility/Timer.h"
 #include "Utility/Timing.h"
 
@@ -117,7 +131,7 @@ static void SprintRunDirectory( IO::Filename & rundir, const char * batchdir, u3
 	IO::Path::Combine(rundir, batchdir, filename);
 }
 
-static bool MakeRunDirectory( IO::Filename & rundir, const char * batchdir )
+static bool MakeRunDirectory( IO::Filename & rundir, const char * batchdir, s32 * p_run_id )
 {
 	// Find an unused directory
 	for( u32 run_id = 0; run_id < 100; ++run_id )
@@ -126,13 +140,307 @@ static bool MakeRunDirectory( IO::Filename & rundir, const char * batchdir )
 
 		// Skip if it already exists as a file or directory
 		if( IO::Directory::Create( rundir ) )
+		{
+			*p_run_id = run_id;
 			return true;
+		}
 	}
 
 	return false;
 }
 
-void BatchTestMain( int argc, char* argv[] )
+// Configurable from the command line.
+static u32 gMaxDLs = 10;
+static u32 gMaxVblsWithoutDL = 1000;
+static f32 gBatchTimeLimit = 60.0f;
+
+// Make a filename of the form: '<rundir>/<romfilename><extension>'
+static void MakeRomLogFilename( IO::Filename & filepath, const char * rundir, const char * rom, const char * extension )
+{
+	IO::Path::Combine( filepath, rundir, IO::Path::FindFileName( rom ) );
+	IO::Path::SetExtension( filepath, extension );
+}
+
+static CBatchTestEventHandler::ETerminationReason ProcessRom( const char * rom, const char * rundir, bool result_exists, CTimer & timer )
+{
+	fprintf( gBatchFH, "\n\n%#.3f: Processing: %s\n", timer.GetElapsedSecondsSinceReset(), rom );
+
+	IO::Filename rom_logpath;
+	MakeRomLogFilename( rom_logpath, rundir, rom, ".txt" );
+
+	// Each rom gets its own temp file so that worker processes don't collide.
+	IO::Filename tmpfilepath;
+	MakeRomLogFilename( tmpfilepath, rundir, rom, ".tmp" );
+
+	gRomLogFH = fopen( tmpfilepath, "w" );
+	if( !gRomLogFH )
+	{
+		fprintf( gBatchFH, "#%.3f: Unable to open temp file\n", timer.GetElapsedSecondsSinceReset() );
+		return CBatchTestEventHandler::TR_UNKNOWN;
+	}
+
+	fflush( gBatchFH );
+
+	gBatchTestEventHandler->Reset();
+
+	// TODO: use ROM_GetRomDetailsByFilename and the alternative form of ROM_LoadFile with overridden preferences (allows us to test if roms break by changing prefs)
+	System_Open( rom );
+
+	CPU_Run();
+
+	System_Close();
+
+	CBatchTestEventHandler::ETerminationReason termination_reason( gBatchTestEventHandler->GetTerminationReason() );
+	const char * reason( CBatchTestEventHandler::GetTerminationReasonString( termination_reason ) );
+
+	fprintf( gBatchFH, "%#.3f: Finished running: %s - %s\n", timer.GetElapsedSecondsSinceReset(), rom, reason );
+
+	// Copy temp file over rom_logpath
+	gBatchTestEventHandler->PrintSummary( gRomLogFH );
+	fclose( gRomLogFH );
+	gRomLogFH = NULL;
+	if( result_exists )
+	{
+		IO::File::Delete( rom_logpath );
+	}
+	if( !IO::File::Move( tmpfilepath, rom_logpath ) )
+	{
+		fprintf( gBatchFH, "%#.3f: Coping %s -> %s failed\n", timer.GetElapsedSecondsSinceReset(), tmpfilepath, rom_logpath );
+	}
+
+	return termination_reason;
+}
+
+// Worker processes report how they terminated through their exit code.
+static int TerminationReasonToExitCode( CBatchTestEventHandler::ETerminationReason reason )
+{
+	switch( reason )
+	{
+	case CBatchTestEventHandler::TR_REACHED_DL_COUNT:			return 0;
+	case CBatchTestEventHandler::TR_INPUT_MOVIE_FINISHED:		return 1;
+	case CBatchTestEventHandler::TR_TIME_LIMIT_REACHED:			return 2;
+	case CBatchTestEventHandler::TR_TOO_MANY_VBLS_WITH_NO_DL:	return 3;
+	case CBatchTestEventHandler::TR_UNKNOWN:					return 4;
+	}
+	return 4;
+}
+
+// Workers leave their frame timings in a file next to their log for the driver to collect.
+static void WriteWorkerTimings( const char * rundir, const char * rom )
+{
+	CBatchTestEventHandler::SFrameTimeStats stats;
+	if( !gBatchTestEventHandler->GetFrameTimeStats( &stats ) )
+		return;
+
+	IO::Filename timingspath;
+	MakeRomLogFilename( timingspath, rundir, rom, ".timings" );
+	if( FILE * fh = fopen( timingspath, "w" ) )
+	{
+		fprintf( fh, "%d,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+			stats.NumFrames, stats.MeanMs, stats.MinMs, stats.MedianMs, stats.P95Ms, stats.MaxMs );
+		fclose( fh );
+	}
+}
+
+#ifdef DAEDALUS_BATCH_TEST_WORKERS
+
+static const char * kTimingsColumns = "frames,mean_ms,min_ms,median_ms,p95_ms,max_ms";
+static const char * kNoTimings = ",,,,,";
+
+static const char * ExitCodeToResultString( int exit_code )
+{
+	switch( exit_code )
+	{
+	case 0:		return CBatchTestEventHandler::GetTerminationReasonString( CBatchTestEventHandler::TR_REACHED_DL_COUNT );
+	case 1:		return CBatchTestEventHandler::GetTerminationReasonString( CBatchTestEventHandler::TR_INPUT_MOVIE_FINISHED );
+	case 2:		return CBatchTestEventHandler::GetTerminationReasonString( CBatchTestEventHandler::TR_TIME_LIMIT_REACHED );
+	case 3:		return CBatchTestEventHandler::GetTerminationReasonString( CBatchTestEventHandler::TR_TOO_MANY_VBLS_WITH_NO_DL );
+	}
+	return CBatchTestEventHandler::GetTerminationReasonString( CBatchTestEventHandler::TR_UNKNOWN );
+}
+
+// execv doesn't search PATH, so argv[0] can't be relied on to find ourselves.
+static bool GetExecutablePath( IO::Filename & exe, const char * argv0 )
+{
+#if defined( DAEDALUS_LINUX )
+	ssize_t len( readlink( "/proc/self/exe", exe, sizeof( IO::Filename ) - 1 ) );
+	if( len > 0 )
+	{
+		exe[ len ] = '\0';
+		return true;
+	}
+#elif defined( DAEDALUS_OSX )
+	uint32_t size( sizeof( IO::Filename ) );
+	if( _NSGetExecutablePath( exe, &size ) == 0 )
+		return true;
+#endif
+	IO::Path::Combine( exe, gDaedalusExePath, IO::Path::FindFileName( argv0 ) );
+	return IO::File::Exists( exe );
+}
+
+// Quote a CSV field, doubling any quotes in it.
+static void WriteCSVString( FILE * fh, const char * str )
+{
+	fputc( '"', fh );
+	for( const char * p = str; *p; ++p )
+	{
+		if( *p == '"' )
+			fputc( '"', fh );
+		fputc( *p, fh );
+	}
+	fputc( '"', fh );
+}
+
+static void WriteSummaryRow( FILE * fh, const char * rom, const char * result, int exit_status, f32 seconds, const char * timings )
+{
+	WriteCSVString( fh, rom );
+	fputc( ',', fh );
+	WriteCSVString( fh, result );
+	fprintf( fh, ",%d,%.3f,%s\n", exit_status, seconds, timings );
+}
+
+// Returns the worker's timings as CSV fields, or empty fields if it didn't leave any.
+static std::string ReadWorkerTimings( const char * rundir, const char * rom )
+{
+	IO::Filename timingspath;
+	MakeRomLogFilename( timingspath, rundir, rom, ".timings" );
+
+	std::string	timings( kNoTimings );
+	if( FILE * fh = fopen( timingspath, "r" ) )
+	{
+		char line[ 256 ];
+		if( fgets( line, sizeof( line ), fh ) )
+		{
+			timings = line;
+			timings.erase( timings.find_last_not_of( "\r\n" ) + 1 );
+		}
+		fclose( fh );
+		IO::File::Delete( timingspath );
+	}
+	return timings;
+}
+
+struct SBatchWorker
+{
+	pid_t			Pid;
+	std::string		Rom;
+	f32				StartTime;
+	bool			Killed;
+};
+
+//
+//	Run each rom in its own process, so that crashes and hangs only take out
+//	that rom. Workers which overrun the time limit are killed, unless they're
+//	replaying a movie, which runs to completion.
+//
+static void RunWorkers( const char * exe, std::vector< std::string > & roms, const std::vector< std::string > & worker_args,
+						u32 num_jobs, bool time_limited, const char * rundir, FILE * summary_fh, CTimer & timer )
+{
+	// Give workers some slack over the limit they enforce themselves, to allow for startup.
+	const f32	kill_time( gBatchTimeLimit + 30.0f );
+
+	std::vector< SBatchWorker >	workers;
+
+	fprintf( summary_fh, "rom,result,exit_status,seconds,%s\n", kTimingsColumns );
+
+	while( !roms.empty() || !workers.empty() )
+	{
+		while( workers.size() < num_jobs && !roms.empty() )
+		{
+			SBatchWorker	worker;
+			worker.Rom = roms.back();
+			worker.StartTime = timer.GetElapsedSecondsSinceReset();
+			worker.Killed = false;
+			roms.pop_back();
+
+			std::vector< char * >	args;
+			args.push_back( const_cast< char * >( exe ) );
+			args.push_back( const_cast< char * >( "--batch" ) );
+			for( u32 i = 0; i < worker_args.size(); ++i )
+			{
+				args.push_back( const_cast< char * >( worker_args[i].c_str() ) );
+			}
+			args.push_back( const_cast< char * >( "-worker" ) );
+			args.push_back( const_cast< char * >( worker.Rom.c_str() ) );
+			args.push_back( NULL );
+
+			worker.Pid = fork();
+			if( worker.Pid == 0 )
+			{
+				execv( exe, &args[0] );
+				_exit( 127 );
+			}
+
+			if( worker.Pid < 0 )
+			{
+				fprintf( gBatchFH, "%#.3f: Couldn't start worker for %s\n", timer.GetElapsedSecondsSinceReset(), worker.Rom.c_str() );
+				WriteSummaryRow( summary_fh, worker.Rom.c_str(), "Couldn't start worker", -1, 0.0f, kNoTimings );
+				continue;
+			}
+
+			fprintf( gBatchFH, "%#.3f: Started worker %d: %s\n", timer.GetElapsedSecondsSinceReset(), worker.Pid, worker.Rom.c_str() );
+			workers.push_back( worker );
+		}
+		fflush( gBatchFH );
+
+		int		status;
+		pid_t	pid( waitpid( -1, &status, WNOHANG ) );
+		if( pid > 0 )
+		{
+			for( u32 i = 0; i < workers.size(); ++i )
+			{
+				SBatchWorker & worker( workers[i] );
+				if( worker.Pid != pid )
+					continue;
+
+				const f32		elapsed( timer.GetElapsedSecondsSinceReset() - worker.StartTime );
+				const char *	result;
+				int				exit_status;
+				if( worker.Killed )
+				{
+					result = "Killed after timeout";
+					exit_status = -1;
+				}
+				else if( WIFSIGNALED( status ) )
+				{
+					result = "Crashed";
+					exit_status = -WTERMSIG( status );
+				}
+				else
+				{
+					exit_status = WEXITSTATUS( status );
+					result = ExitCodeToResultString( exit_status );
+				}
+
+				fprintf( gBatchFH, "%#.3f: Finished running: %s - %s\n", timer.GetElapsedSecondsSinceReset(), worker.Rom.c_str(), result );
+				std::string		timings( ReadWorkerTimings( rundir, worker.Rom.c_str() ) );
+				WriteSummaryRow( summary_fh, worker.Rom.c_str(), result, exit_status, elapsed, timings.c_str() );
+				fflush( summary_fh );
+
+				workers.erase( workers.begin() + i );
+				break;
+			}
+		}
+		else
+		{
+			const f32	now( timer.GetElapsedSecondsSinceReset() );
+			for( u32 i = 0; i < workers.size(); ++i )
+			{
+				SBatchWorker & worker( workers[i] );
+				if( time_limited && !worker.Killed && now - worker.StartTime > kill_time )
+				{
+					kill( worker.Pid, SIGKILL );
+					worker.Killed = true;
+				}
+			}
+			ThreadSleepMs( 50 );
+		}
+	}
+}
+
+#endif // DAEDALUS_BATCH_TEST_WORKERS
+
+int BatchTestMain( int argc, char* argv[] )
 {
 	// TODO: Allow other directories and configuration
 #ifdef DAEDALUS_PSP
@@ -144,6 +452,12 @@ void BatchTestMain( int argc, char* argv[] )
 	bool	random_order( false );		// Whether to randomise the order of processing, to help avoid hangs
 	bool	update_results( false );	// Whether to update existing results
 	s32		run_id( -1 );				// New run by default
+	const char * movie( NULL );			// Input movie to replay, for comparing frame times between builds
+	u32		num_jobs( 1 );				// Number of worker processes to run roms in
+	const char * worker_rom( NULL );	// Set when we're a worker process, running a single rom
+
+	// Options which are passed on to worker processes.
+	std::vector< std::string >	worker_args;
 
 	for(int i = 1; i < argc; ++i )
 	{
@@ -158,13 +472,57 @@ void BatchTestMain( int argc, char* argv[] )
 			else if( strcmp( arg, "u" ) == 0 || strcmp( arg, "update" ) == 0 )
 			{
 				update_results = true;
+				worker_args.push_back( argv[i] );
 			}
-			else if( strcmp( arg, "r" ) == 0 || strcmp( arg, "run" ) == 0 )
+			else if( i+1 < argc )
 			{
-				if( i+1 < argc )
+				const char * value( argv[i+1] );
+				bool consumed( true );
+
+				if( strcmp( arg, "r" ) == 0 || strcmp( arg, "run" ) == 0 )
+				{
+					run_id = atoi( value );
+				}
+				else if( strcmp( arg, "movie" ) == 0 )
+				{
+					movie = value;
+					worker_args.push_back( argv[i] );
+					worker_args.push_back( value );
+				}
+				else if( strcmp( arg, "j" ) == 0 || strcmp( arg, "jobs" ) == 0 )
+				{
+					num_jobs = Max( atoi( value ), 1 );
+				}
+				else if( strcmp( arg, "dls" ) == 0 )
+				{
+					gMaxDLs = atoi( value );
+					worker_args.push_back( argv[i] );
+					worker_args.push_back( value );
+				}
+				else if( strcmp( arg, "vbls" ) == 0 )
+				{
+					gMaxVblsWithoutDL = atoi( value );
+					worker_args.push_back( argv[i] );
+					worker_args.push_back( value );
+				}
+				else if( strcmp( arg, "timeout" ) == 0 )
+				{
+					gBatchTimeLimit = f32( atof( value ) );
+					worker_args.push_back( argv[i] );
+					worker_args.push_back( value );
+				}
+				else if( strcmp( arg, "worker" ) == 0 )
+				{
+					worker_rom = value;
+				}
+				else
+				{
+					consumed = false;
+				}
+
+				if( consumed )
 				{
 					++i;	// Consume next arg
-					run_id = atoi( argv[i] );
 				}
 			}
 		}
@@ -176,10 +534,10 @@ void BatchTestMain( int argc, char* argv[] )
 	IO::Filename rundir;
 	if( run_id < 0 )
 	{
-		if( !MakeRunDirectory( rundir, batchdir ) )
+		if( !MakeRunDirectory( rundir, batchdir, &run_id ) )
 		{
 			printf( "Couldn't start a new run\n" );
-			return;
+			return 1;
 		}
 	}
 	else
@@ -188,23 +546,65 @@ void BatchTestMain( int argc, char* argv[] )
 		if( !IO::Directory::IsDirectory( rundir ) )
 		{
 			printf( "Couldn't resume run %d\n", run_id );
-			return;
+			return 1;
 		}
 	}
 
 	gBatchTestEventHandler = new CBatchTestEventHandler();
 
 	IO::Filename logpath;
-	MakeNewLogFilename( logpath, rundir );
+	if( worker_rom != NULL )
+	{
+		MakeRomLogFilename( logpath, rundir, worker_rom, ".log" );
+	}
+	else
+	{
+		MakeNewLogFilename( logpath, rundir );
+	}
 	gBatchFH = fopen(logpath, "w");
 	if( !gBatchFH )
 	{
 		printf( "Unable to open '%s' for writing", logpath );
-		return;
+		return 1;
 	}
 
 	std::vector< std::string > roms;
-	MakeRomList( romdir, roms );
+	if( worker_rom != NULL )
+	{
+		roms.push_back( worker_rom );
+	}
+	else
+	{
+		MakeRomList( romdir, roms );
+	}
+
+	// When replaying a movie, only run the rom it was recorded with.
+	if( movie != NULL )
+	{
+		RomID	movie_rom_id( InputMovie_GetRomID( movie ) );
+		if( movie_rom_id.Empty() )
+		{
+			printf( "Couldn't read input movie '%s'\n", movie );
+			return 1;
+		}
+
+		std::vector< std::string > movie_roms;
+		for( u32 i = 0; i < roms.size(); ++i )
+		{
+			RomID		id;
+			u32			rom_size;
+			ECicType	boot_type;
+			if( ROM_GetRomDetailsByFilename( roms[i].c_str(), &id, &rom_size, &boot_type ) && id == movie_rom_id )
+			{
+				movie_roms.push_back( roms[i] );
+				break;
+			}
+		}
+		roms.swap( movie_roms );
+
+		fprintf( gBatchFH, "Replaying input movie %s\n", movie );
+		InputMovie_StartReplay( movie );
+	}
 
 	u64 time;
 	if( NTiming::GetPreciseTime( &time ) )
@@ -212,19 +612,10 @@ void BatchTestMain( int argc, char* argv[] )
 
 	CTimer	timer;
 
-	//	Set up an assert hook to capture all asserts
-	SetAssertHook( BatchAssertHook );
-
-	// Hook in our Vbl handler.
-	CPU_RegisterVblCallback( &BatchVblHandler, NULL );
-
-	IO::Filename tmpfilepath;
-	IO::Path::Combine( tmpfilepath, rundir, "tmp.tmp" );
-
+	// Skip roms which already have results, unless we're updating them.
+	std::vector< std::string > pending;
 	while( !roms.empty() )
 	{
-		gBatchTestEventHandler->Reset();
-
 		u32 idx( 0 );
 
 		// Picking roms in a random order means we can work around roms which crash the emulator a little more easily
@@ -235,79 +626,99 @@ void BatchTestMain( int argc, char* argv[] )
 		r.swap( roms[idx] );
 		roms.erase( roms.begin() + idx );
 
-		// Make a filename of the form: '<rundir>/<romfilename>.txt'
 		IO::Filename rom_logpath;
-		IO::Path::Combine( rom_logpath, rundir, IO::Path::FindFileName( r.c_str() ) );
-		IO::Path::SetExtension( rom_logpath, ".txt" );
-
-		bool	result_exists( IO::File::Exists( rom_logpath ) );
+		MakeRomLogFilename( rom_logpath, rundir, r.c_str(), ".txt" );
 
-		if( !update_results && result_exists )
+		if( !update_results && IO::File::Exists( rom_logpath ) )
 		{
 			// Already exists, skip
 			fprintf( gBatchFH, "\n\n%#.3f: Skipping %s - log already exists\n", timer.GetElapsedSecondsSinceReset(), r.c_str() );
 		}
 		else
 		{
-			fprintf( gBatchFH, "\n\n%#.3f: Processing: %s\n", timer.GetElapsedSecondsSinceReset(), r.c_str() );
+			pending.push_back( r );
+		}
+	}
 
-			gRomLogFH = fopen( tmpfilepath, "w" );
-			if( !gRomLogFH )
-			{
-				fprintf( gBatchFH, "#%.3f: Unable to open temp file\n", timer.GetElapsedSecondsSinceReset() );
-			}
-			else
-			{
-				fflush( gBatchFH );
+	int result( 0 );
 
-				// TODO: use ROM_GetRomDetailsByFilename and the alternative form of ROM_LoadFile with overridden preferences (allows us to test if roms break by changing prefs)
-				System_Open( r.c_str() );
+#ifdef DAEDALUS_BATCH_TEST_WORKERS
+	if( num_jobs > 1 && worker_rom == NULL )
+	{
+		IO::Filename summarypath;
+		IO::Path::Combine( summarypath, rundir, "summary.csv" );
+		FILE * summary_fh( fopen( summarypath, "w" ) );
+		if( !summary_fh )
+		{
+			printf( "Unable to open '%s' for writing", summarypath );
+			return 1;
+		}
 
-				CPU_Run();
+		// Workers append to this run rather than starting their own.
+		char run_arg[16];
+		sprintf( run_arg, "%d", run_id );
+		worker_args.push_back( "-run" );
+		worker_args.push_back( run_arg );
 
-				System_Close();
+		IO::Filename exe;
+		if( !GetExecutablePath( exe, argv[0] ) )
+		{
+			printf( "Couldn't find the executable to start workers with\n" );
+			return 1;
+		}
 
-				const char * reason( CBatchTestEventHandler::GetTerminationReasonString( gBatchTestEventHandler->GetTerminationReason() ) );
+		// Workers pop from the back, so reverse to keep the requested order.
+		std::reverse( pending.begin(), pending.end() );
+		RunWorkers( exe, pending, worker_args, num_jobs, movie == NULL, rundir, summary_fh, timer );
 
-				fprintf( gBatchFH, "%#.3f: Finished running: %s - %s\n", timer.GetElapsedSecondsSinceReset(), r.c_str(), reason );
+		fclose( summary_fh );
+	}
+	else
+#endif
+	{
+		//	Set up an assert hook to capture all asserts
+		SetAssertHook( BatchAssertHook );
 
-				// Copy temp file over rom_logpath
-				gBatchTestEventHandler->PrintSummary( gRomLogFH );
-				fclose( gRomLogFH );
-				gRomLogFH = NULL;
-				if( result_exists )
-				{
-					IO::File::Delete( rom_logpath );
-				}
-				if( !IO::File::Move( tmpfilepath, rom_logpath ) )
-				{
-					fprintf( gBatchFH, "%#.3f: Coping %s -> %s failed\n", timer.GetElapsedSecondsSinceReset(), tmpfilepath, rom_logpath );
-				}
-			}
+		// Hook in our Vbl handler.
+		CPU_RegisterVblCallback( &BatchVblHandler, NULL );
+
+		for( u32 i = 0; i < pending.size(); ++i )
+		{
+			IO::Filename rom_logpath;
+			MakeRomLogFilename( rom_logpath, rundir, pending[i].c_str(), ".txt" );
 
+			CBatchTestEventHandler::ETerminationReason reason( ProcessRom( pending[i].c_str(), rundir, IO::File::Exists( rom_logpath ), timer ) );
+
+			if( worker_rom != NULL )
+			{
+				result = TerminationReasonToExitCode( reason );
+				WriteWorkerTimings( rundir, worker_rom );
+			}
 		}
 
+		CPU_UnregisterVblCallback( &BatchVblHandler, NULL );
+		SetAssertHook( NULL );
 	}
 
-	CPU_UnregisterVblCallback( &BatchVblHandler, NULL );
-	SetAssertHook( NULL );
+	if( movie != NULL )
+	{
+		InputMovie_Stop();
+	}
 
 	fclose( gBatchFH );
 	gBatchFH = NULL;
 
 	delete gBatchTestEventHandler;
 	gBatchTestEventHandler = NULL;
-}
 
-// Should make these configurable
-const u32 MAX_DLS = 10;
-const u32 MAX_VBLS_WITHOUT_DL = 1000;
-const f32 BATCH_TIME_LIMIT = 60.0f;
+	return result;
+}
 
 CBatchTestEventHandler::CBatchTestEventHandler()
 :	mNumDisplayListsCompleted( 0 )
 ,	mNumVerticalBlanksSinceDisplayList( 0 )
 ,	mTerminationReason( TR_UNKNOWN )
+,	mLastVerticalBlankTime( 0 )
 {
 
 }
@@ -319,6 +730,8 @@ void CBatchTestEventHandler::Reset()
 	mTimer.Reset();
 	mTerminationReason = TR_UNKNOWN;
 	mAsserts.clear();
+	mLastVerticalBlankTime = 0;
+	mFrameTimes.clear();
 }
 
 void CBatchTestEventHandler::Terminate( ETerminationReason reason )
@@ -331,7 +744,12 @@ void CBatchTestEventHandler::OnDisplayListComplete()
 {
 	++mNumDisplayListsCompleted;
 	mNumVerticalBlanksSinceDisplayList = 0;
-	if( MAX_DLS != 0 && mNumDisplayListsCompleted >= MAX_DLS )
+
+	// Movies run to completion.
+	if( InputMovie_GetMode() == IMM_REPLAY )
+		return;
+
+	if( gMaxDLs != 0 && mNumDisplayListsCompleted >= gMaxDLs )
 	{
 		Terminate( TR_REACHED_DL_COUNT );
 	}
@@ -339,13 +757,35 @@ void CBatchTestEventHandler::OnDisplayListComplete()
 
 void CBatchTestEventHandler::OnVerticalBlank()
 {
+	u64		now;
+	u64		freq;
+	if( NTiming::GetPreciseTime( &now ) && NTiming::GetPreciseFrequency( &freq ) )
+	{
+		if( mLastVerticalBlankTime != 0 )
+		{
+			mFrameTimes.push_back( f32( now - mLastVerticalBlankTime ) * 1000.0f / f32( freq ) );
+		}
+		mLastVerticalBlankTime = now;
+	}
+
 	++mNumVerticalBlanksSinceDisplayList;
-	if( mNumVerticalBlanksSinceDisplayList > MAX_VBLS_WITHOUT_DL )
+
+	if( mNumVerticalBlanksSinceDisplayList > gMaxVblsWithoutDL )
 	{
 		Terminate( TR_TOO_MANY_VBLS_WITH_NO_DL );
 	}
 
-	if( mTimer.GetElapsedSecondsSinceReset() > BATCH_TIME_LIMIT )
+	// Movies aren't subject to the time limit.
+	if( InputMovie_GetMode() == IMM_REPLAY )
+	{
+		if( InputMovie_IsFinished() )
+		{
+			Terminate( TR_INPUT_MOVIE_FINISHED );
+		}
+		return;
+	}
+
+	if( mTimer.GetElapsedSecondsSinceReset() > gBatchTimeLimit )
 	{
 		Terminate( TR_TIME_LIMIT_REACHED );
 	}
@@ -384,6 +824,7 @@ const char * CBatchTestEventHandler::GetTerminationReasonString( ETerminationRea
 	{
 	case TR_UNKNOWN:						return "Unknown";
 	case TR_REACHED_DL_COUNT:				return "Reached display list count";
+	case TR_INPUT_MOVIE_FINISHED:			return "Input movie finished";
 	case TR_TIME_LIMIT_REACHED:				return "Time limit reached";
 	case TR_TOO_MANY_VBLS_WITH_NO_DL:		return "Too many vertical blanks without a display list";
 	}
@@ -399,7 +840,43 @@ void CBatchTestEventHandler::PrintSummary( FILE * fh )
 
 	fprintf( fh, "\n\nSummary:\n--------\n\n" );
 	fprintf( fh, "Termination Reason: [%s] - %s\n", success ? " OK " : "FAIL", reason );
-	fprintf( fh, "Display Lists Completed: %d / %d\n", mNumDisplayListsCompleted, MAX_DLS );
+	fprintf( fh, "Display Lists Completed: %d / %d\n", mNumDisplayListsCompleted, gMaxDLs );
+
+	if( InputMovie_GetMode() == IMM_REPLAY )
+	{
+		fprintf( fh, "Input Movie Desyncs: %d\n", InputMovie_GetNumDesyncs() );
+	}
+
+	SFrameTimeStats	stats;
+	if( GetFrameTimeStats( &stats ) )
+	{
+		fprintf( fh, "Frames: %d\n", stats.NumFrames );
+		fprintf( fh, "Frame Time (ms): mean %.3f, min %.3f, median %.3f, 95th %.3f, max %.3f\n",
+			stats.MeanMs, stats.MinMs, stats.MedianMs, stats.P95Ms, stats.MaxMs );
+	}
+}
+
+bool CBatchTestEventHandler::GetFrameTimeStats( SFrameTimeStats * stats ) const
+{
+	if( mFrameTimes.empty() )
+		return false;
+
+	std::vector<f32>	sorted( mFrameTimes );
+	std::sort( sorted.begin(), sorted.end() );
+
+	f32		total( 0.0f );
+	for( u32 i = 0; i < sorted.size(); ++i )
+	{
+		total += sorted[i];
+	}
+
+	stats->NumFrames = sorted.size();
+	stats->MeanMs    = total / sorted.size();
+	stats->MinMs     = sorted.front();
+	stats->MedianMs  = sorted[ sorted.size() / 2 ];
+	stats->P95Ms     = sorted[ ( sorted.size() * 95 ) / 100 ];
+	stats->MaxMs     = sorted.back();
+	return true;
 }
 
 
@@ -34,6 +34,7 @@ public:
 	{
 		TR_UNKNOWN						= -1,
 		TR_REACHED_DL_COUNT				= 0,
+		TR_INPUT_MOVIE_FINISHED			= 1,
 		TR_TIME_LIMIT_REACHED			= 0x80000000,
 		TR_TOO_MANY_VBLS_WITH_NO_DL,
 	};
@@ -52,6 +53,19 @@ public:
 
 	void				PrintSummary( FILE * fh );
 
+	struct SFrameTimeStats
+	{
+		u32		NumFrames;
+		f32		MeanMs;
+		f32		MinMs;
+		f32		MedianMs;
+		f32		P95Ms;
+		f32		MaxMs;
+	};
+
+	// Returns false if no frames were timed.
+	bool				GetFrameTimeStats( SFrameTimeStats * stats ) const;
+
 	static const char * GetTerminationReasonString( ETerminationReason reason );
 
 private:
@@ -60,11 +74,14 @@ private:
 	u32					mNumVerticalBlanksSinceDisplayList;
 	ETerminationReason	mTerminationReason;
 
+	u64					mLastVerticalBlankTime;
+	std::vector<f32>	mFrameTimes;			// Milliseconds between vertical blanks
+
 	std::vector<u32>	mAsserts;
 };
 
 CBatchTestEventHandler * BatchTest_GetHandler();
 
-void BatchTestMain( int argc, char* argv[] );
+int BatchTestMain( int argc, char* argv[] );
 
 #endif
@@ -0,0 +1,198 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Config/ConfigOptions.h"
+#include "Core/CPU.h"
+#include "Core/ROM.h"
+#include "HLEGraphics/TnLCache.h"
+#include "Math/MathUtil.h"
+#include "OSHLE/ultra_R4300.h"
+#include "System/System.h"
+
+bool	gBenchmarkRunning = false;
+
+namespace
+{
+	u32					sTargetVbls( 0 );
+	u32					sNumVbls( 0 );
+	u64					sLastVblTime( 0 );
+	u32					sLastCount( 0 );
+	u64					sEmulatedCycles( 0 );
+	u64					sCategoryTicks[ NUM_BENCHMARK_CATEGORIES ];
+	std::vector<u64>	sFrameTicks;
+	std::vector<u64>	sGPUTimes;
+
+	void BenchmarkVblHandler( void * arg )
+	{
+		u64		now;
+		NTiming::GetPreciseTime( &now );
+
+		// COUNT advances COUNTER_INCREMENT_PER_OP per instruction (and over skipped idle loops).
+		// Unsigned arithmetic handles it wrapping.
+		u32		count( gCPUState.CPUControl[C0_COUNT]._u32 );
+
+		if( sNumVbls > 0 )
+		{
+			sFrameTicks.push_back( now - sLastVblTime );
+			sEmulatedCycles += count - sLastCount;
+		}
+		else
+		{
+			// Don't count startup in any of the timings.
+			for( u32 i = 0; i < NUM_BENCHMARK_CATEGORIES; ++i )
+			{
+				sCategoryTicks[i] = 0;
+			}
+			sGPUTimes.clear();
+			TnLCache_ResetStats();
+		}
+
+		sLastVblTime = now;
+		sLastCount = count;
+
+		if( ++sNumVbls > sTargetVbls )
+		{
+			CPU_Halt( "Benchmark complete" );
+		}
+	}
+
+	f64 TicksToMs( u64 ticks, u64 freq )
+	{
+		return f64( ticks ) * 1000.0 / f64( freq );
+	}
+
+	f64 Percentile( const std::vector<u64> & sorted, u32 percent, u64 freq )
+	{
+		size_t	idx( Min< size_t >( ( sorted.size() * percent ) / 100, sorted.size() - 1 ) );
+		return TicksToMs( sorted[ idx ], freq );
+	}
+}
+
+void Benchmark_AddTime( EBenchmarkCategory category, u64 ticks )
+{
+	sCategoryTicks[ category ] += ticks;
+}
+
+void Benchmark_AddGPUTime( u64 nanoseconds )
+{
+	sGPUTimes.push_back( nanoseconds );
+}
+
+bool Benchmark_Run( const char * filename, u32 num_vbls, FILE * fh )
+{
+	u64		freq;
+	if( num_vbls == 0 || !NTiming::GetPreciseFrequency( &freq ) )
+		return false;
+
+	sTargetVbls = num_vbls;
+	sNumVbls = 0;
+	sEmulatedCycles = 0;
+	sFrameTicks.clear();
+	sFrameTicks.reserve( num_vbls );
+	sGPUTimes.clear();
+
+	if( !System_Open( filename ) )
+	{
+		fprintf( stderr, "Couldn't open '%s'\n", filename );
+		System_Close();
+		return false;
+	}
+
+	CPU_RegisterVblCallback( &BenchmarkVblHandler, NULL );
+	gBenchmarkRunning = true;
+	CPU_Run();
+	gBenchmarkRunning = false;
+	CPU_UnregisterVblCallback( &BenchmarkVblHandler, NULL );
+
+	const std::string	game_name( g_ROM.settings.GameName.c_str() );
+	System_Close();
+
+	if( sFrameTicks.empty() )
+		return false;
+
+	u64		total_ticks( 0 );
+	for( size_t i = 0; i < sFrameTicks.size(); ++i )
+	{
+		total_ticks += sFrameTicks[i];
+	}
+
+	std::vector<u64>	sorted( sFrameTicks );
+	std::sort( sorted.begin(), sorted.end() );
+
+	const f64	seconds( f64( total_ticks ) / f64( freq ) );
+	const f64	dl_fraction( f64( sCategoryTicks[ BC_DISPLAY_LIST ] ) / f64( total_ticks ) );
+	const f64	audio_fraction( f64( sCategoryTicks[ BC_AUDIO ] ) / f64( total_ticks ) );
+
+	fprintf( fh, "{\n" );
+	fprintf( fh, "  \"rom\": \"%s\",\n", game_name.c_str() );
+	fprintf( fh, "  \"vbls\": %u,\n", u32( sFrameTicks.size() ) );
+	fprintf( fh, "  \"seconds\": %.3f,\n", seconds );
+	fprintf( fh, "  \"vi_per_second\": %.2f,\n", f64( sFrameTicks.size() ) / seconds );
+	fprintf( fh, "  \"instructions_per_second\": %.0f,\n", f64( sEmulatedCycles / COUNTER_INCREMENT_PER_OP ) / seconds );
+	fprintf( fh, "  \"frame_ms\": { \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f },\n",
+		TicksToMs( total_ticks, freq ) / sFrameTicks.size(),
+		Percentile( sorted, 50, freq ), Percentile( sorted, 90, freq ), Percentile( sorted, 99, freq ),
+		TicksToMs( sorted.back(), freq ) );
+	fprintf( fh, "  \"time_split\": { \"cpu\": %.4f, \"display_list\": %.4f, \"audio\": %.4f },\n",
+		Max( 1.0 - dl_fraction - audio_fraction, 0.0 ), dl_fraction, audio_fraction );
+	fprintf( fh, "  \"internal_scale\": %u,\n", gInternalResolutionScale );
+	fprintf( fh, "  \"msaa_samples\": %u", gInternalResolutionSamples );
+
+	// The saving is estimated from the average cost per vertex of loads which missed.
+	STnLCacheStats	tnl;
+	TnLCache_GetStats( &tnl );
+	if( tnl.Hits + tnl.Misses > 0 )
+	{
+		const f64	miss_ticks_per_vert( tnl.MissVerts > 0 ? f64( tnl.MissTicks ) / f64( tnl.MissVerts ) : 0.0 );
+		const f64	saved_ticks( f64( tnl.HitVerts ) * miss_ticks_per_vert - f64( tnl.HitTicks ) );
+
+		fprintf( fh, ",\n  \"tnl_cache\": { \"hits\": %u, \"misses\": %u, \"hit_rate\": %.4f, \"saved_ms\": %.3f }",
+			tnl.Hits, tnl.Misses, f64( tnl.Hits ) / f64( tnl.Hits + tnl.Misses ),
+			saved_ticks * 1000.0 / f64( freq ) );
+	}
+
+	// Per display list, as measured on the GPU. Not all renderers can measure this.
+	if( !sGPUTimes.empty() )
+	{
+		const u64	ns_freq( 1000000000 );
+		u64			total_gpu( 0 );
+		for( size_t i = 0; i < sGPUTimes.size(); ++i )
+		{
+			total_gpu += sGPUTimes[i];
+		}
+
+		std::vector<u64>	sorted_gpu( sGPUTimes );
+		std::sort( sorted_gpu.begin(), sorted_gpu.end() );
+
+		fprintf( fh, ",\n  \"gpu_ms\": { \"lists\": %u, \"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f }",
+			u32( sorted_gpu.size() ), TicksToMs( total_gpu, ns_freq ) / sorted_gpu.size(),
+			Percentile( sorted_gpu, 50, ns_freq ), Percentile( sorted_gpu, 90, ns_freq ), Percentile( sorted_gpu, 99, ns_freq ),
+			TicksToMs( sorted_gpu.back(), ns_freq ) );
+	}
+	fprintf( fh, "\n" );
+	fprintf( fh, "}\n" );
+	return true;
+}
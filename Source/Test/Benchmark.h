@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef TEST_BENCHMARK_H_
+#define TEST_BENCHMARK_H_
+
+#include <stdio.h>
+
+#include "Utility/Timing.h"
+
+//
+//	Runs a rom headless and unthrottled for a fixed number of vertical blanks
+//	and writes the timings out as JSON, for tracking performance across builds.
+//
+
+enum EBenchmarkCategory
+{
+	BC_DISPLAY_LIST,
+	BC_AUDIO,
+	NUM_BENCHMARK_CATEGORIES,
+};
+
+bool	Benchmark_Run( const char * filename, u32 num_vbls, FILE * fh );
+
+extern bool	gBenchmarkRunning;
+void	Benchmark_AddTime( EBenchmarkCategory category, u64 ticks );
+
+// GPU time for a single display list, for renderers that can measure it.
+void	Benchmark_AddGPUTime( u64 nanoseconds );
+
+// Accumulates the time spent in a scope while a benchmark is running.
+class CBenchmarkScope
+{
+public:
+	explicit CBenchmarkScope( EBenchmarkCategory category )
+		: mCategory( category )
+		, mStart( 0 )
+	{
+		if( gBenchmarkRunning )
+			NTiming::GetPreciseTime( &mStart );
+	}
+
+	~CBenchmarkScope()
+	{
+		if( mStart != 0 )
+		{
+			u64		now;
+			NTiming::GetPreciseTime( &now );
+			Benchmark_AddTime( mCategory, now - mStart );
+		}
+	}
+
+private:
+	EBenchmarkCategory	mCategory;
+	u64					mStart;
+};
+
+#endif // TEST_BENCHMARK_H_
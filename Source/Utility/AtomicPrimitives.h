@@ -84,14 +84,12 @@ inline u32 AtomicBitSet( volatile u32 * ptr, u32 and_bits, u32 or_bits )
 
 inline u32 AtomicIncrement( volatile u32 * ptr )
 {
-	DAEDALUS_ASSERT(false, "FIXME");
-	return *ptr++;
+	return __sync_add_and_fetch( ptr, 1 );
 }
 
 inline u32 AtomicDecrement( volatile u32 * ptr )
 {
-	DAEDALUS_ASSERT(false, "FIXME");
-	return *ptr--;
+	return __sync_sub_and_fetch( ptr, 1 );
 }
 
 inline u32 AtomicBitSet( volatile u32 * ptr, u32 and_bits, u32 or_bits )
@@ -20,9 +20,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "FramerateLimiter.h"
 
+#include "Utility/Frameskip.h"
 #include "Utility/Timing.h"
 #include "Utility/Thread.h"
 
+#include "Config/ConfigOptions.h"
 #include "Core/Memory.h"
 #include "Core/ROM.h"
 
@@ -34,6 +36,7 @@ static u32				gVblsSinceFlip = 0;				// The number of vertical blanks that have
 static u32				gCurrentAverageTicksPerVbl = 0;
 static FramerateSyncFn 	gAuxSyncFn = NULL;
 static void *			gAuxSyncArg = NULL;
+static u64				gAuxSyncTicks = 0;				// Time spent in gAuxSyncFn since the last flip
 
 static const u32		gTvFrequencies[] =
 {
@@ -54,8 +57,11 @@ bool FramerateLimiter_Reset()
 
 	gLastVITime = 0;
 	gLastOrigin = 0;
+	gAuxSyncTicks = 0;
 	gVblsSinceFlip = 0;
 
+	Frameskip_Reset();
+
 	//gAuxSyncFn  = NULL;	// Should we reset this? Will audio re-init?
 	//gAuxSyncArg = NULL;
 
@@ -95,7 +101,12 @@ void FramerateLimiter_Limit()
 
 	if (gAuxSyncFn)
 	{
+		// The audio sync sleeps, so time it to keep it out of the frame cost.
+		u64 sync_start, sync_end;
+		NTiming::GetPreciseTime(&sync_start);
 		gAuxSyncFn(gAuxSyncArg);
+		NTiming::GetPreciseTime(&sync_end);
+		gAuxSyncTicks += sync_end - sync_start;
 	}
 
 	if( current_origin == gLastOrigin )
@@ -108,7 +119,15 @@ void FramerateLimiter_Limit()
 
 	gCurrentAverageTicksPerVbl = FramerateLimiter_UpdateAverageTicksPerVbl( elapsed_ticks / gVblsSinceFlip );
 
-	if( gSpeedSyncEnabled && !gAuxSyncFn )
+	// gLastVITime is taken after any delay below, and the time spent in the aux sync
+	// is taken off, so this is the cost of the frame alone.
+	if( gLastVITime != 0 )
+	{
+		u64 sync_ticks = gAuxSyncTicks < elapsed_ticks ? gAuxSyncTicks : elapsed_ticks;
+		Frameskip_EndFrame( elapsed_ticks - sync_ticks, u64( gTicksBetweenVbls ) * gVblsSinceFlip );
+	}
+
+	if( gSpeedSyncEnabled && !gAuxSyncFn && !gHeadlessMode )
 	{
 		u32 required_ticks = gTicksBetweenVbls * gVblsSinceFlip;
 
@@ -128,6 +147,7 @@ void FramerateLimiter_Limit()
 	gLastOrigin = current_origin;
 	gLastVITime = now;
 	gVblsSinceFlip = 0;
+	gAuxSyncTicks = 0;
 }
 
 f32	FramerateLimiter_GetSync()
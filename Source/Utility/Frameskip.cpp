@@ -0,0 +1,154 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+#include "stdafx.h"
+#include "Utility/Frameskip.h"
+
+#include "Math/Math.h"
+#include "Math/MathUtil.h"
+#include "Utility/Timing.h"
+
+namespace
+{
+
+const f32	kSmoothing				= 0.125f;	// Weight given to the latest frame
+const u32	kMaxConsecutiveSkips	= 3;		// Always show at least one frame in this many
+const u32	kWarmupFrames			= 8;		// Frames to measure before we trust the estimates
+
+f32			gCPUTicks = 0.f;
+f32			gRenderTicks = 0.f;
+f32			gErrorTicks = 0.f;				// Smoothed absolute error of the prediction
+f32			gDeadlineTicks = 0.f;
+f32			gSkipRate = 0.f;
+
+u64			gPendingRenderTicks = 0;
+bool		gRenderedThisFrame = false;
+u32			gConsecutiveSkips = 0;
+u32			gFramesMeasured = 0;
+bool		gSkipNextFrame = false;
+
+u32			gFramesRendered = 0;
+u32			gFramesSkipped = 0;
+
+inline void Smooth( f32 & estimate, f32 value )
+{
+	estimate += (value - estimate) * kSmoothing;
+}
+
+f32 TicksToMs( f32 ticks )
+{
+	u64 freq;
+	if( !NTiming::GetPreciseFrequency( &freq ) || freq == 0 )
+		return 0.f;
+
+	return ticks * 1000.f / f32( freq );
+}
+
+}
+
+void Frameskip_Reset()
+{
+	gCPUTicks = 0.f;
+	gRenderTicks = 0.f;
+	gErrorTicks = 0.f;
+	gDeadlineTicks = 0.f;
+	gSkipRate = 0.f;
+
+	gPendingRenderTicks = 0;
+	gRenderedThisFrame = false;
+	gConsecutiveSkips = 0;
+	gFramesMeasured = 0;
+	gSkipNextFrame = false;
+
+	gFramesRendered = 0;
+	gFramesSkipped = 0;
+}
+
+void Frameskip_AddRenderTime( u64 ticks )
+{
+	gPendingRenderTicks += ticks;
+	gRenderedThisFrame = true;
+}
+
+void Frameskip_EndFrame( u64 frame_ticks, u64 deadline_ticks )
+{
+	const f32 render = f32( Min( gPendingRenderTicks, frame_ticks ) );
+	const f32 cpu    = f32( frame_ticks ) - render;
+
+	if( gRenderedThisFrame )
+	{
+		++gFramesRendered;
+		gConsecutiveSkips = 0;
+
+		if( gFramesMeasured > 0 )
+		{
+			Smooth( gErrorTicks, Abs( f32( frame_ticks ) - (gCPUTicks + gRenderTicks) ) );
+			Smooth( gRenderTicks, render );
+		}
+		else
+		{
+			gRenderTicks = render;
+		}
+		Smooth( gSkipRate, 0.f );
+	}
+	else
+	{
+		// Skipped frames only tell us about the CPU cost - the render estimate stays
+		// where it was until we render again.
+		++gFramesSkipped;
+		++gConsecutiveSkips;
+		Smooth( gSkipRate, 1.f );
+	}
+
+	if( gFramesMeasured > 0 )
+	{
+		Smooth( gCPUTicks, cpu );
+		Smooth( gDeadlineTicks, f32( deadline_ticks ) );
+	}
+	else
+	{
+		gCPUTicks = cpu;
+		gDeadlineTicks = f32( deadline_ticks );
+	}
+	++gFramesMeasured;
+
+	gPendingRenderTicks = 0;
+	gRenderedThisFrame = false;
+
+	// Allow for the usual frame to frame variation, so we skip before we're late rather than after.
+	const f32 predicted = gCPUTicks + gRenderTicks + gErrorTicks;
+
+	gSkipNextFrame = gFramesMeasured >= kWarmupFrames &&
+					 gConsecutiveSkips < kMaxConsecutiveSkips &&
+					 predicted > gDeadlineTicks;
+}
+
+bool Frameskip_ShouldSkipNextFrame()
+{
+	return gSkipNextFrame;
+}
+
+void Frameskip_GetStats( SFrameskipStats * stats )
+{
+	stats->FramesRendered = gFramesRendered;
+	stats->FramesSkipped  = gFramesSkipped;
+	stats->CPUMs          = TicksToMs( gCPUTicks );
+	stats->RenderMs       = TicksToMs( gRenderTicks );
+	stats->DeadlineMs     = TicksToMs( gDeadlineTicks );
+	stats->SkipRate       = gSkipRate;
+}
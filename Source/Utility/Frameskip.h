@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef UTILITY_FRAMESKIP_H_
+#define UTILITY_FRAMESKIP_H_
+
+#include "Utility/DaedalusTypes.h"
+
+//
+//	Adaptive frameskip. The cost of each frame is split into the time spent
+//	rendering display lists and everything else (CPU, audio, etc.), and tracked
+//	against the time the N64 had to produce it. When the next frame is predicted
+//	to miss its deadline, only its rendering is skipped - the game itself keeps
+//	running in real time.
+//
+
+// Called by FramerateLimiter_Reset.
+void		Frameskip_Reset();
+
+// Time spent processing a display list which was rendered.
+void		Frameskip_AddRenderTime( u64 ticks );
+
+// Called on each flip, with the time taken to produce the frame (not including any
+// time spent waiting for sync) and the time the N64 would have taken.
+void		Frameskip_EndFrame( u64 frame_ticks, u64 deadline_ticks );
+
+// True if the next frame is predicted to miss its deadline if it's rendered.
+bool		Frameskip_ShouldSkipNextFrame();
+
+struct SFrameskipStats
+{
+	u32		FramesRendered;
+	u32		FramesSkipped;
+	f32		CPUMs;				// Smoothed estimates for a single frame
+	f32		RenderMs;
+	f32		DeadlineMs;
+	f32		SkipRate;			// Smoothed fraction of recent frames which were skipped
+};
+
+void		Frameskip_GetStats( SFrameskipStats * stats );
+
+#endif // UTILITY_FRAMESKIP_H_
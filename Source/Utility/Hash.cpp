@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "Utility/Hash.h"
 
+#include <string.h>
+
 //-----------------------------------------------------------------------------
 // MurmurHash2, by Austin Appleby
 // Note - This code makes a few assumptions about how your machine behaves -
@@ -132,3 +134,52 @@ unsigned int murmur2_neutral_hash ( const void * key, int len, unsigned int seed
 
 	return h;
 }
+
+//-----------------------------------------------------------------------------
+// MurmurHash64A, by Austin Appleby
+// 64-bit hash for 64-bit platforms. Like murmur2_hash, the result depends on
+// the machine's endianness.
+
+unsigned long long murmur2_64_hash ( const void * key, int len, unsigned long long seed )
+{
+	const unsigned long long m = 0xc6a4a7935bd1e995ULL;
+	const int r = 47;
+
+	unsigned long long h = seed ^ (len * m);
+
+	const unsigned char * data = (const unsigned char *)key;
+
+	while(len >= 8)
+	{
+		unsigned long long k;
+		memcpy( &k, data, sizeof( k ) );
+
+		k *= m;
+		k ^= k >> r;
+		k *= m;
+
+		h ^= k;
+		h *= m;
+
+		data += 8;
+		len -= 8;
+	}
+
+	switch(len)
+	{
+	case 7: h ^= (unsigned long long)data[6] << 48;
+	case 6: h ^= (unsigned long long)data[5] << 40;
+	case 5: h ^= (unsigned long long)data[4] << 32;
+	case 4: h ^= (unsigned long long)data[3] << 24;
+	case 3: h ^= (unsigned long long)data[2] << 16;
+	case 2: h ^= (unsigned long long)data[1] << 8;
+	case 1: h ^= (unsigned long long)data[0];
+	        h *= m;
+	};
+
+	h ^= h >> r;
+	h *= m;
+	h ^= h >> r;
+
+	return h;
+}
@@ -24,5 +24,6 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 unsigned int murmur2_hash ( const void * key, int len, unsigned int seed );
 unsigned int murmur2_neutral_hash ( const void * key, int len, unsigned int seed );
+unsigned long long murmur2_64_hash ( const void * key, int len, unsigned long long seed );
 
 #endif // UTILITY_HASH_H_
@@ -38,7 +38,16 @@ namespace IO
 #ifdef DAEDALUS_PSP
 		int			Stat( const char *p_file, SceIoStat *stat );
 #endif
-
+		// Returns the size and modification time of a file. The time is only
+		// meaningful for comparing against another value returned by this function.
+		bool		GetInfo( const char * p_file, u32 * p_size, u64 * p_mtime );
+
+#ifndef DAEDALUS_PSP
+		// Maps the whole file into memory copy-on-write, i.e. writes to the
+		// mapping are private to this process. Returns NULL on failure.
+		void *		Map( const char * p_file, u32 * p_size );
+		void		Unmap( void * p_data, u32 size );
+#endif
 	}
 	namespace Directory
 	{
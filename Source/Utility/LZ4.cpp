@@ -0,0 +1,236 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "Utility/LZ4.h"
+
+#include <string.h>
+
+#include "Math/MathUtil.h"
+
+//
+//	Each sequence is a token byte (literal count in the high nibble, match
+//	length - 4 in the low nibble), optional extra length bytes, the literals,
+//	a little endian 16 bit offset and optional extra match length bytes.
+//	The final sequence is literals only. See lz4_Block_format.md upstream.
+//
+
+namespace
+{
+	const u32 MIN_MATCH			= 4;
+	const u32 LAST_LITERALS		= 5;	// The last 5 bytes are always literals
+	const u32 MF_LIMIT			= 12;	// The last match must start at least 12 bytes before the end
+	const u32 HASH_LOG			= 12;
+	const u32 SKIP_TRIGGER		= 6;	// Step faster through incompressible data
+
+	inline u32 Read32( const u8 * p )
+	{
+		u32 v;
+		memcpy( &v, p, sizeof( v ) );
+		return v;
+	}
+
+	inline u32 HashSequence( u32 v )
+	{
+		return ( v * 2654435761U ) >> ( 32 - HASH_LOG );
+	}
+
+	inline u8 * WriteLength( u8 * op, u32 length )
+	{
+		while( length >= 255 )
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = u8( length );
+		return op;
+	}
+
+	inline bool ReadLength( const u8 *& ip, const u8 * iend, u32 * length )
+	{
+		u32 s;
+		do
+		{
+			if( ip >= iend )
+				return false;
+			s = *ip++;
+			*length += s;
+		}
+		while( s == 255 );
+		return true;
+	}
+
+	inline u8 * WriteLiterals( u8 * op, u8 * token, const u8 * literals, u32 count )
+	{
+		*token = u8( Min< u32 >( count, 15 ) << 4 );
+		if( count >= 15 )
+		{
+			op = WriteLength( op, count - 15 );
+		}
+		memcpy( op, literals, count );
+		return op + count;
+	}
+}
+
+u32 LZ4_CompressBlock( const void * src, u32 src_size, void * dst, u32 dst_capacity )
+{
+	DAEDALUS_ASSERT( src_size <= LZ4_MAX_BLOCK_SIZE, "Block is too large" );
+
+	// Checking against the bound up front keeps bounds checks out of the inner loop.
+	if( dst_capacity < LZ4_CompressBound( src_size ) )
+		return 0;
+
+	const u8 * const	base( reinterpret_cast< const u8 * >( src ) );
+	const u8 * const	iend( base + src_size );
+	const u8 *			ip( base );
+	const u8 *			anchor( base );
+	u8 * const			ostart( reinterpret_cast< u8 * >( dst ) );
+	u8 *				op( ostart );
+
+	if( src_size > MF_LIMIT )
+	{
+		const u8 * const	mflimit( iend - MF_LIMIT );
+		const u8 * const	matchlimit( iend - LAST_LITERALS );
+
+		// Offsets into a 64KB block fit in 16 bits. Stale or zeroed entries are rejected by the compare below.
+		u16		table[ 1 << HASH_LOG ];
+		memset( table, 0, sizeof( table ) );
+
+		u32		misses( 0 );
+		ip++;
+		while( ip <= mflimit )
+		{
+			const u32	sequence( Read32( ip ) );
+			const u32	h( HashSequence( sequence ) );
+			const u8 *	ref( base + table[ h ] );
+			table[ h ] = u16( ip - base );
+
+			if( ref >= ip || Read32( ref ) != sequence )
+			{
+				ip += 1 + ( misses++ >> SKIP_TRIGGER );
+				continue;
+			}
+			misses = 0;
+
+			// Grow the match backwards into the pending literals, then forwards.
+			while( ip > anchor && ref > base && ip[ -1 ] == ref[ -1 ] )
+			{
+				ip--;
+				ref--;
+			}
+
+			const u8 *	mp( ip + MIN_MATCH );
+			const u8 *	rp( ref + MIN_MATCH );
+			while( mp < matchlimit && *mp == *rp )
+			{
+				mp++;
+				rp++;
+			}
+
+			u8 *		token( op++ );
+			op = WriteLiterals( op, token, anchor, u32( ip - anchor ) );
+
+			const u32	offset( u32( ip - ref ) );
+			*op++ = u8( offset );
+			*op++ = u8( offset >> 8 );
+
+			const u32	match_length( u32( mp - ip ) - MIN_MATCH );
+			*token |= u8( Min< u32 >( match_length, 15 ) );
+			if( match_length >= 15 )
+			{
+				op = WriteLength( op, match_length - 15 );
+			}
+
+			ip = mp;
+			anchor = ip;
+
+			if( ip <= mflimit )
+			{
+				table[ HashSequence( Read32( ip - 2 ) ) ] = u16( ip - 2 - base );
+			}
+		}
+	}
+
+	u8 *	token( op++ );
+	op = WriteLiterals( op, token, anchor, u32( iend - anchor ) );
+
+	return u32( op - ostart );
+}
+
+bool LZ4_DecompressBlock( const void * src, u32 src_size, void * dst, u32 dst_size )
+{
+	const u8 *			ip( reinterpret_cast< const u8 * >( src ) );
+	const u8 * const	iend( ip + src_size );
+	u8 * const			ostart( reinterpret_cast< u8 * >( dst ) );
+	u8 * const			oend( ostart + dst_size );
+	u8 *				op( ostart );
+
+	while( ip < iend )
+	{
+		const u32	token( *ip++ );
+
+		u32			literal_length( token >> 4 );
+		if( literal_length == 15 && !ReadLength( ip, iend, &literal_length ) )
+			return false;
+
+		if( literal_length > u32( iend - ip ) || literal_length > u32( oend - op ) )
+			return false;
+
+		memcpy( op, ip, literal_length );
+		op += literal_length;
+		ip += literal_length;
+
+		// The final sequence has no match.
+		if( ip >= iend )
+			break;
+
+		if( iend - ip < 2 )
+			return false;
+
+		const u32	offset( ip[ 0 ] | ( ip[ 1 ] << 8 ) );
+		ip += 2;
+		if( offset == 0 || offset > u32( op - ostart ) )
+			return false;
+
+		u32			match_length( token & 15 );
+		if( match_length == 15 && !ReadLength( ip, iend, &match_length ) )
+			return false;
+		match_length += MIN_MATCH;
+
+		if( match_length > u32( oend - op ) )
+			return false;
+
+		const u8 *	ref( op - offset );
+		if( offset >= match_length )
+		{
+			memcpy( op, ref, match_length );
+			op += match_length;
+		}
+		else
+		{
+			// Overlapping matches replicate the last 'offset' bytes.
+			for( u32 i = 0; i < match_length; ++i )
+			{
+				*op++ = *ref++;
+			}
+		}
+	}
+
+	return op == oend;
+}
@@ -0,0 +1,43 @@
+/*
+Copyright (C) 2014 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef UTILITY_LZ4_H_
+#define UTILITY_LZ4_H_
+
+//
+//	A small, fast compressor which emits the LZ4 block format.
+//	It trades ratio for speed, so it's suited to large, frequently
+//	written buffers like save states, where zlib is far too slow.
+//
+
+// Blocks are limited to 64KB so that match offsets always fit in 16 bits.
+static const u32 LZ4_MAX_BLOCK_SIZE = 64 * 1024;
+
+// Worst case compressed size for a block of the specified size.
+inline u32 LZ4_CompressBound( u32 size )		{ return size + size / 255 + 16; }
+
+// Returns the number of bytes written to dst, or 0 if dst is too small.
+u32		LZ4_CompressBlock( const void * src, u32 src_size, void * dst, u32 dst_capacity );
+
+// Returns false if the data is corrupt or doesn't decompress to exactly dst_size bytes.
+bool	LZ4_DecompressBlock( const void * src, u32 src_size, void * dst, u32 dst_size );
+
+#endif // UTILITY_LZ4_H_
@@ -0,0 +1,66 @@
+#include <stdafx.h>
+#include "Utility/LZ4.h"
+
+#include <string.h>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+static void RoundTrip( const std::vector<u8> & src )
+{
+	std::vector<u8> compressed( LZ4_CompressBound( src.size() ) );
+	std::vector<u8> decompressed( src.size() + 1 );
+
+	u32 compressed_size = LZ4_CompressBlock( src.empty() ? NULL : &src[0], src.size(), &compressed[0], compressed.size() );
+	ASSERT_NE(0u, compressed_size);
+	ASSERT_TRUE(LZ4_DecompressBlock( &compressed[0], compressed_size, &decompressed[0], src.size() ));
+	EXPECT_EQ(0, memcmp( src.empty() ? NULL : &src[0], &decompressed[0], src.size() ));
+
+	// Asking for the wrong size must fail rather than overrun.
+	EXPECT_FALSE(LZ4_DecompressBlock( &compressed[0], compressed_size, &decompressed[0], src.size() + 1 ));
+}
+
+TEST(LZ4, RoundTripsSmallBlocks)
+{
+	for (u32 len = 0; len < 40; ++len)
+	{
+		std::vector<u8> src( len );
+		for (u32 i = 0; i < len; ++i)
+			src[i] = u8(i % 3);
+		RoundTrip( src );
+	}
+}
+
+TEST(LZ4, CompressesRepetitiveData)
+{
+	std::vector<u8> src( LZ4_MAX_BLOCK_SIZE, 0 );
+	for (u32 i = 0; i < src.size(); i += 64)
+		src[i] = u8(i >> 6);
+
+	std::vector<u8> compressed( LZ4_CompressBound( src.size() ) );
+	u32 compressed_size = LZ4_CompressBlock( &src[0], src.size(), &compressed[0], compressed.size() );
+	EXPECT_LT(compressed_size, src.size() / 8);
+	RoundTrip( src );
+}
+
+TEST(LZ4, RoundTripsIncompressibleData)
+{
+	std::vector<u8> src( LZ4_MAX_BLOCK_SIZE );
+	u32 seed = 0x12345678;
+	for (u32 i = 0; i < src.size(); ++i)
+	{
+		seed = seed * 1664525 + 1013904223;
+		src[i] = u8(seed >> 24);
+	}
+	RoundTrip( src );
+}
+
+TEST(LZ4, RejectsTruncatedInput)
+{
+	std::vector<u8> src( 4096, 0xAB );
+	std::vector<u8> compressed( LZ4_CompressBound( src.size() ) );
+	std::vector<u8> decompressed( src.size() );
+
+	u32 compressed_size = LZ4_CompressBlock( &src[0], src.size(), &compressed[0], compressed.size() );
+	EXPECT_FALSE(LZ4_DecompressBlock( &compressed[0], compressed_size - 1, &decompressed[0], src.size() ));
+}
@@ -586,6 +586,7 @@ const char * Preferences_GetFrameskipDescription( EFrameskipValue value )
 	case FV_7:				return "7";
 	case FV_8:				return "8";
 	case FV_9:				return "9";
+	case FV_ADAPTIVE:		return "Adaptive";
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	case FV_99:				return "99";
 #endif
@@ -63,6 +63,7 @@ enum EFrameskipValue
 	FV_7,
 	FV_8,
 	FV_9,
+	FV_ADAPTIVE,		// Skip rendering only when the next frame is predicted to miss its deadline
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	FV_99,
 #endif
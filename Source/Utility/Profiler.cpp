@@ -8,13 +8,13 @@
 #ifdef DAEDALUS_ENABLE_PROFILING
 
 #include "Debug/DBGConsole.h"
+#include "Utility/Mutex.h"
 #include "Utility/Timing.h"
-#include "Utility/Hash.h"
+
+#include <string.h>
 
 #include <vector>
 #include <string>
-#include <stack>
-#include <set>
 #include <map>
 #include <algorithm>
 
@@ -25,87 +25,83 @@ static u64 GetNow()
 	return now;
 }
 
-class CProfileItem
+// Make sure a record is fully written before it's published to the reader.
+static inline void WriteBarrier()
 {
-	public:
-		typedef std::vector< CProfileItem * > ItemVector;
-
-		CProfileItem( const char * p_str )
-			:	mName( p_str )
-		{
-		}
+#if defined( _MSC_VER )
+	_ReadWriteBarrier();
+#elif defined( __GNUC__ )
+	__sync_synchronize();
+#endif
+}
 
-		inline const char *			GetName() const				{ return mName.c_str(); }
+// Make sure a record is fully read before checking whether it was overwritten.
+static inline void ReadBarrier()
+{
+#if defined( _MSC_VER )
+	_ReadWriteBarrier();
+#elif defined( __GNUC__ )
+	__sync_synchronize();
+#endif
+}
 
-	private:
-		std::string					mName;
-};
+static const u32	kMaxItems			= 1024;
+static const u32	kMaxThreads			= 16;
+static const u32	kMaxDepth			= 64;
+static const u32	kRecordsPerThread	= 64 * 1024;		// Must be a power of two
+static const u32	kMaxTraceRecords	= 4 * 1024 * 1024;
 
-inline u32 ComputeCallstackHash( const std::vector< CProfileItem * > & items )
+inline u32 CombineCallstackHash( u32 parent_hash, u32 item )
 {
-	if( items.empty() )
-		return 0;
-
-	return murmur2_hash( reinterpret_cast< const u8 * >( &items[0] ), items.size() * sizeof( CProfileItem * ), 0 );
+	return ( ( parent_hash << 5 ) + parent_hash + item + 1 ) * 0x9E3779B1;
 }
 
-class CProfileCallstack
+struct SProfileRecord
 {
-public:
-	CProfileCallstack( const CProfileCallstack * parent, const std::vector< CProfileItem * > & items )
-		:	mParent( parent )
-		,	mItems( items )
-		,	mHash( ComputeCallstackHash( items ) )
-		,	mTotalTime( 0 )
-		,	mStartTime( 0 )
-		,	mHitCount( 0 )
-	{
-	}
-
-
-	CProfileItem *	GetBack() const	{ return mItems.empty() ? NULL : mItems.back(); }
-	u32		GetDepth() const		{ return mItems.size(); }
-	bool	Empty() const			{ return mItems.empty(); }
-	void	Clear()					{ return mItems.clear(); }
-	u32		GetHash() const			{ return mHash; }
+	u32		Item;
+	u16		Depth;
+	u16		Thread;
+	u32		Hash;				// Hash of the callstack including this item
+	u32		ParentHash;
+	u64		Begin;
+	u64		End;
+};
 
-	s32		Compare( const CProfileCallstack & rhs ) const
-	{
-		u32 i;
-		for( i = 0; i < mItems.size() && i < rhs.mItems.size(); ++i )
-		{
-			s32		compare = _strcmpi( mItems[ i ]->GetName(), rhs.mItems[ i ]->GetName() );
-			if( compare != 0 )
-			{
-				return compare;
-			}
-		}
+struct SProfileStackEntry
+{
+	u32		Item;
+	u32		Hash;
+	u64		Begin;
+};
 
-		//
-		//	If both stacks are equal to this point and there are no more entries,
-		//	they must be identical.
-		//
-		if( i >= mItems.size() && i >= rhs.mItems.size() )
-			return 0;
+//
+//	Each thread owns one of these. Only that thread writes to Records and
+//	NumWritten; only the thread calling Update() touches NumRead. When the
+//	thread exits it sets Exited, and once Update() has drained what's left
+//	the slot is marked Free for the next thread to register.
+//
+struct SProfileThread
+{
+	volatile u32		NumWritten;
+	u32					NumRead;
+	volatile bool		Exited;
+	bool				Free;				// Protected by mMutex
+	u32					Index;
+	u32					Depth;
+	SProfileStackEntry	Stack[ kMaxDepth ];
+	SProfileRecord		Records[ kRecordsPerThread ];
+};
 
-		return i >= mItems.size() ? 1 : -1;
-	}
+static DAEDALUS_THREAD_LOCAL SProfileThread * tThread = NULL;
+static DAEDALUS_THREAD_LOCAL bool tThreadRejected = false;		// No slot was free - don't keep asking
 
-	inline	const CProfileCallstack *	GetParent() const	{ return mParent; }
-			void				Reset();
-	inline	void				StartTiming();
-	inline	void				StopTiming( u64 now );
-
-	inline	u64					GetTotalTime() const		{ return mTotalTime; }
-	inline	u32					GetHitCount() const			{ return mHitCount; }
-
-private:
-	const CProfileCallstack *		mParent;
-	std::vector< CProfileItem * >	mItems;
-	u32								mHash;
-	u64								mTotalTime;				// The total time accumulated since the last Reset
-	u64								mStartTime;				// The time when StartTiming() was called
-	u32								mHitCount;				// The total number of times StartTiming() has been called since the last Reset()
+struct SCallstackStats
+{
+	u32		Item;
+	u32		ParentHash;
+	u32		Depth;
+	u64		TotalTime;
+	u32		HitCount;
 };
 
 class CProfilerImpl
@@ -122,56 +118,110 @@ class CProfilerImpl
 		inline void				Enter( SProfileItemHandle handle );
 		inline void				Exit( SProfileItemHandle handle );
 
+		void					CaptureTrace( u32 num_frames, const char * filename );
+		bool					IsCapturingTrace() const		{ return mTraceFramesRemaining > 0; }
+
 	private:
-		CProfileCallstack *		GetActiveStats();
+		SProfileThread *		RegisterThread();
+		void					WriteTrace();
+		std::string				GetCallstackName( u32 hash ) const;
 
 	private:
-		typedef std::vector< CProfileItem * >			ProfileItemList;
-		typedef std::stack< CProfileItem * >			ProfileItemStack;
+		const char *			mItems[ kMaxItems ];
+		volatile u32			mNumItems;
 
-		std::vector< CProfileItem * >	mActiveItems;
-		std::vector< CProfileCallstack * >	mActiveCallstacks;
+		SProfileThread *		mThreads[ kMaxThreads ];
+		volatile u32			mNumThreads;
 
-		typedef std::map< u32, CProfileCallstack * >	CallstackStatsMap;
-		CallstackStatsMap		mCallstackStatsMap;
+		Mutex					mMutex;					// Only taken when adding items or threads
 
+		typedef std::map< u32, SCallstackStats >	CallstackStatsMap;
+		CallstackStatsMap		mCallstackStatsMap;
+		u64						mLastUpdateTime;
+		u64						mFrameTime;
+		u32						mDroppedRecords;
 		f32						mFrequencyInv;
-		ProfileItemList			mItems;
+
+		std::vector< SProfileRecord >	mTraceRecords;
+		std::vector< u64 >				mTraceFrames;
+		std::string						mTraceFilename;
+		u32								mTraceFramesRemaining;
 };
 
 
 CProfilerImpl::CProfilerImpl()
+:	mNumItems( 0 )
+,	mNumThreads( 0 )
+,	mMutex( "Profiler" )
+,	mLastUpdateTime( GetNow() )
+,	mFrameTime( 0 )
+,	mDroppedRecords( 0 )
+,	mTraceFramesRemaining( 0 )
 {
 	u64	frequency;
 	NTiming::GetPreciseFrequency( &frequency );
 	mFrequencyInv = 1.0f / float( frequency );
-
-	SProfileItemHandle	root_item = AddItem( "<root>" );
-	Enter( root_item );
 }
 
 CProfilerImpl::~CProfilerImpl()
 {
-	for( ProfileItemList::iterator it = mItems.begin(); it != mItems.end(); ++it )
+	for( u32 i = 0; i < mNumThreads; ++i )
 	{
-		CProfileItem * item = *it;
-		delete item;
+		delete mThreads[ i ];
 	}
 }
 
 SProfileItemHandle CProfilerImpl::AddItem( const char * p_str )
 {
-	// Create a new item
-	SProfileItemHandle	handle( mItems.size() );
-	CProfileItem *		p_item = new CProfileItem( p_str );
+	MutexLock lock( &mMutex );
+
+	DAEDALUS_ASSERT( mNumItems < kMaxItems, "Too many profile items" );
+	if( mNumItems >= kMaxItems )
+		return SProfileItemHandle( 0 );
 
-	mItems.push_back( p_item );
+	SProfileItemHandle	handle( mNumItems );
+	mItems[ mNumItems ] = p_str;
+	mNumItems++;
 
 	return handle;
 }
 
-void CProfilerImpl::Display()
+SProfileThread * CProfilerImpl::RegisterThread()
 {
+	MutexLock lock( &mMutex );
+
+	// Reuse the slot of a thread which has exited. The counts carry on from where
+	// that thread left off, so Update() doesn't need to know the owner changed.
+	for( u32 i = 0; i < mNumThreads; ++i )
+	{
+		SProfileThread * thread = mThreads[ i ];
+		if( thread->Free )
+		{
+			thread->Free = false;
+			thread->Depth = 0;
+			return thread;
+		}
+	}
+
+	if( mNumThreads >= kMaxThreads )
+	{
+		DAEDALUS_ERROR( "Too many profiled threads" );
+		return NULL;
+	}
+
+	SProfileThread * thread = new SProfileThread;
+	thread->NumWritten = 0;
+	thread->NumRead = 0;
+	thread->Exited = false;
+	thread->Free = false;
+	thread->Index = mNumThreads;
+	thread->Depth = 0;
+
+	mThreads[ mNumThreads ] = thread;
+	WriteBarrier();
+	mNumThreads++;
+
+	return thread;
 }
 
 static void Pad( char * str, u32 length )
@@ -197,30 +247,105 @@ static void Pad( char * str, u32 length )
 	}
 }
 
-struct SortByCallstack
+std::string CProfilerImpl::GetCallstackName( u32 hash ) const
 {
-	bool operator()( const CProfileCallstack * a, const CProfileCallstack * b )
+	std::string	name;
+	CallstackStatsMap::const_iterator it = mCallstackStatsMap.find( hash );
+	while( it != mCallstackStatsMap.end() )
 	{
-		return a->Compare( *b ) > 0;
+		name = std::string( mItems[ it->second.Item ] ) + "/" + name;
+		it = mCallstackStatsMap.find( it->second.ParentHash );
 	}
-};
+	return name;
+}
 
+struct SortByName
+{
+	bool operator()( const std::pair< std::string, const SCallstackStats * > & a,
+					 const std::pair< std::string, const SCallstackStats * > & b ) const
+	{
+		return _strcmpi( a.first.c_str(), b.first.c_str() ) < 0;
+	}
+};
 
 void CProfilerImpl::Update()
 {
-	DAEDALUS_ASSERT( mActiveCallstacks.size() == mActiveItems.size(), "Why are there different numbers of callstacks/items?" );
-
 	u64 now = GetNow();
-	for( u32 i = 0; i < mActiveCallstacks.size(); ++i )
+	mFrameTime = now - mLastUpdateTime;
+	mLastUpdateTime = now;
+
+	for( CallstackStatsMap::iterator it = mCallstackStatsMap.begin(); it != mCallstackStatsMap.end(); ++it )
 	{
-		mActiveCallstacks[ i ]->StopTiming( now );
+		it->second.TotalTime = 0;
+		it->second.HitCount = 0;
+	}
+
+	// Drain everything written since the last update.
+	u32	num_threads = mNumThreads;
+	for( u32 t = 0; t < num_threads; ++t )
+	{
+		SProfileThread * thread = mThreads[ t ];
+		bool exited = thread->Exited;
+		ReadBarrier();
+		u32	num_written = thread->NumWritten;
+		ReadBarrier();
+
+		// If the writer has lapped us, skip the records that were overwritten.
+		if( num_written - thread->NumRead > kRecordsPerThread )
+		{
+			mDroppedRecords += num_written - thread->NumRead - kRecordsPerThread;
+			thread->NumRead = num_written - kRecordsPerThread;
+		}
+
+		for( ; thread->NumRead != num_written; ++thread->NumRead )
+		{
+			SProfileRecord	record = thread->Records[ thread->NumRead & ( kRecordsPerThread - 1 ) ];
+			ReadBarrier();
+
+			// The writer may have come round and started overwriting this slot while we were copying it.
+			if( thread->NumWritten - thread->NumRead >= kRecordsPerThread )
+			{
+				mDroppedRecords++;
+				continue;
+			}
+
+			CallstackStatsMap::iterator it = mCallstackStatsMap.find( record.Hash );
+			if( it == mCallstackStatsMap.end() )
+			{
+				SCallstackStats	stats = { record.Item, record.ParentHash, record.Depth, 0, 0 };
+				it = mCallstackStatsMap.insert( std::make_pair( record.Hash, stats ) ).first;
+			}
+			it->second.TotalTime += record.End - record.Begin;
+			it->second.HitCount++;
+
+			if( mTraceFramesRemaining > 0 && mTraceRecords.size() < kMaxTraceRecords )
+			{
+				mTraceRecords.push_back( record );
+			}
+		}
+
+		// Everything the thread wrote before exiting has been read, so the slot can go.
+		if( exited )
+		{
+			MutexLock lock( &mMutex );
+			thread->Exited = false;
+			thread->Free = true;
+		}
 	}
 
-	u64 total_root_time = 0;
-	if( mActiveCallstacks.size() > 0 )
+	if( mTraceFramesRemaining > 0 )
 	{
-		total_root_time = mActiveCallstacks[ 0 ]->GetTotalTime();
+		mTraceFrames.push_back( now );
+		if( --mTraceFramesRemaining == 0 )
+		{
+			WriteTrace();
+		}
 	}
+}
+
+void CProfilerImpl::Display()
+{
+	const u64	frame_time = mFrameTime;
 
 	const char * const TERMINAL_SAVE_CURSOR			= "\033[s";
 //	const char * const TERMINAL_RESTORE_CURSOR		= "\033[u";
@@ -232,17 +357,16 @@ void CProfilerImpl::Update()
 	printf( TERMINAL_SAVE_CURSOR );
 	printf( TERMINAL_TOP_LEFT );
 
-	std::vector< const CProfileCallstack * >	active_callstacks;
+	std::vector< std::pair< std::string, const SCallstackStats * > >	active_callstacks;
 	for( CallstackStatsMap::const_iterator it = mCallstackStatsMap.begin(); it != mCallstackStatsMap.end(); ++it )
 	{
-		const CProfileCallstack * callstack = it->second;
-		if( callstack->GetHitCount() > 0 )
+		if( it->second.HitCount > 0 )
 		{
-			active_callstacks.push_back( callstack );
+			active_callstacks.push_back( std::make_pair( GetCallstackName( it->first ), &it->second ) );
 		}
 	}
 
-	std::sort( active_callstacks.begin(), active_callstacks.end(), SortByCallstack() );
+	std::sort( active_callstacks.begin(), active_callstacks.end(), SortByName() );
 
 	//       0         1         2         3         4         5         6         7         8
 	//       012345678901234567890123456789012345678901234567890123456789012345678901234567890123456789
@@ -250,152 +374,203 @@ void CProfilerImpl::Update()
 
 	for( u32 i = 0; i < active_callstacks.size(); ++i )
 	{
-		const CProfileCallstack * callstack = active_callstacks[ i ];
+		const SCallstackStats & stats = *active_callstacks[ i ].second;
 
-		u64 parent_time = 0;
-		if ( const CProfileCallstack * parent = callstack->GetParent() )
+		u64 parent_time = frame_time;
+		CallstackStatsMap::const_iterator parent_it = mCallstackStatsMap.find( stats.ParentHash );
+		if( stats.Depth > 0 && parent_it != mCallstackStatsMap.end() )
 		{
-			parent_time = parent->GetTotalTime();
+			parent_time = parent_it->second.TotalTime;
 		}
 
-		u32		hit_count = callstack->GetHitCount();
-
 		// Display details on this item
-		u32		depth = callstack->GetDepth();
-		u32		total_us = u32( callstack->GetTotalTime() * 1000.0f * 1000.0f * mFrequencyInv );
+		u32		depth = stats.Depth;
+		u32		total_us = u32( stats.TotalTime * 1000.0f * 1000.0f * mFrequencyInv );
 
 		f32		percent_parent_time = 0;
 		f32		percent_total_time = 0;
 
 		if( parent_time != 0 )
 		{
-			percent_parent_time = 100.0f * f32( callstack->GetTotalTime() ) / f32( parent_time );
+			percent_parent_time = 100.0f * f32( stats.TotalTime ) / f32( parent_time );
 		}
-		if( total_root_time != 0 )
+		if( frame_time != 0 )
 		{
-			percent_total_time = 100.0f * f32( callstack->GetTotalTime() ) / f32( total_root_time );
+			percent_total_time = 100.0f * f32( stats.TotalTime ) / f32( frame_time );
 		}
 
 		char line[ 1024 ];
-		sprintf( line, "\033[2K%x%*s%s" , depth, depth, "", callstack->GetBack()->GetName() );
+		sprintf( line, "\033[2K%x%*s%s" , depth, depth, "", mItems[ stats.Item ] );
 		Pad( line, 54 );
-		printf( "%s %6.2f %6.1f%% %6.1f%% %5d%s\n", line, (f32)total_us / 1000.0f, percent_parent_time, percent_total_time, hit_count, TERMINAL_ERASE_TO_EOL );
-		//DBGConsole_Msg( 0, "%*s %s %d,%03dms (%d calls)", depth, "", p_item->GetName(), total_us / 1000, total_us % 1000, hit_count );
+		printf( "%s %6.2f %6.1f%% %6.1f%% %5d%s\n", line, (f32)total_us / 1000.0f, percent_parent_time, percent_total_time, stats.HitCount, TERMINAL_ERASE_TO_EOL );
+	}
+
+	if( mDroppedRecords > 0 )
+	{
+		printf( "\033[2K%d records dropped%s\n", mDroppedRecords, TERMINAL_ERASE_TO_EOL );
+		mDroppedRecords = 0;
 	}
 
 	printf( "<*>");
-	//printf( "\033[2K----------------\n%s\n", TERMINAL_ERASE_TO_EOS );
-	//printf( TERMINAL_RESTORE_CURSOR );
 	fflush( stdout );
+}
 
-	for( CallstackStatsMap::iterator it = mCallstackStatsMap.begin(); it != mCallstackStatsMap.end(); ++it )
-	{
-		CProfileCallstack *	callstack = it->second;
-		callstack->Reset();
-	}
+void CProfilerImpl::CaptureTrace( u32 num_frames, const char * filename )
+{
+	mTraceRecords.clear();
+	mTraceFrames.clear();
+	mTraceFilename = filename;
+	mTraceFramesRemaining = num_frames;
 
-	for( u32 i = 0; i < mActiveCallstacks.size(); ++i )
+	DBGConsole_Msg( 0, "Capturing %d frames to [C%s]", num_frames, filename );
+}
+
+static void WriteJsonString( FILE * fh, const char * str )
+{
+	fputc( '"', fh );
+	for( ; *str; ++str )
 	{
-		mActiveCallstacks[ i ]->StartTiming();
+		if( *str == '"' || *str == '\\' )
+			fputc( '\\', fh );
+		fputc( *str, fh );
 	}
+	fputc( '"', fh );
 }
 
-CProfileCallstack * CProfilerImpl::GetActiveStats()
+//
+//	Writes the Trace Event Format, which chrome://tracing and Perfetto both load.
+//	Timestamps are in microseconds, relative to the first frame of the capture.
+//
+void CProfilerImpl::WriteTrace()
 {
-	u32 callstack_hash = ComputeCallstackHash( mActiveItems );
-	CallstackStatsMap::iterator	it = mCallstackStatsMap.find( callstack_hash );
+	FILE * fh = fopen( mTraceFilename.c_str(), "w" );
+	if( fh == NULL )
+	{
+		DBGConsole_Msg( 0, "Couldn't open [C%s] for writing", mTraceFilename.c_str() );
+		return;
+	}
 
-	CProfileCallstack *	callstack;
-	if( it == mCallstackStatsMap.end() )
+	u64	origin = mTraceFrames.empty() ? 0 : mTraceFrames[ 0 ];
+	for( u32 i = 0; i < mTraceRecords.size(); ++i )
 	{
-		CProfileCallstack *	parent_callstack( mActiveCallstacks.empty() ? NULL : mActiveCallstacks.back() );
+		origin = std::min( origin, mTraceRecords[ i ].Begin );
+	}
+	const f64	us_per_tick = 1000000.0 * mFrequencyInv;
+
+	fprintf( fh, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
 
-		callstack = new CProfileCallstack( parent_callstack, mActiveItems );
-		mCallstackStatsMap[ callstack_hash ] = callstack;
+	for( u32 t = 0; t < mNumThreads; ++t )
+	{
+		fprintf( fh, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}},\n", t, t );
 	}
-	else
+
+	for( u32 i = 0; i < mTraceFrames.size(); ++i )
 	{
-		callstack = it->second;
+		fprintf( fh, "{\"name\":\"Frame %d\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%.3f},\n",
+			i, f64( mTraceFrames[ i ] - origin ) * us_per_tick );
 	}
 
-	return callstack;
+	for( u32 i = 0; i < mTraceRecords.size(); ++i )
+	{
+		const SProfileRecord & record = mTraceRecords[ i ];
+
+		fprintf( fh, "{\"name\":" );
+		WriteJsonString( fh, mItems[ record.Item ] );
+		fprintf( fh, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}%s\n",
+			record.Thread,
+			f64( record.Begin - origin ) * us_per_tick,
+			f64( record.End - record.Begin ) * us_per_tick,
+			i + 1 < mTraceRecords.size() ? "," : "" );
+	}
+
+	fprintf( fh, "]}\n" );
+	fclose( fh );
+
+	DBGConsole_Msg( 0, "Wrote %d trace events to [C%s]", mTraceRecords.size(), mTraceFilename.c_str() );
+
+	mTraceRecords.clear();
+	mTraceFrames.clear();
 }
 
 // Start profiling for an item
 void CProfilerImpl::Enter( SProfileItemHandle handle )
 {
-	DAEDALUS_ASSERT( handle.Handle < mItems.size(), "Invalid handle!" );
-	DAEDALUS_ASSERT( mActiveCallstacks.size() == mActiveItems.size(), "Why are there different numbers of callstacks/items?" );
-
-	CProfileItem * item = mItems[ handle.Handle ];
+	DAEDALUS_ASSERT( handle.Handle < mNumItems, "Invalid handle!" );
 
-	mActiveItems.push_back( item );
+	SProfileThread * thread = tThread;
+	if( thread == NULL )
+	{
+		if( tThreadRejected )
+			return;
 
-	CProfileCallstack * callstack = GetActiveStats();
+		thread = tThread = RegisterThread();
+		if( thread == NULL )
+		{
+			tThreadRejected = true;
+			return;
+		}
+	}
 
-	mActiveCallstacks.push_back( callstack );
+	if( thread->Depth >= kMaxDepth )
+	{
+		DAEDALUS_ERROR( "Item stack overflow" );
+		return;
+	}
 
-	callstack->StartTiming();
+	u32 parent_hash = thread->Depth > 0 ? thread->Stack[ thread->Depth - 1 ].Hash : 0;
 
-	DAEDALUS_ASSERT( mActiveCallstacks.size() == mActiveItems.size(), "Why are there different numbers of callstacks/items?" );
+	SProfileStackEntry & entry = thread->Stack[ thread->Depth++ ];
+	entry.Item = handle.Handle;
+	entry.Hash = CombineCallstackHash( parent_hash, handle.Handle );
+	entry.Begin = GetNow();
 }
 
 // Stop profiling for an item
 void CProfilerImpl::Exit( SProfileItemHandle handle )
 {
-	DAEDALUS_ASSERT( handle.Handle < mItems.size(), "Invalid handle!" );
-	DAEDALUS_ASSERT( mActiveCallstacks.size() == mActiveItems.size(), "Why are there different numbers of callstacks/items?" );
+	u64	now = GetNow();
 
-	u64				now = GetNow();
-	CProfileItem *	item = mItems[ handle.Handle ];
-
-	if( !mActiveItems.empty() )
-	{
-		if( item == mActiveItems.back() )
-		{
-			CProfileCallstack *		callstack = mActiveCallstacks.back();
-			mActiveItems.pop_back();
-			mActiveCallstacks.pop_back();
+	SProfileThread * thread = tThread;
+	if( thread == NULL )
+		return;
 
-			callstack->StopTiming( now );
-		}
-		else
-		{
-			DAEDALUS_ERROR( "Popping the wrong item" );
-		}
-	}
-	else
+	if( thread->Depth == 0 )
 	{
 		DAEDALUS_ERROR( "Item stack underflow" );
+		return;
 	}
 
-	DAEDALUS_ASSERT( mActiveCallstacks.size() == mActiveItems.size(), "Why are there different numbers of callstacks/items?" );
-}
-
-void CProfileCallstack::Reset()
-{
-	mTotalTime = 0;
-	mStartTime = 0;
-	mHitCount = 0;
-}
-
-void CProfileCallstack::StartTiming()
-{
-	DAEDALUS_ASSERT( mStartTime == 0, "Already timing - recursive?" );
+	const SProfileStackEntry & entry = thread->Stack[ --thread->Depth ];
+	if( entry.Item != handle.Handle )
+	{
+		DAEDALUS_ERROR( "Popping the wrong item" );
+		return;
+	}
 
-	mHitCount++;
-	mStartTime = GetNow();
+	u32 num_written = thread->NumWritten;
+	SProfileRecord & record = thread->Records[ num_written & ( kRecordsPerThread - 1 ) ];
+	record.Item = entry.Item;
+	record.Depth = u16( thread->Depth );
+	record.Thread = u16( thread->Index );
+	record.Hash = entry.Hash;
+	record.ParentHash = thread->Depth > 0 ? thread->Stack[ thread->Depth - 1 ].Hash : 0;
+	record.Begin = entry.Begin;
+	record.End = now;
+
+	WriteBarrier();
+	thread->NumWritten = num_written + 1;
 }
 
-void CProfileCallstack::StopTiming( u64 now )
+void CProfiler::ThreadExit()
 {
-	DAEDALUS_ASSERT( mStartTime != 0, "We're not currently timing" );
-
-	if( mStartTime != 0 )
+	SProfileThread * thread = tThread;
+	if( thread != NULL )
 	{
-		mTotalTime += now - mStartTime;
-		mStartTime = 0;
+		WriteBarrier();
+		thread->Exited = true;
+		tThread = NULL;
 	}
+	tThreadRejected = false;
 }
 
 CProfiler::CProfiler()
@@ -442,4 +617,14 @@ void CProfiler::Display()
 	mpImpl->Display();
 }
 
+void CProfiler::CaptureTrace( u32 num_frames, const char * filename )
+{
+	mpImpl->CaptureTrace( num_frames, filename );
+}
+
+bool CProfiler::IsCapturingTrace() const
+{
+	return mpImpl->IsCapturingTrace();
+}
+
 #endif // DAEDALUS_ENABLE_PROFILING
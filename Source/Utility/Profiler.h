@@ -12,6 +12,10 @@
 
 struct SProfileItemHandle;
 
+//
+//	Enter/Exit are lock free and don't allocate - each thread writes fixed size
+//	records into its own ring buffer, which Update() drains once per frame.
+//
 class CProfiler : public CSingleton< CProfiler >
 {
 	protected:
@@ -20,14 +24,23 @@ class CProfiler : public CSingleton< CProfiler >
 	public:
 		virtual ~CProfiler();
 
-		void					Display();
+		// Update() gathers the timings recorded since the last call, Display() prints them.
 		void					Update();
+		void					Display();
 
+		// p_str must outlive the profiler (it's not copied).
 		SProfileItemHandle		AddItem( const char * p_str );
 
 		void					Enter( SProfileItemHandle handle );
 		void					Exit( SProfileItemHandle handle );
 
+		// Record the next num_frames frames and write them out as a Chrome trace (chrome://tracing, Perfetto)
+		void					CaptureTrace( u32 num_frames, const char * filename );
+		bool					IsCapturingTrace() const;
+
+		// Called as each thread exits, so its slot can be reused. Safe on threads which never profiled anything.
+		static void				ThreadExit();
+
 	protected:
 		class CProfilerImpl * mpImpl;
 };
@@ -38,6 +38,7 @@ ROMFileCompressed::ROMFileCompressed( const char * filename )
 ,	mZipFile( NULL )
 ,	mFoundRom( false )
 ,	mRomSize( 0 )
+,	mRomCRC( 0 )
 {
 }
 
@@ -113,6 +114,7 @@ bool ROMFileCompressed::Open( COutputStream & messages )
 						{
 							unzCloseCurrentFile(mZipFile);
 							mRomSize = file_info.uncompressed_size;
+							mRomCRC = file_info.crc;
 							mFoundRom = true;
 							if (!SetHeaderMagic( magic ))
 							{
@@ -43,6 +43,7 @@ public:
 
 	virtual bool		IsCompressed() const			{ return true; }
 	virtual u32			GetRomSize() const				{ return mRomSize; }
+			u32			GetRomCRC() const				{ return mRomCRC; }		// CRC of the uncompressed image, from the zip directory
 	virtual bool		LoadRawData( u32 bytes_to_read, u8 *p_bytes, COutputStream & messages );
 
 	virtual bool		ReadChunk( u32 offset, u8 * p_dst, u32 length );
@@ -55,6 +56,7 @@ private:
 	unzFile				mZipFile;
 	bool				mFoundRom;
 	u32					mRomSize;
+	u32					mRomCRC;
 
 };
 
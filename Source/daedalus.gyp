@@ -7,9 +7,6 @@
         'target_name': 'daedalus_lib',
         'type': 'static_library',
         'dependencies': [
-          'SysGL/SysGL.gyp:SysGL',
-          'third_party/glew/glew.gyp:glew', # FIXME: should transitively pull in include dir
-          'third_party/glfw/glfw.gyp:glfw', # FIXME: should transitively pull in include dir
           'third_party/libpng/libpng.gyp:libpng',
           'third_party/webby/webby.gyp:webby',
           'third_party/zlib/zlib.gyp:minizip',
@@ -33,6 +30,7 @@
           'Core/DMA.cpp',
           'Core/Dynamo.cpp',
           'Core/FlashMem.cpp',
+          'Core/GuestProfiler.cpp',
           'Core/Interpret.cpp',
           'Core/Interrupts.cpp',
           'Core/JpegTask.cpp',
@@ -43,6 +41,7 @@
           'Core/ROM.cpp',
           'Core/ROMBuffer.cpp',
           'Core/ROMImage.cpp',
+          'Core/Rewind.cpp',
           'Core/RomSettings.cpp',
           'Core/RSP_HLE.cpp',
           'Core/Save.cpp',
@@ -52,12 +51,14 @@
           'Debug/DebugLog.cpp',
           'Debug/Dump.cpp',
           'DynaRec/BranchType.cpp',
+          'DynaRec/DynaRecProfile.cpp',
           'DynaRec/Fragment.cpp',
           'DynaRec/FragmentCache.cpp',
           'DynaRec/IndirectExitMap.cpp',
           'DynaRec/StaticAnalysis.cpp',
           'DynaRec/TraceRecorder.cpp',
           'Graphics/ColourValue.cpp',
+          'Graphics/FrameDump.cpp',
           'Graphics/PngUtil.cpp',
           'Graphics/TextureTransform.cpp',
           'HLEAudio/ABI1.cpp',
@@ -73,13 +74,19 @@
           'HLEGraphics/ConvertTile.cpp',
           'HLEGraphics/DLDebug.cpp',
           'HLEGraphics/DLParser.cpp',
+          'HLEGraphics/DLStats.cpp',
+          'HLEGraphics/DLStatsWebDebug.cpp',
           'HLEGraphics/Microcode.cpp',
           'HLEGraphics/RDP.cpp',
           'HLEGraphics/RDPStateManager.cpp',
+          'HLEGraphics/TexelCache.cpp',
           'HLEGraphics/TextureCache.cpp',
           'HLEGraphics/TextureCacheWebDebug.cpp',
           'HLEGraphics/TextureInfo.cpp',
+          'HLEGraphics/TexturePack.cpp',
+          'HLEGraphics/TnLCache.cpp',
           'HLEGraphics/uCodes/Ucode.cpp',
+          'Input/InputMovie.cpp',
           'Interface/RomDB.cpp',
           'Math/Matrix4x4.cpp',
           'OSHLE/OS.cpp',
@@ -88,12 +95,15 @@
           'System/Paths.cpp',
           'System/System.cpp',
           'Test/BatchTest.cpp',
+          'Test/Benchmark.cpp',
           'Utility/CRC.cpp',
           'Utility/DataSink.cpp',
           'Utility/FastMemcpy.cpp',
           'Utility/FramerateLimiter.cpp',
+          'Utility/Frameskip.cpp',
           'Utility/Hash.cpp',
           'Utility/IniFile.cpp',
+          'Utility/LZ4.cpp',
           'Utility/MemoryHeap.cpp',
           'Utility/Preferences.cpp',
           'Utility/PrintOpCode.cpp',
@@ -113,6 +123,17 @@
           'SysW32/DynaRec/x86/AssemblyUtilsX86.cpp',
         ],
         'conditions': [
+          ['renderer=="soft"', {
+            'dependencies': [
+              'SysSoft/SysSoft.gyp:SysSoft',
+            ],
+          }, {
+            'dependencies': [
+              'SysGL/SysGL.gyp:SysGL',
+              'third_party/glew/glew.gyp:glew', # FIXME: should transitively pull in include dir
+              'third_party/glfw/glfw.gyp:glfw', # FIXME: should transitively pull in include dir
+            ],
+          }],
           ['OS=="win"', {
             'sources': [
               'SysW32/HLEAudio/AudioPluginW32.cpp',
@@ -232,7 +253,9 @@
           '.',
         ],
         'sources': [
+          'DynaRec/StaticAnalysis_test.cpp',
           'Utility/FastMemcpy_test.cpp',
+          'Utility/LZ4_test.cpp',
         ],
       }
     ],